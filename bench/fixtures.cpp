@@ -0,0 +1,98 @@
+#include <algorithm>
+
+#include "fixtures.hpp"
+
+namespace bandwit {
+namespace bench {
+
+static std::string get_iface(int idx) { return "eth" + std::to_string(idx); }
+
+std::string get_last_iface(int num_ifaces) {
+    return get_iface(num_ifaces - 1);
+}
+
+std::vector<std::string> make_iface_names(int num_ifaces, int first,
+                                          int step) {
+    std::vector<std::string> names{};
+    for (int i = first; i < num_ifaces; i += step) {
+        names.push_back(get_iface(i));
+    }
+
+    return names;
+}
+
+std::vector<std::string> make_procfs_lines(int num_ifaces) {
+    // /proc/net/dev
+    std::vector<std::string> lines{
+        "Inter-|   Receive                                                |  "
+        "Transmit",
+        " face |bytes    packets errs drop fifo frame compressed multicast|"
+        "bytes    packets errs drop fifo colls carrier compressed",
+    };
+
+    for (int i = 0; i < num_ifaces; ++i) {
+        lines.push_back("  " + get_iface(i) +
+                        ": 2769428119 2386859    0    0    0     0          "
+                        "0         0 163035634 1037066    0    0    0     0 "
+                        "      0          0");
+    }
+
+    return lines;
+}
+
+std::vector<std::string> make_ip_lines(int num_ifaces) {
+    // ip -statistics link show
+    std::vector<std::string> lines{};
+
+    for (int i = 0; i < num_ifaces; ++i) {
+        lines.push_back(std::to_string(i + 2) + ": " + get_iface(i) +
+                        ": <BROADCAST,MULTICAST,UP,LOWER_UP> mtu 1500 qdisc "
+                        "fq_codel state UP mode DEFAULT group default qlen "
+                        "1000");
+        lines.emplace_back(
+            "    link/ether 02:fc:00:00:00:01 brd ff:ff:ff:ff:ff:ff");
+        lines.emplace_back(
+            "    RX:  bytes packets errors dropped  missed   mcast");
+        lines.emplace_back(
+            "    2769428119 2386859      0       0       0       0");
+        lines.emplace_back(
+            "    TX:  bytes packets errors dropped carrier collsns");
+        lines.emplace_back(
+            "     163035634 1037066      0       0       0       0");
+    }
+
+    return lines;
+}
+
+std::vector<std::string> make_netstat_lines(int num_ifaces) {
+    // netstat -ibn on FreeBSD
+    std::vector<std::string> lines{
+        "Name    Mtu Network       Address              Ipkts Ierrs Idrop     "
+        "Ibytes    Opkts Oerrs     Obytes  Coll",
+    };
+
+    for (int i = 0; i < num_ifaces; ++i) {
+        auto name = get_iface(i);
+        name.resize(std::max<std::size_t>(name.size(), 6), ' ');
+
+        lines.push_back(name +
+                        "  1500 <Link#1>      02:fc:00:00:00:01  2386859     "
+                        "0     0 2769428119  1037066     0  163035634     0");
+    }
+
+    return lines;
+}
+
+std::string join_lines(const std::vector<std::string> &lines) {
+    std::string contents{};
+
+    for (const auto &line : lines) {
+        contents.append(line);
+        contents.push_back('\n');
+    }
+
+    return contents;
+}
+
+} // namespace bench
+} // namespace bandwit
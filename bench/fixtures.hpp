@@ -0,0 +1,26 @@
+#ifndef BENCH_FIXTURES_H
+#define BENCH_FIXTURES_H
+
+#include <string>
+#include <vector>
+
+namespace bandwit {
+namespace bench {
+
+// Outputs captured from real systems, replicated for num_ifaces interfaces
+// named eth0, eth1, ... The interface to look up is always the last one,
+// which is the worst case for the parsers.
+std::vector<std::string> make_procfs_lines(int num_ifaces);
+std::vector<std::string> make_ip_lines(int num_ifaces);
+std::vector<std::string> make_netstat_lines(int num_ifaces);
+
+std::string join_lines(const std::vector<std::string> &lines);
+// the names of the interfaces of the outputs, every step-th from first on
+std::vector<std::string> make_iface_names(int num_ifaces, int first = 0,
+                                          int step = 1);
+std::string get_last_iface(int num_ifaces);
+
+} // namespace bench
+} // namespace bandwit
+
+#endif // BENCH_FIXTURES_H
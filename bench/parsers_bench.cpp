@@ -0,0 +1,94 @@
+#include <benchmark/benchmark.h>
+
+#include "fixtures.hpp"
+#include "macros.hpp"
+#include "sampling/ip_cmd_sampler.hpp"
+#include "sampling/netstat_cmd_sampler.hpp"
+#include "sampling/procfs_sampler.hpp"
+
+namespace bandwit {
+namespace bench {
+
+static void BM_ProcFsParser_parse(benchmark::State &state) {
+    auto num_ifaces = INT(state.range(0));
+    auto lines = make_procfs_lines(num_ifaces);
+    auto iface = get_last_iface(num_ifaces);
+
+    sampling::ProcFsParser parser{};
+    sampling::Counters rx{};
+    sampling::Counters tx{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse(lines, iface, &rx, &tx));
+    }
+}
+BENCHMARK(BM_ProcFsParser_parse)->Arg(1)->Arg(100)->Arg(1000);
+
+static void BM_ProcFsParser_scan(benchmark::State &state) {
+    auto num_ifaces = INT(state.range(0));
+    auto contents = join_lines(make_procfs_lines(num_ifaces));
+    auto iface = get_last_iface(num_ifaces);
+
+    sampling::ProcFsParser parser{};
+    sampling::Counters rx{};
+    sampling::Counters tx{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.scan(contents, iface, &rx, &tx));
+    }
+}
+BENCHMARK(BM_ProcFsParser_scan)->Arg(1)->Arg(100)->Arg(1000);
+
+// A pass of a bulk sampler under --adaptive: every iface by the same names
+// every time, or as it was, a different half of them as the ifaces that are
+// due come and go, which rebuilds the index every time
+static void BM_ProcFsParser_scan_all(benchmark::State &state) {
+    auto num_ifaces = INT(state.range(0));
+    bool is_changing = state.range(1) != 0;
+    auto contents = join_lines(make_procfs_lines(num_ifaces));
+    auto all_names = make_iface_names(num_ifaces);
+    std::vector<std::vector<std::string>> due_names{
+        make_iface_names(num_ifaces, 0, 2), make_iface_names(num_ifaces, 1, 2)};
+
+    sampling::ProcFsParser parser{};
+    sampling::InterfaceIndex index{};
+    std::vector<sampling::Sample> samples{};
+    std::size_t pass{0};
+    for (auto _ : state) {
+        const auto &names = is_changing ? due_names[pass++ % 2] : all_names;
+        index.update(names);
+        samples.resize(names.size());
+        parser.scan_all(contents, index, &samples);
+        benchmark::DoNotOptimize(samples.data());
+    }
+}
+BENCHMARK(BM_ProcFsParser_scan_all)->Args({1000, 0})->Args({1000, 1});
+
+static void BM_IpStatsParser_parse(benchmark::State &state) {
+    auto num_ifaces = INT(state.range(0));
+    auto output = join_lines(make_ip_lines(num_ifaces));
+    auto iface = get_last_iface(num_ifaces);
+
+    sampling::IpStatsParser parser{};
+    sampling::Counters rx{};
+    sampling::Counters tx{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse(output, iface, &rx, &tx));
+    }
+}
+BENCHMARK(BM_IpStatsParser_parse)->Arg(1)->Arg(100)->Arg(1000);
+
+static void BM_NetstatStatsParser_parse(benchmark::State &state) {
+    auto num_ifaces = INT(state.range(0));
+    auto output = join_lines(make_netstat_lines(num_ifaces));
+    auto iface = get_last_iface(num_ifaces);
+
+    sampling::NetstatStatsParser parser{};
+    sampling::Counters rx{};
+    sampling::Counters tx{};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parser.parse(output, iface, &rx, &tx));
+    }
+}
+BENCHMARK(BM_NetstatStatsParser_parse)->Arg(1)->Arg(100)->Arg(1000);
+
+} // namespace bench
+} // namespace bandwit
@@ -0,0 +1,347 @@
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <memory>
+#include <new>
+#include <pty.h>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "sampling/time_series.hpp"
+#include "termui/bar_chart.hpp"
+#include "termui/file_status.hpp"
+#include "termui/memory_terminal_driver.hpp"
+#include "termui/terminal_surface.hpp"
+#include "termui/terminal_window.hpp"
+#include "termui/tty_terminal_driver.hpp"
+
+// Every allocation of the bench binary is counted, so that the drawing
+// benchmarks can tell how many a frame takes. Not inlined, so that the
+// compiler does not pair up the malloc() and free() inside of them.
+static std::atomic<std::size_t> num_allocs{0};
+
+[[gnu::noinline]] void *operator new(std::size_t size) {
+    num_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (auto *ptr = malloc(size > 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { free(ptr); }
+
+[[gnu::noinline]] void operator delete(void *ptr, std::size_t) noexcept {
+    free(ptr);
+}
+
+namespace bandwit {
+namespace bench {
+
+// A terminal that nobody looks at: the output goes to a pty whose master end
+// is drained by a thread, and the cursor query on startup is answered from a
+// pipe. This way the whole output path is exercised, down to write(2).
+class NullTerminal {
+  public:
+    explicit NullTerminal(termui::Dimensions dim) {
+        struct winsize size {};
+        size.ws_col = dim.width;
+        size.ws_row = dim.height;
+
+        if (openpty(&master_fd_, &slave_fd_, nullptr, nullptr, &size) < 0) {
+            THROW_CERROR(std::runtime_error,
+                         "NullTerminal failed in openpty()");
+        }
+
+        int fds[2];
+        if (pipe(fds) < 0) {
+            THROW_CERROR(std::runtime_error, "NullTerminal failed in pipe()");
+        }
+
+        // the replies to the cursor position queries of the capabilities
+        // probe and of the window, the surface starts on the 5th line
+        const char reply[] = "\033[5;1R\033[5;1R";
+        if (write(fds[1], reply, sizeof(reply) - 1) < 0) {
+            THROW_CERROR(std::runtime_error, "NullTerminal failed in write()");
+        }
+        close(fds[1]);
+
+        stdin_file_ = fdopen(fds[0], "r");
+        stdout_file_ = fdopen(slave_fd_, "w");
+
+        drainer_ = std::thread{[this]() { drain(); }};
+
+        status_setter_ =
+            termui::FileStatusSet{}.status_off(O_NONBLOCK).build_setter(
+                fds[0]);
+        driver_ = std::make_unique<termui::TtyTerminalDriver>(
+            stdin_file_, stdout_file_, status_setter_.get());
+        window_ = std::make_unique<termui::TerminalWindow>(driver_.get());
+    }
+
+    ~NullTerminal() {
+        window_.reset();
+        driver_.reset();
+
+        // closing the slave end makes the drainer read EIO and stop
+        fclose(stdout_file_);
+        fclose(stdin_file_);
+        drainer_.join();
+        close(master_fd_);
+    }
+
+    CLASS_DISABLE_COPIES(NullTerminal)
+    CLASS_DISABLE_MOVES(NullTerminal)
+
+    termui::TerminalWindow *get_window() { return window_.get(); }
+
+  private:
+    void drain() {
+        char buf[4096];
+        while (read(master_fd_, buf, sizeof(buf)) > 0) {
+        }
+    }
+
+    int master_fd_{-1};
+    int slave_fd_{-1};
+    FILE *stdin_file_{nullptr};
+    FILE *stdout_file_{nullptr};
+    std::thread drainer_{};
+
+    std::unique_ptr<termui::FileStatusSetter> status_setter_{};
+    std::unique_ptr<termui::TtyTerminalDriver> driver_{};
+    std::unique_ptr<termui::TerminalWindow> window_{};
+};
+
+static sampling::TimeSeries make_series(TimePoint start,
+                                        std::size_t capacity = 512) {
+    constexpr Millis interval{1000};
+    sampling::TimeSeries ts{interval, start, capacity};
+
+    for (std::size_t i = 0; i < ts.capacity(); ++i) {
+        // something that looks like traffic, with peaks every now and then
+        ts.inc(start + interval * i, (i % 17 == 0) ? 9000000 : 1000 + i * 97);
+    }
+
+    return ts;
+}
+
+// Redraws the same chart, only the first frame writes anything out
+static void BM_BarChart_redraw(benchmark::State &state) {
+    NullTerminal term{termui::Dimensions{80, 24}};
+    termui::TerminalSurface surface{term.get_window(), 12};
+    termui::BarChart chart{&surface};
+
+    auto ts = make_series(TimePoint{});
+    auto slice = ts.get_slice_from_point(ts.max(), chart.get_width(),
+                                         sampling::Statistic::AVERAGE);
+
+    for (auto _ : state) {
+        chart.draw_bars_from_right("eth0", "received", slice,
+                                   termui::DisplayScale::LINEAR,
+                                   sampling::Statistic::AVERAGE);
+    }
+}
+BENCHMARK(BM_BarChart_redraw);
+
+// Repaints the whole chart every time, as after a resize
+static void BM_BarChart_repaint(benchmark::State &state) {
+    NullTerminal term{termui::Dimensions{80, 24}};
+    termui::TerminalSurface surface{term.get_window(), 12};
+    termui::BarChart chart{&surface};
+
+    auto ts = make_series(TimePoint{});
+    auto slice = ts.get_slice_from_point(ts.max(), chart.get_width(),
+                                         sampling::Statistic::AVERAGE);
+
+    for (auto _ : state) {
+        surface.invalidate();
+        chart.draw_bars_from_right("eth0", "received", slice,
+                                   termui::DisplayScale::LINEAR,
+                                   sampling::Statistic::AVERAGE);
+    }
+}
+BENCHMARK(BM_BarChart_repaint);
+
+// The output of a run that drew state.iterations() frames, without what was
+// written out before the first one
+struct FrameCounts {
+    explicit FrameCounts(const termui::MemoryTerminalDriver &driver)
+        : driver_{driver}, num_bytes_{driver.get_num_bytes_written()},
+          num_moves_{driver.get_num_cursor_moves()},
+          num_allocs_{num_allocs.load(std::memory_order_relaxed)} {}
+
+    std::size_t get_num_allocs() const {
+        return num_allocs.load(std::memory_order_relaxed) - num_allocs_;
+    }
+
+    void set_counters(benchmark::State &state) const {
+        // before the counters, which allocate themselves
+        auto frame_allocs = F64(get_num_allocs());
+        auto num_frames = F64(state.iterations());
+        state.counters["bytes/frame"] =
+            F64(driver_.get_num_bytes_written() - num_bytes_) / num_frames;
+        state.counters["moves/frame"] =
+            F64(driver_.get_num_cursor_moves() - num_moves_) / num_frames;
+        state.counters["allocs/frame"] = frame_allocs / num_frames;
+    }
+
+    const termui::MemoryTerminalDriver &driver_;
+    std::size_t num_bytes_;
+    std::size_t num_moves_;
+    std::size_t num_allocs_;
+};
+
+// Arg 0 is a terminal that only has absolute cursor moves, 1 one that has
+// all of the cheaper sequences too
+static termui::TerminalCapabilities get_capabilities(int64_t arg) {
+    return arg == 0 ? termui::TerminalCapabilities{}
+                    : termui::TerminalCapabilities{true, true, true, true};
+}
+
+// The same as the two above but into memory, what is left is the cost of
+// drawing alone and the bytes a frame takes
+static void BM_BarChart_redraw_memory(benchmark::State &state) {
+    termui::MemoryTerminalDriver driver{termui::Dimensions{80, 24},
+                                        termui::Point{1, 5}};
+    termui::TerminalWindow window{&driver};
+    termui::TerminalSurface surface{&window, 12};
+    termui::BarChart chart{&surface};
+
+    auto ts = make_series(TimePoint{});
+    auto slice = ts.get_slice_from_point(ts.max(), chart.get_width(),
+                                         sampling::Statistic::AVERAGE);
+
+    FrameCounts counts{driver};
+    for (auto _ : state) {
+        chart.draw_bars_from_right("eth0", "received", slice,
+                                   termui::DisplayScale::LINEAR,
+                                   sampling::Statistic::AVERAGE);
+    }
+
+    counts.set_counters(state);
+}
+BENCHMARK(BM_BarChart_redraw_memory);
+
+static void BM_BarChart_repaint_memory(benchmark::State &state) {
+    termui::MemoryTerminalDriver driver{termui::Dimensions{80, 24},
+                                        termui::Point{1, 5},
+                                        get_capabilities(state.range(0))};
+    termui::TerminalWindow window{&driver};
+    termui::TerminalSurface surface{&window, 12};
+    termui::BarChart chart{&surface};
+
+    auto ts = make_series(TimePoint{});
+    auto slice = ts.get_slice_from_point(ts.max(), chart.get_width(),
+                                         sampling::Statistic::AVERAGE);
+
+    FrameCounts counts{driver};
+    for (auto _ : state) {
+        surface.invalidate();
+        chart.draw_bars_from_right("eth0", "received", slice,
+                                   termui::DisplayScale::LINEAR,
+                                   sampling::Statistic::AVERAGE);
+    }
+
+    counts.set_counters(state);
+}
+BENCHMARK(BM_BarChart_repaint_memory)->ArgName("caps")->Arg(0)->Arg(1);
+
+// A chart that scrolls by one bar per frame, as it does while recording
+static void BM_BarChart_scroll_memory(benchmark::State &state) {
+    termui::MemoryTerminalDriver driver{termui::Dimensions{80, 24},
+                                        termui::Point{1, 5},
+                                        get_capabilities(state.range(0))};
+    termui::TerminalWindow window{&driver};
+    termui::TerminalSurface surface{&window, 12};
+    termui::BarChart chart{&surface};
+
+    auto ts = make_series(TimePoint{});
+    auto width = chart.get_width();
+
+    FrameCounts counts{driver};
+    std::size_t num_frames{0};
+    for (auto _ : state) {
+        auto end = ts.max() - Millis{1000} * (num_frames++ % 64);
+        auto slice = ts.get_slice_from_point(end, width,
+                                             sampling::Statistic::AVERAGE);
+        chart.draw_bars_from_right("eth0", "received", slice,
+                                   termui::DisplayScale::LINEAR,
+                                   sampling::Statistic::AVERAGE);
+    }
+
+    counts.set_counters(state);
+}
+BENCHMARK(BM_BarChart_scroll_memory)->ArgName("caps")->Arg(0)->Arg(1);
+
+// rx and tx at once, the dual view
+static void BM_BarChart_mirrored_memory(benchmark::State &state) {
+    termui::MemoryTerminalDriver driver{termui::Dimensions{80, 24},
+                                        termui::Point{1, 5}};
+    termui::TerminalWindow window{&driver};
+    termui::TerminalSurface surface{&window, 12};
+    termui::BarChart chart{&surface};
+
+    auto ts = make_series(TimePoint{});
+    auto slice = ts.get_slice_from_point(ts.max(), chart.get_width(),
+                                         sampling::Statistic::AVERAGE);
+
+    FrameCounts counts{driver};
+    for (auto _ : state) {
+        surface.invalidate();
+        chart.draw_mirrored_bars("eth0", slice, slice,
+                                 termui::DisplayScale::LINEAR,
+                                 sampling::Statistic::AVERAGE);
+    }
+
+    counts.set_counters(state);
+}
+BENCHMARK(BM_BarChart_mirrored_memory);
+
+// A chart that scrolls on terminals from 80x24 up to a wall monitor's
+static void BM_BarChart_scroll_wide(benchmark::State &state) {
+    termui::Dimensions dim{U16(state.range(0)), U16(state.range(1))};
+    termui::MemoryTerminalDriver driver{dim};
+    termui::TerminalWindow window{&driver};
+    termui::TerminalSurface surface{&window, dim.height};
+    termui::BarChart chart{&surface};
+
+    auto ts = make_series(TimePoint{}, 4096);
+    auto width = chart.get_width();
+
+    std::size_t num_frames{0};
+    auto draw_frame = [&]() {
+        auto end = ts.max() - Millis{1000} * (63 - num_frames++ % 64);
+        auto slice = ts.get_slice_from_point(end, width,
+                                             sampling::Statistic::AVERAGE);
+        chart.draw_bars_from_right("eth0", "received", slice,
+                                   termui::DisplayScale::LINEAR,
+                                   sampling::Statistic::AVERAGE);
+    };
+
+    // The first frame sizes the buffers, every one after it allocates
+    // nothing however wide the terminal is
+    draw_frame();
+
+    FrameCounts counts{driver};
+    for (auto _ : state) {
+        draw_frame();
+    }
+
+    bool is_allocated = counts.get_num_allocs() > 0;
+    counts.set_counters(state);
+    if (is_allocated) {
+        state.SkipWithError("a frame allocated");
+    }
+}
+BENCHMARK(BM_BarChart_scroll_wide)
+    ->ArgNames({"cols", "lines"})
+    ->Args({80, 24})
+    ->Args({320, 60})
+    ->Args({640, 120});
+
+} // namespace bench
+} // namespace bandwit
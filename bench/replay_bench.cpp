@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "except.hpp"
+#include "macros.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/recorder.hpp"
+#include "sampling/snapshot.hpp"
+#include "service/record_encoder.hpp"
+#include "service/replay_sampler.hpp"
+
+namespace bandwit {
+namespace bench {
+
+constexpr Millis REPLAY_INTERVAL{1000};
+
+// A recording of num_ticks samples of num_ifaces ifaces in a temporary
+// file, which goes away with it
+class Recording {
+  public:
+    Recording(std::size_t num_ifaces, std::size_t num_ticks) {
+        char path[] = "/tmp/bw_bench_replay_XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0) {
+            THROW_CERROR(std::runtime_error, "Recording failed in mkstemp()");
+        }
+        path_ = path;
+
+        std::vector<std::string> names{};
+        for (std::size_t i = 0; i < num_ifaces; ++i) {
+            names.push_back("eth" + std::to_string(i));
+        }
+
+        service::BinaryEncoder encoder{
+            names, {sampling::Quantity::BYTES}, REPLAY_INTERVAL};
+        std::string out{};
+        encoder.append_header(&out);
+
+        for (std::size_t tick = 0; tick < num_ticks; ++tick) {
+            TimePoint tp{REPLAY_INTERVAL * (tick + 1)};
+            for (std::size_t i = 0; i < num_ifaces; ++i) {
+                // something that looks like traffic, with peaks every now
+                // and then
+                service::ExportRecord record{tp, i, {}};
+                record.delta.rx[sampling::Quantity::BYTES] =
+                    (tick % 17 == 0) ? 9000000 : 1000 + tick * 97;
+                record.delta.tx[sampling::Quantity::BYTES] = 1000 + i;
+                encoder.append_record(record, &out);
+            }
+        }
+
+        auto nwritten = write(fd, out.data(), out.size());
+        close(fd);
+        if ((nwritten < 0) || (SIZE_T(nwritten) != out.size())) {
+            THROW_MSG(std::runtime_error, "Recording failed to write");
+        }
+    }
+
+    ~Recording() { unlink(path_.c_str()); }
+
+    CLASS_DISABLE_COPIES(Recording)
+    CLASS_DISABLE_MOVES(Recording)
+
+    const std::string &get_path() const { return path_; }
+
+  private:
+    std::string path_{};
+};
+
+// Replays the whole recording into a recorder of every window
+static std::unique_ptr<sampling::Recorder>
+replay_all(const Recording &recording) {
+    auto replay =
+        std::make_unique<service::ReplaySampler>(recording.get_path());
+    auto *sampler = replay.get();
+    auto recorder = std::make_unique<sampling::Recorder>(
+        std::move(replay), sampler->get_counter_bits(),
+        sampler->get_iface_names(), sampler->get_first_samples(),
+        sampler->get_start(),
+        sampling::get_windows_for_interval(sampler->get_interval()),
+        sampling::Retention{});
+
+    for (auto tp = sampler->get_next_time_point(); tp.has_value();
+         tp = sampler->get_next_time_point()) {
+        recorder->sample(tp.value());
+    }
+
+    return recorder;
+}
+
+// Replays the whole recording into a history of every window, as fast as
+// it goes. The same recording every time, so it is deterministic.
+static void BM_Replay_record(benchmark::State &state) {
+    auto num_ifaces = SIZE_T(state.range(0));
+    auto num_ticks = SIZE_T(state.range(1));
+    Recording recording{num_ifaces, num_ticks};
+
+    for (auto _ : state) {
+        auto recorder = replay_all(recording);
+        benchmark::DoNotOptimize(recorder->get_deltas());
+    }
+
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(num_ifaces * num_ticks));
+}
+// an hour of 1 and of 100 ifaces, and a day of 1
+BENCHMARK(BM_Replay_record)
+    ->Args({1, 3600})
+    ->Args({100, 3600})
+    ->Args({1, 86400})
+    ->Unit(benchmark::kMillisecond);
+
+// Restores the history that the replay leaves behind from a snapshot, which
+// is what a restart does rather than replaying it
+static void BM_Snapshot_restore(benchmark::State &state) {
+    auto num_ifaces = SIZE_T(state.range(0));
+    auto num_ticks = SIZE_T(state.range(1));
+    Recording recording{num_ifaces, num_ticks};
+
+    auto recorder = replay_all(recording);
+    const auto &history = recorder->get_history();
+    auto path = recording.get_path() + ".snapshot";
+    sampling::write_snapshot(path, REPLAY_INTERVAL, history);
+
+    std::vector<std::string> names{};
+    for (std::size_t i = 0; i < history.num_ifaces(); ++i) {
+        names.push_back(history.get_iface_name(i));
+    }
+    auto windows = sampling::get_windows_for_interval(REPLAY_INTERVAL);
+
+    for (auto _ : state) {
+        sampling::History restored{names, TimePoint{}, windows};
+        benchmark::DoNotOptimize(
+            sampling::read_snapshot(path, REPLAY_INTERVAL, &restored));
+    }
+
+    unlink(path.c_str());
+    state.SetItemsProcessed(state.iterations() *
+                            static_cast<int64_t>(num_ifaces * num_ticks));
+}
+// the same as the replays
+BENCHMARK(BM_Snapshot_restore)
+    ->Args({1, 3600})
+    ->Args({100, 3600})
+    ->Args({1, 86400})
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace bench
+} // namespace bandwit
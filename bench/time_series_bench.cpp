@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include "macros.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/time_series.hpp"
+#include "sampling/time_series_coll.hpp"
+#include "termui/formatter.hpp"
+
+namespace bandwit {
+namespace bench {
+
+constexpr Millis INTERVAL{1000};
+
+// Fills every bucket of the ring so that slices are backed by storage
+static void fill(sampling::TimeSeries *ts, TimePoint start) {
+    for (std::size_t i = 0; i < ts->capacity(); ++i) {
+        ts->inc(start + INTERVAL * i, 1000 + i);
+    }
+}
+
+static void BM_TimeSeries_inc(benchmark::State &state) {
+    TimePoint start{};
+    sampling::TimeSeries ts{INTERVAL, start};
+
+    for (auto _ : state) {
+        ts.inc(start, 1500);
+    }
+}
+BENCHMARK(BM_TimeSeries_inc);
+
+// Every inc moves on to a new key, so that the ring keeps wrapping around
+// and the oldest bucket is dropped each time. This is what truncating the
+// series used to do.
+static void BM_TimeSeries_inc_wrapping(benchmark::State &state) {
+    TimePoint start{};
+    sampling::TimeSeries ts{INTERVAL, start};
+    fill(&ts, start);
+
+    auto tp = start + INTERVAL * ts.capacity();
+    for (auto _ : state) {
+        ts.inc(tp, 1500);
+        tp += INTERVAL;
+    }
+}
+BENCHMARK(BM_TimeSeries_inc_wrapping);
+
+// The same with the 4 byte buckets of the finest tier
+static void BM_TimeSeries_inc_wrapping_packed(benchmark::State &state) {
+    TimePoint start{};
+    sampling::TimeSeries ts{INTERVAL, start, 512,
+                            sampling::BucketStorage::PACKED};
+    fill(&ts, start);
+
+    auto tp = start + INTERVAL * ts.capacity();
+    for (auto _ : state) {
+        ts.inc(tp, 1500);
+        tp += INTERVAL;
+    }
+}
+BENCHMARK(BM_TimeSeries_inc_wrapping_packed);
+
+static void BM_TimeSeries_get_slice_from_point(benchmark::State &state) {
+    TimePoint start{};
+    sampling::TimeSeries ts{INTERVAL, start};
+    fill(&ts, start);
+
+    auto len = SIZE_T(state.range(0));
+    for (auto _ : state) {
+        auto slice = ts.get_slice_from_point(ts.max(), len,
+                                             sampling::Statistic::AVERAGE);
+        benchmark::DoNotOptimize(slice);
+    }
+}
+BENCHMARK(BM_TimeSeries_get_slice_from_point)->Arg(80)->Arg(512);
+
+static void BM_TimeSeriesCollection_inc(benchmark::State &state) {
+    TimePoint start{};
+    sampling::TimeSeriesCollection coll{
+        start, sampling::get_windows_for_interval(INTERVAL)};
+
+    // a new bucket every time, which rolls up into the coarser tiers
+    auto tp = start;
+    for (auto _ : state) {
+        tp += INTERVAL;
+        coll.inc(tp, 1500);
+    }
+}
+BENCHMARK(BM_TimeSeriesCollection_inc);
+
+static void BM_Formatter_format_num_bytes(benchmark::State &state) {
+    termui::Formatter formatter{};
+    uint64_t num{1};
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            formatter.format_num_bytes(termui::YAxisScale::BASE2, num));
+
+        // walk through all the magnitudes
+        num = num < (UINT64_MAX / 7) ? num * 7 : 1;
+    }
+}
+BENCHMARK(BM_Formatter_format_num_bytes);
+
+static void BM_Formatter_format_num_bytes_buffer(benchmark::State &state) {
+    termui::Formatter formatter{};
+    termui::NumBytesBuffer buf{};
+    uint64_t num{1};
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            formatter.format_num_bytes(&buf, termui::YAxisScale::BASE2, num));
+
+        num = num < (UINT64_MAX / 7) ? num * 7 : 1;
+    }
+}
+BENCHMARK(BM_Formatter_format_num_bytes_buffer);
+
+} // namespace bench
+} // namespace bandwit
@@ -0,0 +1,58 @@
+# Link time optimization of the whole program, across the libraries of the
+# modules
+option(BANDWIT_LTO "Enable link time optimization" OFF)
+
+if(BANDWIT_LTO)
+    cmake_policy(SET CMP0069 NEW)
+    include(CheckIPOSupported)
+    check_ipo_supported(RESULT is_lto_supported OUTPUT lto_error)
+    if(NOT is_lto_supported)
+        message(FATAL_ERROR "LTO is not supported: ${lto_error}")
+    endif()
+    set(CMAKE_INTERPROCEDURAL_OPTIMIZATION ON)
+endif()
+
+# The instruction set to tune for, eg. native or x86-64-v3. Empty builds for
+# any CPU of the target.
+set(BANDWIT_MARCH "" CACHE STRING "the -march to build for")
+
+if(BANDWIT_MARCH)
+    add_compile_options(-march=${BANDWIT_MARCH})
+endif()
+
+# Profile guided optimization in two builds in the same directory, see the
+# pgo script: GENERATE builds with instrumentation that writes the profiles
+# to BANDWIT_PGO_DIR when it runs, USE builds with the profiles found there.
+# Empty builds without either.
+set(BANDWIT_PGO "" CACHE STRING "GENERATE, USE or empty")
+set(BANDWIT_PGO_DIR "${CMAKE_BINARY_DIR}/pgo" CACHE PATH
+    "where the profiles of PGO are written and read")
+
+if(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    # llvm-profdata merge -o ${BANDWIT_PGO_DIR}/bw.profdata *.profraw
+    set(pgo_generate_flags
+        "-fprofile-instr-generate=${BANDWIT_PGO_DIR}/%p.profraw")
+    set(pgo_use_flags
+        "-fprofile-instr-use=${BANDWIT_PGO_DIR}/bw.profdata"
+        -Wno-profile-instr-unprofiled -Wno-profile-instr-out-of-date)
+else()
+    # The profiles are named by the paths of the objects, which is why both
+    # builds go in the same directory. The sampler thread updates the
+    # counters too.
+    set(pgo_generate_flags
+        "-fprofile-generate=${BANDWIT_PGO_DIR}" -fprofile-update=atomic)
+    set(pgo_use_flags
+        "-fprofile-use=${BANDWIT_PGO_DIR}" -fprofile-correction
+        -Wno-missing-profile)
+endif()
+
+if(BANDWIT_PGO STREQUAL "GENERATE")
+    add_compile_options(${pgo_generate_flags})
+    string(REPLACE ";" " " pgo_link_flags "${pgo_generate_flags}")
+    set(CMAKE_EXE_LINKER_FLAGS "${CMAKE_EXE_LINKER_FLAGS} ${pgo_link_flags}")
+elseif(BANDWIT_PGO STREQUAL "USE")
+    add_compile_options(${pgo_use_flags})
+elseif(BANDWIT_PGO)
+    message(FATAL_ERROR "BANDWIT_PGO is GENERATE, USE or empty, not "
+        "${BANDWIT_PGO}")
+endif()
@@ -9,6 +9,10 @@ using Clock = std::chrono::system_clock;
 using TimePoint = Clock::time_point;
 using Millis = std::chrono::milliseconds;
 
+// Used for scheduling, never for anything that is displayed
+using SteadyClock = std::chrono::steady_clock;
+using SteadyTimePoint = SteadyClock::time_point;
+
 } // namespace bandwit
 
-#endif // ALIASES_H
\ No newline at end of file
+#endif // ALIASES_H
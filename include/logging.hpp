@@ -1,26 +1,71 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
-#include <cstdlib>
-#include <fstream>
-
-#include "macros.hpp"
-
-#define LOGFILE "log"
-#define MAX_LINE_LEN 1024
-
-#define LOG(msg)                                                               \
-    {                                                                          \
-        std::fstream logfile{LOGFILE, std::fstream::out | std::fstream::app};  \
-        logfile << msg;                                                        \
-    }
-
-#define LOG_A(msg, ...)                                                        \
-    {                                                                          \
-        std::fstream logfile{LOGFILE, std::fstream::out | std::fstream::app};  \
-        auto buf_msg = PCHAR(malloc(MAX_LINE_LEN));                            \
-        snprintf(buf_msg, MAX_LINE_LEN, msg, __VA_ARGS__);                     \
-        logfile << buf_msg;                                                    \
-    }
+// printf style logging into the file "log" in the working directory, eg.
+//
+//     LOG_W("sampler queue full, skipped %zu deadlines", num_skipped);
+//
+// Which levels are compiled in is decided at build time by
+// BANDWIT_LOG_LEVEL, the levels below it compile to nothing and their
+// arguments are never evaluated. Nothing is compiled in by default.
+//
+// A message is formatted into a preallocated ring buffer, without locks or
+// allocations, and written out by a background thread in batches. If the
+// ring is full the message is dropped and the drop counted in the log.
+
+#define BANDWIT_LOG_LEVEL_DEBUG 0
+#define BANDWIT_LOG_LEVEL_INFO 1
+#define BANDWIT_LOG_LEVEL_WARN 2
+#define BANDWIT_LOG_LEVEL_ERROR 3
+#define BANDWIT_LOG_LEVEL_OFF 4
+
+#ifndef BANDWIT_LOG_LEVEL
+#define BANDWIT_LOG_LEVEL BANDWIT_LOG_LEVEL_OFF
+#endif
+
+namespace bandwit {
+
+enum class LogLevel {
+    DEBUG,
+    INFO,
+    WARN,
+    ERROR,
+};
+
+// Use the macros instead, so that the level can be compiled out
+void log_message(LogLevel level, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+} // namespace bandwit
+
+// Never evaluated, but the format is still checked and the arguments count
+// as used
+#define LOG_DISABLED(...)                                                      \
+    static_cast<void>(sizeof(                                                  \
+        (bandwit::log_message(bandwit::LogLevel::DEBUG, __VA_ARGS__), 0)))
+
+#if BANDWIT_LOG_LEVEL <= BANDWIT_LOG_LEVEL_DEBUG
+#define LOG_D(...) bandwit::log_message(bandwit::LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_D(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if BANDWIT_LOG_LEVEL <= BANDWIT_LOG_LEVEL_INFO
+#define LOG_I(...) bandwit::log_message(bandwit::LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_I(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if BANDWIT_LOG_LEVEL <= BANDWIT_LOG_LEVEL_WARN
+#define LOG_W(...) bandwit::log_message(bandwit::LogLevel::WARN, __VA_ARGS__)
+#else
+#define LOG_W(...) LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if BANDWIT_LOG_LEVEL <= BANDWIT_LOG_LEVEL_ERROR
+#define LOG_E(...) bandwit::log_message(bandwit::LogLevel::ERROR, __VA_ARGS__)
+#else
+#define LOG_E(...) LOG_DISABLED(__VA_ARGS__)
+#endif
 
 #endif // LOGGING_H
@@ -22,6 +22,7 @@
 #define F64(num) static_cast<double>(num)
 
 #define INT(num) static_cast<int>(num)
+#define U8(num) static_cast<uint8_t>(num)
 #define U16(num) static_cast<uint16_t>(num)
 #define U32(num) static_cast<uint32_t>(num)
 #define U64(num) static_cast<uint64_t>(num)
@@ -0,0 +1,10 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// The BSDs (and macOS) share the AF_LINK / struct if_data interface
+#if defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) ||     \
+    defined(__DragonFly__) || defined(__APPLE__)
+#define BANDWIT_BSD 1
+#endif
+
+#endif // PLATFORM_H
@@ -2,21 +2,39 @@
 #define AGG_WINDOW_H
 
 #include <string>
+#include <vector>
+
+#include "aliases.hpp"
 
 namespace bandwit {
 namespace sampling {
 
+// The values are the length of the window in milliseconds
 enum class AggregationWindow {
-    ONE_SECOND = 1,
-    ONE_MINUTE = 60,
-    ONE_HOUR = 3600,
-    ONE_DAY = 86400,
+    TENTH_SECOND = 100,
+    QUARTER_SECOND = 250,
+    HALF_SECOND = 500,
+    ONE_SECOND = 1000,
+    ONE_MINUTE = 60000,
+    ONE_HOUR = 3600000,
+    ONE_DAY = 86400000,
 };
 
-AggregationWindow next_interval(AggregationWindow agg_window);
-AggregationWindow prev_interval(AggregationWindow agg_window);
+// The windows are expected to be ordered from the shortest to the longest
+AggregationWindow next_interval(AggregationWindow agg_window,
+                                const std::vector<AggregationWindow> &windows);
+AggregationWindow prev_interval(AggregationWindow agg_window,
+                                const std::vector<AggregationWindow> &windows);
 std::string get_label(AggregationWindow agg_window);
 
+Millis get_duration(AggregationWindow agg_window);
+bool is_sampling_interval(Millis interval);
+
+// The windows to keep when sampling at the given interval: a sub-second
+// window when sampling faster than once a second, followed by the standard
+// second/minute/hour/day windows.
+std::vector<AggregationWindow> get_windows_for_interval(Millis interval);
+
 } // namespace sampling
 } // namespace bandwit
 
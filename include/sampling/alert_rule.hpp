@@ -0,0 +1,49 @@
+#ifndef ALERT_RULE_H
+#define ALERT_RULE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "aliases.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+enum class AlertOp : uint8_t {
+    ABOVE,
+    BELOW,
+    // mostly for "exactly nothing"
+    EQUAL,
+};
+
+// A threshold that the rate of an iface is held against, eg. above 90% of
+// the line rate of the link over the last 30 seconds. Every rule applies to
+// every iface.
+struct AlertRule {
+    // as it was given, eg. "rx>90%/30s"
+    std::string text{};
+
+    bool is_rx{true};
+    AlertOp op{AlertOp::ABOVE};
+
+    // in bytes a second, or in percent of the line rate
+    double threshold{0};
+    bool is_line_rate{false};
+
+    // What the rate is averaged over. Zero is a single bucket of the
+    // sampling interval.
+    Millis duration{0};
+};
+
+// DIR OP VALUE[/DURATION], eg. "rx>90%/30s" or "tx=0/10s", where DIR is rx
+// or tx and OP one of >, < or =. VALUE is in bytes a second, optionally
+// followed by k, m or g for powers of 1000, or followed by % of the line
+// rate. DURATION is as for the retention, eg. 30s or 5m. Returns false if it
+// is anything else.
+bool parse_alert_rule(std::string_view spec, AlertRule *rule);
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // ALERT_RULE_H
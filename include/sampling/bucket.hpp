@@ -0,0 +1,31 @@
+#ifndef BUCKET_H
+#define BUCKET_H
+
+#include <cstdint>
+
+namespace bandwit {
+namespace sampling {
+
+// The aggregate of all the values that fell into one time series bucket. The
+// min and max are over the individual values, so they survive being rolled up
+// into coarser buckets.
+//
+// Percentiles do not survive a roll up, so they are not merged. They are set
+// by the TimeSeriesCollection when the bucket closes, from a sketch of the
+// individual values, and are zero until then.
+struct Bucket {
+    void add(uint64_t value);
+    void merge(const Bucket &other);
+
+    uint64_t sum{0};
+    uint64_t min{0};
+    uint64_t max{0};
+    uint64_t count{0};
+    uint64_t p95{0};
+    uint64_t p99{0};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // BUCKET_H
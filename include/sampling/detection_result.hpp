@@ -2,6 +2,7 @@
 #define DETECTION_RESULT_H
 
 #include <memory>
+#include <vector>
 
 #include "sample.hpp"
 #include "sampler.hpp"
@@ -11,7 +12,8 @@ namespace sampling {
 
 struct DetectionResult {
     std::unique_ptr<Sampler> sampler;
-    Sample sample;
+    // one per iface, in the order they were requested
+    std::vector<Sample> samples;
 };
 
 } // namespace sampling
@@ -0,0 +1,57 @@
+#ifndef QUANTITY_H
+#define QUANTITY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "macros.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// What the counters of an iface count. There is one counter of each for rx
+// and one for tx, and every sampler reads all of them in the same read that
+// gets it the bytes.
+enum class Quantity : uint8_t {
+    BYTES,
+    PACKETS,
+    ERRORS,
+    // the packets that the kernel or the driver dropped
+    DROPS,
+};
+
+constexpr std::size_t NUM_QUANTITIES = 4;
+
+// A counter per quantity, for one direction
+struct Counters {
+    uint64_t &operator[](Quantity qtty) { return values[SIZE_T(qtty)]; }
+    uint64_t operator[](Quantity qtty) const { return values[SIZE_T(qtty)]; }
+
+    std::array<uint64_t, NUM_QUANTITIES> values{};
+};
+
+// eg. "bytes"
+std::string get_label(Quantity qtty);
+
+// A list like "packets,drops", which comes out in the order of the enum
+// whatever the order it was given in. The bytes are always in it, the
+// cursors and the windows are kept on them. Returns false if any of it is
+// not a quantity.
+bool parse_quantities(std::string_view spec, std::vector<Quantity> *qttys);
+
+// A bit per quantity, for headers of images and files
+uint32_t get_mask(const std::vector<Quantity> &qttys);
+std::vector<Quantity> from_mask(uint32_t mask);
+
+// The quantities are expected to be in the order of the enum, the one after
+// the last is the first
+Quantity next_quantity(Quantity qtty, const std::vector<Quantity> &qttys);
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // QUANTITY_H
@@ -0,0 +1,48 @@
+#ifndef RETENTION_H
+#define RETENTION_H
+
+#include <cstddef>
+#include <map>
+#include <string_view>
+
+#include "aliases.hpp"
+#include "sampling/agg_window.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// How long the buckets of every aggregation window are kept for. The time
+// series are allocated for all of it up front, so the memory they take is
+// known from the start and does not grow.
+//
+// Unless set otherwise the sub-second windows are kept for 5 minutes, the
+// seconds for an hour, the minutes for 2 days, the hours for 90 days and the
+// days for 2 years.
+class Retention {
+  public:
+    void set(AggregationWindow window, Millis duration);
+
+    // the buckets it takes to cover the window's duration, at least one
+    std::size_t get_num_buckets(AggregationWindow window) const;
+
+  private:
+    static Millis get_default(AggregationWindow window);
+
+    // only the windows that were set
+    std::map<AggregationWindow, Millis> durations_{};
+};
+
+// Parses a comma separated list of WINDOW=DURATION, eg. "sec=1h,min=7d",
+// where WINDOW is the label of a window (100ms, 250ms, 500ms, sec, min, hour
+// or day) and DURATION a whole number followed by s, m, h or d. Returns
+// false if it is anything else.
+bool parse_retention(std::string_view spec, Retention *retention);
+
+// A whole number followed by s, m, h or d, eg. "30s", of up to a hundred
+// years
+bool parse_duration(std::string_view text, Millis *duration);
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // RETENTION_H
@@ -2,16 +2,37 @@
 #define SAMPLE_H
 
 #include <cstdint>
-#include <ctime>
+
+#include "aliases.hpp"
+#include "sampling/quantity.hpp"
 
 namespace bandwit {
 namespace sampling {
 
+// Why a sample could not be taken. Samplers return these rather than throw,
+// an iface that goes away for a while must not cost an exception per sample.
+enum class SampleError : uint8_t {
+    NONE,
+    // the iface does not exist, eg. it was removed or not yet created
+    NO_SUCH_IFACE,
+    // the source of the counters could not be read
+    READ_FAILED,
+    // the source was read but the counters were not found in it
+    PARSE_FAILED,
+    // not sampled at all this time, the adaptive schedule backed off on it
+    NOT_DUE,
+};
+
 struct Sample {
-    uint64_t rx;
-    uint64_t tx;
+    // by quantity, the ones that are not wanted may be left at 0
+    Counters rx{};
+    Counters tx{};
+
+    // when the counters were read, at nanosecond resolution
+    TimePoint ts{};
 
-    std::time_t ts;
+    // the counters are only valid if there is no error
+    SampleError error{SampleError::NONE};
 };
 
 } // namespace sampling
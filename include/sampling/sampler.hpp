@@ -2,6 +2,7 @@
 #define SAMPLER_H
 
 #include <string>
+#include <vector>
 
 #include "macros.hpp"
 #include "sample.hpp"
@@ -22,9 +23,36 @@ class Sampler {
     CLASS_DISABLE_COPIES(Sampler)
     CLASS_DISABLE_MOVES(Sampler)
 
-    virtual Sample get_sample(const std::string &iface_name) const = 0;
+    // An iface that cannot be sampled gets a sample with the error set,
+    // rather than an exception: this runs once per interval for as long as
+    // the iface is gone.
+    virtual Sample get_sample(const std::string &iface_name) = 0;
+
+    // Samples all the interfaces in one pass, writing the samples in the same
+    // order as the names. The default calls get_sample once per interface,
+    // samplers that read all interfaces at once should override it. One iface
+    // that cannot be sampled does not stop the others from being sampled.
+    virtual void get_samples(const std::vector<std::string> &iface_names,
+                             std::vector<Sample> *samples);
+
+    // Whether get_samples() reads every iface anyway, however few of them
+    // it is asked for, eg. from a file that has them all. Such a sampler is
+    // always asked for the same names, which keeps what it knows of them.
+    virtual bool is_bulk() const;
+
+    // How many bits wide the counters are, ie. where they wrap around back
+    // to zero. The default is for samplers that read 64bit counters.
+    virtual unsigned get_counter_bits() const;
+
+    // The quantities that are wanted from now on, only the bytes unless this
+    // is called. Every sampler but the sysfs one reads all of them at once
+    // anyway and ignores this, that one has a file to read per quantity.
+    virtual void set_quantities(const std::vector<Quantity> &qttys);
 };
 
+// A description of the error, for err messages
+const char *get_message(SampleError error);
+
 } // namespace sampling
 } // namespace bandwit
 
@@ -9,8 +9,13 @@ namespace sampling {
 enum class Statistic {
     AVERAGE,
     SUM,
+    // over the individual samples in the bucket, as a rate
+    MAX,
+    P95,
+    P99,
 };
 
+Statistic next_statistic(Statistic stat);
 std::string get_label(Statistic stat);
 
 } // namespace sampling
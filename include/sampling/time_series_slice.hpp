@@ -1,35 +1,115 @@
 #ifndef TIME_SERIES_SLICE_H
 #define TIME_SERIES_SLICE_H
 
+#include <cstdint>
 #include <unistd.h>
-#include <vector>
 
 #include "agg_window.hpp"
 #include "aliases.hpp"
+#include "sampling/bucket.hpp"
 
 namespace bandwit {
 namespace sampling {
 
-// FIXME: should this be a struct?
+class TimeSeries;
+
+// A read only view of consecutive keys of a TimeSeries. Nothing is copied:
+// the buckets are read straight from the series, however it stores them.
+// Keys past the newest one have not been written yet and read as empty. Time
+// points are computed from the start and the interval. A bucket without any
+// samples in it is a gap, eg. the sampler was stopped or the counter reset,
+// which is not the same as a bucket of samples that were all zero. The keys
+// from before the first sample are blank instead, there was no sampler to
+// stop. The ones past the pending bucket are pending too, eg. of an iface
+// that is backed off on, until the sample that covers them comes in.
+//
+// The view is only valid until the series it came from is written to again.
 class TimeSeriesSlice {
   public:
-    explicit TimeSeriesSlice(std::vector<TimePoint> tps,
-                             std::vector<uint64_t> vals,
-                             AggregationWindow agg_win)
-        : time_points{std::move(tps)}, values{std::move(vals)}, agg_window{
-                                                                    agg_win} {}
+    TimeSeriesSlice(const TimeSeries *series, std::size_t first_key,
+                    std::size_t len, TimePoint start,
+                    AggregationWindow agg_win);
 
     // We need this to be able to declare a variable in an outer scope and
     // populate it in an inner scope. The value should not be used for anything
     // cause it's going to be empty.
     TimeSeriesSlice() {}
 
-    std::vector<TimePoint> time_points{};
-    std::vector<uint64_t> values{};
-    AggregationWindow agg_window;
+    // Which field of the buckets the values are read from
+    void set_field(uint64_t Bucket::*field);
+
+    // The bucket at `index`, in place of what is in the series, for a bucket
+    // that is partly accounted for outside the series
+    void set_pending(std::size_t index, const Bucket &bucket);
+
+    // The buckets from first up to end are the ones the series recorded,
+    // all of them unless this is set
+    void set_recorded(std::size_t first, std::size_t end);
+
+    // A full bucket holds num_samples samples. The values of buckets with
+    // fewer, eg. around a gap or the one still open, are scaled up to what a
+    // full bucket would have held, so that an average is over the time that
+    // was actually sampled. 0 leaves the values as they are.
+    void set_coverage(uint64_t num_samples);
+
+    // Averages are per second, sums are per bucket. Since this is monotonic
+    // it can be applied after finding the max of the raw sums.
+    void set_rate(uint64_t multiplier, uint64_t divisor);
+
+    // The rate that turns values over `interval` into values per second
+    void set_rate_per_second(Millis interval);
+
+    std::size_t size() const { return len_; }
+
+    // raw value of the bucket, eg. the sum
+    uint64_t get_value(std::size_t i) const;
+
+    bool is_gap(std::size_t i) const;
+    bool is_blank(std::size_t i) const;
+    bool is_pending(std::size_t i) const;
+
+    uint64_t to_stat(uint64_t value) const {
+        return value * multiplier_ / divisor_;
+    }
+
+    // the raw value that a value of the statistic comes from
+    uint64_t from_stat(uint64_t stat_value) const {
+        return stat_value * divisor_ / multiplier_;
+    }
+
+    TimePoint get_time_point(std::size_t i) const {
+        return start_ + get_interval() * i;
+    }
+
+    Millis get_interval() const { return get_duration(agg_window); }
+
+    uint64_t get_max_value() const;
+
+    AggregationWindow agg_window{AggregationWindow::ONE_SECOND};
+
+  private:
+    Bucket get_bucket(std::size_t i) const;
+
+    const TimeSeries *series_{nullptr};
+    std::size_t first_key_{0};
+    std::size_t len_{0};
+    TimePoint start_{};
+    uint64_t Bucket::*field_{&Bucket::sum};
+
+    // past the end if there is none
+    std::size_t pending_index_{SIZE_MAX};
+    Bucket pending_{};
+
+    std::size_t first_recorded_{0};
+    std::size_t end_recorded_{SIZE_MAX};
+
+    uint64_t num_samples_{0};
+
+    uint64_t multiplier_{1};
+    uint64_t divisor_{1};
 };
 
 } // namespace sampling
 } // namespace bandwit
 
-#endif // TIME_SERIES_SLICE_H
\ No newline at end of file
+#endif // TIME_SERIES_SLICE_H
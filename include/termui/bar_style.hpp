@@ -0,0 +1,17 @@
+#ifndef BAR_STYLE_H
+#define BAR_STYLE_H
+
+namespace bandwit {
+namespace termui {
+
+enum class BarStyle {
+    // whole cells only
+    BLOCKS,
+    // the top cell of a bar is filled in eighths
+    EIGHTHS,
+};
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // BAR_STYLE_H
@@ -7,6 +7,8 @@ namespace termui {
 enum class DisplayMode {
     DISPLAY_RX,
     DISPLAY_TX,
+    // rx and tx mirrored in one chart
+    DISPLAY_BOTH,
 };
 
 } // namespace termui
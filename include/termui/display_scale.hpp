@@ -10,6 +10,8 @@ enum class DisplayScale {
     LINEAR,
     LOG10,
     LOG2,
+    // linear up to the line rate of the link, the same for every frame
+    LINE_RATE,
 };
 
 DisplayScale next_scale(DisplayScale scale);
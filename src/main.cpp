@@ -1,34 +1,178 @@
 #include <csignal>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <unistd.h>
+#include <vector>
 
+#include "options.hpp"
+#include "sampling/cgroup_sampler.hpp"
+#include "sampling/ethtool_sampler.hpp"
+#include "sampling/iface_lister.hpp"
+#include "service/client.hpp"
+#include "service/daemon.hpp"
+#include "service/exporter.hpp"
+#include "service/remote_viewer.hpp"
+#include "service/replay_sampler.hpp"
+#include "service/shm_segment.hpp"
 #include "termui/signals.hpp"
 #include "termui/termui.hpp"
+#include "tools/profiler.hpp"
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        std::cout << "Must pass <iface_name>\n";
-        exit(EXIT_FAILURE);
-    }
-
-    std::string iface_name{argv[1]};
+    bandwit::OptionsParser parser{};
+    auto opts = parser.parse(argc, argv);
 
     // We expect to get a Ctrl+C. Install a SIGINT handler that throws an
     // exception such that we can unwind orderly and enter the catch block
     // below.
     signal(SIGINT, bandwit::termui::sigint_handler);
 
+    // Outlives the ui, so that it can be printed once the terminal is back
+    // to normal
+    bandwit::tools::Profiler profiler{};
+
     // We desperately need to wrap the execution in a try/catch otherwise an
     // uncaught exception will terminate the program bypassing all destructors
     // and leave the terminal in a corrupted state.
     try {
-        bandwit::termui::TermUi termui{iface_name};
+        if ((opts.mode == bandwit::RunMode::ATTACH) &&
+            !opts.shm_name.empty()) {
+            auto viewer =
+                std::make_unique<bandwit::service::ShmViewer>(opts.shm_name);
+
+            bandwit::termui::TermUi termui{std::move(viewer), opts.max_fps,
+                                           &profiler};
+            termui.set_alerts(opts.alert_rules, opts.alert_hook,
+                              opts.alert_hook_interval);
+            termui.run_forever();
+            return 0;
+        }
+
+        if (opts.mode == bandwit::RunMode::ATTACH) {
+            auto client =
+                std::make_unique<bandwit::service::Client>(opts.socket_path);
+
+            bandwit::termui::TermUi termui{std::move(client), opts.max_fps,
+                                           &profiler};
+            termui.set_alerts(opts.alert_rules, opts.alert_hook,
+                              opts.alert_hook_interval);
+            termui.run_forever();
+            return 0;
+        }
+
+        if (opts.mode == bandwit::RunMode::CONNECT) {
+            auto remote = std::make_unique<bandwit::service::RemoteViewer>(
+                opts.remote_addresses, opts.is_remote_udp, opts.retention);
+
+            bandwit::termui::TermUi termui{std::move(remote), opts.max_fps,
+                                           &profiler};
+            termui.set_alerts(opts.alert_rules, opts.alert_hook,
+                              opts.alert_hook_interval);
+            termui.run_forever();
+            return 0;
+        }
+
+        if (opts.mode == bandwit::RunMode::REPLAY) {
+            auto replay = std::make_unique<bandwit::service::ReplaySampler>(
+                opts.replay_path);
+
+            bandwit::termui::TermUi termui{std::move(replay),
+                                           opts.replay_speed, opts.retention,
+                                           opts.max_fps, &profiler};
+            termui.set_alerts(opts.alert_rules, opts.alert_hook,
+                              opts.alert_hook_interval);
+            termui.run_forever();
+            return 0;
+        }
+
+        std::vector<std::string> iface_names{};
+        if (opts.sample_cgroups) {
+#ifdef BANDWIT_BPF
+            iface_names =
+                bandwit::sampling::expand_cgroups(opts.iface_patterns);
+#else
+            std::cerr << "--cgroups requires a build with BANDWIT_BPF\n";
+            exit(EXIT_FAILURE);
+#endif
+        } else {
+            bandwit::sampling::InterfaceLister lister{};
+            iface_names = lister.expand(opts.iface_patterns);
+        }
+
+#ifdef __linux__
+        if (opts.sample_queues) {
+            bandwit::sampling::EthtoolSampler ethtool{};
+            iface_names = ethtool.list_queues(iface_names);
+            if (iface_names.empty()) {
+                std::cerr << "None of the interfaces has per-queue "
+                             "counters\n";
+                exit(EXIT_FAILURE);
+            }
+        }
+#else
+        if (opts.sample_queues) {
+            std::cerr << "--queues is only supported on Linux\n";
+            exit(EXIT_FAILURE);
+        }
+#endif
+
+        if (opts.mode == bandwit::RunMode::EXPORT) {
+            std::optional<bandwit::sampling::AggregationWindow> window{};
+            if (opts.output_window.count() > 0) {
+                window = static_cast<bandwit::sampling::AggregationWindow>(
+                    opts.output_window.count());
+            }
+
+            // Stops orderly on SIGINT or SIGTERM, or when the reader of the
+            // output goes away
+            bandwit::service::Exporter exporter{iface_names, opts.interval,
+                                                opts.export_format,
+                                                opts.output_path, window,
+                                                opts.retention,
+                                                opts.quantities};
+            exporter.run_forever();
+            return 0;
+        }
+
+        if (opts.mode == bandwit::RunMode::DAEMON) {
+            // Stops orderly on SIGINT or SIGTERM, there is no terminal to
+            // restore
+            bandwit::service::DaemonConfig config{};
+            config.interval = opts.interval;
+            config.socket_path = opts.socket_path;
+            config.retention = opts.retention;
+            config.quantities = opts.quantities;
+            config.shm_name = opts.shm_name;
+            config.history_dir = opts.history_dir;
+            config.metrics_address = opts.metrics_address;
+            config.serve_address = opts.serve_address;
+            config.snapshot_path = opts.snapshot_path;
+            config.adaptive_threshold = opts.adaptive_threshold;
+
+            bandwit::service::Daemon daemon{iface_names, config};
+            daemon.run_forever();
+            return 0;
+        }
+
+        bandwit::termui::TermUi termui{iface_names, opts.interval,
+                                       opts.history_dir, opts.snapshot_path,
+                                       opts.adaptive_threshold, opts.retention,
+                                       opts.quantities, opts.max_fps,
+                                       &profiler};
+        termui.set_alerts(opts.alert_rules, opts.alert_hook,
+                          opts.alert_hook_interval);
         termui.run_forever();
     } catch (bandwit::termui::InterruptException &e) {
         // This is the expected way to stop the program.
         // Emit a newline so we move beyond the menu that was displayed at the
         // cursor position.
         std::cerr << "\n";
+
+        if (opts.print_stats) {
+            profiler.dump(std::cerr);
+        }
     } catch (std::exception &e) {
         std::cerr << "\nTrapped uncaught exception:\n  " << e.what() << "\n";
         exit(EXIT_FAILURE);
@@ -0,0 +1,544 @@
+#include <algorithm>
+#include <cstdlib>
+#include <getopt.h>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "macros.hpp"
+#include "options.hpp"
+#include "sampling/adaptive_schedule.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/snapshot.hpp"
+#include "service/protocol.hpp"
+#include "service/remote_protocol.hpp"
+#include "service/shm_segment.hpp"
+
+namespace bandwit {
+
+// a frame every millisecond
+constexpr long MAX_FPS = 1000;
+
+// bytes a second, about what the odd ARP and neighbour discovery add up to
+constexpr uint64_t DEFAULT_ADAPTIVE_THRESHOLD = 1024;
+
+Options OptionsParser::parse(int argc, char *argv[]) const {
+    Options opts{};
+    opts.socket_path = service::get_default_socket_path();
+
+    enum LongOnly {
+        OPT_INTERVAL = 256,
+        OPT_ADAPTIVE,
+        OPT_DAEMON,
+        OPT_ATTACH,
+        OPT_SOCKET,
+        OPT_SHM,
+        OPT_HISTORY_DIR,
+        OPT_SNAPSHOT,
+        OPT_METRICS,
+        OPT_OUTPUT,
+        OPT_OUTPUT_FILE,
+        OPT_OUTPUT_WINDOW,
+        OPT_RETENTION,
+        OPT_COUNTERS,
+        OPT_FPS,
+        OPT_STATS,
+        OPT_REPLAY,
+        OPT_SPEED,
+        OPT_QUEUES,
+        OPT_CGROUPS,
+        OPT_ALERT,
+        OPT_ALERT_HOOK,
+        OPT_ALERT_HOOK_INTERVAL,
+        OPT_SERVE,
+        OPT_CONNECT,
+        OPT_UDP,
+    };
+
+    const struct option long_opts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"interval", required_argument, nullptr, OPT_INTERVAL},
+        {"adaptive", optional_argument, nullptr, OPT_ADAPTIVE},
+        {"daemon", no_argument, nullptr, OPT_DAEMON},
+        {"attach", no_argument, nullptr, OPT_ATTACH},
+        {"socket", required_argument, nullptr, OPT_SOCKET},
+        {"shm", optional_argument, nullptr, OPT_SHM},
+        {"history-dir", required_argument, nullptr, OPT_HISTORY_DIR},
+        {"snapshot", optional_argument, nullptr, OPT_SNAPSHOT},
+        {"metrics", required_argument, nullptr, OPT_METRICS},
+        {"output", required_argument, nullptr, OPT_OUTPUT},
+        {"output-file", required_argument, nullptr, OPT_OUTPUT_FILE},
+        {"output-window", required_argument, nullptr, OPT_OUTPUT_WINDOW},
+        {"retention", required_argument, nullptr, OPT_RETENTION},
+        {"counters", required_argument, nullptr, OPT_COUNTERS},
+        {"fps", required_argument, nullptr, OPT_FPS},
+        {"stats", no_argument, nullptr, OPT_STATS},
+        {"replay", required_argument, nullptr, OPT_REPLAY},
+        {"speed", required_argument, nullptr, OPT_SPEED},
+        {"queues", no_argument, nullptr, OPT_QUEUES},
+        {"cgroups", no_argument, nullptr, OPT_CGROUPS},
+        {"alert", required_argument, nullptr, OPT_ALERT},
+        {"alert-hook", required_argument, nullptr, OPT_ALERT_HOOK},
+        {"alert-hook-interval", required_argument, nullptr,
+         OPT_ALERT_HOOK_INTERVAL},
+        {"serve", optional_argument, nullptr, OPT_SERVE},
+        {"connect", required_argument, nullptr, OPT_CONNECT},
+        {"udp", no_argument, nullptr, OPT_UDP},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    bool is_export = false;
+    bool is_paced = false;
+    bool is_snapshot = false;
+
+    int opt{0};
+    while ((opt = getopt_long(argc, argv, "h", long_opts, nullptr)) != -1) {
+        switch (opt) {
+        case 'h':
+            exit_with_usage(argv[0], EXIT_SUCCESS);
+        case OPT_INTERVAL: {
+            char *end{nullptr};
+            auto millis = std::strtol(optarg, &end, 10);
+            opts.interval = Millis{millis};
+
+            if ((*end != '\0') ||
+                !sampling::is_sampling_interval(opts.interval)) {
+                std::cerr << "Invalid interval: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        }
+        case OPT_ADAPTIVE: {
+            if (optarg == nullptr) {
+                opts.adaptive_threshold = DEFAULT_ADAPTIVE_THRESHOLD;
+                break;
+            }
+
+            char *end{nullptr};
+            auto threshold = std::strtoll(optarg, &end, 10);
+            if ((*end != '\0') || (end == optarg) || (threshold < 0)) {
+                std::cerr << "Invalid adaptive threshold: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            opts.adaptive_threshold = U64(threshold);
+            break;
+        }
+        case OPT_DAEMON:
+            opts.mode = RunMode::DAEMON;
+            break;
+        case OPT_ATTACH:
+            opts.mode = RunMode::ATTACH;
+            break;
+        case OPT_SOCKET:
+            opts.socket_path = optarg;
+            break;
+        case OPT_SHM:
+            opts.shm_name =
+                optarg != nullptr ? optarg : service::get_default_shm_name();
+            break;
+        case OPT_HISTORY_DIR:
+            opts.history_dir = optarg;
+            break;
+        case OPT_SNAPSHOT:
+            is_snapshot = true;
+            opts.snapshot_path = optarg != nullptr
+                                     ? optarg
+                                     : sampling::get_default_snapshot_path();
+            break;
+        case OPT_METRICS:
+            opts.metrics_address = optarg;
+            break;
+        case OPT_OUTPUT:
+            is_export = true;
+            if (!service::parse_export_format(optarg, &opts.export_format)) {
+                std::cerr << "Invalid output format: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        case OPT_OUTPUT_FILE:
+            opts.output_path = optarg;
+            break;
+        case OPT_OUTPUT_WINDOW: {
+            char *end{nullptr};
+            opts.output_window = Millis{std::strtol(optarg, &end, 10)};
+
+            if ((*end != '\0') || (opts.output_window.count() <= 0)) {
+                std::cerr << "Invalid output window: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        }
+        case OPT_RETENTION:
+            if (!sampling::parse_retention(optarg, &opts.retention)) {
+                std::cerr << "Invalid retention: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        case OPT_COUNTERS:
+            if (!sampling::parse_quantities(optarg, &opts.quantities)) {
+                std::cerr << "Invalid counters: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        case OPT_FPS: {
+            char *end{nullptr};
+            auto fps = std::strtol(optarg, &end, 10);
+
+            if ((*end != '\0') || (fps < 1) || (fps > MAX_FPS)) {
+                std::cerr << "Invalid fps: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            opts.max_fps = static_cast<unsigned>(fps);
+            break;
+        }
+        case OPT_STATS:
+            opts.print_stats = true;
+            break;
+        case OPT_REPLAY:
+            opts.mode = RunMode::REPLAY;
+            opts.replay_path = optarg;
+            break;
+        case OPT_SPEED: {
+            char *end{nullptr};
+            opts.replay_speed = std::strtod(optarg, &end);
+            is_paced = true;
+
+            if ((*end != '\0') || !(opts.replay_speed > 0)) {
+                std::cerr << "Invalid speed: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        }
+        case OPT_QUEUES:
+            opts.sample_queues = true;
+            break;
+        case OPT_CGROUPS:
+            opts.sample_cgroups = true;
+            break;
+        case OPT_ALERT: {
+            sampling::AlertRule rule{};
+            if (!sampling::parse_alert_rule(optarg, &rule)) {
+                std::cerr << "Invalid alert: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            opts.alert_rules.push_back(rule);
+            break;
+        }
+        case OPT_ALERT_HOOK:
+            opts.alert_hook = optarg;
+            break;
+        case OPT_ALERT_HOOK_INTERVAL:
+            if (!sampling::parse_duration(optarg,
+                                          &opts.alert_hook_interval)) {
+                std::cerr << "Invalid alert hook interval: " << optarg
+                          << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        case OPT_SERVE:
+            opts.serve_address =
+                optarg != nullptr ? optarg : service::DEFAULT_REMOTE_PORT;
+            break;
+        case OPT_CONNECT: {
+            opts.mode = RunMode::CONNECT;
+
+            std::string_view list{optarg};
+            while (!list.empty()) {
+                auto comma = list.find(',');
+                auto address = list.substr(0, comma);
+                if (!address.empty()) {
+                    opts.remote_addresses.emplace_back(address);
+                }
+                list.remove_prefix(comma == std::string_view::npos
+                                       ? list.size()
+                                       : comma + 1);
+            }
+
+            if (opts.remote_addresses.empty()) {
+                std::cerr << "Invalid connect: " << optarg << "\n";
+                exit_with_usage(argv[0], EXIT_FAILURE);
+            }
+            break;
+        }
+        case OPT_UDP:
+            opts.is_remote_udp = true;
+            break;
+        default:
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+    }
+
+    // Serving is what a daemon does, with or without --daemon
+    if (!opts.serve_address.empty()) {
+        if (((opts.mode != RunMode::MONITOR) &&
+             (opts.mode != RunMode::DAEMON)) ||
+            is_export) {
+            std::cerr << "--serve cannot be combined with --attach, "
+                         "--connect, --replay or --output\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+        opts.mode = RunMode::DAEMON;
+    }
+
+    // Only what is sampled here is snapshot, and the files keep it already
+    if (is_snapshot) {
+        if (((opts.mode != RunMode::MONITOR) &&
+             (opts.mode != RunMode::DAEMON)) ||
+            is_export || !opts.history_dir.empty()) {
+            std::cerr << "--snapshot cannot be combined with --history-dir, "
+                         "--attach, --connect, --replay or --output\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+        if (opts.snapshot_path.empty()) {
+            std::cerr << "--snapshot needs a PATH without a home directory\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+    }
+
+    // An export has a record for every interval, and the alerts a closed
+    // bucket, which an iface that is backed off on does not have yet. The
+    // cgroups are read all at once anyway.
+    if (opts.adaptive_threshold.has_value()) {
+        if (((opts.mode != RunMode::MONITOR) &&
+             (opts.mode != RunMode::DAEMON)) ||
+            is_export || !opts.alert_rules.empty() || opts.sample_cgroups) {
+            std::cerr << "--adaptive cannot be combined with --attach, "
+                         "--connect, --replay, --output, --alert or "
+                         "--cgroups\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+    }
+
+    if (opts.is_remote_udp && (opts.mode != RunMode::CONNECT)) {
+        std::cerr << "--udp requires --connect\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    if (!opts.metrics_address.empty() && (opts.mode != RunMode::DAEMON)) {
+        std::cerr << "--metrics requires --daemon\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    // Only the terminal ui is timed
+    if (opts.print_stats && (opts.mode == RunMode::DAEMON)) {
+        std::cerr << "--stats cannot be combined with --daemon\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    bool is_viewer = (opts.mode == RunMode::ATTACH) ||
+                     (opts.mode == RunMode::REPLAY) ||
+                     (opts.mode == RunMode::CONNECT);
+    if (opts.sample_queues && is_viewer) {
+        std::cerr << "--queues cannot be combined with --attach, --connect "
+                     "or --replay\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    if (opts.sample_cgroups && (opts.sample_queues || is_viewer)) {
+        std::cerr << "--cgroups cannot be combined with --queues, --attach, "
+                     "--connect or --replay\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    // The terminal ui holds the rules, the daemon and the export do not
+    if (!opts.alert_rules.empty() &&
+        ((opts.mode == RunMode::DAEMON) || is_export)) {
+        std::cerr << "--alert cannot be combined with --daemon or "
+                     "--output\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    if (!opts.alert_hook.empty() && opts.alert_rules.empty()) {
+        std::cerr << "--alert-hook requires --alert\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    if (is_paced && (opts.mode != RunMode::REPLAY)) {
+        std::cerr << "--speed requires --replay\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    if (is_export) {
+        if (opts.mode != RunMode::MONITOR) {
+            std::cerr << "--output cannot be combined with --daemon, "
+                         "--attach, --connect or --replay\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+        if (opts.print_stats) {
+            std::cerr << "--output cannot be combined with --stats\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+        opts.mode = RunMode::EXPORT;
+    }
+
+    // Only the windows that are recorded at the interval have buckets
+    if (opts.output_window.count() > 0) {
+        auto windows = sampling::get_windows_for_interval(opts.interval);
+        auto is_recorded =
+            std::any_of(windows.begin(), windows.end(),
+                        [&opts](sampling::AggregationWindow window) {
+                            return sampling::get_duration(window) ==
+                                   opts.output_window;
+                        });
+
+        if (!is_recorded) {
+            std::cerr << "Invalid output window: "
+                      << opts.output_window.count() << "\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+    }
+
+    for (int i = optind; i < argc; ++i) {
+        opts.iface_patterns.emplace_back(argv[i]);
+    }
+
+    // The daemon decides what is sampled and how often
+    if (opts.mode == RunMode::ATTACH) {
+        if (!opts.iface_patterns.empty()) {
+            std::cerr << "--attach takes no <iface_name>\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+        return opts;
+    }
+
+    // and the recording does for a replay
+    if (opts.mode == RunMode::REPLAY) {
+        if (!opts.iface_patterns.empty()) {
+            std::cerr << "--replay takes no <iface_name>\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+        return opts;
+    }
+
+    // and the daemons do for the hosts they are on
+    if (opts.mode == RunMode::CONNECT) {
+        if (!opts.iface_patterns.empty()) {
+            std::cerr << "--connect takes no <iface_name>\n";
+            exit_with_usage(argv[0], EXIT_FAILURE);
+        }
+        return opts;
+    }
+
+    if (opts.iface_patterns.empty()) {
+        std::cerr << "Must pass <iface_name>\n";
+        exit_with_usage(argv[0], EXIT_FAILURE);
+    }
+
+    return opts;
+}
+
+void OptionsParser::exit_with_usage(const char *prog, int status) const {
+    auto &out = status == EXIT_SUCCESS ? std::cout : std::cerr;
+
+    out << "Usage: " << prog << " [options] <iface_name> [<iface_name> ...]\n"
+        << "       " << prog << " --attach [--socket=PATH | --shm[=NAME]]\n"
+        << "       " << prog << " --replay=FILE [--speed=N]\n"
+        << "       " << prog << " --connect=HOST[:PORT][,...] [--udp]\n"
+        << "\n"
+        << "Options:\n"
+        << "  --interval=MS   sample every MS milliseconds: 100, 250, 500 "
+           "or 1000\n"
+        << "                  (default: 1000)\n"
+        << "  --adaptive[=BYTES]\n"
+        << "                  sample the ifaces that count fewer than BYTES "
+           "a second less\n"
+        << "                  often, down to every "
+        << sampling::AdaptiveSchedule::MAX_BACKOFF
+        << " intervals (default: "
+        << DEFAULT_ADAPTIVE_THRESHOLD << ")\n"
+        << "  --retention=WINDOW=DURATION[,...]\n"
+        << "                  keep the buckets of WINDOW (100ms, 250ms, "
+           "500ms, sec, min,\n"
+        << "                  hour or day) for DURATION, a number followed by "
+           "s, m, h\n"
+        << "                  or d (default: 5m of sub-second windows, "
+           "sec=1h,min=2d,\n"
+        << "                  hour=90d,day=730d)\n"
+        << "  --counters=LIST also record packets, errors or drops, eg. "
+           "packets,drops\n"
+        << "                  (default: bytes only)\n"
+        << "  --fps=N         redraw the terminal at most N times a second, "
+           "1 to 1000\n"
+        << "                  (default: 30)\n"
+        << "  --queues        sample every queue of the NICs as an iface of "
+           "its own, eg.\n"
+        << "                  eth0/q0, eth0/q1 and on, from the counters of "
+           "ethtool -S\n"
+        << "  --cgroups       sample the cgroups named by their paths, eg. "
+           "'/system.slice/*',\n"
+        << "                  rather than ifaces, if built with BANDWIT_BPF\n"
+        << "  --alert=RULE    highlight the ifaces that meet RULE in the menu "
+           "bar, eg.\n"
+        << "                  rx>90%/30s for above 90% of the line rate for "
+           "30 seconds\n"
+        << "                  or tx=0/10s for nothing sent for 10 seconds, "
+           "repeatable\n"
+        << "  --alert-hook=CMD\n"
+        << "                  run CMD with the shell when an alert goes on "
+           "or off, with\n"
+        << "                  BW_IFACE, BW_ALERT and BW_STATE set\n"
+        << "  --alert-hook-interval=DURATION\n"
+        << "                  run it once per DURATION for a rule and an "
+           "iface at most\n"
+        << "                  (default: 1m)\n"
+        << "  --stats         print the latencies of sampling and drawing "
+           "on exit\n"
+        << "  --history-dir=DIR\n"
+        << "                  keep the history in files in DIR, so that it "
+           "survives\n"
+        << "                  restarts\n"
+        << "  --snapshot[=PATH]\n"
+        << "                  write the history to PATH on SIGUSR1 and on "
+           "exit, and pick\n"
+        << "                  it up from there on startup\n"
+        << "                  (default: "
+        << sampling::get_default_snapshot_path() << ")\n"
+        << "  --daemon        sample in the background and serve the history "
+           "to\n"
+        << "                  clients that --attach\n"
+        << "  --attach        display the history of a running --daemon\n"
+        << "  --socket=PATH   the socket of the daemon\n"
+        << "                  (default: " << service::get_default_socket_path()
+        << ")\n"
+        << "  --shm[=NAME]    with --daemon also publish the history to a "
+           "shared\n"
+        << "                  memory segment, with --attach read it from "
+           "there\n"
+        << "                  (default: " << service::get_default_shm_name()
+        << ")\n"
+        << "  --metrics=[HOST:]PORT\n"
+        << "                  with --daemon serve Prometheus metrics at "
+           "/metrics\n"
+        << "  --serve[=[HOST:]PORT]\n"
+        << "                  sample as a --daemon and stream the samples to "
+           "viewers that\n"
+        << "                  --connect over TCP or UDP (default: port "
+        << service::DEFAULT_REMOTE_PORT << ")\n"
+        << "  --connect=HOST[:PORT][,...]\n"
+        << "                  display the ifaces of the daemons that --serve "
+           "on the hosts\n"
+        << "                  together, eg. web1:eth0 for eth0 on web1\n"
+        << "  --udp           with --connect subscribe to the samples over "
+           "UDP rather\n"
+        << "                  than TCP, lost ones are gaps\n"
+        << "  --output=FORMAT stream the samples to stdout as csv, jsonl or "
+           "binary\n"
+        << "                  records instead of displaying them\n"
+        << "  --output-file=PATH\n"
+        << "                  stream them to PATH instead of stdout\n"
+        << "  --output-window=MS\n"
+        << "                  stream one record per closed bucket of MS "
+           "milliseconds:\n"
+        << "                  the interval, 1000, 60000, 3600000 or "
+           "86400000\n"
+        << "  --replay=FILE   display a recording of --output=binary as it "
+           "is replayed\n"
+        << "  --speed=N       replay N times as fast as it was recorded "
+           "(default: as\n"
+        << "                  fast as it can)\n"
+        << "  -h, --help      show this help\n";
+
+    exit(status);
+}
+
+} // namespace bandwit
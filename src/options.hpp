@@ -0,0 +1,115 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "sampling/alert_rule.hpp"
+#include "sampling/quantity.hpp"
+#include "sampling/retention.hpp"
+#include "service/record_encoder.hpp"
+
+namespace bandwit {
+
+enum class RunMode {
+    // sample and display in this process
+    MONITOR,
+    // sample without a terminal and serve clients over a socket
+    DAEMON,
+    // display what a daemon samples
+    ATTACH,
+    // display a recording of the binary export
+    REPLAY,
+    // sample and stream the deltas as records
+    EXPORT,
+    // display what the daemons on other hosts serve
+    CONNECT,
+};
+
+struct Options {
+    RunMode mode{RunMode::MONITOR};
+
+    // iface names or glob patterns like 'eth*'
+    std::vector<std::string> iface_patterns{};
+
+    // sample the queues of the ifaces rather than the ifaces
+    bool sample_queues{false};
+
+    // the patterns are of cgroups rather than of ifaces
+    bool sample_cgroups{false};
+
+    // how often to sample the counters
+    Millis interval{1000};
+    // back off on the ifaces that count fewer bytes a second than this, if
+    // set
+    std::optional<uint64_t> adaptive_threshold{};
+
+    // how long the buckets of every window are kept for
+    sampling::Retention retention{};
+
+    // what is counted, each one adds up to another history as large as that
+    // of the bytes
+    std::vector<sampling::Quantity> quantities{sampling::Quantity::BYTES};
+
+    // held against every iface as its buckets close, shown in the menu bar
+    std::vector<sampling::AlertRule> alert_rules{};
+    // run when an alert goes on or off, if not empty
+    std::string alert_hook{};
+    // how often the hook runs for a rule and an iface at most
+    Millis alert_hook_interval{60 * 1000};
+
+    // how many times a second the terminal is redrawn at most
+    unsigned max_fps{30};
+
+    // print the latencies of the stages on exit
+    bool print_stats{false};
+
+    // the unix socket the daemon listens on
+    std::string socket_path{};
+
+    // the shared memory segment the daemon publishes to, if not empty
+    std::string shm_name{};
+
+    // where the history is kept across restarts, if not empty
+    std::string history_dir{};
+    // where the history is snapshot to on SIGUSR1 and on exit, and restored
+    // from on startup, if not empty
+    std::string snapshot_path{};
+
+    // [HOST:]PORT to serve Prometheus metrics on, if not empty
+    std::string metrics_address{};
+
+    // [HOST:]PORT to stream the samples to remote viewers on, if not empty
+    std::string serve_address{};
+    // HOST[:PORT] of every daemon to display the ifaces of
+    std::vector<std::string> remote_addresses{};
+    // whether the daemons are subscribed to over UDP rather than TCP
+    bool is_remote_udp{false};
+
+    service::ExportFormat export_format{service::ExportFormat::CSV};
+    // stdout if empty
+    std::string output_path{};
+    // zero exports every sample, else every closed bucket of the window
+    Millis output_window{0};
+
+    // the recording to replay
+    std::string replay_path{};
+    // how many times as fast as it was recorded, 0 is as fast as it can
+    double replay_speed{0};
+};
+
+class OptionsParser {
+  public:
+    // Prints the usage and exits on invalid arguments
+    Options parse(int argc, char *argv[]) const;
+
+  private:
+    [[noreturn]] void exit_with_usage(const char *prog, int status) const;
+};
+
+} // namespace bandwit
+
+#endif // OPTIONS_H
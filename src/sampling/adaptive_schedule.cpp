@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "adaptive_schedule.hpp"
+#include "macros.hpp"
+#include "sampling/agg_window.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// the bytes between two readings of a counter, if it did not go back
+static bool get_count(uint64_t prev, uint64_t cur, uint64_t *count) {
+    if (cur < prev) {
+        return false;
+    }
+
+    *count += cur - prev;
+    return true;
+}
+
+AdaptiveSchedule::AdaptiveSchedule(const History &history, TimePoint start,
+                                   Millis interval, uint64_t threshold,
+                                   std::vector<Sample> first_samples)
+    : interval_{interval}, threshold_{threshold} {
+    // there is always a coarser window than the interval
+    auto window = get_windows_for_interval(interval_).at(1);
+    span_ = get_duration(window);
+
+    // A restored history may have been started at another time, and its
+    // buckets with it
+    auto qtty = history.get_quantities().front();
+    states_.resize(history.num_ifaces());
+    for (std::size_t i = 0; i < states_.size(); ++i) {
+        auto &state = states_[i];
+        state.last = first_samples[i];
+        state.last_tp = start;
+        state.origin = history.get_rx(i, qtty).floor(window, start);
+    }
+}
+
+void AdaptiveSchedule::sample(Sampler *sampler,
+                              const std::vector<std::string> &iface_names,
+                              TimePoint tp, std::vector<Sample> *samples) {
+    due_.clear();
+    for (std::size_t i = 0; i < states_.size(); ++i) {
+        if (is_due(states_[i], tp)) {
+            due_.push_back(i);
+        }
+    }
+
+    // Nothing to pick out while they are all busy. A bulk sampler reads
+    // every iface anyway, it gets the same names every time and the ones
+    // that are not due are dropped after, rather than a subset that keeps
+    // changing and that it would index anew, or worse, every time.
+    if ((due_.size() == states_.size()) || sampler->is_bulk()) {
+        sampler->get_samples(iface_names, samples);
+
+        std::size_t next{0};
+        for (std::size_t i = 0; i < states_.size(); ++i) {
+            auto &sample = (*samples)[i];
+            if ((next < due_.size()) && (due_[next] == i)) {
+                update(&states_[i], sample, tp);
+                ++next;
+            } else {
+                sample = Sample{};
+                sample.error = SampleError::NOT_DUE;
+            }
+        }
+        return;
+    }
+
+    due_names_.resize(due_.size());
+    for (std::size_t i = 0; i < due_.size(); ++i) {
+        due_names_[i] = iface_names[due_[i]];
+    }
+
+    if (!due_names_.empty()) {
+        sampler->get_samples(due_names_, &due_samples_);
+    }
+
+    samples->resize(states_.size());
+    for (auto &sample : *samples) {
+        sample = Sample{};
+        sample.error = SampleError::NOT_DUE;
+    }
+
+    for (std::size_t i = 0; i < due_.size(); ++i) {
+        auto idx = due_[i];
+        (*samples)[idx] = due_samples_[i];
+        update(&states_[idx], due_samples_[i], tp);
+    }
+}
+
+bool AdaptiveSchedule::is_due(const State &state, TimePoint tp) const {
+    if (tp - state.last_tp >= interval_ * state.backoff) {
+        return true;
+    }
+
+    // the last deadline of the bucket tp falls into
+    return (tp - state.origin) / span_ !=
+           (tp + interval_ - state.origin) / span_;
+}
+
+void AdaptiveSchedule::update(State *state, const Sample &sample,
+                              TimePoint tp) const {
+    // An iface that failed or whose counters went back is sampled at every
+    // interval until it is known to be idle
+    auto elapsed = std::chrono::duration_cast<Millis>(tp - state->last_tp);
+    uint64_t count{0};
+    bool is_idle =
+        (sample.error == SampleError::NONE) &&
+        (state->last.error == SampleError::NONE) &&
+        get_count(state->last.rx[Quantity::BYTES], sample.rx[Quantity::BYTES],
+                  &count) &&
+        get_count(state->last.tx[Quantity::BYTES], sample.tx[Quantity::BYTES],
+                  &count) &&
+        (count * 1000 <= threshold_ * U64(elapsed.count()));
+
+    state->backoff = is_idle ? std::min(state->backoff * 2, MAX_BACKOFF) : 1;
+    state->last = sample;
+    state->last_tp = tp;
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,74 @@
+#ifndef ADAPTIVE_SCHEDULE_H
+#define ADAPTIVE_SCHEDULE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "sampling/history.hpp"
+#include "sampling/sample.hpp"
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// Backs off on the ifaces that are idle, ie. that counted fewer bytes a
+// second than the threshold since they were last sampled, rx and tx
+// together. An idle iface is sampled every 2, 4, 8 and at most MAX_BACKOFF
+// intervals, and at every interval again from the first sample that is not
+// idle on. The delta of the sample after the intervals it was not sampled
+// for covers all of them, and the history spreads it over their buckets.
+//
+// Every iface is also sampled for the last deadline of every bucket of the
+// window after the finest, eg. once a minute at an interval of 1s. A delta
+// then never spans two of its buckets, so they and the buckets of every
+// coarser window hold exactly what was counted, and only the finest buckets
+// of an iface that was backed off on are even shares of it.
+class AdaptiveSchedule {
+  public:
+    // At most this many intervals between the samples of an idle iface
+    static constexpr uint32_t MAX_BACKOFF = 16;
+
+    // The deadlines are interval apart from start on. The first samples are
+    // the ones the deltas start from, of every iface of the history in
+    // turn, and its buckets are the ones that the deltas must not span.
+    AdaptiveSchedule(const History &history, TimePoint start, Millis interval,
+                     uint64_t threshold, std::vector<Sample> first_samples);
+
+    // Takes the samples of the ifaces that are due for the deadline tp, in
+    // the same order as the names, the others get a NOT_DUE sample. Only a
+    // sampler that is not bulk is asked for just the ones that are due.
+    void sample(Sampler *sampler, const std::vector<std::string> &iface_names,
+                TimePoint tp, std::vector<Sample> *samples);
+
+  private:
+    struct State {
+        // the last sample taken and the deadline it was taken for
+        Sample last{};
+        TimePoint last_tp{};
+        // the intervals from one sample to the next
+        uint32_t backoff{1};
+        // where a bucket of the window after the finest starts
+        TimePoint origin{};
+    };
+
+    bool is_due(const State &state, TimePoint tp) const;
+    void update(State *state, const Sample &sample, TimePoint tp) const;
+
+    Millis interval_{};
+    // of the window after the finest
+    Millis span_{};
+    uint64_t threshold_{0};
+    std::vector<State> states_{};
+
+    // reused for every deadline, of the ifaces that are due
+    std::vector<std::size_t> due_{};
+    std::vector<std::string> due_names_{};
+    std::vector<Sample> due_samples_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // ADAPTIVE_SCHEDULE_H
@@ -1,36 +1,41 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "except.hpp"
+#include "macros.hpp"
 #include "sampling/agg_window.hpp"
 
 namespace bandwit {
 namespace sampling {
 
-AggregationWindow next_interval(AggregationWindow agg_window) {
-    switch (agg_window) {
-    case AggregationWindow::ONE_SECOND:
-        return AggregationWindow::ONE_MINUTE;
-    case AggregationWindow::ONE_MINUTE:
-        return AggregationWindow::ONE_HOUR;
-    case AggregationWindow::ONE_HOUR:
-        return AggregationWindow::ONE_DAY;
-    case AggregationWindow::ONE_DAY:
-        return AggregationWindow::ONE_DAY;
+AggregationWindow next_interval(AggregationWindow agg_window,
+                                const std::vector<AggregationWindow> &windows) {
+    auto it = std::find(windows.begin(), windows.end(), agg_window);
+    if ((it == windows.end()) || (it + 1 == windows.end())) {
+        return agg_window;
     }
+
+    return *(it + 1);
 }
 
-AggregationWindow prev_interval(AggregationWindow agg_window) {
-    switch (agg_window) {
-    case AggregationWindow::ONE_DAY:
-        return AggregationWindow::ONE_HOUR;
-    case AggregationWindow::ONE_HOUR:
-        return AggregationWindow::ONE_MINUTE;
-    case AggregationWindow::ONE_MINUTE:
-        return AggregationWindow::ONE_SECOND;
-    case AggregationWindow::ONE_SECOND:
-        return AggregationWindow::ONE_SECOND;
+AggregationWindow prev_interval(AggregationWindow agg_window,
+                                const std::vector<AggregationWindow> &windows) {
+    auto it = std::find(windows.begin(), windows.end(), agg_window);
+    if ((it == windows.end()) || (it == windows.begin())) {
+        return agg_window;
     }
+
+    return *(it - 1);
 }
 
 std::string get_label(AggregationWindow agg_window) {
     switch (agg_window) {
+    case AggregationWindow::TENTH_SECOND:
+        return "100ms";
+    case AggregationWindow::QUARTER_SECOND:
+        return "250ms";
+    case AggregationWindow::HALF_SECOND:
+        return "500ms";
     case AggregationWindow::ONE_SECOND:
         return "sec";
     case AggregationWindow::ONE_MINUTE:
@@ -40,7 +45,40 @@ std::string get_label(AggregationWindow agg_window) {
     case AggregationWindow::ONE_DAY:
         return "day";
     }
+
+    THROW_MSG(std::logic_error, "unknown aggregation window");
+}
+
+Millis get_duration(AggregationWindow agg_window) {
+    return Millis{INT(agg_window)};
+}
+
+bool is_sampling_interval(Millis interval) {
+    switch (interval.count()) {
+    case INT(AggregationWindow::TENTH_SECOND):
+    case INT(AggregationWindow::QUARTER_SECOND):
+    case INT(AggregationWindow::HALF_SECOND):
+    case INT(AggregationWindow::ONE_SECOND):
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::vector<AggregationWindow> get_windows_for_interval(Millis interval) {
+    std::vector<AggregationWindow> windows{};
+
+    if (interval < get_duration(AggregationWindow::ONE_SECOND)) {
+        windows.push_back(static_cast<AggregationWindow>(interval.count()));
+    }
+
+    windows.push_back(AggregationWindow::ONE_SECOND);
+    windows.push_back(AggregationWindow::ONE_MINUTE);
+    windows.push_back(AggregationWindow::ONE_HOUR);
+    windows.push_back(AggregationWindow::ONE_DAY);
+
+    return windows;
 }
 
 } // namespace sampling
-} // namespace bandwit
\ No newline at end of file
+} // namespace bandwit
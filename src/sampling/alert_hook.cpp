@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "alert_hook.hpp"
+
+extern char **environ;
+
+namespace bandwit {
+namespace sampling {
+
+AlertHook::AlertHook(std::string command, Millis min_interval)
+    : command_{std::move(command)}, min_interval_{min_interval} {}
+
+bool AlertHook::run(std::size_t rule_idx, std::size_t iface_idx,
+                    const std::string &iface_name,
+                    const std::string &rule_text, bool is_on,
+                    SteadyTimePoint now) {
+    reap();
+    if (running_.size() >= MAX_RUNNING) {
+        return false;
+    }
+
+    auto key = std::make_pair(rule_idx, iface_idx);
+    auto it = last_runs_.find(key);
+    if ((it != last_runs_.end()) && (now < it->second + min_interval_)) {
+        return false;
+    }
+
+    // The variables of the alert go first, where getenv finds them before
+    // any of the same name that we were started with
+    std::vector<std::string> vars{"BW_IFACE=" + iface_name,
+                                  "BW_ALERT=" + rule_text,
+                                  std::string{"BW_STATE="} +
+                                      (is_on ? "on" : "off")};
+    std::vector<char *> envp{};
+    for (auto &var : vars) {
+        envp.push_back(var.data());
+    }
+    for (auto **var = environ; *var != nullptr; ++var) {
+        envp.push_back(*var);
+    }
+    envp.push_back(nullptr);
+
+    std::string shell{"/bin/sh"};
+    std::string shell_opt{"-c"};
+    std::vector<char *> argv{shell.data(), shell_opt.data(), command_.data(),
+                             nullptr};
+
+    posix_spawn_file_actions_t actions{};
+    posix_spawnattr_t attr{};
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attr);
+
+    for (int fd : {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO}) {
+        posix_spawn_file_actions_addopen(&actions, fd, "/dev/null", O_RDWR,
+                                         0);
+    }
+
+    // The signals we block, eg. SIGINT while the terminal is set up, are
+    // nothing for it to inherit, and a Ctrl+C is for us rather than for it
+    sigset_t empty_mask;
+    sigemptyset(&empty_mask);
+    posix_spawnattr_setsigmask(&attr, &empty_mask);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setflags(&attr,
+                             POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+
+    pid_t pid{-1};
+    int rv = posix_spawn(&pid, shell.c_str(), &actions, &attr, argv.data(),
+                         envp.data());
+
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (rv != 0) {
+        return false;
+    }
+
+    running_.push_back(pid);
+    last_runs_[key] = now;
+    return true;
+}
+
+void AlertHook::reap() {
+    running_.erase(std::remove_if(running_.begin(), running_.end(),
+                                  [](pid_t pid) {
+                                      int status{0};
+                                      return waitpid(pid, &status, WNOHANG) !=
+                                             0;
+                                  }),
+                   running_.end());
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,50 @@
+#ifndef ALERT_HOOK_H
+#define ALERT_HOOK_H
+
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+#include "aliases.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// Runs a shell command whenever an alert goes on or off, with what it is
+// about in BW_IFACE, BW_ALERT (the rule, eg. "rx>90%/30s") and BW_STATE (on
+// or off). The command gets /dev/null for stdin, stdout and stderr, so that
+// it cannot draw over the terminal ui, and is not waited for.
+//
+// A link that flaps makes one run per min_interval for each rule and iface
+// at most, and there are never more than a handful of runs at a time. The
+// runs that are left out are dropped, not queued.
+class AlertHook {
+  public:
+    AlertHook(std::string command, Millis min_interval);
+
+    // Returns whether the command was started
+    bool run(std::size_t rule_idx, std::size_t iface_idx,
+             const std::string &iface_name, const std::string &rule_text,
+             bool is_on, SteadyTimePoint now);
+
+    // Reaps the runs that exited, without waiting for the others
+    void reap();
+
+  private:
+    static constexpr std::size_t MAX_RUNNING = 4;
+
+    std::string command_{};
+    Millis min_interval_{};
+
+    // by rule and iface
+    std::map<std::pair<std::size_t, std::size_t>, SteadyTimePoint>
+        last_runs_{};
+    std::vector<pid_t> running_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // ALERT_HOOK_H
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "alert_monitor.hpp"
+#include "counter_delta.hpp"
+#include "except.hpp"
+#include "link_speed.hpp"
+#include "macros.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+AlertMonitor::AlertMonitor(std::vector<AlertRule> rules,
+                           AggregationWindow window)
+    : rules_{std::move(rules)}, window_{window} {}
+
+bool AlertMonitor::update(const History &history) {
+    changes_.clear();
+    if ((history.num_ifaces() == 0) || rules_.empty()) {
+        return false;
+    }
+
+    // eg. a daemon that was restarted with other ifaces
+    if (history.num_ifaces() != num_ifaces_) {
+        reset(history);
+    }
+
+    // Every iface is sampled at the same time, so the buckets of all of them
+    // close together
+    auto open = history.get_rx(0).max(window_);
+    if (!open_.has_value() || (open < open_.value())) {
+        open_ = open;
+        return false;
+    }
+
+    // After a long sleep only the buckets that any rule still covers
+    auto interval = get_duration(window_);
+    std::size_t max_len{0};
+    for (const auto &state : states_) {
+        max_len = std::max(max_len, state.ring.size());
+    }
+    auto num_closed = SIZE_T((open - open_.value()) / interval);
+    auto tp = open - interval * std::min(num_closed, max_len);
+    open_ = open;
+
+    for (; tp < open; tp += interval) {
+        for (std::size_t i = 0; i < num_ifaces_; ++i) {
+            const auto &ts_coll_rx = history.get_rx(i);
+            const auto &ts_coll_tx = history.get_tx(i);
+            Bucket rx{};
+            Bucket tx{};
+            bool is_loaded = false;
+
+            for (std::size_t r = 0; r < rules_.size(); ++r) {
+                auto &state = states_[r * num_ifaces_ + i];
+                if (!state.limit.has_value()) {
+                    continue;
+                }
+
+                // only read once there is a rule that takes it
+                if (!is_loaded) {
+                    rx = ts_coll_rx.get_bucket(window_, tp);
+                    tx = ts_coll_tx.get_bucket(window_, tp);
+                    is_loaded = true;
+                }
+
+                push(&state, rules_[r].is_rx ? rx : tx);
+
+                if ((state.num_filled < state.ring.size()) ||
+                    (state.num_gaps > 0)) {
+                    continue;
+                }
+
+                auto is_on = is_met(rules_[r], state);
+                if (is_on != state.is_on) {
+                    set_on(r, i, is_on, tp);
+                }
+            }
+        }
+    }
+
+    return !changes_.empty();
+}
+
+const std::vector<AlertMonitor::Alert> &AlertMonitor::get_active() const {
+    return active_;
+}
+
+const std::vector<AlertMonitor::Alert> &AlertMonitor::get_changes() const {
+    return changes_;
+}
+
+const AlertRule &AlertMonitor::get_rule(std::size_t rule_idx) const {
+    return rules_[rule_idx];
+}
+
+void AlertMonitor::reset(const History &history) {
+    num_ifaces_ = history.num_ifaces();
+    states_.assign(rules_.size() * num_ifaces_, State{});
+    active_.clear();
+    open_.reset();
+
+    // The line rates are read once, for the ifaces that have a rule of it
+    std::vector<std::optional<uint64_t>> speeds(num_ifaces_);
+    bool has_line_rate =
+        std::any_of(rules_.begin(), rules_.end(),
+                    [](const AlertRule &rule) { return rule.is_line_rate; });
+    for (std::size_t i = 0; has_line_rate && (i < num_ifaces_); ++i) {
+        speeds[i] = read_link_speed(history.get_iface_name(i));
+    }
+
+    auto interval = get_duration(window_);
+    for (std::size_t r = 0; r < rules_.size(); ++r) {
+        const auto &rule = rules_[r];
+
+        // the buckets that the duration takes, rounded up
+        auto num_buckets = std::max(
+            SIZE_T((rule.duration + interval - Millis{1}) / interval),
+            std::size_t{1});
+        auto secs = F64(num_buckets * SIZE_T(interval.count())) / 1000;
+
+        for (std::size_t i = 0; i < num_ifaces_; ++i) {
+            auto &state = states_[r * num_ifaces_ + i];
+            state.ring.assign(num_buckets, 0);
+
+            if (!rule.is_line_rate) {
+                state.limit = rule.threshold * secs;
+            } else if (speeds[i].has_value()) {
+                state.limit =
+                    F64(speeds[i].value()) * rule.threshold / 100 * secs;
+            }
+        }
+    }
+}
+
+void AlertMonitor::push(State *state, const Bucket &bucket) const {
+    // A bucket without a sample is a gap
+    auto value = bucket.count > 0 ? bucket.sum : GAP_DELTA;
+
+    auto &oldest = state->ring[state->pos];
+    if (state->num_filled == state->ring.size()) {
+        if (oldest == GAP_DELTA) {
+            state->num_gaps--;
+        } else {
+            state->sum -= oldest;
+        }
+    } else {
+        state->num_filled++;
+    }
+
+    oldest = value;
+    if (value == GAP_DELTA) {
+        state->num_gaps++;
+    } else {
+        state->sum += value;
+    }
+
+    state->pos = (state->pos + 1) % state->ring.size();
+}
+
+bool AlertMonitor::is_met(const AlertRule &rule, const State &state) const {
+    auto sum = F64(state.sum);
+    auto limit = state.limit.value();
+
+    switch (rule.op) {
+    case AlertOp::ABOVE:
+        return sum > limit;
+    case AlertOp::BELOW:
+        return sum < limit;
+    case AlertOp::EQUAL:
+        return sum == limit;
+    }
+
+    THROW_MSG(std::logic_error, "unknown alert op");
+}
+
+void AlertMonitor::set_on(std::size_t rule_idx, std::size_t iface_idx,
+                          bool is_on, TimePoint tp) {
+    states_[rule_idx * num_ifaces_ + iface_idx].is_on = is_on;
+
+    Alert alert{rule_idx, iface_idx, is_on, tp};
+    changes_.push_back(alert);
+
+    if (is_on) {
+        active_.push_back(alert);
+        return;
+    }
+
+    active_.erase(std::remove_if(active_.begin(), active_.end(),
+                                 [rule_idx, iface_idx](const Alert &other) {
+                                     return (other.rule_idx == rule_idx) &&
+                                            (other.iface_idx == iface_idx);
+                                 }),
+                  active_.end());
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,90 @@
+#ifndef ALERT_MONITOR_H
+#define ALERT_MONITOR_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "aliases.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/alert_rule.hpp"
+#include "sampling/history.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// Holds the rules against every iface of a history as the buckets of its
+// finest window close. Each rule keeps a ring of the last buckets it covers
+// per iface and their running sum, so a closed bucket costs one add and one
+// subtract per rule and iface, however long the rules are.
+//
+// A rule goes on once the buckets it covers meet it and off once they no
+// longer do. Gaps, eg. an iface that went away, change neither, and a rule
+// is not held at all until it covers as many buckets as it should. A rule
+// of the line rate is not held against an iface without one.
+class AlertMonitor {
+  public:
+    struct Alert {
+        std::size_t rule_idx{0};
+        std::size_t iface_idx{0};
+        // whether it went on or off, in the changes
+        bool is_on{false};
+        // the bucket that it went on or off with
+        TimePoint tp{};
+    };
+
+    // window is the finest window of the history
+    AlertMonitor(std::vector<AlertRule> rules, AggregationWindow window);
+
+    // Holds the rules against the buckets that closed since the last
+    // update. The first update only starts from the bucket that is open.
+    // Returns whether any alert went on or off.
+    bool update(const History &history);
+
+    // the alerts that are on, in the order they went on
+    const std::vector<Alert> &get_active() const;
+    // the alerts that went on or off in the last update
+    const std::vector<Alert> &get_changes() const;
+
+    const AlertRule &get_rule(std::size_t rule_idx) const;
+
+  private:
+    // of a rule and an iface
+    struct State {
+        // the values of the buckets, the oldest at pos once it is full
+        std::vector<uint64_t> ring{};
+        std::size_t pos{0};
+        std::size_t num_filled{0};
+        uint64_t sum{0};
+        std::size_t num_gaps{0};
+
+        // what the sum is held against, nullopt if it cannot be
+        std::optional<double> limit{};
+        bool is_on{false};
+    };
+
+    // one per rule and iface, once the ifaces are known
+    void reset(const History &history);
+    void push(State *state, const Bucket &bucket) const;
+    bool is_met(const AlertRule &rule, const State &state) const;
+    void set_on(std::size_t rule_idx, std::size_t iface_idx, bool is_on,
+                TimePoint tp);
+
+    std::vector<AlertRule> rules_{};
+    AggregationWindow window_{};
+
+    // by rule, then by iface
+    std::vector<State> states_{};
+    std::size_t num_ifaces_{0};
+
+    // the bucket that was open at the last update
+    std::optional<TimePoint> open_{};
+
+    std::vector<Alert> active_{};
+    std::vector<Alert> changes_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // ALERT_MONITOR_H
@@ -0,0 +1,107 @@
+#include <cstdlib>
+
+#include "sampling/alert_rule.hpp"
+#include "sampling/retention.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// A line rate is a hundred percent, and nothing is a terabyte a second
+constexpr double MAX_PERCENT = 100;
+constexpr double MAX_RATE = 1e12;
+
+static bool parse_threshold(std::string_view text, AlertRule *rule) {
+    if (text.empty()) {
+        return false;
+    }
+
+    double unit{1};
+    rule->is_line_rate = false;
+    switch (text.back()) {
+    case '%':
+        rule->is_line_rate = true;
+        break;
+    case 'k':
+    case 'K':
+        unit = 1e3;
+        break;
+    case 'm':
+    case 'M':
+        unit = 1e6;
+        break;
+    case 'g':
+    case 'G':
+        unit = 1e9;
+        break;
+    default:
+        break;
+    }
+    if (rule->is_line_rate || (unit > 1)) {
+        text.remove_suffix(1);
+    }
+
+    // strtod wants it null terminated, and must not take a sign or an
+    // exponent for a number
+    std::string num{text};
+    if (num.empty() || (num.find_first_not_of("0123456789.") !=
+                        std::string::npos)) {
+        return false;
+    }
+
+    char *end{nullptr};
+    auto value = std::strtod(num.c_str(), &end) * unit;
+    if ((*end != '\0') || (value > (rule->is_line_rate ? MAX_PERCENT
+                                                       : MAX_RATE))) {
+        return false;
+    }
+
+    rule->threshold = value;
+    return true;
+}
+
+bool parse_alert_rule(std::string_view spec, AlertRule *rule) {
+    AlertRule parsed{};
+    parsed.text = spec;
+
+    if (spec.substr(0, 2) == "rx") {
+        parsed.is_rx = true;
+    } else if (spec.substr(0, 2) == "tx") {
+        parsed.is_rx = false;
+    } else {
+        return false;
+    }
+    spec.remove_prefix(2);
+
+    if (spec.empty()) {
+        return false;
+    }
+    switch (spec.front()) {
+    case '>':
+        parsed.op = AlertOp::ABOVE;
+        break;
+    case '<':
+        parsed.op = AlertOp::BELOW;
+        break;
+    case '=':
+        parsed.op = AlertOp::EQUAL;
+        break;
+    default:
+        return false;
+    }
+    spec.remove_prefix(1);
+
+    auto slash = spec.find('/');
+    if (!parse_threshold(spec.substr(0, slash), &parsed)) {
+        return false;
+    }
+    if ((slash != std::string_view::npos) &&
+        !parse_duration(spec.substr(slash + 1), &parsed.duration)) {
+        return false;
+    }
+
+    *rule = parsed;
+    return true;
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,27 @@
+#include <algorithm>
+
+#include "sampling/bucket.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+void Bucket::add(uint64_t value) {
+    min = count == 0 ? value : std::min(min, value);
+    max = count == 0 ? value : std::max(max, value);
+    sum += value;
+    ++count;
+}
+
+void Bucket::merge(const Bucket &other) {
+    if (other.count == 0) {
+        return;
+    }
+
+    min = count == 0 ? other.min : std::min(min, other.min);
+    max = count == 0 ? other.max : std::max(max, other.max);
+    sum += other.sum;
+    count += other.count;
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,482 @@
+#ifdef BANDWIT_BPF
+
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <glob.h>
+#include <linux/bpf.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "cgroup_sampler.hpp"
+#include "except.hpp"
+#include "macros.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// The cgroups that the maps have room for, every one that ever sent or
+// received anything while we run takes an entry
+constexpr uint32_t MAX_CGROUPS = 65536;
+
+// entries per BPF_MAP_LOOKUP_BATCH, grown if a bucket of the map has more
+constexpr std::size_t BATCH_SIZE = 256;
+
+// eBPF registers and helpers, see include/uapi/linux/bpf.h
+constexpr uint8_t R0 = 0;
+constexpr uint8_t R1 = 1;
+constexpr uint8_t R2 = 2;
+constexpr uint8_t R3 = 3;
+constexpr uint8_t R4 = 4;
+constexpr uint8_t R6 = 6;
+constexpr uint8_t R7 = 7;
+constexpr uint8_t R10 = 10;
+
+static bpf_insn make_insn(uint8_t code, uint8_t dst, uint8_t src,
+                          int16_t off, int32_t imm) {
+    bpf_insn insn{};
+    insn.code = code;
+    insn.dst_reg = dst & 0xf;
+    insn.src_reg = src & 0xf;
+    insn.off = off;
+    insn.imm = imm;
+    return insn;
+}
+
+static std::vector<bpf_insn> make_program(int map_fd) {
+    // In C this is:
+    //
+    //   __u64 id = bpf_skb_cgroup_id(skb);
+    //   struct counts *c = bpf_map_lookup_elem(&map, &id);
+    //   if (c) {
+    //       __sync_fetch_and_add(&c->bytes, skb->len);
+    //       __sync_fetch_and_add(&c->packets, 1);
+    //   } else {
+    //       struct counts init = {skb->len, 1};
+    //       bpf_map_update_elem(&map, &id, &init, BPF_ANY);
+    //   }
+    //   return 1;
+    //
+    // The map is per CPU, but the adds are atomic all the same, so that a
+    // program that interrupts this one on the same CPU loses no counts.
+    // The key is at r10 - 8, the counts to start a cgroup with below it.
+    auto ld_map_fd = [map_fd](uint8_t dst) {
+        return std::vector<bpf_insn>{
+            make_insn(BPF_LD | BPF_DW | BPF_IMM, dst, BPF_PSEUDO_MAP_FD, 0,
+                      map_fd),
+            make_insn(0, 0, 0, 0, 0)};
+    };
+
+    std::vector<bpf_insn> prog{
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_X, R6, R1, 0, 0),
+        make_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_skb_cgroup_id),
+        make_insn(BPF_STX | BPF_MEM | BPF_DW, R10, R0, -8, 0),
+        make_insn(BPF_LDX | BPF_MEM | BPF_W, R7, R6,
+                  INT(offsetof(__sk_buff, len)), 0),
+    };
+
+    auto append = [&prog](const std::vector<bpf_insn> &insns) {
+        prog.insert(prog.end(), insns.begin(), insns.end());
+    };
+
+    append(ld_map_fd(R1));
+    append({
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_X, R2, R10, 0, 0),
+        make_insn(BPF_ALU64 | BPF_ADD | BPF_K, R2, 0, 0, -8),
+        make_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem),
+        // to the update below if there are no counts yet
+        make_insn(BPF_JMP | BPF_JEQ | BPF_K, R0, 0, 4, 0),
+        make_insn(BPF_STX | BPF_XADD | BPF_DW, R0, R7, 0, 0),
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_K, R1, 0, 0, 1),
+        make_insn(BPF_STX | BPF_XADD | BPF_DW, R0, R1, 8, 0),
+        // to the return
+        make_insn(BPF_JA | BPF_JMP, 0, 0, 11, 0),
+        make_insn(BPF_STX | BPF_MEM | BPF_DW, R10, R7, -24, 0),
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_K, R1, 0, 0, 1),
+        make_insn(BPF_STX | BPF_MEM | BPF_DW, R10, R1, -16, 0),
+    });
+    append(ld_map_fd(R1));
+    append({
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_X, R2, R10, 0, 0),
+        make_insn(BPF_ALU64 | BPF_ADD | BPF_K, R2, 0, 0, -8),
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_X, R3, R10, 0, 0),
+        make_insn(BPF_ALU64 | BPF_ADD | BPF_K, R3, 0, 0, -24),
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_K, R4, 0, 0, BPF_ANY),
+        make_insn(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_update_elem),
+        // let the skb through
+        make_insn(BPF_ALU64 | BPF_MOV | BPF_K, R0, 0, 0, 1),
+        make_insn(BPF_JMP | BPF_EXIT, 0, 0, 0, 0),
+    });
+
+    return prog;
+}
+
+static int sys_bpf(int cmd, bpf_attr *attr) {
+    return INT(syscall(__NR_bpf, cmd, attr, sizeof(*attr)));
+}
+
+static uint64_t to_u64(const void *ptr) {
+    return U64(reinterpret_cast<uintptr_t>(ptr));
+}
+
+// eg. "0-7" or "0,2-3", the highest number plus one
+static std::size_t get_num_possible_cpus() {
+    std::ifstream file{"/sys/devices/system/cpu/possible"};
+    std::string ranges{};
+    std::getline(file, ranges);
+
+    std::size_t num_cpus{0};
+    std::stringstream ss{ranges};
+    std::string range{};
+    while (std::getline(ss, range, ',')) {
+        auto pos = range.find('-');
+        auto last = range.substr(pos == std::string::npos ? 0 : pos + 1);
+        num_cpus = std::max(num_cpus, SIZE_T(std::stoul(last)) + 1);
+    }
+
+    return num_cpus;
+}
+
+// Calls on_cgroup with the id of the cgroup at path and with those of all
+// the cgroups below it. The id of a cgroup is the inode of its directory.
+static bool walk_cgroups(const std::string &path,
+                         const std::function<void(uint64_t id)> &on_cgroup) {
+    struct stat st {};
+    if ((stat(path.c_str(), &st) < 0) || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    on_cgroup(U64(st.st_ino));
+
+    DIR *dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return true;
+    }
+
+    for (auto *ent = readdir(dir); ent != nullptr; ent = readdir(dir)) {
+        std::string name{ent->d_name};
+        if ((ent->d_type == DT_DIR) && (name != ".") && (name != "..")) {
+            walk_cgroups(path + "/" + name, on_cgroup);
+        }
+    }
+
+    closedir(dir);
+    return true;
+}
+
+std::string get_cgroup2_mount() {
+    // eg. "cgroup2 /sys/fs/cgroup cgroup2 rw,nosuid,nodev,noexec 0 0"
+    std::ifstream file{"/proc/self/mounts"};
+    std::string line{};
+    while (std::getline(file, line)) {
+        std::stringstream ss{line};
+        std::string device{};
+        std::string mount{};
+        std::string type{};
+        ss >> device >> mount >> type;
+        if (type == "cgroup2") {
+            return mount;
+        }
+    }
+
+    return std::string{};
+}
+
+std::vector<std::string>
+expand_cgroups(const std::vector<std::string> &patterns) {
+    auto mount = get_cgroup2_mount();
+    if (mount.empty()) {
+        THROW_MSG(std::runtime_error, "cgroup2 is not mounted");
+    }
+
+    std::vector<std::string> cgroups{};
+    auto add_cgroup = [&cgroups](const std::string &cgroup) {
+        if (std::find(cgroups.begin(), cgroups.end(), cgroup) ==
+            cgroups.end()) {
+            cgroups.push_back(cgroup);
+        }
+    };
+
+    for (const auto &pattern : patterns) {
+        if ((pattern.empty()) || (pattern[0] != CGROUP_PREFIX)) {
+            THROW_ARGS(std::runtime_error, "not a cgroup path: %s",
+                       pattern.c_str());
+        }
+
+        if (pattern.find_first_of("*?[") == std::string::npos) {
+            add_cgroup(pattern);
+            continue;
+        }
+
+        glob_t matches{};
+        auto path = mount + pattern;
+        if (glob(path.c_str(), GLOB_ONLYDIR, nullptr, &matches) != 0) {
+            globfree(&matches);
+            THROW_ARGS(std::runtime_error, "no cgroup matches pattern: %s",
+                       pattern.c_str());
+        }
+
+        // GLOB_ONLYDIR is only a hint, the files of the controllers match
+        // as well
+        for (std::size_t i = 0; i < matches.gl_pathc; ++i) {
+            std::string match{matches.gl_pathv[i]};
+            struct stat st {};
+            if ((stat(match.c_str(), &st) == 0) && S_ISDIR(st.st_mode)) {
+                add_cgroup(match.substr(mount.size()));
+            }
+        }
+        globfree(&matches);
+    }
+
+    return cgroups;
+}
+
+CgroupSampler::~CgroupSampler() {
+    close_hook(&ingress_);
+    close_hook(&egress_);
+}
+
+Sample CgroupSampler::get_sample(const std::string &iface_name) {
+    std::vector<Sample> samples{};
+    get_samples({iface_name}, &samples);
+    return samples[0];
+}
+
+void CgroupSampler::get_samples(const std::vector<std::string> &iface_names,
+                                std::vector<Sample> *samples) {
+    // Not loaded for names that are not of cgroups, eg. while the sampler
+    // of ifaces is being picked
+    bool has_cgroups = std::any_of(
+        iface_names.begin(), iface_names.end(), [](const std::string &name) {
+            return !name.empty() && (name[0] == CGROUP_PREFIX);
+        });
+    if (!has_cgroups) {
+        samples->assign(iface_names.size(), Sample{});
+        for (auto &sample : *samples) {
+            sample.ts = tools::MonotonicClock::now();
+            sample.error = SampleError::NO_SUCH_IFACE;
+        }
+        return;
+    }
+
+    if (!is_loaded_) {
+        load();
+    }
+
+    if (iface_names != cgroup_names_) {
+        cgroup_names_ = iface_names;
+        map_cgroups();
+    }
+
+    for (std::size_t attempt = 0; attempt < 2; ++attempt) {
+        samples->assign(iface_names.size(), Sample{});
+        has_new_cgroups_ = false;
+
+        auto ts = tools::MonotonicClock::now();
+        auto rx_error = read_counts(ingress_, true, samples);
+        auto tx_error = read_counts(egress_, false, samples);
+
+        for (std::size_t i = 0; i < samples->size(); ++i) {
+            auto &sample = (*samples)[i];
+            sample.ts = ts;
+            sample.error = cgroup_errors_[i];
+            if (sample.error == SampleError::NONE) {
+                sample.error = rx_error != SampleError::NONE ? rx_error
+                                                             : tx_error;
+            }
+        }
+
+        // A cgroup that was created since it was last looked for is mapped
+        // before its counts are taken, so that nothing it counted is lost
+        if (!has_new_cgroups_) {
+            break;
+        }
+        map_cgroups();
+    }
+}
+
+void CgroupSampler::load() {
+    auto mount = get_cgroup2_mount();
+    if (mount.empty()) {
+        THROW_MSG(std::runtime_error, "cgroup2 is not mounted");
+    }
+
+    num_cpus_ = get_num_possible_cpus();
+    mount_ = mount;
+
+    int cgroup_fd = open(mount.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (cgroup_fd < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "CgroupSampler.load failed to open the cgroup2 root");
+    }
+
+    // Neither is left half loaded, the programs go away with their fds
+    try {
+        load_hook(cgroup_fd, true, &ingress_);
+        load_hook(cgroup_fd, false, &egress_);
+    } catch (...) {
+        close(cgroup_fd);
+        close_hook(&ingress_);
+        close_hook(&egress_);
+        throw;
+    }
+
+    close(cgroup_fd);
+    is_loaded_ = true;
+}
+
+void CgroupSampler::load_hook(int cgroup_fd, bool is_ingress, Hook *hook) {
+    bpf_attr map_attr{};
+    map_attr.map_type = BPF_MAP_TYPE_PERCPU_HASH;
+    map_attr.key_size = sizeof(uint64_t);
+    map_attr.value_size = sizeof(Counts);
+    map_attr.max_entries = MAX_CGROUPS;
+    hook->map_fd = sys_bpf(BPF_MAP_CREATE, &map_attr);
+    if (hook->map_fd < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "CgroupSampler.load_hook failed in BPF_MAP_CREATE");
+    }
+
+    auto prog = make_program(hook->map_fd);
+    auto attach_type =
+        is_ingress ? BPF_CGROUP_INET_INGRESS : BPF_CGROUP_INET_EGRESS;
+
+    bpf_attr prog_attr{};
+    prog_attr.prog_type = BPF_PROG_TYPE_CGROUP_SKB;
+    prog_attr.insns = to_u64(prog.data());
+    prog_attr.insn_cnt = U32(prog.size());
+    prog_attr.license = to_u64("GPL");
+    prog_attr.expected_attach_type = attach_type;
+    hook->prog_fd = sys_bpf(BPF_PROG_LOAD, &prog_attr);
+    if (hook->prog_fd < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "CgroupSampler.load_hook failed in BPF_PROG_LOAD");
+    }
+
+    // A link rather than a plain attach, which the kernel detaches once the
+    // last fd of it is closed, even if we crash
+    bpf_attr link_attr{};
+    link_attr.link_create.prog_fd = U32(hook->prog_fd);
+    link_attr.link_create.target_fd = U32(cgroup_fd);
+    link_attr.link_create.attach_type = attach_type;
+    hook->link_fd = sys_bpf(BPF_LINK_CREATE, &link_attr);
+    if (hook->link_fd < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "CgroupSampler.load_hook failed in BPF_LINK_CREATE");
+    }
+}
+
+void CgroupSampler::close_hook(Hook *hook) {
+    for (auto *fd : {&hook->link_fd, &hook->prog_fd, &hook->map_fd}) {
+        if (*fd >= 0) {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+SampleError CgroupSampler::read_counts(const Hook &hook, bool is_rx,
+                                       std::vector<Sample> *samples) {
+    uint64_t in_batch{0};
+    uint64_t out_batch{0};
+    bool is_first = true;
+
+    while (true) {
+        keys_.resize(std::max(keys_.size(), BATCH_SIZE));
+        values_.resize(keys_.size() * num_cpus_);
+
+        bpf_attr attr{};
+        attr.batch.in_batch = is_first ? 0 : to_u64(&in_batch);
+        attr.batch.out_batch = to_u64(&out_batch);
+        attr.batch.keys = to_u64(keys_.data());
+        attr.batch.values = to_u64(values_.data());
+        attr.batch.count = U32(keys_.size());
+        attr.batch.map_fd = U32(hook.map_fd);
+
+        auto rc = sys_bpf(BPF_MAP_LOOKUP_BATCH, &attr);
+        bool is_done = (rc < 0) && (errno == ENOENT);
+
+        // one bucket of the hash map has more cgroups than the batch
+        if ((rc < 0) && (errno == ENOSPC)) {
+            keys_.resize(keys_.size() * 2);
+            continue;
+        }
+        if ((rc < 0) && !is_done) {
+            return SampleError::READ_FAILED;
+        }
+
+        for (std::size_t i = 0; i < attr.batch.count; ++i) {
+            auto it = owners_.find(keys_[i]);
+            if (it == owners_.end()) {
+                has_new_cgroups_ = true;
+                continue;
+            }
+
+            Counts counts{};
+            for (std::size_t cpu = 0; cpu < num_cpus_; ++cpu) {
+                const auto &cpu_counts = values_[i * num_cpus_ + cpu];
+                counts.bytes += cpu_counts.bytes;
+                counts.packets += cpu_counts.packets;
+            }
+
+            for (auto pos : it->second) {
+                auto &counters = is_rx ? (*samples)[pos].rx
+                                       : (*samples)[pos].tx;
+                counters[Quantity::BYTES] += counts.bytes;
+                counters[Quantity::PACKETS] += counts.packets;
+            }
+        }
+
+        if (is_done) {
+            return SampleError::NONE;
+        }
+
+        in_batch = out_batch;
+        is_first = false;
+    }
+}
+
+void CgroupSampler::map_cgroups() {
+    owners_.clear();
+    cgroup_errors_.assign(cgroup_names_.size(), SampleError::NONE);
+
+    for (std::size_t i = 0; i < cgroup_names_.size(); ++i) {
+        const auto &name = cgroup_names_[i];
+        if (name.empty() || (name[0] != CGROUP_PREFIX)) {
+            cgroup_errors_[i] = SampleError::NO_SUCH_IFACE;
+            continue;
+        }
+
+        bool is_found = walk_cgroups(mount_ + name, [this, i](uint64_t id) {
+            owners_[id].push_back(i);
+        });
+        if (!is_found) {
+            cgroup_errors_[i] = SampleError::NO_SUCH_IFACE;
+        }
+    }
+
+    // The ones under none of them are known too, so that they are not
+    // looked for again with every sample
+    for (const auto *hook : {&ingress_, &egress_}) {
+        uint64_t key{0};
+        bpf_attr attr{};
+        attr.map_fd = U32(hook->map_fd);
+        attr.key = 0;
+        attr.next_key = to_u64(&key);
+        while (sys_bpf(BPF_MAP_GET_NEXT_KEY, &attr) == 0) {
+            owners_.try_emplace(key);
+            attr.key = to_u64(&key);
+        }
+    }
+}
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // BANDWIT_BPF
@@ -0,0 +1,105 @@
+#ifndef CGROUP_SAMPLER_H
+#define CGROUP_SAMPLER_H
+
+#ifdef BANDWIT_BPF
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "macros.hpp"
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// A cgroup is sampled as if it was an iface, named by its path in the cgroup2
+// hierarchy, eg. "/system.slice/nginx.service". Iface names never start with
+// a slash.
+constexpr char CGROUP_PREFIX = '/';
+
+// Where the cgroup2 hierarchy is mounted, eg. /sys/fs/cgroup, or empty if
+// it is not
+std::string get_cgroup2_mount();
+
+// Expands glob patterns like "/system.slice/*" against the cgroups on the
+// system. Plain paths are passed through as they are, and every cgroup
+// appears only once in the result.
+std::vector<std::string>
+expand_cgroups(const std::vector<std::string> &patterns);
+
+// Counts the bytes and the packets that the sockets of every cgroup send and
+// receive, with two eBPF programs on the ingress and egress hooks of the root
+// cgroup. They add up every skb into a per-CPU hash map by the id of the
+// cgroup of its socket, so the hot path takes no lock and shares no cache
+// line between CPUs. A sample reads the whole map in one BPF_MAP_LOOKUP_BATCH
+// per direction, and a cgroup counts what all the cgroups below it count.
+//
+// The programs are loaded on the first sample and detached when the sampler
+// goes away, or along with the process. This takes Linux 5.7 or later and
+// CAP_BPF or root.
+class CgroupSampler : public Sampler {
+  public:
+    CgroupSampler() = default;
+    ~CgroupSampler() override;
+
+    CLASS_DISABLE_COPIES(CgroupSampler)
+    CLASS_DISABLE_MOVES(CgroupSampler)
+
+    Sample get_sample(const std::string &iface_name) override;
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+
+  private:
+    // the value of the maps, per CPU
+    struct Counts {
+        uint64_t bytes{0};
+        uint64_t packets{0};
+    };
+
+    // one per direction
+    struct Hook {
+        int map_fd{-1};
+        int prog_fd{-1};
+        int link_fd{-1};
+    };
+
+    void load();
+    void load_hook(int cgroup_fd, bool is_ingress, Hook *hook);
+    void close_hook(Hook *hook);
+
+    // Reads the map of the hook and adds the counts up into the samples of
+    // the cgroups they come under
+    SampleError read_counts(const Hook &hook, bool is_rx,
+                            std::vector<Sample> *samples);
+    // Which of the cgroups being sampled every cgroup under them comes under
+    void map_cgroups();
+
+    bool is_loaded_{false};
+    std::string mount_{};
+    Hook ingress_{};
+    Hook egress_{};
+
+    // Every possible CPU has a value in the maps, up to the one with the
+    // highest number, online or not
+    std::size_t num_cpus_{0};
+
+    // by cgroup id, the positions of the cgroups being sampled that it is at
+    // or under, empty for the ones under none
+    std::vector<std::string> cgroup_names_{};
+    std::vector<SampleError> cgroup_errors_{};
+    std::unordered_map<uint64_t, std::vector<std::size_t>> owners_{};
+    bool has_new_cgroups_{false};
+
+    // reused for every batch
+    std::vector<uint64_t> keys_{};
+    std::vector<Counts> values_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // BANDWIT_BPF
+
+#endif // CGROUP_SAMPLER_H
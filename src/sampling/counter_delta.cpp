@@ -0,0 +1,34 @@
+#include <algorithm>
+
+#include "counter_delta.hpp"
+#include "macros.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+CounterDelta::CounterDelta(unsigned counter_bits)
+    : wrap_mask_{counter_bits < 64 ? (uint64_t{1} << counter_bits) - 1 : 0} {}
+
+uint64_t CounterDelta::get(uint64_t prev, uint64_t cur, TimePoint prev_ts,
+                           TimePoint cur_ts) const {
+    // The readings are timestamped by a monotonic clock, a millisecond is
+    // as close together as two samples get
+    auto elapsed_ms = std::max(
+        std::chrono::duration_cast<Millis>(cur_ts - prev_ts).count(),
+        Millis::rep{1});
+    auto max_delta = MAX_BYTES_PER_SECOND / 1000 * U64(elapsed_ms);
+
+    uint64_t delta{0};
+    if (cur >= prev) {
+        delta = cur - prev;
+    } else if (wrap_mask_ != 0) {
+        delta = (cur - prev) & wrap_mask_;
+    } else {
+        return GAP_DELTA;
+    }
+
+    return delta <= max_delta ? delta : GAP_DELTA;
+}
+
+} // namespace sampling
+} // namespace bandwit
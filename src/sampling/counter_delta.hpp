@@ -0,0 +1,56 @@
+#ifndef COUNTER_DELTA_H
+#define COUNTER_DELTA_H
+
+#include <cstdint>
+
+#include "sampling/sample.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// A delta that is not known, recorded as a gap rather than as bytes. No real
+// delta gets anywhere near it.
+constexpr uint64_t GAP_DELTA = UINT64_MAX;
+
+// What one iface counted between two samples, by quantity. Any of them is
+// GAP_DELTA if the counter was reset in between, and all of them if either
+// sample failed.
+//
+// The samples are usually one interval apart. An iface that the adaptive
+// schedule backed off on is not sampled for a few intervals, with 0 of them
+// in the meantime, and the delta of the sample after covers all the
+// intervals since the last one.
+struct Delta {
+    Counters rx{};
+    Counters tx{};
+    uint32_t num_intervals{1};
+};
+
+// Works out the count between two readings of a counter that is counter_bits
+// wide. A counter that is lower than before either wrapped around or was
+// reset, eg. because the iface was recreated or the driver reloaded. It is
+// taken to have wrapped if it is narrow enough to and the bytes that makes
+// are plausible for the time between the readings, else the delta is a gap.
+// A counter that jumped by more than is plausible is a gap too.
+class CounterDelta {
+  public:
+    explicit CounterDelta(unsigned counter_bits);
+
+    // the delta, or GAP_DELTA
+    uint64_t get(uint64_t prev, uint64_t cur, TimePoint prev_ts,
+                 TimePoint cur_ts) const;
+
+  private:
+    // About 275 Gbit/s, above any single iface, and the other quantities
+    // count less than the bytes. A counter that went up by more than this
+    // was not counting the same thing all along.
+    static constexpr uint64_t MAX_BYTES_PER_SECOND = uint64_t{1} << 35;
+
+    // 0 for 64bit counters, which never wrap in practice
+    uint64_t wrap_mask_{0};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // COUNTER_DELTA_H
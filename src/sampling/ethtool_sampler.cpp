@@ -0,0 +1,367 @@
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <linux/ethtool.h>
+#include <linux/sockios.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ethtool_sampler.hpp"
+#include "macros.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// No NIC has more, a larger number is something else, eg. a size
+constexpr std::size_t MAX_QUEUES = 4096;
+
+// the names of the quantities after the queue, eg. rx_queue_3_<name>
+struct QuantityName {
+    std::string_view name;
+    Quantity qtty;
+};
+
+constexpr QuantityName QUANTITY_NAMES[] = {
+    {"bytes", Quantity::BYTES},     {"packets", Quantity::PACKETS},
+    {"pkts", Quantity::PACKETS},    {"errors", Quantity::ERRORS},
+    {"errs", Quantity::ERRORS},     {"drops", Quantity::DROPS},
+    {"dropped", Quantity::DROPS},
+};
+
+static bool consume(std::string_view *str, std::string_view prefix) {
+    if (str->substr(0, prefix.size()) != prefix) {
+        return false;
+    }
+
+    str->remove_prefix(prefix.size());
+    return true;
+}
+
+static bool consume_number(std::string_view *str, std::size_t *num) {
+    std::size_t len{0};
+    std::size_t value{0};
+    while ((len < str->size()) && ((*str)[len] >= '0') &&
+           ((*str)[len] <= '9') && (value < MAX_QUEUES)) {
+        value = value * 10 + SIZE_T((*str)[len] - '0');
+        ++len;
+    }
+
+    if ((len == 0) || (value >= MAX_QUEUES)) {
+        return false;
+    }
+
+    str->remove_prefix(len);
+    *num = value;
+    return true;
+}
+
+static bool consume_direction(std::string_view *str, bool *is_rx) {
+    if (consume(str, "rx")) {
+        *is_rx = true;
+        return true;
+    }
+    if (consume(str, "tx")) {
+        *is_rx = false;
+        return true;
+    }
+
+    return false;
+}
+
+bool split_queue_name(std::string_view name, std::string_view *iface,
+                      std::size_t *queue) {
+    auto pos = name.rfind(QUEUE_SEPARATOR);
+    if ((pos == std::string_view::npos) || (pos == 0)) {
+        return false;
+    }
+
+    auto num = name.substr(pos + QUEUE_SEPARATOR.size());
+    if (!consume_number(&num, queue) || !num.empty()) {
+        return false;
+    }
+
+    *iface = name.substr(0, pos);
+    return true;
+}
+
+std::optional<QueueStat> parse_queue_stat(std::string_view name) {
+    QueueStat stat{};
+
+    if (consume_direction(&name, &stat.is_rx)) {
+        // rx_queue_3_bytes, rx3_bytes, rx-3.bytes or rx-3.rx_bytes
+        if (!consume(&name, "_queue_")) {
+            consume(&name, "-");
+        }
+        if (!consume_number(&name, &stat.queue) ||
+            !(consume(&name, "_") || consume(&name, "."))) {
+            return std::nullopt;
+        }
+
+        bool is_rx{true};
+        if (consume_direction(&name, &is_rx) &&
+            ((is_rx != stat.is_rx) || !consume(&name, "_"))) {
+            return std::nullopt;
+        }
+    } else if (consume(&name, "queue_")) {
+        // queue_3_rx_bytes
+        if (!consume_number(&name, &stat.queue) || !consume(&name, "_") ||
+            !consume_direction(&name, &stat.is_rx) || !consume(&name, "_")) {
+            return std::nullopt;
+        }
+    } else {
+        return std::nullopt;
+    }
+
+    for (const auto &qtty_name : QUANTITY_NAMES) {
+        if (name == qtty_name.name) {
+            stat.qtty = qtty_name.qtty;
+            return stat;
+        }
+    }
+
+    return std::nullopt;
+}
+
+EthtoolSampler::~EthtoolSampler() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+Sample EthtoolSampler::get_sample(const std::string &iface_name) {
+    std::vector<Sample> samples{};
+    get_samples({iface_name}, &samples);
+    return samples[0];
+}
+
+void EthtoolSampler::get_samples(const std::vector<std::string> &iface_names,
+                                 std::vector<Sample> *samples) {
+    samples->resize(iface_names.size());
+
+    // The queues of an iface all come from the one read of its counters in
+    // this pass
+    ++pass_;
+
+    std::string name{};
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        auto &sample = (*samples)[i];
+        sample = Sample{};
+
+        std::string_view iface_name{};
+        std::size_t queue{0};
+        if (!split_queue_name(iface_names[i], &iface_name, &queue)) {
+            sample.ts = tools::MonotonicClock::now();
+            sample.error = SampleError::NO_SUCH_IFACE;
+            continue;
+        }
+
+        name.assign(iface_name);
+        auto *iface = get_interface(name, &sample.error);
+        if (iface == nullptr) {
+            sample.ts = tools::MonotonicClock::now();
+            continue;
+        }
+
+        if (iface->pass != pass_) {
+            iface->error = read_stats(name, iface);
+            iface->ts = tools::MonotonicClock::now();
+            iface->pass = pass_;
+        }
+
+        sample.ts = iface->ts;
+        sample.error = iface->error;
+
+        // The queues can be cut down, eg. by ethtool -L
+        if ((sample.error == SampleError::NONE) &&
+            (queue >= iface->queues.size())) {
+            sample.error = SampleError::NO_SUCH_IFACE;
+        }
+
+        if (sample.error == SampleError::NONE) {
+            fill_sample(*iface, queue, &sample);
+        }
+    }
+}
+
+std::vector<std::string>
+EthtoolSampler::list_queues(const std::vector<std::string> &iface_names) {
+    std::vector<std::string> queue_names{};
+
+    for (const auto &iface_name : iface_names) {
+        SampleError error{SampleError::NONE};
+        auto *iface = get_interface(iface_name, &error);
+        if (iface == nullptr) {
+            continue;
+        }
+
+        for (std::size_t i = 0; i < iface->queues.size(); ++i) {
+            queue_names.push_back(iface_name + std::string{QUEUE_SEPARATOR} +
+                                  std::to_string(i));
+        }
+    }
+
+    return queue_names;
+}
+
+SampleError EthtoolSampler::open_socket() {
+    // Any socket will do, the ioctl goes to the driver of the iface
+    fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    return fd_ < 0 ? SampleError::READ_FAILED : SampleError::NONE;
+}
+
+SampleError EthtoolSampler::ioctl_ethtool(const std::string &iface_name,
+                                          void *cmd) {
+    if (fd_ < 0) {
+        auto error = open_socket();
+        if (error != SampleError::NONE) {
+            return error;
+        }
+    }
+
+    if (iface_name.size() >= IFNAMSIZ) {
+        return SampleError::NO_SUCH_IFACE;
+    }
+
+    ifreq ifr{};
+    memcpy(ifr.ifr_name, iface_name.data(), iface_name.size());
+    ifr.ifr_data = PCHAR(cmd);
+
+    if (ioctl(fd_, SIOCETHTOOL, &ifr) < 0) {
+        return errno == ENODEV ? SampleError::NO_SUCH_IFACE
+                               : SampleError::READ_FAILED;
+    }
+
+    return SampleError::NONE;
+}
+
+EthtoolSampler::Interface *
+EthtoolSampler::get_interface(const std::string &iface_name,
+                              SampleError *error) {
+    auto it = ifaces_.find(iface_name);
+    if (it != ifaces_.end()) {
+        return it->second.get();
+    }
+
+    // Not kept unless it has queues, an iface that comes back later is
+    // tried again
+    auto iface = std::make_unique<Interface>();
+    *error = load_string_table(iface_name, iface.get());
+    if ((*error == SampleError::NONE) && iface->queues.empty()) {
+        *error = SampleError::PARSE_FAILED;
+    }
+    if (*error != SampleError::NONE) {
+        return nullptr;
+    }
+
+    auto *ptr = iface.get();
+    ifaces_.emplace(iface_name, std::move(iface));
+    return ptr;
+}
+
+SampleError EthtoolSampler::load_string_table(const std::string &iface_name,
+                                              Interface *iface) {
+    ethtool_drvinfo drvinfo{};
+    drvinfo.cmd = ETHTOOL_GDRVINFO;
+    auto error = ioctl_ethtool(iface_name, &drvinfo);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    // struct ethtool_gstrings followed by a name per counter
+    auto num_stats = SIZE_T(drvinfo.n_stats);
+    std::vector<char> buffer(sizeof(ethtool_gstrings) +
+                             num_stats * ETH_GSTRING_LEN);
+    auto *strings = reinterpret_cast<ethtool_gstrings *>(buffer.data());
+    strings->cmd = ETHTOOL_GSTRINGS;
+    strings->string_set = ETH_SS_STATS;
+    strings->len = U32(num_stats);
+    error = ioctl_ethtool(iface_name, strings);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    iface->queues.clear();
+    iface->num_stats = std::min(num_stats, SIZE_T(strings->len));
+    for (std::size_t i = 0; i < iface->num_stats; ++i) {
+        const auto *str = reinterpret_cast<const char *>(strings->data) +
+                          i * ETH_GSTRING_LEN;
+        auto stat = parse_queue_stat(
+            std::string_view{str, strnlen(str, ETH_GSTRING_LEN)});
+        if (!stat.has_value()) {
+            continue;
+        }
+
+        if (stat->queue >= iface->queues.size()) {
+            iface->queues.resize(stat->queue + 1);
+        }
+
+        // A driver that has, eg. both the packets and the pkts of a queue,
+        // counts the same packets twice. The first one is taken.
+        auto &counters = iface->queues[stat->queue];
+        auto is_taken = std::any_of(
+            counters.begin(), counters.end(), [&stat](const Counter &c) {
+                return (c.is_rx == stat->is_rx) && (c.qtty == stat->qtty);
+            });
+        if (!is_taken) {
+            counters.push_back(Counter{i, stat->is_rx, stat->qtty});
+        }
+    }
+
+    // The values come after struct ethtool_stats, which is 8 bytes
+    static_assert(sizeof(ethtool_stats) == sizeof(uint64_t));
+    iface->buffer.assign(1 + iface->num_stats, 0);
+    return SampleError::NONE;
+}
+
+SampleError EthtoolSampler::read_stats(const std::string &iface_name,
+                                       Interface *iface) {
+    auto *stats = reinterpret_cast<ethtool_stats *>(iface->buffer.data());
+    stats->cmd = ETHTOOL_GSTATS;
+    stats->n_stats = U32(iface->num_stats);
+    auto error = ioctl_ethtool(iface_name, stats);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    // A driver whose counters changed, eg. with the number of queues, has
+    // its string table read again
+    if (SIZE_T(stats->n_stats) == iface->num_stats) {
+        return SampleError::NONE;
+    }
+
+    error = load_string_table(iface_name, iface);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    stats = reinterpret_cast<ethtool_stats *>(iface->buffer.data());
+    stats->cmd = ETHTOOL_GSTATS;
+    stats->n_stats = U32(iface->num_stats);
+    error = ioctl_ethtool(iface_name, stats);
+    if ((error == SampleError::NONE) &&
+        (SIZE_T(stats->n_stats) != iface->num_stats)) {
+        return SampleError::PARSE_FAILED;
+    }
+
+    return error;
+}
+
+void EthtoolSampler::fill_sample(const Interface &iface, std::size_t queue,
+                                 Sample *sample) const {
+    // The quantities the driver does not count per queue are left at 0
+    const auto *values = &iface.buffer[1];
+    for (const auto &counter : iface.queues[queue]) {
+        auto &counters = counter.is_rx ? sample->rx : sample->tx;
+        counters[counter.qtty] = values[counter.index];
+    }
+}
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // __linux__
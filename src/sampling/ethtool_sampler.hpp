@@ -0,0 +1,112 @@
+#ifndef ETHTOOL_SAMPLER_H
+#define ETHTOOL_SAMPLER_H
+
+#ifdef __linux__
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// A queue of an iface is sampled as if it was an iface of its own, named
+// "<iface>/q<N>", eg. "eth0/q3". The kernel does not allow a slash in an
+// iface name, so the last one is always the separator.
+constexpr std::string_view QUEUE_SEPARATOR = "/q";
+
+// Splits "eth0/q3", false if the name is not that of a queue
+bool split_queue_name(std::string_view name, std::string_view *iface,
+                      std::size_t *queue);
+
+// What a per-queue counter of `ethtool -S` counts
+struct QueueStat {
+    std::size_t queue{0};
+    bool is_rx{true};
+    Quantity qtty{Quantity::BYTES};
+};
+
+// Drivers name their per-queue counters in a few ways, eg. rx_queue_3_bytes
+// (ixgbe, virtio_net and most others), rx3_bytes (mlx5), rx-3.bytes or
+// rx-3.rx_bytes (i40e) and queue_3_rx_bytes (ena). nullopt for the counters
+// that are not one of the quantities of a queue.
+std::optional<QueueStat> parse_queue_stat(std::string_view name);
+
+// Reads the per-queue counters of a NIC with one SIOCETHTOOL ETHTOOL_GSTATS
+// ioctl per iface per sample, however many of its queues are sampled. The
+// ioctl only returns the values, their names come from the string table of
+// the driver, which is read once per iface and cached along with where each
+// counter goes.
+//
+// Only the ifaces of our own network namespace can be sampled.
+class EthtoolSampler : public Sampler {
+  public:
+    EthtoolSampler() = default;
+    ~EthtoolSampler() override;
+
+    CLASS_DISABLE_COPIES(EthtoolSampler)
+    CLASS_DISABLE_MOVES(EthtoolSampler)
+
+    Sample get_sample(const std::string &iface_name) override;
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+
+    // The queues of the ifaces, eg. "eth0/q0" and on, in order. The ifaces
+    // without per-queue counters are left out.
+    std::vector<std::string>
+    list_queues(const std::vector<std::string> &iface_names);
+
+  private:
+    // where a counter of a queue is among the values of the ioctl
+    struct Counter {
+        std::size_t index{0};
+        bool is_rx{true};
+        Quantity qtty{Quantity::BYTES};
+    };
+
+    // What the string table of an iface says, and the buffer its counters
+    // are read into
+    struct Interface {
+        // the counters of every queue, by queue
+        std::vector<std::vector<Counter>> queues{};
+        std::size_t num_stats{0};
+
+        // struct ethtool_stats followed by a value per counter
+        std::vector<uint64_t> buffer{};
+
+        // the pass of get_samples that the buffer was last read in
+        uint64_t pass{0};
+        TimePoint ts{};
+        SampleError error{SampleError::NONE};
+    };
+
+    SampleError open_socket();
+    SampleError ioctl_ethtool(const std::string &iface_name, void *cmd);
+
+    // nullptr if the iface cannot have its queues sampled, the error says why
+    Interface *get_interface(const std::string &iface_name,
+                             SampleError *error);
+    SampleError load_string_table(const std::string &iface_name,
+                                  Interface *iface);
+    SampleError read_stats(const std::string &iface_name, Interface *iface);
+    void fill_sample(const Interface &iface, std::size_t queue,
+                     Sample *sample) const;
+
+    int fd_{-1};
+    uint64_t pass_{0};
+
+    std::unordered_map<std::string, std::unique_ptr<Interface>> ifaces_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // __linux__
+
+#endif // ETHTOOL_SAMPLER_H
@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "except.hpp"
+#include "history.hpp"
+#include "macros.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+static void record_one(TimeSeriesCollection *ts_coll, TimePoint tp,
+                       uint64_t value, uint32_t num_intervals) {
+    if (value == GAP_DELTA) {
+        ts_coll->skip(tp);
+    } else if (num_intervals > 1) {
+        ts_coll->spread(tp, value, num_intervals);
+    } else {
+        ts_coll->inc(tp, value);
+    }
+}
+
+History::History(std::vector<std::string> iface_names, TimePoint start,
+                 const std::vector<AggregationWindow> &windows,
+                 const Retention &retention, std::vector<Quantity> quantities)
+    : iface_names_{std::move(iface_names)} {
+    set_quantities(std::move(quantities));
+
+    auto num_colls = iface_names_.size() * quantities_.size();
+    for (std::size_t i = 0; i < num_colls; ++i) {
+        ts_colls_rx_.emplace_back(std::make_unique<TimeSeriesCollection>(
+            start, windows, retention));
+        ts_colls_tx_.emplace_back(std::make_unique<TimeSeriesCollection>(
+            start, windows, retention));
+    }
+}
+
+void History::record(std::size_t idx, TimePoint tp, const Delta &delta) {
+    // The buckets stay open until the sample that covers them comes in,
+    // the ones past the open bucket read as pending until then
+    if (delta.num_intervals == 0) {
+        return;
+    }
+
+    auto pos = idx * quantities_.size();
+    for (auto qtty : quantities_) {
+        record_one(ts_colls_rx_[pos].get(), tp, delta.rx[qtty],
+                   delta.num_intervals);
+        record_one(ts_colls_tx_[pos].get(), tp, delta.tx[qtty],
+                   delta.num_intervals);
+        ++pos;
+    }
+}
+
+void History::restore(std::size_t idx, Quantity qtty,
+                      std::unique_ptr<TimeSeriesCollection> rx,
+                      std::unique_ptr<TimeSeriesCollection> tx) {
+    auto pos = get_pos(idx, qtty);
+    ts_colls_rx_[pos] = std::move(rx);
+    ts_colls_tx_[pos] = std::move(tx);
+}
+
+std::size_t History::restore(History *other) {
+    std::size_t num_restored = 0;
+
+    for (std::size_t i = 0; i < iface_names_.size(); ++i) {
+        auto it = std::find(other->iface_names_.begin(),
+                            other->iface_names_.end(), iface_names_[i]);
+        if (it == other->iface_names_.end()) {
+            continue;
+        }
+
+        auto other_idx = SIZE_T(it - other->iface_names_.begin());
+        bool is_restored = false;
+
+        for (auto qtty : quantities_) {
+            if (!other->has_quantity(qtty)) {
+                continue;
+            }
+
+            auto pos = get_pos(i, qtty);
+            auto other_pos = other->get_pos(other_idx, qtty);
+
+            // Taken already by an iface of the same name, or kept for
+            // another retention with tiers of another size
+            const auto &other_rx = other->ts_colls_rx_[other_pos];
+            if ((other_rx == nullptr) ||
+                (ts_colls_rx_[pos]->get_image_size() !=
+                 other_rx->get_image_size())) {
+                continue;
+            }
+
+            ts_colls_rx_[pos] = std::move(other->ts_colls_rx_[other_pos]);
+            ts_colls_tx_[pos] = std::move(other->ts_colls_tx_[other_pos]);
+            is_restored = true;
+        }
+
+        num_restored += is_restored ? 1 : 0;
+    }
+
+    return num_restored;
+}
+
+std::size_t History::num_ifaces() const { return iface_names_.size(); }
+
+const std::string &History::get_iface_name(std::size_t idx) const {
+    return iface_names_.at(idx);
+}
+
+const std::vector<Quantity> &History::get_quantities() const {
+    return quantities_;
+}
+
+bool History::has_quantity(Quantity qtty) const {
+    return slots_[SIZE_T(qtty)] < quantities_.size();
+}
+
+const TimeSeriesCollection &History::get_rx(std::size_t idx,
+                                            Quantity qtty) const {
+    return *ts_colls_rx_[get_pos(idx, qtty)];
+}
+
+const TimeSeriesCollection &History::get_tx(std::size_t idx,
+                                            Quantity qtty) const {
+    return *ts_colls_tx_[get_pos(idx, qtty)];
+}
+
+void History::encode(tools::ByteWriter *writer) const {
+    writer->put_u32(U32(iface_names_.size()));
+    writer->put_u32(get_mask(quantities_));
+
+    for (std::size_t i = 0; i < iface_names_.size(); ++i) {
+        writer->put_string(iface_names_[i]);
+
+        auto pos = i * quantities_.size();
+        for (std::size_t j = 0; j < quantities_.size(); ++j) {
+            ts_colls_rx_[pos + j]->encode(writer);
+            ts_colls_tx_[pos + j]->encode(writer);
+        }
+    }
+}
+
+std::unique_ptr<History> History::decode(tools::ByteReader *reader) {
+    // the default constructor is private
+    std::unique_ptr<History> history{new History{}};
+
+    auto num_ifaces = reader->get_u32();
+    history->set_quantities(from_mask(reader->get_u32()));
+
+    for (uint32_t i = 0; i < num_ifaces; ++i) {
+        history->iface_names_.push_back(reader->get_string());
+
+        for (std::size_t j = 0; j < history->quantities_.size(); ++j) {
+            history->ts_colls_rx_.push_back(
+                TimeSeriesCollection::decode(reader));
+            history->ts_colls_tx_.push_back(
+                TimeSeriesCollection::decode(reader));
+        }
+    }
+
+    return history;
+}
+
+std::size_t History::get_image_size() const {
+    std::size_t size = 2 * sizeof(uint64_t);
+
+    for (std::size_t i = 0; i < ts_colls_rx_.size(); ++i) {
+        size += ts_colls_rx_[i]->get_image_size() +
+                ts_colls_tx_[i]->get_image_size();
+    }
+
+    return size + (iface_names_.size() * IMAGE_NAME_LEN);
+}
+
+void History::write_image(char *image) const {
+    auto *header = reinterpret_cast<uint64_t *>(image);
+    header[0] = iface_names_.size();
+    header[1] = get_mask(quantities_);
+    image += 2 * sizeof(uint64_t);
+
+    for (std::size_t i = 0; i < iface_names_.size(); ++i) {
+        // always leaves room for the terminating nul
+        auto name_len = std::min(iface_names_[i].size(), IMAGE_NAME_LEN - 1);
+        memset(image, 0, IMAGE_NAME_LEN);
+        memcpy(image, iface_names_[i].data(), name_len);
+        image += IMAGE_NAME_LEN;
+
+        auto pos = i * quantities_.size();
+        for (std::size_t j = 0; j < quantities_.size(); ++j) {
+            ts_colls_rx_[pos + j]->write_image(image);
+            image += ts_colls_rx_[pos + j]->get_image_size();
+
+            ts_colls_tx_[pos + j]->write_image(image);
+            image += ts_colls_tx_[pos + j]->get_image_size();
+        }
+    }
+}
+
+std::unique_ptr<History> History::read_image(const char *image,
+                                             std::size_t len) {
+    // the default constructor is private
+    std::unique_ptr<History> history{new History{}};
+
+    if (len < 2 * sizeof(uint64_t)) {
+        THROW_MSG(std::runtime_error, "History.read_image: image too short");
+    }
+
+    const auto *header = reinterpret_cast<const uint64_t *>(image);
+    auto num_ifaces = header[0];
+    history->set_quantities(from_mask(U32(header[1])));
+    std::size_t pos = 2 * sizeof(uint64_t);
+
+    for (uint64_t i = 0; i < num_ifaces; ++i) {
+        if (len - pos < IMAGE_NAME_LEN) {
+            THROW_MSG(std::runtime_error,
+                      "History.read_image: image too short");
+        }
+
+        history->iface_names_.emplace_back(
+            image + pos, strnlen(image + pos, IMAGE_NAME_LEN));
+        pos += IMAGE_NAME_LEN;
+
+        for (std::size_t j = 0; j < history->quantities_.size(); ++j) {
+            auto rx = TimeSeriesCollection::read_image(image + pos, len - pos);
+            pos += rx->get_image_size();
+            auto tx = TimeSeriesCollection::read_image(image + pos, len - pos);
+            pos += tx->get_image_size();
+
+            history->ts_colls_rx_.push_back(std::move(rx));
+            history->ts_colls_tx_.push_back(std::move(tx));
+        }
+    }
+
+    return history;
+}
+
+void History::set_quantities(std::vector<Quantity> quantities) {
+    quantities_ = std::move(quantities);
+
+    slots_.fill(SIZE_MAX);
+    for (std::size_t i = 0; i < quantities_.size(); ++i) {
+        slots_[SIZE_T(quantities_[i])] = i;
+    }
+}
+
+std::size_t History::get_pos(std::size_t idx, Quantity qtty) const {
+    auto slot = slots_[SIZE_T(qtty)];
+    if ((idx >= iface_names_.size()) || (slot >= quantities_.size())) {
+        THROW_ARGS(std::out_of_range,
+                   "History: no %s recorded of the iface at %zu",
+                   get_label(qtty).c_str(), idx);
+    }
+
+    return (idx * quantities_.size()) + slot;
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,94 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "counter_delta.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/quantity.hpp"
+#include "sampling/retention.hpp"
+#include "sampling/time_series_coll.hpp"
+#include "tools/byte_stream.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// The history of a set of ifaces, one pair of rx/tx TimeSeriesCollections
+// per iface for every quantity that is recorded. It is what gets displayed,
+// whether it was recorded in this process or received from a daemon.
+class History {
+  public:
+    History(std::vector<std::string> iface_names, TimePoint start,
+            const std::vector<AggregationWindow> &windows,
+            const Retention &retention = Retention{},
+            std::vector<Quantity> quantities = {Quantity::BYTES});
+
+    // Records the deltas of the quantities that are recorded of the iface at
+    // idx in the bucket for tp. A GAP_DELTA is recorded as no sample at all.
+    // Deltas of more than one interval are spread over the buckets of all of
+    // them, and deltas of none are not recorded yet.
+    void record(std::size_t idx, TimePoint tp, const Delta &delta);
+
+    // Replaces the history of a quantity of the iface at idx with one
+    // recorded earlier
+    void restore(std::size_t idx, Quantity qtty,
+                 std::unique_ptr<TimeSeriesCollection> rx,
+                 std::unique_ptr<TimeSeriesCollection> tx);
+
+    // Takes over the history of every iface of other that has the same
+    // name, for the quantities that both record and that were kept for as
+    // long as here. Returns how many ifaces got any.
+    std::size_t restore(History *other);
+
+    std::size_t num_ifaces() const;
+    const std::string &get_iface_name(std::size_t idx) const;
+
+    // in the order of the enum
+    const std::vector<Quantity> &get_quantities() const;
+    bool has_quantity(Quantity qtty) const;
+
+    // Throw for a quantity that is not recorded
+    const TimeSeriesCollection &get_rx(std::size_t idx,
+                                       Quantity qtty = Quantity::BYTES) const;
+    const TimeSeriesCollection &get_tx(std::size_t idx,
+                                       Quantity qtty = Quantity::BYTES) const;
+
+    void encode(tools::ByteWriter *writer) const;
+    static std::unique_ptr<History> decode(tools::ByteReader *reader);
+
+    // The flat image starts with the number of ifaces and the mask of the
+    // quantities. Each iface is its name padded to IMAGE_NAME_LEN, then the
+    // images of its rx and tx collections of every quantity in turn.
+    static constexpr std::size_t IMAGE_NAME_LEN = 64;
+
+    std::size_t get_image_size() const;
+    void write_image(char *image) const;
+    static std::unique_ptr<History> read_image(const char *image,
+                                               std::size_t len);
+
+  private:
+    History() = default;
+
+    void set_quantities(std::vector<Quantity> quantities);
+    // where the collections of the quantity of the iface at idx are
+    std::size_t get_pos(std::size_t idx, Quantity qtty) const;
+
+    std::vector<std::string> iface_names_{};
+    std::vector<Quantity> quantities_{};
+    // by quantity, where it is in quantities_ or past the end if it is not
+    // recorded
+    std::array<std::size_t, NUM_QUANTITIES> slots_{};
+
+    // every iface has one of each quantity in turn
+    std::vector<std::unique_ptr<TimeSeriesCollection>> ts_colls_rx_{};
+    std::vector<std::unique_ptr<TimeSeriesCollection>> ts_colls_tx_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // HISTORY_H
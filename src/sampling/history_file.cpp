@@ -0,0 +1,141 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <stdexcept>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "history_file.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// "BANDWHST"
+constexpr uint64_t HISTORY_FILE_MAGIC = 0x54534857444e4142;
+constexpr uint32_t HISTORY_FILE_VERSION = 3;
+
+HistoryFile::HistoryFile(std::string path, Millis interval,
+                         const History &history, std::size_t idx)
+    : path_{std::move(path)} {
+    const auto &qttys = history.get_quantities();
+    auto image_len = history.get_rx(idx, qttys.front()).get_image_size();
+    len_ = sizeof(HistoryFileHeader) + (2 * qttys.size() * image_len);
+
+    int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        THROW_ARGS(std::runtime_error, "HistoryFile failed to open %s: %s",
+                   path_.c_str(), strerror(errno));
+    }
+
+    // Two recorders of the same file would overwrite each other's buckets,
+    // the lock is held for as long as the file stays open
+    if (flock(fd, LOCK_EX | LOCK_NB) < 0) {
+        int errno_orig = errno;
+        close(fd);
+        if (errno_orig == EWOULDBLOCK) {
+            THROW_ARGS(std::runtime_error,
+                       "history file %s is in use by another bw",
+                       path_.c_str());
+        }
+        THROW_ARGS(std::runtime_error, "HistoryFile failed to lock %s: %s",
+                   path_.c_str(), strerror(errno_orig));
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        THROW_CERROR(std::runtime_error, "HistoryFile failed in fstat()");
+    }
+
+    // A new file is extended with zeroes, which is a blank image
+    bool is_new = st.st_size == 0;
+    if (is_new && (ftruncate(fd, static_cast<off_t>(len_)) < 0)) {
+        close(fd);
+        THROW_CERROR(std::runtime_error, "HistoryFile failed in ftruncate()");
+    }
+
+    if (!is_new && (SIZE_T(st.st_size) != len_)) {
+        close(fd);
+        THROW_ARGS(std::runtime_error,
+                   "history file %s was recorded with another interval, "
+                   "retention, counters or version, remove it to start over",
+                   path_.c_str());
+    }
+
+    void *addr = mmap(nullptr, len_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        THROW_CERROR(std::runtime_error, "HistoryFile failed in mmap()");
+    }
+
+    fd_ = fd;
+
+    data_ = static_cast<char *>(addr);
+    header_ = reinterpret_cast<HistoryFileHeader *>(data_);
+
+    if (is_new) {
+        header_ = new (data_) HistoryFileHeader{};
+        header_->magic = HISTORY_FILE_MAGIC;
+        header_->version = HISTORY_FILE_VERSION;
+        header_->quantities = get_mask(qttys);
+        header_->interval_ms = U64(interval.count());
+        header_->image_len = image_len;
+        return;
+    }
+
+    bool is_match = (header_->magic == HISTORY_FILE_MAGIC) &&
+                    (header_->version == HISTORY_FILE_VERSION) &&
+                    (header_->quantities == get_mask(qttys)) &&
+                    (header_->interval_ms == U64(interval.count())) &&
+                    (header_->image_len == image_len);
+    if (!is_match) {
+        munmap(data_, len_);
+        close(fd_);
+        THROW_ARGS(std::runtime_error,
+                   "history file %s was recorded with another interval, "
+                   "retention, counters or version, remove it to start over",
+                   path_.c_str());
+    }
+
+    has_history_ = true;
+}
+
+HistoryFile::~HistoryFile() {
+    munmap(data_, len_);
+    close(fd_);
+}
+
+bool HistoryFile::has_history() const { return has_history_; }
+
+void HistoryFile::read(History *history, std::size_t idx) const {
+    const auto &qttys = history->get_quantities();
+    auto len = header_->image_len;
+
+    for (std::size_t i = 0; i < qttys.size(); ++i) {
+        const auto *images = get_images(i);
+        history->restore(idx, qttys[i],
+                         TimeSeriesCollection::read_image(images, len),
+                         TimeSeriesCollection::read_image(images + len, len));
+    }
+}
+
+void HistoryFile::write(const History &history, std::size_t idx) {
+    const auto &qttys = history.get_quantities();
+
+    for (std::size_t i = 0; i < qttys.size(); ++i) {
+        auto *images = get_images(i);
+        history.get_rx(idx, qttys[i]).write_image(images);
+        history.get_tx(idx, qttys[i]).write_image(images + header_->image_len);
+    }
+}
+
+char *HistoryFile::get_images(std::size_t i) const {
+    return data_ + sizeof(HistoryFileHeader) + (2 * i * header_->image_len);
+}
+
+} // namespace sampling
+} // namespace bandwit
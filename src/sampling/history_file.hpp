@@ -0,0 +1,66 @@
+#ifndef HISTORY_FILE_H
+#define HISTORY_FILE_H
+
+#include <memory>
+#include <string>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/history.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+struct HistoryFileHeader {
+    uint64_t magic;
+    uint32_t version;
+    // the mask of the quantities
+    uint32_t quantities;
+    uint64_t interval_ms;
+    // every collection is the same size, they have the same windows
+    uint64_t image_len;
+    uint64_t reserved;
+};
+
+// The history of one iface in a memory mapped file: the header, then the
+// images of the rx and the tx TimeSeriesCollection of every quantity in
+// turn. The layout is fixed for a given interval, so the file is sized once
+// and every write is a store into the mapping which the kernel writes back
+// on its own.
+class HistoryFile {
+  public:
+    // Creates the file for the iface at idx if it does not exist. An existing
+    // file must have been written with the same interval and quantities, and
+    // must not be open in another process.
+    HistoryFile(std::string path, Millis interval, const History &history,
+                std::size_t idx);
+    ~HistoryFile();
+
+    CLASS_DISABLE_COPIES(HistoryFile)
+    CLASS_DISABLE_MOVES(HistoryFile)
+
+    // whether the file held a history when it was opened
+    bool has_history() const;
+    // restores the history of the iface at idx from the file
+    void read(History *history, std::size_t idx) const;
+
+    // Only copies the buckets that changed since the last write
+    void write(const History &history, std::size_t idx);
+
+  private:
+    // where the images of the ith quantity start
+    char *get_images(std::size_t i) const;
+
+    std::string path_{};
+    // kept open for the lock on the file
+    int fd_{-1};
+    std::size_t len_{0};
+    char *data_{nullptr};
+    HistoryFileHeader *header_{nullptr};
+    bool has_history_{false};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // HISTORY_FILE_H
@@ -0,0 +1,31 @@
+#include "iface_index.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+void InterfaceIndex::update(const std::vector<std::string> &iface_names) {
+    if (iface_names == iface_names_) {
+        return;
+    }
+
+    index_.clear();
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        index_.emplace(iface_names[i], i);
+    }
+
+    iface_names_ = iface_names;
+}
+
+std::size_t InterfaceIndex::find(std::string_view iface_name) const {
+    auto it = index_.find(iface_name);
+    if (it == index_.end()) {
+        return size();
+    }
+
+    return it->second;
+}
+
+std::size_t InterfaceIndex::size() const { return iface_names_.size(); }
+
+} // namespace sampling
+} // namespace bandwit
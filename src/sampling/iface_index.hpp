@@ -0,0 +1,33 @@
+#ifndef IFACE_INDEX_H
+#define IFACE_INDEX_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bandwit {
+namespace sampling {
+
+// Maps an iface name to its position in the list of sampled ifaces, for
+// samplers that read the counters for all interfaces in one go and have to
+// pick out the ones we want.
+class InterfaceIndex {
+  public:
+    // Cheap when the list hasn't changed since the last call
+    void update(const std::vector<std::string> &iface_names);
+
+    // Returns size() if the name is not one of ours
+    std::size_t find(std::string_view iface_name) const;
+    std::size_t size() const;
+
+  private:
+    std::vector<std::string> iface_names_{};
+    std::map<std::string, std::size_t, std::less<>> index_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // IFACE_INDEX_H
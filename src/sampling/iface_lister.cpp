@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <fnmatch.h>
+#include <net/if.h>
+#include <stdexcept>
+
+#include "except.hpp"
+#include "iface_lister.hpp"
+#include "netlink_sampler.hpp"
+#include "netns.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+std::vector<std::string> InterfaceLister::list_system_ifaces() const {
+    struct if_nameindex *names = if_nameindex();
+    if (names == nullptr) {
+        THROW_CERROR(std::runtime_error,
+                     "InterfaceLister.list_system_ifaces failed in "
+                     "if_nameindex()");
+    }
+
+    std::vector<std::string> ifaces{};
+    for (auto *it = names; it->if_index != 0; ++it) {
+        ifaces.emplace_back(it->if_name);
+    }
+
+    if_freenameindex(names);
+    return ifaces;
+}
+
+std::vector<std::string>
+InterfaceLister::expand(const std::vector<std::string> &patterns) const {
+    std::vector<std::string> system_ifaces{};
+    std::vector<std::string> ifaces{};
+
+    auto add_iface = [&ifaces](const std::string &iface) {
+        if (std::find(ifaces.begin(), ifaces.end(), iface) == ifaces.end()) {
+            ifaces.push_back(iface);
+        }
+    };
+
+    for (const auto &pattern : patterns) {
+        if (!is_glob(pattern)) {
+            add_iface(pattern);
+            continue;
+        }
+
+        bool matched = false;
+
+        if (pattern.find(NETNS_SEPARATOR) != std::string::npos) {
+            for (const auto &iface : list_netns_ifaces(pattern)) {
+                add_iface(iface);
+                matched = true;
+            }
+        } else {
+            if (system_ifaces.empty()) {
+                system_ifaces = list_system_ifaces();
+            }
+
+            for (const auto &iface : system_ifaces) {
+                if (fnmatch(pattern.c_str(), iface.c_str(), 0) == 0) {
+                    add_iface(iface);
+                    matched = true;
+                }
+            }
+        }
+
+        if (!matched) {
+            THROW_ARGS(std::runtime_error, "no interface matches pattern: %s",
+                       pattern.c_str());
+        }
+    }
+
+    return ifaces;
+}
+
+bool InterfaceLister::is_glob(const std::string &pattern) const {
+    return pattern.find_first_of("*?[") != std::string::npos;
+}
+
+std::vector<std::string>
+InterfaceLister::list_netns_ifaces(const std::string &pattern) const {
+    std::vector<std::string> ifaces{};
+
+    std::string_view netns_view{};
+    std::string_view iface_view{};
+    split_netns_iface(pattern, &netns_view, &iface_view);
+
+    // fnmatch() wants them nul terminated
+    std::string netns_pattern{netns_view};
+    std::string iface_pattern{iface_view};
+
+#ifdef __linux__
+    for (const auto &netns : list_network_namespaces()) {
+        if (fnmatch(netns_pattern.c_str(), netns.name.c_str(), 0) != 0) {
+            continue;
+        }
+
+        // A netns we may not enter has no ifaces as far as we can tell
+        NetlinkSocket socket{netns.path};
+        socket.dump_link_stats([&](std::string_view iface_name,
+                                   const rtnl_link_stats64 * /*stats*/) {
+            std::string name{iface_name};
+            if (fnmatch(iface_pattern.c_str(), name.c_str(), 0) == 0) {
+                ifaces.push_back(netns.name + NETNS_SEPARATOR + name);
+            }
+        });
+    }
+#endif
+
+    return ifaces;
+}
+
+} // namespace sampling
+} // namespace bandwit
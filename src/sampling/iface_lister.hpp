@@ -0,0 +1,33 @@
+#ifndef IFACE_LISTER_H
+#define IFACE_LISTER_H
+
+#include <string>
+#include <vector>
+
+namespace bandwit {
+namespace sampling {
+
+class InterfaceLister {
+  public:
+    std::vector<std::string> list_system_ifaces() const;
+
+    // Expands glob patterns like "eth*" against the interfaces on the system.
+    // Plain names are passed through as they are, and every iface appears
+    // only once in the result. On Linux a pattern like "*:veth*" is expanded
+    // against the ifaces in the other network namespaces, into names like
+    // "<netns>:veth0".
+    std::vector<std::string>
+    expand(const std::vector<std::string> &patterns) const;
+
+  private:
+    bool is_glob(const std::string &pattern) const;
+
+    // the "<netns>:<iface>" names that match, in every netns but ours
+    std::vector<std::string>
+    list_netns_ifaces(const std::string &pattern) const;
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // IFACE_LISTER_H
@@ -0,0 +1,118 @@
+#include "platform.hpp"
+
+#ifdef BANDWIT_BSD
+
+#include <climits>
+#include <cstring>
+#include <ifaddrs.h>
+#include <memory>
+#include <net/if.h>
+#include <sys/socket.h>
+
+#include "aliases.hpp"
+#include "ifaddrs_sampler.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// Every quantity is in the same if_data
+static Sample make_sample(const if_data &data, TimePoint ts) {
+    Sample sample{};
+    sample.rx[Quantity::BYTES] = U64(data.ifi_ibytes);
+    sample.rx[Quantity::PACKETS] = U64(data.ifi_ipackets);
+    sample.rx[Quantity::ERRORS] = U64(data.ifi_ierrors);
+    sample.rx[Quantity::DROPS] = U64(data.ifi_iqdrops);
+    sample.tx[Quantity::BYTES] = U64(data.ifi_obytes);
+    sample.tx[Quantity::PACKETS] = U64(data.ifi_opackets);
+    sample.tx[Quantity::ERRORS] = U64(data.ifi_oerrors);
+#if defined(__FreeBSD__) || defined(__OpenBSD__)
+    // the others do not count the packets dropped on the way out
+    sample.tx[Quantity::DROPS] = U64(data.ifi_oqdrops);
+#endif
+    sample.ts = ts;
+    return sample;
+}
+
+Sample IfAddrsSampler::get_sample(const std::string &iface_name) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    ifaddrs *addrs{nullptr};
+    if (getifaddrs(&addrs) < 0) {
+        return Sample{{}, {}, ts, SampleError::READ_FAILED};
+    }
+
+    // make sure the list is freed however we leave this function
+    std::unique_ptr<ifaddrs, decltype(&freeifaddrs)> guard{addrs,
+                                                           &freeifaddrs};
+
+    for (ifaddrs *ifa = addrs; ifa != nullptr; ifa = ifa->ifa_next) {
+        // Every interface has one AF_LINK entry which carries the counters
+        if ((ifa->ifa_addr == nullptr) ||
+            (ifa->ifa_addr->sa_family != AF_LINK) ||
+            (ifa->ifa_data == nullptr)) {
+            continue;
+        }
+
+        if (strcmp(ifa->ifa_name, iface_name.c_str()) != 0) {
+            continue;
+        }
+
+        const auto *data = static_cast<const if_data *>(ifa->ifa_data);
+
+        return make_sample(*data, ts);
+    }
+
+    return Sample{{}, {}, ts, SampleError::NO_SUCH_IFACE};
+}
+
+void IfAddrsSampler::get_samples(const std::vector<std::string> &iface_names,
+                                 std::vector<Sample> *samples) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    index_.update(iface_names);
+    samples->resize(iface_names.size());
+
+    ifaddrs *addrs{nullptr};
+    if (getifaddrs(&addrs) < 0) {
+        for (auto &sample : *samples) {
+            sample = Sample{{}, {}, ts, SampleError::READ_FAILED};
+        }
+        return;
+    }
+
+    std::unique_ptr<ifaddrs, decltype(&freeifaddrs)> guard{addrs,
+                                                           &freeifaddrs};
+
+    // Until the iface turns up in the list
+    for (auto &sample : *samples) {
+        sample = Sample{{}, {}, ts, SampleError::NO_SUCH_IFACE};
+    }
+
+    for (ifaddrs *ifa = addrs; ifa != nullptr; ifa = ifa->ifa_next) {
+        if ((ifa->ifa_addr == nullptr) ||
+            (ifa->ifa_addr->sa_family != AF_LINK) ||
+            (ifa->ifa_data == nullptr)) {
+            continue;
+        }
+
+        auto pos = index_.find(ifa->ifa_name);
+        if (pos == index_.size()) {
+            continue;
+        }
+
+        const auto *data = static_cast<const if_data *>(ifa->ifa_data);
+        (*samples)[pos] = make_sample(*data, ts);
+    }
+}
+
+bool IfAddrsSampler::is_bulk() const { return true; }
+
+unsigned IfAddrsSampler::get_counter_bits() const {
+    return sizeof(if_data::ifi_ibytes) * CHAR_BIT;
+}
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // BANDWIT_BSD
@@ -0,0 +1,44 @@
+#ifndef IFADDRS_SAMPLER_H
+#define IFADDRS_SAMPLER_H
+
+#include "platform.hpp"
+
+#ifdef BANDWIT_BSD
+
+#include <string>
+
+#include "sampling/iface_index.hpp"
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// Reads the counters in-process from the struct if_data that getifaddrs()
+// attaches to every AF_LINK entry. This replaces forking netstat on BSD.
+class IfAddrsSampler : public Sampler {
+  public:
+    IfAddrsSampler() = default;
+    ~IfAddrsSampler() override = default;
+
+    CLASS_DISABLE_COPIES(IfAddrsSampler)
+    CLASS_DISABLE_MOVES(IfAddrsSampler)
+
+    Sample get_sample(const std::string &iface_name) override;
+    // one getifaddrs() call serves all the ifaces
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+    bool is_bulk() const override;
+
+    // the width of the counters in struct if_data, which varies by system
+    unsigned get_counter_bits() const override;
+
+  private:
+    InterfaceIndex index_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // BANDWIT_BSD
+
+#endif // IFADDRS_SAMPLER_H
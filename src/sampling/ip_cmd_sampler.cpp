@@ -1,103 +1,297 @@
-#include <array>
-#include <sstream>
-#include <stdexcept>
+#include <charconv>
 
 #include "aliases.hpp"
-#include "except.hpp"
 #include "ip_cmd_sampler.hpp"
+#include "tools/monotonic_clock.hpp"
 
 namespace bandwit {
 namespace sampling {
 
-uint64_t IpStatsParser::parse_nbytes(const std::string &line) const {
-    std::smatch mres{};
-    bool matches = std::regex_search(line, mres, pat_bytes_);
-    if (!matches) {
-        THROW_ARGS(std::runtime_error,
-                   "regex pat_bytes_ failed to match line: %s", line.c_str());
+void IpStatsParser::reset(std::string_view iface_name) {
+    iface_name_ = iface_name;
+    state_ = State::SEEK_IFACE;
+    is_iface_found_ = false;
+    is_rx_found_ = false;
+    is_tx_found_ = false;
+}
+
+void IpStatsParser::feed(std::string_view line) {
+    if (line.empty() || (state_ == State::DONE)) {
+        return;
+    }
+
+    // Only the iface header starts at the beginning of the line
+    if (line.front() != ' ') {
+        feed_header(line);
+    } else if (state_ != State::SEEK_IFACE) {
+        feed_body(line);
+    }
+}
+
+bool IpStatsParser::done() const { return state_ == State::DONE; }
+
+SampleError IpStatsParser::result(Counters *rx, Counters *tx) const {
+    if (!done()) {
+        return is_iface_found_ ? SampleError::PARSE_FAILED
+                               : SampleError::NO_SUCH_IFACE;
+    }
+
+    *rx = rx_;
+    *tx = tx_;
+    return SampleError::NONE;
+}
+
+SampleError IpStatsParser::parse(std::string_view output,
+                                 const std::string &iface_name, Counters *rx,
+                                 Counters *tx) {
+    reset(iface_name);
+
+    std::size_t line_start{0};
+    while ((line_start < output.size()) && !done()) {
+        feed(ProgramRunner::next_line(output, &line_start));
+    }
+
+    return result(rx, tx);
+}
+
+std::string_view IpStatsParser::get_header_name(std::string_view line) {
+    // "4: eth0: <...>" or "5: veth0@if4: <...>"
+    if (line.empty() || (line.front() == ' ')) {
+        return {};
+    }
+
+    auto name_start = line.find(": ");
+    if (name_start == std::string_view::npos) {
+        return {};
+    }
+    line.remove_prefix(name_start + 2);
+
+    auto name_end = line.find_first_of(":@");
+    if (name_end == std::string_view::npos) {
+        return {};
     }
 
-    std::string bytes_s = mres[1];
-    return std::stoul(bytes_s);
+    return line.substr(0, name_end);
 }
 
-std::pair<uint64_t, uint64_t>
-IpStatsParser::parse(const std::vector<std::string> &lines,
-                     const std::string &iface_name) const {
-    std::string cur_iface{};
+void IpStatsParser::feed_header(std::string_view line) {
+    state_ = State::SEEK_IFACE;
 
-    bool next_line_is_rx{false};
-    bool next_line_is_tx{false};
+    auto name = get_header_name(line);
+    if (!name.empty() && (name == iface_name_)) {
+        state_ = State::IN_IFACE;
+        is_iface_found_ = true;
+    }
+}
 
-    int64_t rx{-1};
-    int64_t tx{-1};
+void IpStatsParser::feed_body(std::string_view line) {
+    auto text_start = line.find_first_not_of(' ');
+    if (text_start == std::string_view::npos) {
+        return;
+    }
+    line.remove_prefix(text_start);
 
-    for (const std::string &line : lines) {
-        // Did we match RX: on the previous line?
-        if (next_line_is_rx) {
-            rx = parse_nbytes(line);
-            next_line_is_rx = false;
+    switch (state_) {
+    case State::RX_NUMBERS:
+        is_rx_found_ = parse_numbers(line, &rx_);
+        state_ = is_rx_found_ ? State::IN_IFACE : State::SEEK_IFACE;
+        break;
+    case State::TX_NUMBERS:
+        is_tx_found_ = parse_numbers(line, &tx_);
+        state_ = is_tx_found_ ? State::IN_IFACE : State::SEEK_IFACE;
+        break;
+    case State::IN_IFACE:
+        // The "RX errors:" headers printed with -s -s don't match here
+        if (line.rfind("RX: ", 0) == 0) {
+            state_ = State::RX_NUMBERS;
+        } else if (line.rfind("TX: ", 0) == 0) {
+            state_ = State::TX_NUMBERS;
         }
+        break;
+    case State::SEEK_IFACE:
+    case State::DONE:
+        break;
+    }
+
+    if (is_rx_found_ && is_tx_found_) {
+        state_ = State::DONE;
+    }
+}
+
+bool IpStatsParser::parse_numbers(std::string_view line,
+                                  Counters *counters) const {
+    // bytes packets errors dropped, in the order of the quantities, and then
+    // some that we don't want
+    const char *pos = line.data();
+    const char *end = line.data() + line.size();
 
-        // Did we match TX: on the previous line?
-        if (next_line_is_tx) {
-            tx = parse_nbytes(line);
-            next_line_is_tx = false;
+    for (auto &value : counters->values) {
+        while ((pos < end) && (*pos == ' ')) {
+            ++pos;
         }
 
-        // match iface name
-        std::smatch mres_iface;
-        bool matches = std::regex_search(line, mres_iface, pat_iface_);
-        if (matches) {
-            cur_iface = mres_iface[2];
-            continue;
+        auto res = std::from_chars(pos, end, value);
+        if (res.ec != std::errc()) {
+            return false;
         }
+        pos = res.ptr;
+    }
+
+    return true;
+}
+
+Sample IpCommandSampler::get_sample(const std::string &iface_name) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    if ((argv_.empty()) || (iface_name != iface_name_)) {
+        argv_ = {"ip", "-statistics", "link", "show", "dev", iface_name};
+        iface_name_ = iface_name;
+    }
+
+    Sample sample{};
+    sample.ts = ts;
 
-        // match RX: line
-        matches = std::regex_search(line, pat_rx_);
-        if (matches) {
-            next_line_is_rx = true;
-            continue;
+    std::string_view output{};
+    sample.error = runner_.run(argv_, &output);
+    if (sample.error == SampleError::NONE) {
+        sample.error =
+            parser_.parse(output, iface_name_, &sample.rx, &sample.tx);
+    }
+
+    return sample;
+}
+
+void IpCommandSampler::get_samples(const std::vector<std::string> &iface_names,
+                                   std::vector<Sample> *samples) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    index_.update(iface_names);
+    parsers_.resize(iface_names.size());
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        parsers_[i].reset(iface_names[i]);
+    }
+
+    std::string_view output{};
+    auto error = runner_.run(argv_all_, &output);
+
+    // The lines of an iface go to its parser only, those of the ifaces
+    // that are not ours are skipped
+    auto pos = index_.size();
+    std::size_t line_start{0};
+    while ((error == SampleError::NONE) && (line_start < output.size())) {
+        auto line = ProgramRunner::next_line(output, &line_start);
+        if (!line.empty() && (line.front() != ' ')) {
+            pos = index_.find(IpStatsParser::get_header_name(line));
         }
 
-        // match TX: line
-        matches = std::regex_search(line, pat_tx_);
-        if (matches) {
-            next_line_is_tx = true;
-            continue;
+        if (pos != index_.size()) {
+            parsers_[pos].feed(line);
         }
+    }
 
-        // We've found the right iface and we've parsed rx and tx!
-        if ((cur_iface == iface_name) && (rx >= 0 && tx >= 0)) {
-            auto urx = U64(rx);
-            auto utx = U64(tx);
-            return std::make_pair(urx, utx);
+    samples->resize(iface_names.size());
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        auto &sample = (*samples)[i];
+        sample = Sample{{}, {}, ts, error};
+        if (error == SampleError::NONE) {
+            const auto &parser = parsers_[index_.find(iface_names[i])];
+            sample.error = parser.result(&sample.rx, &sample.tx);
         }
     }
+}
+
+bool IpCommandSampler::is_bulk() const { return true; }
 
-    THROW_MSG(std::runtime_error,
-              "failed to find the right iface / parse output");
+Sample IpBatchSampler::get_sample(const std::string &iface_name) {
+    one_iface_.assign(1, iface_name);
+    get_samples(one_iface_, &one_sample_);
+    return one_sample_.front();
 }
 
-Sample IpCommandSampler::get_sample(const std::string &iface_name) const {
-    auto tp = Clock::now();
-    std::time_t ts = Clock::to_time_t(tp);
+void IpBatchSampler::get_samples(const std::vector<std::string> &iface_names,
+                                 std::vector<Sample> *samples) {
+    TimePoint ts = tools::MonotonicClock::now();
 
-    std::stringstream ss{};
-    ss << "ip -statistics link show dev " << iface_name;
-    std::string args = ss.str();
+    // Whatever is left of the answer must not be read as the next one
+    auto error = query(iface_names);
+    if (error != SampleError::NONE) {
+        ip_.reset();
+    }
 
-    auto output = runner_.run(args);
-    auto pair = parser_.parse(output, iface_name);
+    // ip answers in order and gives up at the first iface it does not know,
+    // the ifaces before it still got their answers
+    samples->resize(iface_names.size());
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        auto &sample = (*samples)[i];
+        sample = Sample{{}, {}, ts};
+        const auto &parser = parsers_[index_.find(iface_names[i])];
+        sample.error = parser.result(&sample.rx, &sample.tx);
+        if ((sample.error != SampleError::NONE) &&
+            (error != SampleError::NONE)) {
+            sample.error = error;
+        }
+    }
+}
 
-    Sample sample{
-        pair.first,
-        pair.second,
-        ts,
-    };
+bool IpBatchSampler::is_bulk() const { return true; }
 
-    return sample;
+SampleError
+IpBatchSampler::query(const std::vector<std::string> &iface_names) {
+    index_.update(iface_names);
+    parsers_.resize(iface_names.size());
+    if (iface_names.empty()) {
+        return SampleError::NONE;
+    }
+
+    if (ip_ == nullptr) {
+        ip_ = std::make_unique<Coprocess>(
+            std::vector<std::string>{"ip", "-statistics", "-batch", "-"});
+    }
+
+    if (iface_names != iface_names_) {
+        request_.clear();
+        for (const auto &iface_name : iface_names) {
+            request_.append("link show dev ").append(iface_name).append("\n");
+        }
+        iface_names_ = iface_names;
+    }
+
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        parsers_[i].reset(iface_names_[i]);
+    }
+
+    auto error = ip_->write_input(request_);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    // The answers come in the order of the queries and each starts with the
+    // one line that is not indented. Once all of them have started and the
+    // last parser is done, every answer has been read up to the lines after
+    // the last numbers, which the next query skips over as they are
+    // indented. Each line only goes to the parser of its iface.
+    const auto &last = parsers_[index_.find(iface_names.back())];
+    auto pos = index_.size();
+    std::size_t num_answers{0};
+    while ((num_answers < iface_names.size()) || !last.done()) {
+        std::string_view line{};
+        error = ip_->read_line(READ_TIMEOUT, &line);
+        if (error != SampleError::NONE) {
+            return error;
+        }
+
+        if (!line.empty() && (line.front() != ' ')) {
+            ++num_answers;
+            pos = index_.find(IpStatsParser::get_header_name(line));
+        }
+
+        if (pos != index_.size()) {
+            parsers_[pos].feed(line);
+        }
+    }
+
+    return SampleError::NONE;
 }
 
 } // namespace sampling
-} // namespace bandwit
\ No newline at end of file
+} // namespace bandwit
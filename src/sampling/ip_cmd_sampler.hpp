@@ -1,26 +1,65 @@
 #ifndef IP_CMD_SAMPLER_H
 #define IP_CMD_SAMPLER_H
 
-#include <regex>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "sampling/iface_index.hpp"
 #include "sampling/program_runner.hpp"
 #include "sampling/sampler.hpp"
 
 namespace bandwit {
 namespace sampling {
 
+// A state machine over the output of `ip -statistics link show`, fed one line
+// at a time:
+//
+//   4: eth0: <BROADCAST,MULTICAST,UP,LOWER_UP> mtu 1400 ...   <- iface header
+//       link/ether 02:fc:00:00:00:01 brd ff:ff:ff:ff:ff:ff
+//       RX:  bytes packets errors dropped  missed   mcast     <- RX header
+//             1318      19      0       0       0       0     <- numbers
+//       TX:  bytes packets errors dropped carrier collsns     <- TX header
+//             1230      17      0       0       0       0     <- numbers
 class IpStatsParser {
   public:
-    uint64_t parse_nbytes(const std::string &line) const;
-    std::pair<uint64_t, uint64_t> parse(const std::vector<std::string> &lines,
-                                        const std::string &iface_name) const;
+    void reset(std::string_view iface_name);
+    void feed(std::string_view line);
+    bool done() const;
+    // Puts the counters into rx and tx, if there is no error
+    SampleError result(Counters *rx, Counters *tx) const;
+
+    // convenience wrapper to parse a captured output in one go
+    SampleError parse(std::string_view output, const std::string &iface_name,
+                      Counters *rx, Counters *tx);
+
+    // The name of the iface that an iface header is of, empty if the line
+    // is not one. The lines after a header up to the next are all of that
+    // iface.
+    static std::string_view get_header_name(std::string_view line);
 
   private:
-    std::regex pat_iface_{R"(^([0-9]+): ([A-Za-z0-9]+):)"};
-    std::regex pat_rx_{R"(^    RX)"};
-    std::regex pat_tx_{R"(^    TX)"};
-    std::regex pat_bytes_{R"(^    ([0-9]+))"};
+    enum class State {
+        SEEK_IFACE,
+        IN_IFACE,
+        RX_NUMBERS,
+        TX_NUMBERS,
+        DONE,
+    };
+
+    void feed_header(std::string_view line);
+    void feed_body(std::string_view line);
+    bool parse_numbers(std::string_view line, Counters *counters) const;
+
+    std::string_view iface_name_{};
+    State state_{State::SEEK_IFACE};
+    // whether the iface header was seen, ie. the iface exists
+    bool is_iface_found_{false};
+    Counters rx_{};
+    Counters tx_{};
+    bool is_rx_found_{false};
+    bool is_tx_found_{false};
 };
 
 class IpCommandSampler : public Sampler {
@@ -31,14 +70,64 @@ class IpCommandSampler : public Sampler {
     CLASS_DISABLE_COPIES(IpCommandSampler)
     CLASS_DISABLE_MOVES(IpCommandSampler)
 
-    Sample get_sample(const std::string &iface_name) const override;
+    Sample get_sample(const std::string &iface_name) override;
+    // runs ip once for all the ifaces
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+    bool is_bulk() const override;
 
   private:
     ProgramRunner runner_{};
     IpStatsParser parser_{};
+    // one per iface in the index, each line only goes to the one of its
+    // iface
+    std::vector<IpStatsParser> parsers_{};
+    InterfaceIndex index_{};
+
+    // the command line is only rebuilt when the interface changes
+    std::string iface_name_{};
+    std::vector<std::string> argv_{};
+    const std::vector<std::string> argv_all_{"ip", "-statistics", "link",
+                                             "show"};
+};
+
+// Keeps a single `ip -statistics -batch -` running for the whole session and
+// queries it over its stdin, instead of starting an ip for every sample. If
+// ip goes away, eg. because an iface went away and the query failed, the
+// ifaces that were not answered fail and the next sample starts a new ip.
+class IpBatchSampler : public Sampler {
+  public:
+    IpBatchSampler() = default;
+    ~IpBatchSampler() override = default;
+
+    CLASS_DISABLE_COPIES(IpBatchSampler)
+    CLASS_DISABLE_MOVES(IpBatchSampler)
+
+    Sample get_sample(const std::string &iface_name) override;
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+    bool is_bulk() const override;
+
+  private:
+    // ip answers within milliseconds, anything longer means it is stuck
+    static constexpr Millis READ_TIMEOUT{1000};
+
+    SampleError query(const std::vector<std::string> &iface_names);
+
+    std::unique_ptr<Coprocess> ip_{nullptr};
+    std::vector<IpStatsParser> parsers_{};
+    InterfaceIndex index_{};
+
+    // a `link show dev` per iface, only rebuilt when the ifaces change
+    std::vector<std::string> iface_names_{};
+    std::string request_{};
+
+    // for get_sample
+    std::vector<std::string> one_iface_{};
+    std::vector<Sample> one_sample_{};
 };
 
 } // namespace sampling
 } // namespace bandwit
 
-#endif // IP_CMD_SAMPLER_H
\ No newline at end of file
+#endif // IP_CMD_SAMPLER_H
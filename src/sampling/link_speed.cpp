@@ -0,0 +1,59 @@
+#include <fstream>
+
+#include "link_speed.hpp"
+#include "macros.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// The name goes into a path, nothing but an iface of this netns may
+static bool is_sysfs_name(const std::string &iface_name) {
+    return !iface_name.empty() &&
+           (iface_name.find_first_of("/:") == std::string::npos) &&
+           (iface_name[0] != '.');
+}
+
+// A number in a file of the iface, nullopt if it cannot be read or is
+// negative, eg. the -1 of the speed of a link that is down
+static std::optional<uint64_t> read_number(const std::string &iface_name,
+                                           const char *file_name) {
+    if (!is_sysfs_name(iface_name)) {
+        return std::nullopt;
+    }
+
+    std::ifstream file{"/sys/class/net/" + iface_name + "/" + file_name};
+    long long num{0};
+    if (!(file >> num) || (num < 0)) {
+        return std::nullopt;
+    }
+
+    return U64(num);
+}
+
+std::optional<uint64_t> read_link_speed(const std::string &iface_name) {
+    auto mbits = read_number(iface_name, "speed");
+    if (!mbits.has_value() || (mbits.value() == 0)) {
+        return std::nullopt;
+    }
+
+    return mbits.value() * 1000 * 1000 / 8;
+}
+
+std::optional<uint64_t> LinkSpeeds::get(const std::string &iface_name) {
+    auto carrier_changes = read_number(iface_name, "carrier_changes");
+
+    auto it = links_.find(iface_name);
+    if ((it != links_.end()) &&
+        (it->second.carrier_changes == carrier_changes)) {
+        return it->second.speed;
+    }
+
+    // The first time, or the link went down or up since
+    auto &link = links_[iface_name];
+    link.carrier_changes = carrier_changes;
+    link.speed = read_link_speed(iface_name);
+    return link.speed;
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,37 @@
+#ifndef LINK_SPEED_H
+#define LINK_SPEED_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace bandwit {
+namespace sampling {
+
+// The line rate of the link of the iface in bytes a second, from the Mbit/s
+// in /sys/class/net/<iface>/speed. nullopt for the ifaces that have none,
+// eg. lo, a bridge or a link that is down, and off Linux.
+std::optional<uint64_t> read_link_speed(const std::string &iface_name);
+
+// The line rates of ifaces, each read once and again after its link changed,
+// eg. went down and came back at another speed. A check is one read of the
+// count of carrier changes in /sys/class/net/<iface>/carrier_changes.
+class LinkSpeeds {
+  public:
+    // Checks whether the link changed, nullopt if it has no line rate
+    std::optional<uint64_t> get(const std::string &iface_name);
+
+  private:
+    struct Link {
+        std::optional<uint64_t> carrier_changes{};
+        std::optional<uint64_t> speed{};
+    };
+
+    std::unordered_map<std::string, Link> links_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // LINK_SPEED_H
@@ -0,0 +1,397 @@
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <linux/rtnetlink.h>
+#include <net/if.h>
+#include <sys/socket.h>
+
+#include "aliases.hpp"
+#include "netlink_sampler.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+NetlinkSocket::NetlinkSocket(std::string netns_path)
+    : netns_path_{std::move(netns_path)} {}
+
+NetlinkSocket::~NetlinkSocket() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+SampleError NetlinkSocket::get_link_stats(const std::string &iface_name,
+                                          rtnl_link_stats64 *stats) {
+    auto error = check_netns();
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    if (fd_ < 0) {
+        error = open_socket();
+        if (error != SampleError::NONE) {
+            return error;
+        }
+    }
+
+    error = send_request(&iface_name);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    bool has_stats{false};
+    error = receive(
+        [stats, &has_stats](std::string_view /*iface_name*/,
+                            const rtnl_link_stats64 *link_stats) {
+            if (link_stats != nullptr) {
+                *stats = *link_stats;
+                has_stats = true;
+            }
+        },
+        false);
+
+    if ((error == SampleError::NONE) && !has_stats) {
+        return SampleError::PARSE_FAILED;
+    }
+
+    return error;
+}
+
+SampleError NetlinkSocket::dump_link_stats(const LinkCallback &on_link) {
+    auto error = check_netns();
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    if (fd_ < 0) {
+        error = open_socket();
+        if (error != SampleError::NONE) {
+            return error;
+        }
+    }
+
+    error = send_request(nullptr);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    return receive(on_link, true);
+}
+
+SampleError NetlinkSocket::open_socket() {
+    auto open_fd = [this] {
+        fd_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        return (fd_ < 0) ? SampleError::READ_FAILED : SampleError::NONE;
+    };
+
+    // The socket talks to the netns it was opened in for as long as it lives
+    if (!netns_path_.empty() && !get_netns_id(netns_path_, &netns_id_)) {
+        return SampleError::NO_SUCH_IFACE;
+    }
+
+    auto error = netns_path_.empty() ? open_fd()
+                                     : call_in_netns(netns_path_, open_fd);
+    if (error != SampleError::NONE) {
+        return error;
+    }
+
+    sockaddr_nl addr{};
+    addr.nl_family = AF_NETLINK;
+
+    // Not kept half open, the next sample tries again from scratch
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        close(fd_);
+        fd_ = -1;
+        return SampleError::READ_FAILED;
+    }
+
+    return SampleError::NONE;
+}
+
+SampleError NetlinkSocket::check_netns() {
+    if (netns_path_.empty() || (fd_ < 0)) {
+        return SampleError::NONE;
+    }
+
+    // One stat() per netns per sample
+    NetnsId id{};
+    bool is_found = get_netns_id(netns_path_, &id);
+    if (is_found && (id == netns_id_)) {
+        return SampleError::NONE;
+    }
+
+    close(fd_);
+    fd_ = -1;
+    return is_found ? SampleError::NONE : SampleError::NO_SUCH_IFACE;
+}
+
+SampleError NetlinkSocket::send_request(const std::string *iface_name) {
+    // No iface can have a name this long
+    if ((iface_name != nullptr) && (iface_name->size() >= IFNAMSIZ)) {
+        return SampleError::NO_SUCH_IFACE;
+    }
+
+    struct Request {
+        nlmsghdr hdr;
+        ifinfomsg ifi;
+        char attrs[RTA_SPACE(IFNAMSIZ)];
+    } req{};
+
+    req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(ifinfomsg));
+    req.hdr.nlmsg_type = RTM_GETLINK;
+    req.hdr.nlmsg_flags = NLM_F_REQUEST;
+    req.hdr.nlmsg_seq = ++seq_;
+    req.ifi.ifi_family = AF_UNSPEC;
+
+    if (iface_name == nullptr) {
+        req.hdr.nlmsg_flags |= NLM_F_DUMP;
+    } else {
+        // Look up the link by name rather than by index, so that an
+        // interface that is recreated with a new index is still found.
+        auto *rta = reinterpret_cast<rtattr *>(req.attrs);
+        rta->rta_type = IFLA_IFNAME;
+        rta->rta_len = U16(RTA_LENGTH(iface_name->size() + 1));
+        memcpy(RTA_DATA(rta), iface_name->c_str(), iface_name->size() + 1);
+        req.hdr.nlmsg_len =
+            NLMSG_ALIGN(req.hdr.nlmsg_len) + RTA_ALIGN(rta->rta_len);
+    }
+
+    sockaddr_nl kernel{};
+    kernel.nl_family = AF_NETLINK;
+
+    ssize_t rv = sendto(fd_, &req, req.hdr.nlmsg_len, 0,
+                        reinterpret_cast<sockaddr *>(&kernel), sizeof(kernel));
+    if (rv < 0) {
+        return SampleError::READ_FAILED;
+    }
+
+    return SampleError::NONE;
+}
+
+SampleError NetlinkSocket::receive(const LinkCallback &on_link,
+                                   bool is_dump) {
+    bool is_done = false;
+
+    while (!is_done) {
+        ssize_t len = recv(fd_, buffer_.data(), buffer_.size(), 0);
+        if (len < 0) {
+            return SampleError::READ_FAILED;
+        }
+
+        auto error = parse_response(SIZE_T(len), on_link, is_dump, &is_done);
+        if (error != SampleError::NONE) {
+            return error;
+        }
+    }
+
+    return SampleError::NONE;
+}
+
+SampleError NetlinkSocket::parse_response(std::size_t len,
+                                          const LinkCallback &on_link,
+                                          bool is_dump, bool *is_done) {
+    auto *hdr = reinterpret_cast<nlmsghdr *>(buffer_.data());
+    auto remaining = INT(len);
+
+    for (; NLMSG_OK(hdr, remaining); hdr = NLMSG_NEXT(hdr, remaining)) {
+        // Skip stale replies to earlier requests
+        if (hdr->nlmsg_seq != seq_) {
+            continue;
+        }
+
+        // A request for a link that does not exist is answered with ENODEV
+        if (hdr->nlmsg_type == NLMSG_ERROR) {
+            auto *err = reinterpret_cast<nlmsgerr *>(message_data(hdr));
+            *is_done = true;
+            return (err->error == -ENODEV) ? SampleError::NO_SUCH_IFACE
+                                           : SampleError::READ_FAILED;
+        }
+
+        // A dump is a multipart message terminated by NLMSG_DONE
+        if (hdr->nlmsg_type == NLMSG_DONE) {
+            *is_done = true;
+            return SampleError::NONE;
+        }
+
+        if (hdr->nlmsg_type == RTM_NEWLINK) {
+            parse_link(hdr, on_link);
+
+            // The reply to a plain request is just one message
+            if (!is_dump) {
+                *is_done = true;
+                return SampleError::NONE;
+            }
+        }
+    }
+
+    *is_done = false;
+    return SampleError::NONE;
+}
+
+void NetlinkSocket::parse_link(nlmsghdr *hdr, const LinkCallback &on_link) {
+    auto *ifi = reinterpret_cast<ifinfomsg *>(message_data(hdr));
+    auto attrs_len = INT(IFLA_PAYLOAD(hdr));
+
+    std::string_view iface_name{};
+    const rtattr *stats_rta{nullptr};
+
+    for (auto *rta = IFLA_RTA(ifi); RTA_OK(rta, attrs_len);
+         rta = RTA_NEXT(rta, attrs_len)) {
+        if (rta->rta_type == IFLA_IFNAME) {
+            iface_name = std::string_view{PCHAR(RTA_DATA(rta))};
+        } else if (rta->rta_type == IFLA_STATS64) {
+            stats_rta = rta;
+        }
+    }
+
+    if (stats_rta == nullptr) {
+        on_link(iface_name, nullptr);
+        return;
+    }
+
+    // The attribute payload is only 4 byte aligned
+    rtnl_link_stats64 stats{};
+    memcpy(&stats, RTA_DATA(stats_rta), sizeof(stats));
+
+    on_link(iface_name, &stats);
+}
+
+char *NetlinkSocket::message_data(nlmsghdr *hdr) {
+    // Same as NLMSG_DATA, minus the C style cast
+    return reinterpret_cast<char *>(hdr) + NLMSG_HDRLEN;
+}
+
+// Every quantity is in the same reply
+static void set_counters(const rtnl_link_stats64 &stats, Sample *sample) {
+    sample->rx[Quantity::BYTES] = U64(stats.rx_bytes);
+    sample->rx[Quantity::PACKETS] = U64(stats.rx_packets);
+    sample->rx[Quantity::ERRORS] = U64(stats.rx_errors);
+    sample->rx[Quantity::DROPS] = U64(stats.rx_dropped);
+    sample->tx[Quantity::BYTES] = U64(stats.tx_bytes);
+    sample->tx[Quantity::PACKETS] = U64(stats.tx_packets);
+    sample->tx[Quantity::ERRORS] = U64(stats.tx_errors);
+    sample->tx[Quantity::DROPS] = U64(stats.tx_dropped);
+}
+
+Sample NetlinkSampler::get_sample(const std::string &iface_name) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    std::string_view netns{};
+    std::string_view name{};
+    split_netns_iface(iface_name, &netns, &name);
+
+    rtnl_link_stats64 stats{};
+    auto error =
+        get_namespace(netns)->socket.get_link_stats(std::string{name}, &stats);
+
+    Sample sample{};
+    set_counters(stats, &sample);
+    sample.ts = ts;
+    sample.error = error;
+
+    return sample;
+}
+
+void NetlinkSampler::get_samples(const std::vector<std::string> &iface_names,
+                                 std::vector<Sample> *samples) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    update_namespaces(iface_names);
+    samples->resize(iface_names.size());
+
+    // Until the iface turns up in the dump
+    for (auto &sample : *samples) {
+        sample = Sample{};
+        sample.ts = ts;
+        sample.error = SampleError::NO_SUCH_IFACE;
+    }
+
+    for (auto &entry : namespaces_) {
+        auto &ns = *entry.second;
+        if (ns.positions.empty()) {
+            continue;
+        }
+
+        auto error = ns.socket.dump_link_stats(
+            [&ns, samples, ts](std::string_view iface_name,
+                               const rtnl_link_stats64 *stats) {
+                auto idx = ns.index.find(iface_name);
+                if (idx == ns.index.size()) {
+                    return;
+                }
+
+                auto &sample = (*samples)[ns.positions[idx]];
+                if (stats == nullptr) {
+                    sample.error = SampleError::PARSE_FAILED;
+                    return;
+                }
+
+                set_counters(*stats, &sample);
+                sample.error = SampleError::NONE;
+            });
+
+        // Eg. a netns that is gone fails all of its ifaces, but only them
+        if (error != SampleError::NONE) {
+            for (auto pos : ns.positions) {
+                (*samples)[pos].error = error;
+            }
+        }
+    }
+}
+
+bool NetlinkSampler::is_bulk() const { return true; }
+
+void NetlinkSampler::update_namespaces(
+    const std::vector<std::string> &iface_names) {
+    if (iface_names == iface_names_) {
+        return;
+    }
+
+    for (auto &entry : namespaces_) {
+        entry.second->iface_names.clear();
+        entry.second->positions.clear();
+    }
+
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        std::string_view netns{};
+        std::string_view name{};
+        split_netns_iface(iface_names[i], &netns, &name);
+
+        auto *ns = get_namespace(netns);
+        ns->iface_names.emplace_back(name);
+        ns->positions.push_back(i);
+    }
+
+    // The sockets of the namespaces that are still sampled are kept
+    for (auto it = namespaces_.begin(); it != namespaces_.end();) {
+        if (it->second->iface_names.empty()) {
+            it = namespaces_.erase(it);
+        } else {
+            it->second->index.update(it->second->iface_names);
+            ++it;
+        }
+    }
+
+    iface_names_ = iface_names;
+}
+
+NetlinkSampler::Namespace *
+NetlinkSampler::get_namespace(std::string_view netns) {
+    auto it = namespaces_.find(netns);
+    if (it != namespaces_.end()) {
+        return it->second.get();
+    }
+
+    auto netns_path = netns.empty() ? std::string{} : get_netns_path(netns);
+    auto ns = std::make_unique<Namespace>(std::move(netns_path));
+    auto *ptr = ns.get();
+    namespaces_.emplace(std::string{netns}, std::move(ns));
+    return ptr;
+}
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // __linux__
@@ -0,0 +1,113 @@
+#ifndef NETLINK_SAMPLER_H
+#define NETLINK_SAMPLER_H
+
+#ifdef __linux__
+
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sampling/iface_index.hpp"
+#include "sampling/netns.hpp"
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// A NETLINK_ROUTE socket that is opened once and reused for every request.
+class NetlinkSocket {
+  public:
+    NetlinkSocket() = default;
+    // A socket in the network namespace at netns_path, rather than in ours
+    explicit NetlinkSocket(std::string netns_path);
+    ~NetlinkSocket();
+
+    CLASS_DISABLE_COPIES(NetlinkSocket)
+    CLASS_DISABLE_MOVES(NetlinkSocket)
+
+    // stats is nullptr for a link that came without counters
+    using LinkCallback = std::function<void(std::string_view iface_name,
+                                            const rtnl_link_stats64 *stats)>;
+
+    SampleError get_link_stats(const std::string &iface_name,
+                               rtnl_link_stats64 *stats);
+    // one request that returns the counters for every interface
+    SampleError dump_link_stats(const LinkCallback &on_link);
+
+  private:
+    SampleError open_socket();
+    // Closes the socket if its netns went away, or another took its name:
+    // an open socket would keep a deleted netns alive
+    SampleError check_netns();
+    SampleError send_request(const std::string *iface_name);
+    SampleError receive(const LinkCallback &on_link, bool is_dump);
+    SampleError parse_response(std::size_t len, const LinkCallback &on_link,
+                               bool is_dump, bool *is_done);
+    void parse_link(nlmsghdr *hdr, const LinkCallback &on_link);
+    static char *message_data(nlmsghdr *hdr);
+
+    std::string netns_path_{};
+    NetnsId netns_id_{};
+    int fd_{-1};
+    uint32_t seq_{0};
+
+    // Large enough for an RTM_NEWLINK message with all its attributes
+    std::vector<char> buffer_ = std::vector<char>(32768);
+};
+
+// Reads the 64bit link counters in binary form straight from the kernel - one
+// sendto() and one recv() per sample and no text parsing. When sampling
+// several ifaces a single dump request returns all of them.
+//
+// Ifaces named "<netns>:<iface>" are sampled in that network namespace, over
+// a socket that is opened in it once and then kept, so that any number of
+// namespaces cost one dump request each per sample.
+class NetlinkSampler : public Sampler {
+  public:
+    NetlinkSampler() = default;
+    ~NetlinkSampler() override = default;
+
+    CLASS_DISABLE_COPIES(NetlinkSampler)
+    CLASS_DISABLE_MOVES(NetlinkSampler)
+
+    Sample get_sample(const std::string &iface_name) override;
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+    bool is_bulk() const override;
+
+  private:
+    // The ifaces sampled in one network namespace
+    struct Namespace {
+        explicit Namespace(std::string netns_path)
+            : socket{std::move(netns_path)} {}
+
+        NetlinkSocket socket;
+
+        // the names without the netns, and where their samples go
+        std::vector<std::string> iface_names{};
+        std::vector<std::size_t> positions{};
+        InterfaceIndex index{};
+    };
+
+    // Cheap when the list hasn't changed since the last call
+    void update_namespaces(const std::vector<std::string> &iface_names);
+    Namespace *get_namespace(std::string_view netns);
+
+    std::vector<std::string> iface_names_{};
+
+    // by netns name, our own is ""
+    std::map<std::string, std::unique_ptr<Namespace>, std::less<>>
+        namespaces_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // __linux__
+
+#endif // NETLINK_SAMPLER_H
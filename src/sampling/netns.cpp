@@ -0,0 +1,163 @@
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <set>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "netns.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+void split_netns_iface(std::string_view name, std::string_view *netns,
+                       std::string_view *iface) {
+    auto sep = name.rfind(NETNS_SEPARATOR);
+    if (sep == std::string_view::npos) {
+        *netns = std::string_view{};
+        *iface = name;
+        return;
+    }
+
+    *netns = name.substr(0, sep);
+    *iface = name.substr(sep + 1);
+}
+
+#ifdef __linux__
+
+constexpr const char *NAMED_NETNS_DIR = "/var/run/netns";
+constexpr const char *OWN_NETNS_PATH = "/proc/self/ns/net";
+
+static bool is_number(std::string_view str) {
+    if (str.empty()) {
+        return false;
+    }
+
+    for (char ch : str) {
+        if ((ch < '0') || (ch > '9')) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string get_netns_path(std::string_view netns) {
+    if (is_number(netns)) {
+        return "/proc/" + std::string{netns} + "/ns/net";
+    }
+
+    return std::string{NAMED_NETNS_DIR} + "/" + std::string{netns};
+}
+
+bool get_netns_id(const std::string &netns_path, NetnsId *id) {
+    struct stat st {};
+    if (stat(netns_path.c_str(), &st) < 0) {
+        return false;
+    }
+
+    *id = NetnsId{st.st_dev, st.st_ino};
+    return true;
+}
+
+// The names of the entries of a dir, without "." and ".."
+static std::vector<std::string> list_dir(const char *path) {
+    std::vector<std::string> names{};
+
+    DIR *dir = opendir(path);
+    if (dir == nullptr) {
+        return names;
+    }
+
+    while (auto *entry = readdir(dir)) {
+        std::string name{entry->d_name};
+        if ((name != ".") && (name != "..")) {
+            names.push_back(std::move(name));
+        }
+    }
+
+    closedir(dir);
+    return names;
+}
+
+std::vector<NetworkNamespace> list_network_namespaces() {
+    std::vector<NetworkNamespace> namespaces{};
+    std::set<NetnsId> seen{};
+
+    NetnsId own_id{};
+    if (get_netns_id(OWN_NETNS_PATH, &own_id)) {
+        seen.insert(own_id);
+    }
+
+    auto add_netns = [&namespaces, &seen](std::string name) {
+        auto path = get_netns_path(name);
+
+        NetnsId id{};
+        if (!get_netns_id(path, &id) || !seen.insert(id).second) {
+            return;
+        }
+
+        namespaces.push_back(NetworkNamespace{std::move(name), path});
+    };
+
+    for (auto &name : list_dir(NAMED_NETNS_DIR)) {
+        // A number would be taken for a pid
+        if (!is_number(name)) {
+            add_netns(std::move(name));
+        }
+    }
+
+    // Many processes share a netns, only the first of them names it
+    for (auto &name : list_dir("/proc")) {
+        if (is_number(name)) {
+            add_netns(std::move(name));
+        }
+    }
+
+    return namespaces;
+}
+
+SampleError call_in_netns(const std::string &netns_path,
+                          const std::function<SampleError()> &fn) {
+    int own_fd = open(OWN_NETNS_PATH, O_RDONLY | O_CLOEXEC);
+    if (own_fd < 0) {
+        return SampleError::READ_FAILED;
+    }
+
+    int fd = open(netns_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        auto error = (errno == ENOENT) ? SampleError::NO_SUCH_IFACE
+                                       : SampleError::READ_FAILED;
+        close(own_fd);
+        return error;
+    }
+
+    if (setns(fd, CLONE_NEWNET) < 0) {
+        close(fd);
+        close(own_fd);
+        return SampleError::READ_FAILED;
+    }
+    close(fd);
+
+    auto error = fn();
+
+    // A thread that is left behind would go on to sample the wrong ifaces
+    int rv = setns(own_fd, CLONE_NEWNET);
+    int err = errno;
+    close(own_fd);
+    if (rv < 0) {
+        errno = err;
+        THROW_CERROR(std::runtime_error,
+                     "call_in_netns failed to return in setns()");
+    }
+
+    return error;
+}
+
+#endif // __linux__
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,61 @@
+#ifndef NETNS_H
+#define NETNS_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <utility>
+#include <vector>
+
+#include "sampling/sample.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// An iface in another network namespace is named "<netns>:<iface>". The
+// kernel does not allow a colon in an iface name, so the last colon is
+// always the separator.
+constexpr char NETNS_SEPARATOR = ':';
+
+// Splits "<netns>:<iface>", the netns is empty for an iface of our own
+void split_netns_iface(std::string_view name, std::string_view *netns,
+                       std::string_view *iface);
+
+#ifdef __linux__
+
+// A network namespace other than our own, either one named by `ip netns`, by
+// its name in /var/run/netns, or else one that a process is in, eg. a
+// container, by the pid of the process.
+struct NetworkNamespace {
+    std::string name{};
+    std::string path{};
+};
+
+// The file to setns() into for a netns named as above
+std::string get_netns_path(std::string_view netns);
+
+// Tells the namespaces apart, a netns is the same file wherever it is bind
+// mounted or linked from
+using NetnsId = std::pair<dev_t, ino_t>;
+
+// false if there is no netns at the path, eg. it was deleted or its process
+// exited
+bool get_netns_id(const std::string &netns_path, NetnsId *id);
+
+// Every network namespace on the system other than our own, each once, with
+// the named ones first. Those of processes we cannot look into are left out.
+std::vector<NetworkNamespace> list_network_namespaces();
+
+// Calls fn with the calling thread in a network namespace, eg. to open a
+// socket in it, which stays in it for good. Only the thread is moved, and it
+// is moved back before this returns. Moving takes CAP_SYS_ADMIN.
+SampleError call_in_netns(const std::string &netns_path,
+                          const std::function<SampleError()> &fn);
+
+#endif // __linux__
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // NETNS_H
@@ -1,61 +1,131 @@
-#include <stdexcept>
+#include <charconv>
 
 #include "aliases.hpp"
-#include "except.hpp"
 #include "netstat_cmd_sampler.hpp"
+#include "tools/monotonic_clock.hpp"
 
 namespace bandwit {
 namespace sampling {
 
-std::pair<uint64_t, uint64_t>
-NetstatStatsParser::parse(const std::vector<std::string> &lines,
-                          const std::string &iface_name) const {
-    std::string cur_iface{};
+// The whole string has to be the number, the regex lets a "+" through
+static bool parse_number(const std::string &str, uint64_t *value) {
+    auto res = std::from_chars(str.data(), str.data() + str.size(), *value);
+    return (res.ec == std::errc()) && (res.ptr == str.data() + str.size());
+}
 
-    int64_t rx{-1};
-    int64_t tx{-1};
+// A "-" where the platform does not count something is a 0
+static uint64_t parse_number_or_zero(const std::string &str) {
+    uint64_t value{0};
+    return parse_number(str, &value) ? value : 0;
+}
 
-    for (const std::string &line : lines) {
-        std::smatch mres_lines;
-        bool matches = std::regex_search(line, mres_lines, pat_line_);
-        if (matches) {
-            cur_iface = mres_lines[1];
+SampleError NetstatStatsParser::parse(std::string_view output,
+                                      const std::string &iface_name,
+                                      Counters *rx, Counters *tx) const {
+    std::size_t line_start{0};
+    while (line_start < output.size()) {
+        auto line = ProgramRunner::next_line(output, &line_start);
 
-            if (cur_iface == iface_name) {
-                std::string rx_s = mres_lines[8];
-                rx = std::stoul(rx_s);
+        std::cmatch mres_lines;
+        bool matches = std::regex_search(line.data(), line.data() + line.size(),
+                                         mres_lines, pat_line_);
+        if (matches && (mres_lines[1] == iface_name)) {
+            return parse_match(mres_lines, rx, tx);
+        }
+    }
 
-                std::string tx_s = mres_lines[11];
-                tx = std::stoul(tx_s);
+    return SampleError::NO_SUCH_IFACE;
+}
 
-                auto urx = U64(rx);
-                auto utx = U64(tx);
-                return std::make_pair(urx, utx);
-            }
-        }
+void NetstatStatsParser::scan_all(std::string_view output,
+                                  const InterfaceIndex &index,
+                                  std::vector<Sample> *samples) const {
+    // Until its line turns up
+    for (auto &sample : *samples) {
+        sample.error = SampleError::NO_SUCH_IFACE;
     }
 
-    THROW_MSG(std::runtime_error,
-              "failed to find the right iface / parse output");
+    std::size_t line_start{0};
+    while (line_start < output.size()) {
+        auto line = ProgramRunner::next_line(output, &line_start);
+
+        std::cmatch mres_lines;
+        bool matches = std::regex_search(line.data(), line.data() + line.size(),
+                                         mres_lines, pat_line_);
+        if (!matches) {
+            continue;
+        }
+
+        std::string_view name{mres_lines[1].first,
+                              SIZE_T(mres_lines[1].length())};
+        auto pos = index.find(name);
+        if (pos == index.size()) {
+            continue;
+        }
+
+        // The first line of an iface has the link layer counters, the ones
+        // of its addresses after it must not overwrite them
+        auto &sample = (*samples)[pos];
+        if (sample.error == SampleError::NO_SUCH_IFACE) {
+            sample.error = parse_match(mres_lines, &sample.rx, &sample.tx);
+        }
+    }
 }
 
-Sample NetstatCommandSampler::get_sample(const std::string &iface_name) const {
-    auto tp = Clock::now();
-    std::time_t ts = Clock::to_time_t(tp);
+SampleError NetstatStatsParser::parse_match(const std::cmatch &mres_lines,
+                                            Counters *rx,
+                                            Counters *tx) const {
+    // Ipkts Ierrs Idrop Ibytes Opkts Oerrs Obytes, the drops going out are
+    // only printed with -d
+    if (!parse_number(mres_lines[8], &(*rx)[Quantity::BYTES]) ||
+        !parse_number(mres_lines[11], &(*tx)[Quantity::BYTES])) {
+        return SampleError::PARSE_FAILED;
+    }
+
+    (*rx)[Quantity::PACKETS] = parse_number_or_zero(mres_lines[5]);
+    (*rx)[Quantity::ERRORS] = parse_number_or_zero(mres_lines[6]);
+    (*rx)[Quantity::DROPS] = parse_number_or_zero(mres_lines[7]);
+    (*tx)[Quantity::PACKETS] = parse_number_or_zero(mres_lines[9]);
+    (*tx)[Quantity::ERRORS] = parse_number_or_zero(mres_lines[10]);
+    return SampleError::NONE;
+}
 
-    std::string args{"netstat -ibn"};
+Sample NetstatCommandSampler::get_sample(const std::string &iface_name) {
+    TimePoint ts = tools::MonotonicClock::now();
 
-    auto output = runner_.run(args);
-    auto pair = parser_.parse(output, iface_name);
+    Sample sample{{}, {}, ts};
 
-    Sample sample{
-        pair.first,
-        pair.second,
-        ts,
-    };
+    std::string_view output{};
+    sample.error = runner_.run(argv_, &output);
+    if (sample.error == SampleError::NONE) {
+        sample.error =
+            parser_.parse(output, iface_name, &sample.rx, &sample.tx);
+    }
 
     return sample;
 }
 
+void NetstatCommandSampler::get_samples(
+    const std::vector<std::string> &iface_names,
+    std::vector<Sample> *samples) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    index_.update(iface_names);
+
+    std::string_view output{};
+    auto error = runner_.run(argv_, &output);
+
+    samples->resize(iface_names.size());
+    for (auto &sample : *samples) {
+        sample = Sample{{}, {}, ts, error};
+    }
+
+    if (error == SampleError::NONE) {
+        parser_.scan_all(output, index_, samples);
+    }
+}
+
+bool NetstatCommandSampler::is_bulk() const { return true; }
+
 } // namespace sampling
 } // namespace bandwit
@@ -3,7 +3,10 @@
 
 #include <regex>
 #include <string>
+#include <string_view>
+#include <vector>
 
+#include "sampling/iface_index.hpp"
 #include "sampling/program_runner.hpp"
 #include "sampling/sampler.hpp"
 
@@ -12,10 +15,18 @@ namespace sampling {
 
 class NetstatStatsParser {
   public:
-    std::pair<uint64_t, uint64_t> parse(const std::vector<std::string> &lines,
-                                        const std::string &iface_name) const;
+    SampleError parse(std::string_view output, const std::string &iface_name,
+                      Counters *rx, Counters *tx) const;
+    // Every line is matched once and goes to the sample of its iface, an
+    // iface that is not in the output does not keep the others from being
+    // read
+    void scan_all(std::string_view output, const InterfaceIndex &index,
+                  std::vector<Sample> *samples) const;
 
   private:
+    SampleError parse_match(const std::cmatch &mres_lines, Counters *rx,
+                            Counters *tx) const;
+
     std::regex pat_line_{
         R"(^([A-Za-z0-9]+)\s+([^ ]+)\s+([^ ]+)\s+([^ ]+)\s+([^ ]+)\s+([^ ]+)\s+([^ ]+)\s+([0-9+]+)\s+([^ ]+)\s+([^ ]+)\s+([0-9+]+))"};
 };
@@ -29,11 +40,17 @@ class NetstatCommandSampler : public Sampler {
     CLASS_DISABLE_COPIES(NetstatCommandSampler)
     CLASS_DISABLE_MOVES(NetstatCommandSampler)
 
-    Sample get_sample(const std::string &iface_name) const override;
+    Sample get_sample(const std::string &iface_name) override;
+    // runs netstat once for all the ifaces
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+    bool is_bulk() const override;
 
   private:
     ProgramRunner runner_{};
     NetstatStatsParser parser_{};
+    InterfaceIndex index_{};
+    const std::vector<std::string> argv_{"netstat", "-ibn"};
 };
 
 } // namespace sampling
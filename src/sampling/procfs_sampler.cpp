@@ -1,33 +1,42 @@
+#include <array>
+#include <charconv>
+#include <climits>
+#include <fcntl.h>
 #include <fstream>
-#include <stdexcept>
 
 #include "aliases.hpp"
-#include "except.hpp"
 #include "procfs_sampler.hpp"
+#include "tools/monotonic_clock.hpp"
 
 namespace bandwit {
 namespace sampling {
 
-std::vector<std::string> ProcFsParser::read_file_as_lines() const {
+ProcFsParser::~ProcFsParser() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+SampleError
+ProcFsParser::read_file_as_lines(std::vector<std::string> *lines) const {
     std::ifstream fl{filepath_};
     if (!fl) {
-        THROW_ARGS(std::runtime_error, "failed to open file for reading: %s",
-                   filepath_.c_str());
+        return SampleError::READ_FAILED;
     }
 
     std::string line{};
-    std::vector<std::string> lines{};
+    lines->clear();
 
     while (getline(fl, line)) {
-        lines.push_back(std::move(line));
+        lines->push_back(std::move(line));
     }
 
-    return lines;
+    return SampleError::NONE;
 }
 
-std::pair<uint64_t, uint64_t>
-ProcFsParser::parse(const std::vector<std::string> &lines,
-                    const std::string &iface_name) const {
+SampleError ProcFsParser::parse(const std::vector<std::string> &lines,
+                                const std::string &iface_name, Counters *rx,
+                                Counters *tx) const {
     for (const std::string &line : lines) {
         std::smatch mres;
 
@@ -35,36 +44,251 @@ ProcFsParser::parse(const std::vector<std::string> &lines,
         if (matches) {
             std::string cur_iface = mres[1];
             if (cur_iface == iface_name) {
-                std::string rx_s = mres[2];
-                std::string tx_s = mres[10];
+                // bytes packets errs drop are the first four of the eight
+                // fields of each
+                for (std::size_t i = 0; i < NUM_QUANTITIES; ++i) {
+                    std::string rx_s = mres[2 + i];
+                    std::string tx_s = mres[10 + i];
 
-                uint64_t rx = std::stoul(rx_s);
-                uint64_t tx = std::stoul(tx_s);
+                    auto rx_res = std::from_chars(
+                        rx_s.data(), rx_s.data() + rx_s.size(), rx->values[i]);
+                    auto tx_res = std::from_chars(
+                        tx_s.data(), tx_s.data() + tx_s.size(), tx->values[i]);
+                    if ((rx_res.ec != std::errc()) ||
+                        (tx_res.ec != std::errc())) {
+                        return SampleError::PARSE_FAILED;
+                    }
+                }
 
-                return std::make_pair(rx, tx);
+                return SampleError::NONE;
             }
         }
     }
 
-    THROW_MSG(std::runtime_error,
-              "failed to find the right iface / parse output");
+    return SampleError::NO_SUCH_IFACE;
+}
+
+SampleError ProcFsParser::read_file(std::string_view *contents) {
+    if (fd_ < 0) {
+        fd_ = open(filepath_.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_ < 0) {
+            return SampleError::READ_FAILED;
+        }
+    }
+
+    if (buffer_.empty()) {
+        buffer_.resize(4096);
+    }
+
+    // The file has no size we can stat, so read until EOF and grow the buffer
+    // as needed. Once it's big enough it will stay that size.
+    std::size_t total{0};
+
+    while (true) {
+        if (total == buffer_.size()) {
+            buffer_.resize(buffer_.size() * 2);
+        }
+
+        ssize_t num_read = pread(fd_, &buffer_[total], buffer_.size() - total,
+                                 static_cast<off_t>(total));
+        if (num_read < 0) {
+            return SampleError::READ_FAILED;
+        }
+
+        if (num_read == 0) {
+            break;
+        }
+
+        total += SIZE_T(num_read);
+    }
+
+    *contents = std::string_view{buffer_.data(), total};
+    return SampleError::NONE;
+}
+
+SampleError ProcFsParser::scan(std::string_view contents,
+                               const std::string &iface_name, Counters *rx,
+                               Counters *tx) const {
+    std::size_t line_start{0};
+
+    while (line_start < contents.size()) {
+        auto line = next_line(contents, &line_start);
+
+        // Compare just the name, we don't care about any other interfaces
+        std::string_view name{};
+        std::string_view counters{};
+        if (!split_line(line, &name, &counters) || (name != iface_name)) {
+            continue;
+        }
+
+        if (!parse_counters(counters, rx, tx)) {
+            return SampleError::PARSE_FAILED;
+        }
+
+        return SampleError::NONE;
+    }
+
+    return SampleError::NO_SUCH_IFACE;
 }
 
-Sample ProcFsSampler::get_sample(const std::string &iface_name) const {
-    auto tp = Clock::now();
-    std::time_t ts = Clock::to_time_t(tp);
+void ProcFsParser::scan_all(std::string_view contents,
+                            const InterfaceIndex &index,
+                            std::vector<Sample> *samples) const {
+    // Until its line turns up
+    for (auto &sample : *samples) {
+        sample.error = SampleError::NO_SUCH_IFACE;
+    }
+
+    std::size_t line_start{0};
+
+    while (line_start < contents.size()) {
+        auto line = next_line(contents, &line_start);
+
+        std::string_view name{};
+        std::string_view counters{};
+        if (!split_line(line, &name, &counters)) {
+            continue;
+        }
+
+        auto pos = index.find(name);
+        if (pos == index.size()) {
+            continue;
+        }
 
-    auto lines = parser_.read_file_as_lines();
-    auto pair = parser_.parse(lines, iface_name);
+        auto &sample = (*samples)[pos];
+        sample.error = parse_counters(counters, &sample.rx, &sample.tx)
+                           ? SampleError::NONE
+                           : SampleError::PARSE_FAILED;
+    }
+}
 
-    Sample sample{
-        pair.first,
-        pair.second,
-        ts,
-    };
+std::string_view ProcFsParser::next_line(std::string_view contents,
+                                         std::size_t *line_start) const {
+    auto line_end = contents.find('\n', *line_start);
+    if (line_end == std::string_view::npos) {
+        line_end = contents.size();
+    }
+
+    auto line = contents.substr(*line_start, line_end - *line_start);
+    *line_start = line_end + 1;
+    return line;
+}
+
+bool ProcFsParser::split_line(std::string_view line, std::string_view *name,
+                              std::string_view *counters) const {
+    // Each line looks like:
+    //   "  eth0: <8 rx fields> <8 tx fields>"
+    // while the two header lines have no colon after the first word.
+    auto name_start = line.find_first_not_of(' ');
+    auto colon = line.find(':');
+    if ((name_start == std::string_view::npos) ||
+        (colon == std::string_view::npos) || (colon < name_start)) {
+        return false;
+    }
+
+    *name = line.substr(name_start, colon - name_start);
+    *counters = line.substr(colon + 1);
+    return true;
+}
+
+bool ProcFsParser::parse_counters(std::string_view counters, Counters *rx,
+                                  Counters *tx) const {
+    // We want the first four of the rx fields and of the tx fields: bytes
+    // packets errs drop, which are the quantities in order
+    const char *pos = counters.data();
+    const char *end = counters.data() + counters.size();
+
+    std::array<uint64_t, 8 + NUM_QUANTITIES> fields{};
+    for (auto &field : fields) {
+        pos = parse_field(pos, end, &field);
+        if (pos == nullptr) {
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < NUM_QUANTITIES; ++i) {
+        rx->values[i] = fields[i];
+        tx->values[i] = fields[8 + i];
+    }
+    return true;
+}
+
+const char *ProcFsParser::parse_field(const char *pos, const char *end,
+                                      uint64_t *value) const {
+    while ((pos < end) && (*pos == ' ')) {
+        ++pos;
+    }
+
+    auto res = std::from_chars(pos, end, *value);
+    if (res.ec != std::errc()) {
+        return nullptr;
+    }
+
+    return res.ptr;
+}
+
+Sample ProcFsSampler::get_sample(const std::string &iface_name) {
+    TimePoint ts = tools::MonotonicClock::now();
+
+    Sample sample{{}, {}, ts};
+
+    if (use_regex_) {
+        std::vector<std::string> lines{};
+        sample.error = parser_.read_file_as_lines(&lines);
+        if (sample.error == SampleError::NONE) {
+            sample.error =
+                parser_.parse(lines, iface_name, &sample.rx, &sample.tx);
+        }
+    } else {
+        std::string_view contents{};
+        sample.error = parser_.read_file(&contents);
+        if (sample.error == SampleError::NONE) {
+            sample.error =
+                parser_.scan(contents, iface_name, &sample.rx, &sample.tx);
+        }
+    }
 
     return sample;
 }
 
+void ProcFsSampler::get_samples(const std::vector<std::string> &iface_names,
+                                std::vector<Sample> *samples) {
+    if (use_regex_) {
+        Sampler::get_samples(iface_names, samples);
+        return;
+    }
+
+    TimePoint ts = tools::MonotonicClock::now();
+
+    index_.update(iface_names);
+
+    samples->resize(iface_names.size());
+    for (auto &sample : *samples) {
+        sample.ts = ts;
+    }
+
+    // One read of the file serves all the ifaces
+    std::string_view contents{};
+    auto error = parser_.read_file(&contents);
+    if (error != SampleError::NONE) {
+        for (auto &sample : *samples) {
+            sample.error = error;
+        }
+        return;
+    }
+
+    parser_.scan_all(contents, index_, samples);
+}
+
+bool ProcFsSampler::is_bulk() const {
+    // the regex parser reads the file once per iface
+    return !use_regex_;
+}
+
+unsigned ProcFsSampler::get_counter_bits() const {
+    // 32bit kernels keep 32bit counters for most drivers
+    return sizeof(unsigned long) * CHAR_BIT;
+}
+
 } // namespace sampling
 } // namespace bandwit
@@ -3,8 +3,10 @@
 
 #include <regex>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "sampling/iface_index.hpp"
 #include "sampling/sampler.hpp"
 
 namespace bandwit {
@@ -12,31 +14,70 @@ namespace sampling {
 
 class ProcFsParser {
   public:
-    std::vector<std::string> read_file_as_lines() const;
-    std::pair<uint64_t, uint64_t> parse(const std::vector<std::string> &lines,
-                                        const std::string &iface_name) const;
+    ProcFsParser() = default;
+    ~ProcFsParser();
+
+    CLASS_DISABLE_COPIES(ProcFsParser)
+    CLASS_DISABLE_MOVES(ProcFsParser)
+
+    // regex based parser, kept around to validate the scanner against
+    SampleError read_file_as_lines(std::vector<std::string> *lines) const;
+    SampleError parse(const std::vector<std::string> &lines,
+                      const std::string &iface_name, Counters *rx,
+                      Counters *tx) const;
+
+    // single pass scanner over the whole file contents
+    SampleError read_file(std::string_view *contents);
+    SampleError scan(std::string_view contents, const std::string &iface_name,
+                     Counters *rx, Counters *tx) const;
+    // Sets the error of every sample, an iface that is not in the file does
+    // not keep the others from being read
+    void scan_all(std::string_view contents, const InterfaceIndex &index,
+                  std::vector<Sample> *samples) const;
 
   private:
+    std::string_view next_line(std::string_view contents,
+                               std::size_t *line_start) const;
+    bool split_line(std::string_view line, std::string_view *name,
+                    std::string_view *counters) const;
+    bool parse_counters(std::string_view counters, Counters *rx,
+                        Counters *tx) const;
+    const char *parse_field(const char *pos, const char *end,
+                            uint64_t *value) const;
+
     std::string filepath_{"/proc/net/dev"};
     std::regex pat_line_{
-        R"(^\s*([A-Za-z0-9]+):\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+))"};
+        R"(^\s*([A-Za-z0-9]+):\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+)\s+([0-9]+))"};
+
+    // the file is kept open and the buffer reused across reads
+    int fd_{-1};
+    std::string buffer_{};
 };
 
 class ProcFsSampler : public Sampler {
   public:
-    ProcFsSampler() = default;
+    // use_regex selects the (slower) regex based parser
+    explicit ProcFsSampler(bool use_regex = false) : use_regex_{use_regex} {}
     ~ProcFsSampler() override = default;
 
     CLASS_DISABLE_COPIES(ProcFsSampler)
     CLASS_DISABLE_MOVES(ProcFsSampler)
 
-    Sample get_sample(const std::string &iface_name) const override;
+    Sample get_sample(const std::string &iface_name) override;
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<Sample> *samples) override;
+    bool is_bulk() const override;
+
+    // the kernel's unsigned long, whatever the width of the number printed
+    unsigned get_counter_bits() const override;
 
   private:
+    bool use_regex_{false};
     ProcFsParser parser_{};
+    InterfaceIndex index_{};
 };
 
 } // namespace sampling
 } // namespace bandwit
 
-#endif // PROCFS_SAMPLER_H
\ No newline at end of file
+#endif // PROCFS_SAMPLER_H
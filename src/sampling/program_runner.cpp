@@ -1,39 +1,330 @@
-#include <array>
-#include <sstream>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
 #include <stdexcept>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "except.hpp"
+#include "macros.hpp"
 #include "program_runner.hpp"
 
+extern char **environ;
+
 namespace bandwit {
 namespace sampling {
 
-std::vector<std::string> ProgramRunner::run(const std::string &args) const {
-    // append 2>/dev/null to get rid of stderr output
-    std::stringstream ss{};
-    ss << args << " 2>/dev/null";
-    std::string args_actual = ss.str();
+// Owns the spawn attributes and file actions for the duration of a spawn.
+// The program starts with stderr on /dev/null and with an empty signal mask:
+// the signals we block, eg. on the sampler thread, are nothing for it to
+// inherit.
+struct SpawnSetup {
+    SpawnSetup() {
+        posix_spawn_file_actions_init(&actions);
+        posix_spawnattr_init(&attr);
+
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                         O_WRONLY, 0);
+
+        sigset_t empty_mask;
+        sigemptyset(&empty_mask);
+        posix_spawnattr_setsigmask(&attr, &empty_mask);
+        posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+    }
+
+    ~SpawnSetup() {
+        posix_spawnattr_destroy(&attr);
+        posix_spawn_file_actions_destroy(&actions);
+    }
+
+    CLASS_DISABLE_COPIES(SpawnSetup)
+    CLASS_DISABLE_MOVES(SpawnSetup)
+
+    // argv[0] is looked up in PATH, argv must not be empty. Returns -1 with
+    // errno set if the program could not be started.
+    pid_t spawn(std::vector<char *> *argv_ptrs,
+                const std::vector<std::string> &argv);
+
+    posix_spawn_file_actions_t actions{};
+    posix_spawnattr_t attr{};
+};
+
+pid_t SpawnSetup::spawn(std::vector<char *> *argv_ptrs,
+                        const std::vector<std::string> &argv) {
+    argv_ptrs->clear();
+    for (const auto &arg : argv) {
+        argv_ptrs->push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv_ptrs->push_back(nullptr);
+
+    pid_t pid{-1};
+    int rv = posix_spawnp(&pid, (*argv_ptrs)[0], &actions, &attr,
+                          argv_ptrs->data(), environ);
+    if (rv != 0) {
+        errno = rv;
+        return -1;
+    }
+
+    return pid;
+}
+
+// Reaps the program, returns whether it exited 0
+static bool wait_for_exit(pid_t pid) {
+    int status{0};
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+
+    return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+// Whether the program exited, and was reaped, within timeout
+static bool wait_for_exit(pid_t pid, Millis timeout) {
+    constexpr Millis POLL_INTERVAL{10};
+
+    auto deadline = SteadyClock::now() + timeout;
+    while (true) {
+        pid_t rv = waitpid(pid, nullptr, WNOHANG);
+        if ((rv == pid) || ((rv < 0) && (errno != EINTR))) {
+            return true;
+        }
+
+        if (SteadyClock::now() >= deadline) {
+            return false;
+        }
+
+        poll(nullptr, 0, INT(POLL_INTERVAL.count()));
+    }
+}
+
+SampleError ProgramRunner::run(const std::vector<std::string> &argv,
+                               std::string_view *output) {
+    // before there are any fds to leak
+    if (argv.empty()) {
+        THROW_MSG(std::invalid_argument, "ProgramRunner.run got no program");
+    }
+
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return SampleError::READ_FAILED;
+    }
+
+    // Neither end is inherited as such, the dup2 makes a copy of the write
+    // end that is
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+    SpawnSetup setup{};
+    posix_spawn_file_actions_adddup2(&setup.actions, fds[1], STDOUT_FILENO);
+
+    pid_t pid = setup.spawn(&argv_ptrs_, argv);
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return SampleError::READ_FAILED;
+    }
+
+    bool is_read = read_output(fds[0]);
+    close(fds[0]);
+
+    // Reaped either way
+    if (!wait_for_exit(pid) || !is_read) {
+        return SampleError::READ_FAILED;
+    }
+
+    *output = std::string_view{buffer_.data(), output_len_};
+    return SampleError::NONE;
+}
+
+std::string_view ProgramRunner::next_line(std::string_view output,
+                                          std::size_t *line_start) {
+    auto line_end = output.find('\n', *line_start);
+    if (line_end == std::string_view::npos) {
+        line_end = output.size();
+    }
+
+    auto line = output.substr(*line_start, line_end - *line_start);
+    *line_start = line_end + 1;
+    return line;
+}
+
+bool ProgramRunner::read_output(int fd) {
+    output_len_ = 0;
+
+    while (true) {
+        // Only ever grows, so that the next run reads into the same buffer
+        if (output_len_ == buffer_.size()) {
+            buffer_.resize(std::max(INITIAL_BUFFER_SIZE, 2 * buffer_.size()));
+        }
+
+        auto nread = read(fd, buffer_.data() + output_len_,
+                          buffer_.size() - output_len_);
+        if (nread < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        if (nread == 0) {
+            return true;
+        }
+
+        output_len_ += SIZE_T(nread);
+    }
+}
+
+Coprocess::Coprocess(const std::vector<std::string> &argv) {
+    if (argv.empty()) {
+        THROW_MSG(std::invalid_argument, "Coprocess got no program");
+    }
+
+    // A socket rather than a pipe for stdin, so that writing to a program
+    // that went away fails with EPIPE instead of raising SIGPIPE
+    int input_fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, input_fds) < 0) {
+        THROW_CERROR(std::runtime_error, "Coprocess failed in socketpair()");
+    }
+
+    int output_fds[2];
+    if (pipe(output_fds) < 0) {
+        close(input_fds[0]);
+        close(input_fds[1]);
+        THROW_CERROR(std::runtime_error, "Coprocess failed in pipe()");
+    }
+
+    for (auto fd : {input_fds[0], input_fds[1], output_fds[0], output_fds[1]}) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    SpawnSetup setup{};
+    posix_spawn_file_actions_adddup2(&setup.actions, input_fds[1],
+                                     STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&setup.actions, output_fds[1],
+                                     STDOUT_FILENO);
+
+    std::vector<char *> argv_ptrs{};
+    pid_ = setup.spawn(&argv_ptrs, argv);
+    if (pid_ < 0) {
+        for (auto fd :
+             {input_fds[0], input_fds[1], output_fds[0], output_fds[1]}) {
+            close(fd);
+        }
+        THROW_CERROR(std::runtime_error, "Coprocess failed in posix_spawnp()");
+    }
+
+    close(input_fds[1]);
+    close(output_fds[1]);
+    input_fd_ = input_fds[0];
+    output_fd_ = output_fds[0];
+}
+
+Coprocess::~Coprocess() {
+    // EOF on its stdin is the program's cue to exit
+    close(input_fd_);
+    close(output_fd_);
 
-    FILE *fl = popen(args_actual.c_str(), "r");
-    if (fl == nullptr) {
-        THROW_CERROR(std::runtime_error, "popen() failed");
+    if (wait_for_exit(pid_, EXIT_TIMEOUT)) {
+        return;
     }
 
-    std::array<char, 1024> buffer{};
-    std::vector<std::string> lines{};
+    kill(pid_, SIGTERM);
+    if (wait_for_exit(pid_, EXIT_TIMEOUT)) {
+        return;
+    }
+
+    kill(pid_, SIGKILL);
+    wait_for_exit(pid_);
+}
+
+SampleError Coprocess::write_input(std::string_view input) {
+#ifdef MSG_NOSIGNAL
+    int flags = MSG_NOSIGNAL;
+#else
+    int flags = 0;
+#endif
+
+    std::size_t sent{0};
+    while (sent < input.size()) {
+        auto rv = send(input_fd_, input.data() + sent, input.size() - sent,
+                       flags);
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SampleError::READ_FAILED;
+        }
+
+        sent += SIZE_T(rv);
+    }
+
+    return SampleError::NONE;
+}
+
+SampleError Coprocess::read_line(Millis timeout, std::string_view *line) {
+    auto deadline = SteadyClock::now() + timeout;
+
+    while (true) {
+        std::string_view pending{buffer_.data() + line_start_,
+                                 output_len_ - line_start_};
+        auto line_end = pending.find('\n');
+        if (line_end != std::string_view::npos) {
+            line_start_ += line_end + 1;
+            *line = pending.substr(0, line_end);
+            return SampleError::NONE;
+        }
+
+        auto error = read_output(deadline);
+        if (error != SampleError::NONE) {
+            return error;
+        }
+    }
+}
+
+SampleError Coprocess::read_output(SteadyTimePoint deadline) {
+    // Move what is left of a line to the front, so that the buffer only has
+    // to grow for lines that do not fit at all
+    if (line_start_ > 0) {
+        std::copy(buffer_.begin() + INT(line_start_),
+                  buffer_.begin() + INT(output_len_), buffer_.begin());
+        output_len_ -= line_start_;
+        line_start_ = 0;
+    }
+
+    if (output_len_ == buffer_.size()) {
+        buffer_.resize(std::max(INITIAL_BUFFER_SIZE, 2 * buffer_.size()));
+    }
+
+    auto remaining = std::chrono::ceil<Millis>(deadline - SteadyClock::now());
+    pollfd pfd{output_fd_, POLLIN, 0};
+    int rv = poll(&pfd, 1, INT(std::max(remaining.count(), Millis::rep{0})));
+    if (rv < 0) {
+        return (errno == EINTR) ? SampleError::NONE : SampleError::READ_FAILED;
+    }
+    if (rv == 0) {
+        return SampleError::READ_FAILED;
+    }
 
-    while (fgets(buffer.data(), buffer.size(), fl) != nullptr) {
-        lines.emplace_back(buffer.data());
+    auto nread = read(output_fd_, buffer_.data() + output_len_,
+                      buffer_.size() - output_len_);
+    if (nread < 0) {
+        return (errno == EINTR) ? SampleError::NONE : SampleError::READ_FAILED;
     }
 
-    int status_code = pclose(fl);
-    if (status_code != 0) {
-        THROW_CERROR(std::runtime_error,
-                     "program returned non-zero status code");
+    // the program exited
+    if (nread == 0) {
+        return SampleError::READ_FAILED;
     }
 
-    return lines;
+    output_len_ += SIZE_T(nread);
+    return SampleError::NONE;
 }
 
 } // namespace sampling
-} // namespace bandwit
\ No newline at end of file
+} // namespace bandwit
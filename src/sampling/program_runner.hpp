@@ -2,14 +2,89 @@
 #define PROGRAM_RUNNER_H
 
 #include <string>
+#include <string_view>
+#include <sys/types.h>
 #include <vector>
 
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/sample.hpp"
+
 namespace bandwit {
 namespace sampling {
 
+// Runs a program directly, without a shell in between, and collects its
+// output in a buffer that is kept from one run to the next, so that running
+// the same program over and over allocates nothing once the buffer has grown
+// to fit. Stderr goes to /dev/null.
 class ProgramRunner {
   public:
-    std::vector<std::string> run(const std::string &args) const;
+    // argv[0] is looked up in PATH. The output is only valid until the next
+    // run. Fails if the program could not be started or did not exit 0,
+    // throws std::invalid_argument for an empty argv.
+    SampleError run(const std::vector<std::string> &argv,
+                    std::string_view *output);
+
+    // Splits output into lines, without the newlines. Returns the line at
+    // line_start and moves line_start to the start of the next one.
+    static std::string_view next_line(std::string_view output,
+                                      std::size_t *line_start);
+
+  private:
+    // enough for the output of a handful of ifaces in one read
+    static constexpr std::size_t INITIAL_BUFFER_SIZE = 4096;
+
+    // false if the output could not be read to the end
+    bool read_output(int fd);
+
+    std::string buffer_{};
+    std::size_t output_len_{0};
+
+    std::vector<char *> argv_ptrs_{};
+};
+
+// A program that keeps running in the background and is talked to over its
+// stdin and stdout, eg. `ip -batch -`, so that it is only started once
+// rather than for every query. Stderr goes to /dev/null. The program is told
+// to exit by closing its stdin when the Coprocess goes away, and one that
+// does not is sent SIGTERM and then SIGKILL.
+class Coprocess {
+  public:
+    // argv[0] is looked up in PATH. Throws if the program could not be
+    // started.
+    explicit Coprocess(const std::vector<std::string> &argv);
+    ~Coprocess();
+
+    CLASS_DISABLE_COPIES(Coprocess)
+    CLASS_DISABLE_MOVES(Coprocess)
+
+    // Writes all of input to the program's stdin. Fails if the program went
+    // away.
+    SampleError write_input(std::string_view input);
+
+    // The next line of output, without the newline, as soon as it is
+    // complete. The view is only valid until the next call. Fails if the
+    // program exits or nothing comes within timeout.
+    SampleError read_line(Millis timeout, std::string_view *line);
+
+  private:
+    static constexpr std::size_t INITIAL_BUFFER_SIZE = 4096;
+    // how long the program gets to exit, on EOF and then on SIGTERM, before
+    // it is sent the next signal
+    static constexpr Millis EXIT_TIMEOUT{200};
+
+    // reads whatever output there is within the time left to the deadline
+    SampleError read_output(SteadyTimePoint deadline);
+
+    pid_t pid_{-1};
+    int input_fd_{-1};
+    int output_fd_{-1};
+
+    // The output read so far, of which [line_start_, output_len_) is not
+    // handed out yet
+    std::string buffer_{};
+    std::size_t line_start_{0};
+    std::size_t output_len_{0};
 };
 
 } // namespace sampling
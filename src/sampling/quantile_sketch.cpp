@@ -0,0 +1,86 @@
+#include <algorithm>
+
+#include "macros.hpp"
+#include "quantile_sketch.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+void QuantileSketch::add(uint64_t value) {
+    auto bin = get_bin(value);
+    ++counts_[bin];
+
+    min_ = count_ == 0 ? value : std::min(min_, value);
+    max_ = count_ == 0 ? value : std::max(max_, value);
+    ++count_;
+
+    first_bin_ = std::min(first_bin_, bin);
+    last_bin_ = std::max(last_bin_, bin);
+}
+
+void QuantileSketch::clear() {
+    if (count_ == 0) {
+        return;
+    }
+
+    std::fill(counts_.begin() + INT(first_bin_),
+              counts_.begin() + INT(last_bin_) + 1, 0);
+
+    count_ = 0;
+    first_bin_ = NUM_BINS;
+    last_bin_ = 0;
+}
+
+bool QuantileSketch::empty() const { return count_ == 0; }
+
+uint64_t QuantileSketch::get_percentile(uint64_t percentile) const {
+    if (count_ == 0) {
+        return 0;
+    }
+
+    // rounded up, so that the 100th percentile is the max
+    auto rank = std::max<uint64_t>((count_ * percentile + 99) / 100, 1);
+    uint64_t seen{0};
+
+    for (auto bin = first_bin_; bin <= last_bin_; ++bin) {
+        seen += counts_[bin];
+        if (seen >= rank) {
+            // The bin's value is somewhere in the middle, which may well be
+            // outside of what was actually seen
+            return std::clamp(get_bin_value(bin), min_, max_);
+        }
+    }
+
+    return max_;
+}
+
+std::size_t QuantileSketch::get_bin(uint64_t value) {
+    if (value < NUM_EXACT_BINS) {
+        return SIZE_T(value);
+    }
+
+    // The top 4 bits of the value are the power of two and one of the 8 bins
+    // within it
+    auto bit_width = SIZE_T(64 - __builtin_clzll(value));
+    auto shift = bit_width - 4;
+    auto sub_bin = SIZE_T(value >> shift) - 8;
+
+    return NUM_EXACT_BINS + shift * 8 + sub_bin;
+}
+
+uint64_t QuantileSketch::get_bin_value(std::size_t bin) {
+    if (bin < NUM_EXACT_BINS) {
+        return U64(bin);
+    }
+
+    auto shift = (bin - NUM_EXACT_BINS) / 8;
+    auto sub_bin = (bin - NUM_EXACT_BINS) % 8;
+
+    // the middle of [low, low + width)
+    uint64_t low = U64(8 + sub_bin) << shift;
+    uint64_t width = 1ULL << shift;
+    return low + width / 2;
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,44 @@
+#ifndef QUANTILE_SKETCH_H
+#define QUANTILE_SKETCH_H
+
+#include <array>
+#include <cstdint>
+
+namespace bandwit {
+namespace sampling {
+
+// A histogram of values in logarithmic bins, eight per power of two, so that
+// a percentile is off by at most 1/16th of its value. Values below 8 get a
+// bin each and are exact. Only the range of bins that was used is touched
+// when clearing, which keeps a sketch of a single value cheap to reuse.
+class QuantileSketch {
+  public:
+    void add(uint64_t value);
+    void clear();
+    bool empty() const;
+
+    // The smallest value that at least percentile % of the values are less
+    // than or equal to, by nearest rank
+    uint64_t get_percentile(uint64_t percentile) const;
+
+  private:
+    static constexpr std::size_t NUM_EXACT_BINS = 8;
+    static constexpr std::size_t NUM_BINS = NUM_EXACT_BINS + 61 * 8;
+
+    static std::size_t get_bin(uint64_t value);
+    static uint64_t get_bin_value(std::size_t bin);
+
+    std::array<uint32_t, NUM_BINS> counts_{};
+    uint64_t count_{0};
+    uint64_t min_{0};
+    uint64_t max_{0};
+
+    // the bins in use are within [first_bin_, last_bin_]
+    std::size_t first_bin_{NUM_BINS};
+    std::size_t last_bin_{0};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // QUANTILE_SKETCH_H
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "except.hpp"
+#include "sampling/quantity.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+constexpr std::array<Quantity, NUM_QUANTITIES> ALL_QUANTITIES{
+    Quantity::BYTES,
+    Quantity::PACKETS,
+    Quantity::ERRORS,
+    Quantity::DROPS,
+};
+
+std::string get_label(Quantity qtty) {
+    switch (qtty) {
+    case Quantity::BYTES:
+        return "bytes";
+    case Quantity::PACKETS:
+        return "packets";
+    case Quantity::ERRORS:
+        return "errors";
+    case Quantity::DROPS:
+        return "drops";
+    }
+
+    THROW_MSG(std::logic_error, "unknown quantity");
+}
+
+bool parse_quantities(std::string_view spec, std::vector<Quantity> *qttys) {
+    if (spec.empty()) {
+        return false;
+    }
+
+    auto mask = get_mask({Quantity::BYTES});
+
+    std::size_t pos{0};
+    while (pos <= spec.size()) {
+        auto comma = std::min(spec.find(',', pos), spec.size());
+        auto item = spec.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        auto it = std::find_if(
+            ALL_QUANTITIES.begin(), ALL_QUANTITIES.end(),
+            [item](Quantity qtty) { return get_label(qtty) == item; });
+        if (it == ALL_QUANTITIES.end()) {
+            return false;
+        }
+
+        mask |= get_mask({*it});
+    }
+
+    *qttys = from_mask(mask);
+    return true;
+}
+
+uint32_t get_mask(const std::vector<Quantity> &qttys) {
+    uint32_t mask{0};
+    for (auto qtty : qttys) {
+        mask |= uint32_t{1} << U32(qtty);
+    }
+
+    return mask;
+}
+
+std::vector<Quantity> from_mask(uint32_t mask) {
+    std::vector<Quantity> qttys{};
+    for (auto qtty : ALL_QUANTITIES) {
+        if ((mask & get_mask({qtty})) != 0) {
+            qttys.push_back(qtty);
+        }
+    }
+
+    return qttys;
+}
+
+Quantity next_quantity(Quantity qtty, const std::vector<Quantity> &qttys) {
+    auto it = std::find(qttys.begin(), qttys.end(), qtty);
+    if ((it == qttys.end()) || (it + 1 == qttys.end())) {
+        return qttys.empty() ? qtty : qttys.front();
+    }
+
+    return *(it + 1);
+}
+
+} // namespace sampling
+} // namespace bandwit
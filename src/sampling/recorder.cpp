@@ -0,0 +1,122 @@
+#include <algorithm>
+
+#include "recorder.hpp"
+#include "sampling/snapshot.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+Recorder::Recorder(std::unique_ptr<Sampler> sampler, unsigned counter_bits,
+                   std::vector<std::string> iface_names,
+                   std::vector<Sample> first_samples, TimePoint now,
+                   const std::vector<AggregationWindow> &windows,
+                   const Retention &retention,
+                   std::vector<Quantity> quantities)
+    : sampler_{std::move(sampler)}, counter_delta_{counter_bits},
+      iface_names_{std::move(iface_names)},
+      prev_samples_{std::move(first_samples)}, deltas_(iface_names_.size()),
+      num_skipped_(iface_names_.size()),
+      history_{std::make_unique<History>(
+          iface_names_, now, windows, retention, std::move(quantities))} {}
+
+void Recorder::sample(TimePoint tp) {
+    if (schedule_ != nullptr) {
+        schedule_->sample(sampler_.get(), iface_names_, tp, &cur_samples_);
+    } else {
+        sampler_->get_samples(iface_names_, &cur_samples_);
+    }
+    record_current(tp);
+}
+
+void Recorder::set_adaptive(TimePoint start, Millis interval,
+                            uint64_t threshold) {
+    schedule_ = std::make_unique<AdaptiveSchedule>(*history_, start, interval,
+                                                   threshold, prev_samples_);
+}
+
+void Recorder::record(TimePoint tp, const std::vector<Sample> &samples) {
+    cur_samples_.assign(samples.begin(), samples.end());
+    record_current(tp);
+}
+
+void Recorder::record_current(TimePoint tp) {
+    for (std::size_t i = 0; i < iface_names_.size(); ++i) {
+        auto &sample = cur_samples_[i];
+        const auto &prev_sample = prev_samples_[i];
+        auto &delta = deltas_[i];
+
+        // The next sample goes on from the same previous one
+        if (sample.error == SampleError::NOT_DUE) {
+            sample = prev_sample;
+            delta = Delta{{}, {}, 0};
+            ++num_skipped_[i];
+            continue;
+        }
+
+        delta.num_intervals = num_skipped_[i] + 1;
+        num_skipped_[i] = 0;
+
+        // Nothing is known about the time the iface was away for, the first
+        // sample after it only sets the counters to go on from
+        if ((sample.error != SampleError::NONE) ||
+            (prev_sample.error != SampleError::NONE)) {
+            delta.rx.values.fill(GAP_DELTA);
+            delta.tx.values.fill(GAP_DELTA);
+            history_->record(i, tp, delta);
+            continue;
+        }
+
+        // After a gap the deltas carry on from the reset counter
+        for (auto qtty : history_->get_quantities()) {
+            delta.rx[qtty] = counter_delta_.get(
+                prev_sample.rx[qtty], sample.rx[qtty], prev_sample.ts,
+                sample.ts);
+            delta.tx[qtty] = counter_delta_.get(
+                prev_sample.tx[qtty], sample.tx[qtty], prev_sample.ts,
+                sample.ts);
+        }
+
+        history_->record(i, tp, delta);
+    }
+
+    for (std::size_t i = 0; i < files_.size(); ++i) {
+        files_[i]->write(*history_, i);
+    }
+
+    prev_samples_.swap(cur_samples_);
+}
+
+void Recorder::open_history_files(const std::string &dir, Millis interval) {
+    for (std::size_t i = 0; i < iface_names_.size(); ++i) {
+        // A queue, eg. eth0/q3, goes in eth0.q3.history
+        auto filename = iface_names_[i];
+        std::replace(filename.begin(), filename.end(), '/', '.');
+
+        auto path = dir + "/" + filename + ".history";
+        auto file = std::make_unique<HistoryFile>(path, interval, *history_, i);
+
+        if (file->has_history()) {
+            file->read(history_.get(), i);
+        }
+
+        file->write(*history_, i);
+        files_.push_back(std::move(file));
+    }
+}
+
+std::size_t Recorder::restore_snapshot(const std::string &path,
+                                       Millis interval) {
+    return read_snapshot(path, interval, history_.get());
+}
+
+const std::vector<Delta> &Recorder::get_deltas() const { return deltas_; }
+
+const std::vector<Sample> &Recorder::get_samples() const {
+    // swapped in at the end of sample()
+    return prev_samples_;
+}
+
+const History &Recorder::get_history() const { return *history_; }
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,94 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "counter_delta.hpp"
+#include "history.hpp"
+#include "history_file.hpp"
+#include "sampling/adaptive_schedule.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/retention.hpp"
+#include "sampling/sample.hpp"
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// Samples a set of ifaces in one pass and records the deltas in a History.
+// The sampler can be null when the samples are taken elsewhere, eg. on a
+// SamplerThread, and only ever handed in through record(). counter_bits is
+// the width of the counters that the samples are read from. Only the
+// quantities given are recorded, the samples have to have them. A NOT_DUE
+// sample is not recorded until the iface is sampled again, with a delta of
+// all the intervals since.
+class Recorder {
+  public:
+    Recorder(std::unique_ptr<Sampler> sampler, unsigned counter_bits,
+             std::vector<std::string> iface_names,
+             std::vector<Sample> first_samples, TimePoint now,
+             const std::vector<AggregationWindow> &windows,
+             const Retention &retention,
+             std::vector<Quantity> quantities = {Quantity::BYTES});
+
+    // Takes a sample of every iface and records the deltas since the previous
+    // sample in the bucket for tp
+    void sample(TimePoint tp);
+
+    // From now on sample() backs off on the ifaces that count fewer than
+    // threshold bytes a second, the deadlines are interval apart from start
+    // on
+    void set_adaptive(TimePoint start, Millis interval, uint64_t threshold);
+
+    // Records the deltas from the previous samples to these, taken of every
+    // iface in the same order as the names, in the bucket for tp
+    void record(TimePoint tp, const std::vector<Sample> &samples);
+
+    // Keeps the history of every iface in a file in dir from now on. The
+    // history that is already in the files is picked up where it left off.
+    void open_history_files(const std::string &dir, Millis interval);
+
+    // Picks up the history of the ifaces in the snapshot at path, if there
+    // is one taken at the interval. Returns how many ifaces it had.
+    std::size_t restore_snapshot(const std::string &path, Millis interval);
+
+    // the deltas recorded by the last sample(), one per iface
+    const std::vector<Delta> &get_deltas() const;
+
+    // the counters read by the last sample(), one per iface, with the error
+    // set for the ifaces that could not be sampled
+    const std::vector<Sample> &get_samples() const;
+
+    const History &get_history() const;
+
+  private:
+    // records cur_samples_ and makes them the previous samples
+    void record_current(TimePoint tp);
+
+    std::unique_ptr<Sampler> sampler_{nullptr};
+    // null unless sample() backs off on idle ifaces
+    std::unique_ptr<AdaptiveSchedule> schedule_{nullptr};
+    CounterDelta counter_delta_;
+    std::vector<std::string> iface_names_{};
+
+    // swapped after every pass so neither is reallocated
+    std::vector<Sample> prev_samples_{};
+    std::vector<Sample> cur_samples_{};
+
+    std::vector<Delta> deltas_{};
+    // by iface, the samples since the last one that were NOT_DUE
+    std::vector<uint32_t> num_skipped_{};
+
+    std::unique_ptr<History> history_{nullptr};
+
+    // empty unless the history is kept in files, else one per iface
+    std::vector<std::unique_ptr<HistoryFile>> files_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // RECORDER_H
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+
+#include "macros.hpp"
+#include "sampling/retention.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+constexpr AggregationWindow ALL_WINDOWS[] = {
+    AggregationWindow::TENTH_SECOND, AggregationWindow::QUARTER_SECOND,
+    AggregationWindow::HALF_SECOND,  AggregationWindow::ONE_SECOND,
+    AggregationWindow::ONE_MINUTE,   AggregationWindow::ONE_HOUR,
+    AggregationWindow::ONE_DAY,
+};
+
+void Retention::set(AggregationWindow window, Millis duration) {
+    durations_[window] = duration;
+}
+
+std::size_t Retention::get_num_buckets(AggregationWindow window) const {
+    auto it = durations_.find(window);
+    auto duration = it != durations_.end() ? it->second : get_default(window);
+
+    // rounded up, so that all of the duration is covered
+    auto window_ms = get_duration(window).count();
+    auto num_buckets = (duration.count() + window_ms - 1) / window_ms;
+    return std::max(SIZE_T(num_buckets), std::size_t{1});
+}
+
+Millis Retention::get_default(AggregationWindow window) {
+    using std::chrono::hours;
+    using std::chrono::minutes;
+
+    switch (window) {
+    case AggregationWindow::TENTH_SECOND:
+    case AggregationWindow::QUARTER_SECOND:
+    case AggregationWindow::HALF_SECOND:
+        return minutes{5};
+    case AggregationWindow::ONE_SECOND:
+        return hours{1};
+    case AggregationWindow::ONE_MINUTE:
+        return hours{2 * 24};
+    case AggregationWindow::ONE_HOUR:
+        return hours{90 * 24};
+    case AggregationWindow::ONE_DAY:
+        return hours{2 * 365 * 24};
+    }
+
+    return hours{1};
+}
+
+static bool parse_window(std::string_view label, AggregationWindow *window) {
+    for (auto candidate : ALL_WINDOWS) {
+        if (label == get_label(candidate)) {
+            *window = candidate;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool parse_duration(std::string_view text, Millis *duration) {
+    if (text.size() < 2) {
+        return false;
+    }
+
+    int64_t num{0};
+    const auto *end = text.data() + text.size() - 1;
+    auto res = std::from_chars(text.data(), end, num);
+    if ((res.ec != std::errc{}) || (res.ptr != end) || (num <= 0)) {
+        return false;
+    }
+
+    int64_t unit_ms{0};
+    switch (*end) {
+    case 's':
+        unit_ms = 1000;
+        break;
+    case 'm':
+        unit_ms = 60 * 1000;
+        break;
+    case 'h':
+        unit_ms = 60 * 60 * 1000;
+        break;
+    case 'd':
+        unit_ms = 24 * 60 * 60 * 1000;
+        break;
+    default:
+        return false;
+    }
+
+    // Nobody keeps a hundred years of anything
+    if (num > INT64_C(36500) * 24 * 60 * 60 * 1000 / unit_ms) {
+        return false;
+    }
+
+    *duration = Millis{num * unit_ms};
+    return true;
+}
+
+bool parse_retention(std::string_view spec, Retention *retention) {
+    if (spec.empty()) {
+        return false;
+    }
+
+    // Nothing is set unless all of it parses
+    Retention parsed{*retention};
+
+    std::size_t pos{0};
+    while (pos <= spec.size()) {
+        auto comma = std::min(spec.find(',', pos), spec.size());
+        auto item = spec.substr(pos, comma - pos);
+        pos = comma + 1;
+
+        auto equals = item.find('=');
+        if (equals == std::string_view::npos) {
+            return false;
+        }
+
+        AggregationWindow window{};
+        Millis duration{};
+        if (!parse_window(item.substr(0, equals), &window) ||
+            !parse_duration(item.substr(equals + 1), &duration)) {
+            return false;
+        }
+
+        parsed.set(window, duration);
+    }
+
+    *retention = parsed;
+    return true;
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,39 @@
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+void Sampler::get_samples(const std::vector<std::string> &iface_names,
+                          std::vector<Sample> *samples) {
+    samples->resize(iface_names.size());
+
+    for (std::size_t i = 0; i < iface_names.size(); ++i) {
+        (*samples)[i] = get_sample(iface_names[i]);
+    }
+}
+
+bool Sampler::is_bulk() const { return false; }
+
+unsigned Sampler::get_counter_bits() const { return 64; }
+
+void Sampler::set_quantities(const std::vector<Quantity> & /*qttys*/) {}
+
+const char *get_message(SampleError error) {
+    switch (error) {
+    case SampleError::NONE:
+        return "no error";
+    case SampleError::NO_SUCH_IFACE:
+        return "no such interface";
+    case SampleError::READ_FAILED:
+        return "failed to read the counters";
+    case SampleError::PARSE_FAILED:
+        return "failed to parse the counters";
+    case SampleError::NOT_DUE:
+        return "not due to be sampled";
+    }
+
+    return "unknown error";
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -1,11 +1,21 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
 #include "except.hpp"
+#include "platform.hpp"
 #include "sampler_detector.hpp"
+#include "sampling/cgroup_sampler.hpp"
+#include "sampling/ethtool_sampler.hpp"
+#include "sampling/ifaddrs_sampler.hpp"
 #include "sampling/ip_cmd_sampler.hpp"
+#include "sampling/netlink_sampler.hpp"
 #include "sampling/netstat_cmd_sampler.hpp"
 #include "sampling/procfs_sampler.hpp"
 #include "sampling/sysfs_sampler.hpp"
@@ -13,32 +23,51 @@
 namespace bandwit {
 namespace sampling {
 
-#define PAIR(ClsName) std::make_pair("" #ClsName, std::make_unique<ClsName>())
+#define CANDIDATE(ClsName) Candidate{"" #ClsName, std::make_unique<ClsName>()}
 
 DetectionResult
-SamplerDetector::detect_sampler(const std::string &iface_name) const {
-    using Pair = std::pair<std::string, std::unique_ptr<Sampler>>;
+SamplerDetector::detect_sampler(const std::vector<std::string> &iface_names,
+                                const std::vector<Quantity> &qttys) const {
+    auto candidates = make_candidates(qttys);
+    auto cache_path = get_cache_path();
 
-    std::vector<Pair> samplers{};
-    samplers.emplace_back(PAIR(SysFsSampler));
-    samplers.emplace_back(PAIR(ProcFsSampler));
-    samplers.emplace_back(PAIR(IpCommandSampler));
-    samplers.emplace_back(PAIR(NetstatCommandSampler));
+    // The one that worked last time is most likely to work again, and then
+    // nothing else has to be tried
+    auto cached_name = read_cached_name(cache_path);
+    for (auto &candidate : candidates) {
+        if (candidate.name != cached_name) {
+            continue;
+        }
+
+        auto result = probe(candidate.sampler.get(), iface_names);
+        if (result.is_ok) {
+            return DetectionResult{std::move(candidate.sampler),
+                                   std::move(result.samples)};
+        }
 
-    std::vector<std::string> errors{};
+        // It may have been left in any state, start over with a new one
+        candidates = make_candidates(qttys);
+        break;
+    }
 
-    for (auto &pair : samplers) {
-        auto &cls_name = pair.first;
-        auto sampler = std::move(pair.second);
+    std::vector<std::future<Probe>> probes{};
+    for (auto &candidate : candidates) {
+        probes.push_back(std::async(std::launch::async, probe,
+                                    candidate.sampler.get(),
+                                    std::cref(iface_names)));
+    }
 
-        try {
-            auto sample = sampler->get_sample(iface_name);
-            return DetectionResult{std::move(sampler), sample};
+    std::vector<Probe> results{};
+    for (auto &fut : probes) {
+        results.push_back(fut.get());
+    }
 
-        } catch (std::runtime_error &exc) {
-            std::stringstream ss{};
-            ss << cls_name << ": " << std::string{exc.what()};
-            errors.emplace_back(ss.str());
+    // By preference, not by which one answered first
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (results[i].is_ok) {
+            write_cached_name(cache_path, candidates[i].name);
+            return DetectionResult{std::move(candidates[i].sampler),
+                                   std::move(results[i].samples)};
         }
     }
 
@@ -47,14 +76,149 @@ SamplerDetector::detect_sampler(const std::string &iface_name) const {
     // such interface, so to aid troubleshooting we echo the error from every
     // sampler
     std::cerr << "Could not find a sampler supported by the system for the "
-                 "interface: "
-              << iface_name << "\n";
-    for (const auto &msg : errors) {
-        std::cerr << "- " << msg << "\n";
+                 "interfaces:";
+    for (const auto &iface_name : iface_names) {
+        std::cerr << " " << iface_name;
+    }
+    std::cerr << "\n";
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        std::cerr << "- " << candidates[i].name << ": " << results[i].error
+                  << "\n";
     }
 
     THROW_MSG(std::runtime_error, "Cannot run without a sampler");
 }
 
+std::string SamplerDetector::get_cache_path(const std::string &name) {
+    std::string dir{};
+
+    const char *cache_home = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if ((cache_home != nullptr) && (*cache_home != '\0')) {
+        dir = cache_home;
+    } else if ((home != nullptr) && (*home != '\0')) {
+        dir = std::string{home} + "/.cache";
+    } else {
+        return std::string{};
+    }
+
+    // A home directory can be shared between hosts that sample differently
+    char host[256]{};
+    if (gethostname(host, sizeof(host) - 1) < 0) {
+        host[0] = '\0';
+    }
+
+    return dir + "/bandwit/" + name + "-" + std::string{host};
+}
+
+std::vector<SamplerDetector::Candidate>
+SamplerDetector::make_candidates(const std::vector<Quantity> &qttys) {
+    std::vector<Candidate> candidates{};
+
+    // Only the samplers that can work on the platform at all, so that
+    // nothing waits for the others to fail
+#ifdef __linux__
+    candidates.push_back(CANDIDATE(NetlinkSampler));
+    candidates.push_back(CANDIDATE(SysFsSampler));
+    candidates.push_back(CANDIDATE(ProcFsSampler));
+    candidates.push_back(CANDIDATE(IpBatchSampler));
+    candidates.push_back(CANDIDATE(IpCommandSampler));
+    // the only one that samples queues, and it samples nothing else
+    candidates.push_back(CANDIDATE(EthtoolSampler));
+#ifdef BANDWIT_BPF
+    // and the only one that samples cgroups
+    candidates.push_back(CANDIDATE(CgroupSampler));
+#endif
+#elif defined(BANDWIT_BSD)
+    candidates.push_back(CANDIDATE(IfAddrsSampler));
+    candidates.push_back(CANDIDATE(NetstatCommandSampler));
+#else
+    // Neither, so anything goes
+    candidates.push_back(CANDIDATE(SysFsSampler));
+    candidates.push_back(CANDIDATE(ProcFsSampler));
+    candidates.push_back(CANDIDATE(IpBatchSampler));
+    candidates.push_back(CANDIDATE(IpCommandSampler));
+    candidates.push_back(CANDIDATE(NetstatCommandSampler));
+#endif
+
+    for (auto &candidate : candidates) {
+        candidate.sampler->set_quantities(qttys);
+    }
+
+    return candidates;
+}
+
+SamplerDetector::Probe
+SamplerDetector::probe(Sampler *sampler,
+                       const std::vector<std::string> &iface_names) {
+    Probe result{};
+
+    // A sampler that cannot even start throws, that stops here
+    try {
+        sampler->get_samples(iface_names, &result.samples);
+    } catch (std::runtime_error &exc) {
+        result.error = exc.what();
+        return result;
+    }
+
+    // Otherwise it has to sample every iface, on startup an iface that
+    // cannot be sampled is as good as a sampler that does not work
+    for (std::size_t i = 0; i < result.samples.size(); ++i) {
+        auto error = result.samples[i].error;
+        if (error == SampleError::NONE) {
+            continue;
+        }
+
+        if (!result.error.empty()) {
+            result.error += ", ";
+        }
+        result.error += iface_names[i] + ": " + get_message(error);
+    }
+
+    result.is_ok = result.error.empty();
+    return result;
+}
+
+std::string SamplerDetector::read_cached_name(const std::string &path) {
+    if (path.empty()) {
+        return std::string{};
+    }
+
+    std::ifstream file{path};
+    std::string name{};
+    std::getline(file, name);
+    return name;
+}
+
+void SamplerDetector::write_cached_name(const std::string &path,
+                                        const std::string &name) {
+    if (path.empty() || (read_cached_name(path) == name)) {
+        return;
+    }
+
+    // The cache is only a hint, so failing to write it is no error. The
+    // directories may not exist yet.
+    for (auto pos = path.find('/', 1); pos != std::string::npos;
+         pos = path.find('/', pos + 1)) {
+        mkdir(path.substr(0, pos).c_str(), 0700);
+    }
+
+    // Written aside and renamed over, so that a concurrent startup never
+    // reads half a name
+    auto tmp_path = path + "." + std::to_string(getpid());
+    {
+        std::ofstream file{tmp_path};
+        file << name << "\n";
+        if (!file) {
+            unlink(tmp_path.c_str());
+            return;
+        }
+    }
+
+    if (rename(tmp_path.c_str(), path.c_str()) < 0) {
+        unlink(tmp_path.c_str());
+    }
+}
+
 } // namespace sampling
-} // namespace bandwit
\ No newline at end of file
+} // namespace bandwit
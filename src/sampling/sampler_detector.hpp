@@ -3,17 +3,57 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "sampling/detection_result.hpp"
+#include "sampling/quantity.hpp"
 #include "sampling/sample.hpp"
 #include "sampling/sampler.hpp"
 
 namespace bandwit {
 namespace sampling {
 
+// Picks the most preferred sampler that works for all the ifaces, out of the
+// ones that exist on the platform at all. They are all tried at once, so a
+// startup waits for the slowest of them rather than for all of them in turn.
+// The pick is remembered in a file per host, and tried on its own the next
+// time.
 class SamplerDetector {
   public:
-    DetectionResult detect_sampler(const std::string &iface_name) const;
+    // The sampler is set up to take the quantities, the ones it cannot take
+    // are left at 0
+    DetectionResult
+    detect_sampler(const std::vector<std::string> &iface_names,
+                   const std::vector<Quantity> &qttys = {
+                       Quantity::BYTES}) const;
+
+    // $XDG_CACHE_HOME/bandwit/<name>-<host>, or the same in ~/.cache, or
+    // empty if there is no home to put it in
+    static std::string get_cache_path(const std::string &name = "sampler");
+
+  private:
+    struct Candidate {
+        std::string name;
+        std::unique_ptr<Sampler> sampler;
+    };
+
+    // the outcome of trying a sampler, errors are collected not thrown
+    struct Probe {
+        bool is_ok{false};
+        std::vector<Sample> samples{};
+        std::string error{};
+    };
+
+    // most preferred first
+    static std::vector<Candidate>
+    make_candidates(const std::vector<Quantity> &qttys);
+
+    static Probe probe(Sampler *sampler,
+                       const std::vector<std::string> &iface_names);
+
+    static std::string read_cached_name(const std::string &path);
+    static void write_cached_name(const std::string &path,
+                                  const std::string &name);
 };
 
 } // namespace sampling
@@ -0,0 +1,137 @@
+#include <csignal>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "logging.hpp"
+#include "sampler_thread.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+SamplerThread::SamplerThread(std::unique_ptr<Sampler> sampler,
+                             std::vector<std::string> iface_names,
+                             Millis interval, SteadyTimePoint start,
+                             tools::Profiler *profiler,
+                             std::unique_ptr<AdaptiveSchedule> schedule)
+    : sampler_{std::move(sampler)}, schedule_{std::move(schedule)},
+      iface_names_{std::move(iface_names)},
+      scheduler_{interval, start}, profiler_{profiler} {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        THROW_CERROR(std::runtime_error, "SamplerThread failed in pipe()");
+    }
+
+    for (auto fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    wake_read_fd_ = fds[0];
+    wake_write_fd_ = fds[1];
+
+    thread_ = std::thread{&SamplerThread::run, this};
+}
+
+SamplerThread::~SamplerThread() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        is_stopping_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+
+    close(wake_write_fd_);
+    close(wake_read_fd_);
+}
+
+int SamplerThread::get_fd() const { return wake_read_fd_; }
+
+void SamplerThread::drain(const BatchCallback &on_batch) {
+    // Empty the pipe first, a batch queued after this wakes us up again
+    char buf[256];
+    while (read(wake_read_fd_, buf, sizeof(buf)) > 0) {
+    }
+
+    for (auto *batch = queue_.front(); batch != nullptr;
+         batch = queue_.front()) {
+        on_batch(*batch);
+        queue_.pop();
+    }
+
+    if (has_error_.load(std::memory_order_acquire)) {
+        std::rethrow_exception(error_);
+    }
+}
+
+void SamplerThread::run() {
+    // Signals are for the thread with the event loop. A signal that is
+    // watched through a signalfd would be acted on as if it was not watched
+    // at all if it was delivered here.
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    while (true) {
+        auto deadline = scheduler_.get_deadline();
+        if (stop_cv_.wait_until(lock, deadline,
+                                [this] { return is_stopping_; })) {
+            return;
+        }
+
+        lock.unlock();
+
+        try {
+            take_sample(deadline);
+        } catch (...) {
+            error_ = std::current_exception();
+            has_error_.store(true, std::memory_order_release);
+            wake_up();
+            return;
+        }
+
+        scheduler_.advance(SteadyClock::now());
+        lock.lock();
+    }
+}
+
+void SamplerThread::take_sample(SteadyTimePoint deadline) {
+    // With the queue full this deadline is skipped. The next batch that does
+    // go through is taken against the same previous samples, so its deltas
+    // cover the skipped deadlines and no bytes are lost.
+    auto *batch = queue_.get_push_slot();
+    if (batch == nullptr) {
+        LOG_W("sample queue full, skipped a deadline");
+        return;
+    }
+
+    // Recorded in the bucket of the deadline the sample was taken for, not
+    // the time it actually got taken
+    batch->tp = tools::MonotonicClock::from_steady(deadline);
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::SAMPLE};
+        if (schedule_ != nullptr) {
+            schedule_->sample(sampler_.get(), iface_names_, batch->tp,
+                              &batch->samples);
+        } else {
+            sampler_->get_samples(iface_names_, &batch->samples);
+        }
+    }
+
+    queue_.push();
+    wake_up();
+}
+
+void SamplerThread::wake_up() {
+    // A full pipe already has the other side woken up
+    char byte{0};
+    [[maybe_unused]] auto nwritten = write(wake_write_fd_, &byte, 1);
+}
+
+} // namespace sampling
+} // namespace bandwit
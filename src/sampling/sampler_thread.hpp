@@ -0,0 +1,99 @@
+#ifndef SAMPLER_THREAD_H
+#define SAMPLER_THREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/adaptive_schedule.hpp"
+#include "sampling/sample.hpp"
+#include "sampling/sampler.hpp"
+#include "tools/deadline_scheduler.hpp"
+#include "tools/profiler.hpp"
+#include "tools/spsc_ring.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// The samples of every iface taken for one deadline
+struct SampleBatch {
+    TimePoint tp{};
+    std::vector<Sample> samples{};
+};
+
+// Samples a set of ifaces on a thread of its own, on the same fixed schedule
+// as the DeadlineScheduler, and queues the samples for the thread that
+// records them. Taking the samples does not wait for the recording thread, so
+// a recording thread that is held up, eg. by a stalled terminal, does not
+// skew the deltas. If the queue fills up the samples of a deadline are
+// dropped rather than waited on, the bytes then show up in the next batch
+// that does go through.
+class SamplerThread {
+  public:
+    using BatchCallback = std::function<void(const SampleBatch &batch)>;
+
+    // Times the sampling into the profiler, if there is one. Backs off on
+    // idle ifaces if there is a schedule, their samples are NOT_DUE while it
+    // does.
+    SamplerThread(std::unique_ptr<Sampler> sampler,
+                  std::vector<std::string> iface_names, Millis interval,
+                  SteadyTimePoint start, tools::Profiler *profiler = nullptr,
+                  std::unique_ptr<AdaptiveSchedule> schedule = nullptr);
+    ~SamplerThread();
+
+    CLASS_DISABLE_COPIES(SamplerThread)
+    CLASS_DISABLE_MOVES(SamplerThread)
+
+    // readable when there are batches queued, for the recording thread's
+    // event loop to watch
+    int get_fd() const;
+
+    // Recording thread: calls on_batch with the queued batches, oldest
+    // first. Rethrows the exception that stopped the sampling, if any.
+    void drain(const BatchCallback &on_batch);
+
+  private:
+    // room for this many deadlines of backlog
+    static constexpr std::size_t QUEUE_CAPACITY = 64;
+
+    void run();
+    void take_sample(SteadyTimePoint deadline);
+    void wake_up();
+
+    std::unique_ptr<Sampler> sampler_{nullptr};
+    std::unique_ptr<AdaptiveSchedule> schedule_{nullptr};
+    std::vector<std::string> iface_names_{};
+    tools::DeadlineScheduler scheduler_;
+    tools::Profiler *profiler_{nullptr};
+
+    tools::SpscRing<SampleBatch, QUEUE_CAPACITY> queue_{};
+
+    // a pipe that the sampling thread writes a byte into per batch
+    int wake_read_fd_{-1};
+    int wake_write_fd_{-1};
+
+    // set by the sampling thread before it gives up, then published by
+    // has_error_
+    std::exception_ptr error_{nullptr};
+    std::atomic<bool> has_error_{false};
+
+    // only guards is_stopping_, the samples go through the queue
+    std::mutex mutex_{};
+    std::condition_variable stop_cv_{};
+    bool is_stopping_{false};
+
+    std::thread thread_{};
+};
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // SAMPLER_THREAD_H
@@ -0,0 +1,165 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "except.hpp"
+#include "sampling/sampler_detector.hpp"
+#include "snapshot.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+// "BANDWSNP"
+constexpr uint64_t SNAPSHOT_MAGIC = 0x504e5357444e4142;
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+static void make_parent_dirs(const std::string &path) {
+    // the ones that exist already fail, which is fine
+    for (auto pos = path.find('/', 1); pos != std::string::npos;
+         pos = path.find('/', pos + 1)) {
+        mkdir(path.substr(0, pos).c_str(), 0700);
+    }
+}
+
+static bool write_all(int fd, const char *data, std::size_t len) {
+    while (len > 0) {
+        ssize_t rv = write(fd, data, len);
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        data += rv;
+        len -= SIZE_T(rv);
+    }
+
+    return true;
+}
+
+static bool read_all(int fd, char *data, std::size_t len) {
+    while (len > 0) {
+        ssize_t rv = read(fd, data, len);
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        // the file got shorter since it was looked at
+        if (rv == 0) {
+            errno = EIO;
+            return false;
+        }
+
+        data += rv;
+        len -= SIZE_T(rv);
+    }
+
+    return true;
+}
+
+std::string get_default_snapshot_path() {
+    return SamplerDetector::get_cache_path("snapshot");
+}
+
+void write_snapshot(const std::string &path, Millis interval,
+                    const History &history) {
+    auto image_len = history.get_image_size();
+    std::vector<char> data(sizeof(SnapshotHeader) + image_len);
+
+    auto *header = reinterpret_cast<SnapshotHeader *>(data.data());
+    header->magic = SNAPSHOT_MAGIC;
+    header->version = SNAPSHOT_VERSION;
+    header->interval_ms = U64(interval.count());
+    header->image_len = image_len;
+    history.write_image(data.data() + sizeof(SnapshotHeader));
+
+    make_parent_dirs(path);
+
+    auto tmp_path = path + ".tmp";
+    int fd = open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                  0600);
+    if (fd < 0) {
+        THROW_ARGS(std::runtime_error, "Snapshot failed to open %s: %s",
+                   tmp_path.c_str(), strerror(errno));
+    }
+
+    // Synced before the rename, so that what the rename puts in place is
+    // all there after a crash
+    bool is_written =
+        write_all(fd, data.data(), data.size()) && (fsync(fd) == 0);
+    int error = errno;
+    close(fd);
+
+    if (!is_written || (rename(tmp_path.c_str(), path.c_str()) < 0)) {
+        error = is_written ? errno : error;
+        unlink(tmp_path.c_str());
+        THROW_ARGS(std::runtime_error, "Snapshot failed to write %s: %s",
+                   path.c_str(), strerror(error));
+    }
+}
+
+std::size_t read_snapshot(const std::string &path, Millis interval,
+                          History *history) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if ((fd < 0) && (errno == ENOENT)) {
+        return 0;
+    }
+
+    if (fd < 0) {
+        THROW_ARGS(std::runtime_error, "Snapshot failed to open %s: %s",
+                   path.c_str(), strerror(errno));
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        THROW_CERROR(std::runtime_error, "Snapshot failed in fstat()");
+    }
+
+    if (SIZE_T(st.st_size) < sizeof(SnapshotHeader)) {
+        close(fd);
+        THROW_ARGS(std::runtime_error, "snapshot %s is truncated",
+                   path.c_str());
+    }
+
+    // the whole file at once, the image is read in place
+    std::vector<char> data(SIZE_T(st.st_size));
+    bool is_read = read_all(fd, data.data(), data.size());
+    int error = errno;
+    close(fd);
+
+    if (!is_read) {
+        THROW_ARGS(std::runtime_error, "Snapshot failed to read %s: %s",
+                   path.c_str(), strerror(error));
+    }
+
+    const auto *header = reinterpret_cast<const SnapshotHeader *>(data.data());
+    if ((header->magic != SNAPSHOT_MAGIC) ||
+        (header->version != SNAPSHOT_VERSION) ||
+        (header->image_len != data.size() - sizeof(SnapshotHeader))) {
+        THROW_ARGS(std::runtime_error,
+                   "snapshot %s is not one of this version, remove it to "
+                   "start over",
+                   path.c_str());
+    }
+
+    // The buckets of another interval are of other windows
+    if (header->interval_ms != U64(interval.count())) {
+        return 0;
+    }
+
+    auto snapshot = History::read_image(data.data() + sizeof(SnapshotHeader),
+                                        header->image_len);
+    return history->restore(snapshot.get());
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,43 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <string>
+
+#include "aliases.hpp"
+#include "sampling/history.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+struct SnapshotHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t interval_ms;
+    // of the History image that follows
+    uint64_t image_len;
+};
+
+// $XDG_CACHE_HOME/bandwit/snapshot-<host>, or the same in ~/.cache, or empty
+// if there is no home to put it in
+std::string get_default_snapshot_path();
+
+// Writes the whole history to path at once: the header and the flat image
+// of the History, which holds the storage of every tier in one piece. It is
+// written aside and renamed over the snapshot before, so a crash halfway
+// leaves that one in place rather than half of this one. Creates the
+// directories of the path that do not exist, throws if it cannot be written.
+void write_snapshot(const std::string &path, Millis interval,
+                    const History &history);
+
+// Restores the ifaces of the history from the snapshot at path, in one read
+// of the file. Returns how many ifaces were restored, none if there is no
+// snapshot or it was taken at another interval. Throws for a snapshot that
+// cannot be read.
+std::size_t read_snapshot(const std::string &path, Millis interval,
+                          History *history);
+
+} // namespace sampling
+} // namespace bandwit
+
+#endif // SNAPSHOT_H
@@ -1,15 +1,43 @@
+#include <stdexcept>
+
+#include "except.hpp"
 #include "sampling/statistic.hpp"
 
 namespace bandwit {
 namespace sampling {
 
+Statistic next_statistic(Statistic stat) {
+    switch (stat) {
+    case Statistic::AVERAGE:
+        return Statistic::SUM;
+    case Statistic::SUM:
+        return Statistic::MAX;
+    case Statistic::MAX:
+        return Statistic::P95;
+    case Statistic::P95:
+        return Statistic::P99;
+    case Statistic::P99:
+        return Statistic::AVERAGE;
+    }
+
+    THROW_MSG(std::logic_error, "unknown statistic");
+}
+
 std::string get_label(Statistic stat) {
     switch (stat) {
     case Statistic::AVERAGE:
         return "avg";
     case Statistic::SUM:
         return "sum";
+    case Statistic::MAX:
+        return "max";
+    case Statistic::P95:
+        return "p95";
+    case Statistic::P99:
+        return "p99";
     }
+
+    THROW_MSG(std::logic_error, "unknown statistic");
 }
 
 } // namespace sampling
@@ -1,56 +1,196 @@
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <fcntl.h>
 #include <fstream>
 #include <sstream>
-#include <stdexcept>
 
 #include "aliases.hpp"
-#include "except.hpp"
 #include "sysfs_sampler.hpp"
+#include "tools/monotonic_clock.hpp"
 
 namespace bandwit {
 namespace sampling {
 
-uint64_t SysFsParser::read_file_as_number(const std::string &filepath) const {
+StatisticsFile::StatisticsFile(std::string filepath)
+    : filepath_{std::move(filepath)} {}
+
+StatisticsFile::~StatisticsFile() { close_file(); }
+
+// The statistics dir of an iface goes away along with the iface
+static SampleError get_open_error(int err) {
+    return ((err == ENOENT) || (err == ENODEV)) ? SampleError::NO_SUCH_IFACE
+                                                : SampleError::READ_FAILED;
+}
+
+SampleError StatisticsFile::read_number(uint64_t *num) {
+    if (fd_ < 0) {
+        auto error = open_file();
+        if (error != SampleError::NONE) {
+            return error;
+        }
+    }
+
+    char buf[buffer_size_];
+    ssize_t num_read = pread(fd_, buf, buffer_size_, 0);
+
+    // If the interface went away (and possibly came back) the fd we hold is
+    // stale. Reopen the file and give it one more try.
+    if ((num_read < 0) && ((errno == ENODEV) || (errno == ENOENT))) {
+        close_file();
+        auto error = open_file();
+        if (error != SampleError::NONE) {
+            return error;
+        }
+
+        num_read = pread(fd_, buf, buffer_size_, 0);
+    }
+
+    if (num_read < 0) {
+        return SampleError::READ_FAILED;
+    }
+
+    SysFsParser parser{};
+    return parser.parse_number(buf, SIZE_T(num_read), num);
+}
+
+SampleError StatisticsFile::open_file() {
+    fd_ = open(filepath_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+        return get_open_error(errno);
+    }
+
+    return SampleError::NONE;
+}
+
+void StatisticsFile::close_file() {
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+SampleError SysFsParser::read_file_as_number(const std::string &filepath,
+                                             uint64_t *num) const {
     std::ifstream fl{filepath};
     if (!fl) {
-        THROW_ARGS(std::runtime_error, "failed to open file for reading: %s",
-                   filepath.c_str());
+        return get_open_error(errno);
     }
 
     std::string contents{};
     getline(fl, contents);
 
-    return std::stoul(contents);
+    return parse_number(contents.data(), contents.size(), num);
+}
+
+SampleError SysFsParser::parse_number(const char *buf, std::size_t len,
+                                      uint64_t *num) const {
+    uint64_t value{0};
+    std::size_t i = 0;
+
+    for (; i < len; ++i) {
+        char ch = buf[i];
+        if ((ch < '0') || (ch > '9')) {
+            break;
+        }
+
+        uint64_t digit = U64(ch - '0');
+        if (value > (UINT64_MAX - digit) / 10) {
+            return SampleError::PARSE_FAILED;
+        }
+
+        value = value * 10 + digit;
+    }
+
+    // We expect the number to be followed by a newline or nothing at all
+    if ((i == 0) || ((i < len) && (buf[i] != '\n'))) {
+        return SampleError::PARSE_FAILED;
+    }
+
+    *num = value;
+    return SampleError::NONE;
 }
 
 std::string SysFsParser::create_filepath(const std::string &iface_name,
-                                         const Quantity &qtty) const {
+                                         Direction dir, Quantity qtty) const {
     std::stringstream ss{};
     std::string filename = quantity_filenames_.at(qtty);
-    ss << "/sys/class/net/" << iface_name << "/statistics/" << filename;
+    ss << "/sys/class/net/" << iface_name << "/statistics/"
+       << (dir == Direction::RX ? "rx_" : "tx_") << filename;
     return ss.str();
 }
 
-uint64_t SysFsParser::read(const std::string &iface_name,
-                           const Quantity &qtty) const {
-    std::string filepath = create_filepath(iface_name, qtty);
-    return read_file_as_number(filepath);
+SampleError SysFsParser::read(const std::string &iface_name, Direction dir,
+                              Quantity qtty, uint64_t *num) const {
+    std::string filepath = create_filepath(iface_name, dir, qtty);
+    return read_file_as_number(filepath, num);
 }
 
-Sample SysFsSampler::get_sample(const std::string &iface_name) const {
-    auto tp = Clock::now();
-    std::time_t ts = Clock::to_time_t(tp);
+Sample SysFsSampler::get_sample(const std::string &iface_name) {
+    TimePoint ts = tools::MonotonicClock::now();
 
-    uint64_t rx = parser_.read(iface_name, SysFsParser::Quantity::RX_BYTES);
-    uint64_t tx = parser_.read(iface_name, SysFsParser::Quantity::TX_BYTES);
+    Sample sample{};
+    sample.ts = ts;
 
-    Sample sample{
-        rx,
-        tx,
-        ts,
-    };
+    // Stops at the first error, the rest is not read
+    InterfaceFiles *files = keep_files_open_ ? get_files(iface_name) : nullptr;
+    for (std::size_t i = 0;
+         (i < quantities_.size()) && (sample.error == SampleError::NONE);
+         ++i) {
+        auto qtty = quantities_[i];
+
+        if (files != nullptr) {
+            sample.error = files->rx[i]->read_number(&sample.rx[qtty]);
+            if (sample.error == SampleError::NONE) {
+                sample.error = files->tx[i]->read_number(&sample.tx[qtty]);
+            }
+        } else {
+            sample.error = parser_.read(iface_name, SysFsParser::Direction::RX,
+                                        qtty, &sample.rx[qtty]);
+            if (sample.error == SampleError::NONE) {
+                sample.error =
+                    parser_.read(iface_name, SysFsParser::Direction::TX, qtty,
+                                 &sample.tx[qtty]);
+            }
+        }
+    }
 
     return sample;
 }
 
+unsigned SysFsSampler::get_counter_bits() const {
+    // 32bit kernels keep 32bit counters for most drivers
+    return sizeof(unsigned long) * CHAR_BIT;
+}
+
+void SysFsSampler::set_quantities(const std::vector<Quantity> &qttys) {
+    // the files are opened again for the new quantities
+    quantities_ = qttys;
+    files_.clear();
+}
+
+SysFsSampler::InterfaceFiles *
+SysFsSampler::get_files(const std::string &iface_name) {
+    auto it = files_.find(iface_name);
+    if (it != files_.end()) {
+        return it->second.get();
+    }
+
+    // The paths are only built once per interface
+    auto files = std::make_unique<InterfaceFiles>();
+    for (auto qtty : quantities_) {
+        files->rx.push_back(std::make_unique<StatisticsFile>(
+            parser_.create_filepath(iface_name, SysFsParser::Direction::RX,
+                                    qtty)));
+        files->tx.push_back(std::make_unique<StatisticsFile>(
+            parser_.create_filepath(iface_name, SysFsParser::Direction::TX,
+                                    qtty)));
+    }
+
+    auto *ptr = files.get();
+    files_.emplace(iface_name, std::move(files));
+    return ptr;
+}
+
 } // namespace sampling
-} // namespace bandwit
\ No newline at end of file
+} // namespace bandwit
@@ -1,6 +1,7 @@
 #ifndef SYSFS_SAMPLER_H
 #define SYSFS_SAMPLER_H
 
+#include <memory>
 #include <string>
 #include <unistd.h>
 #include <unordered_map>
@@ -10,40 +11,93 @@
 namespace bandwit {
 namespace sampling {
 
+// A statistics file that is kept open across reads. Every read is a single
+// pread() at offset 0, which makes sysfs regenerate the contents of the file.
+class StatisticsFile {
+  public:
+    explicit StatisticsFile(std::string filepath);
+    ~StatisticsFile();
+
+    CLASS_DISABLE_COPIES(StatisticsFile)
+    CLASS_DISABLE_MOVES(StatisticsFile)
+
+    // Reads the number into num, if there is no error
+    SampleError read_number(uint64_t *num);
+
+  private:
+    SampleError open_file();
+    void close_file();
+
+    // the largest uint64_t has 20 digits, plus a newline
+    static constexpr std::size_t buffer_size_{32};
+
+    std::string filepath_{};
+    int fd_{-1};
+};
+
 class SysFsParser {
   public:
-    enum class Quantity {
-        RX_BYTES,
-        TX_BYTES,
+    enum class Direction {
+        RX,
+        TX,
     };
 
-    uint64_t read_file_as_number(const std::string &filepath) const;
-    std::string create_filepath(const std::string &iface_name,
-                                const Quantity &qtty) const;
-    uint64_t read(const std::string &iface_name, const Quantity &qtty) const;
+    // These put the number into num, if there is no error
+    SampleError read_file_as_number(const std::string &filepath,
+                                    uint64_t *num) const;
+    SampleError parse_number(const char *buf, std::size_t len,
+                             uint64_t *num) const;
+    std::string create_filepath(const std::string &iface_name, Direction dir,
+                                Quantity qtty) const;
+    SampleError read(const std::string &iface_name, Direction dir,
+                     Quantity qtty, uint64_t *num) const;
 
   private:
+    // the file names are these after rx_ or tx_
     std::unordered_map<Quantity, std::string> quantity_filenames_{
-        {Quantity::RX_BYTES, "rx_bytes"},
-        {Quantity::TX_BYTES, "tx_bytes"},
+        {Quantity::BYTES, "bytes"},
+        {Quantity::PACKETS, "packets"},
+        {Quantity::ERRORS, "errors"},
+        {Quantity::DROPS, "dropped"},
     };
 };
 
 class SysFsSampler : public Sampler {
   public:
-    SysFsSampler() = default;
+    // With keep_files_open the statistics files are opened on the first
+    // sample and re-read with pread() on every subsequent one. Without it
+    // every sample opens, reads and closes the files.
+    explicit SysFsSampler(bool keep_files_open = true)
+        : keep_files_open_{keep_files_open} {}
     ~SysFsSampler() override = default;
 
     CLASS_DISABLE_COPIES(SysFsSampler)
     CLASS_DISABLE_MOVES(SysFsSampler)
 
-    Sample get_sample(const std::string &iface_name) const override;
+    Sample get_sample(const std::string &iface_name) override;
+
+    // the kernel's unsigned long, whatever the width of the number printed
+    unsigned get_counter_bits() const override;
+
+    // Only the files of these are read, two per quantity
+    void set_quantities(const std::vector<Quantity> &qttys) override;
 
   private:
+    // a file per quantity wanted, in the same order
+    struct InterfaceFiles {
+        std::vector<std::unique_ptr<StatisticsFile>> rx{};
+        std::vector<std::unique_ptr<StatisticsFile>> tx{};
+    };
+
+    InterfaceFiles *get_files(const std::string &iface_name);
+
+    bool keep_files_open_{true};
+    std::vector<Quantity> quantities_{Quantity::BYTES};
     SysFsParser parser_{};
+    std::unordered_map<std::string, std::unique_ptr<InterfaceFiles>> files_{};
 };
 
 } // namespace sampling
 } // namespace bandwit
 
-#endif // SYSFS_SAMPLER_H
\ No newline at end of file
+#endif // SYSFS_SAMPLER_H
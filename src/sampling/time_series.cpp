@@ -1,124 +1,252 @@
-#include "time_series.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+#include "except.hpp"
 #include "macros.hpp"
+#include "time_series.hpp"
 
 namespace bandwit {
 namespace sampling {
 
-void TimeSeries::inc(TimePoint tp, uint64_t value) {
-    // are we well over size?
-    if (F64(size()) > F64(max_capacity_) * oversize_factor_) {
-        truncate();
+TimeSeries::TimeSeries(Millis sampling_interval, TimePoint start,
+                       std::size_t capacity, BucketStorage storage)
+    : sampling_interval_{sampling_interval}, start_{start},
+      storage_kind_{storage}, capacity_{capacity} {
+    if (storage_kind_ == BucketStorage::PACKED) {
+        packed_.resize(capacity_, EMPTY_SLOT);
+    } else {
+        storage_.resize(capacity_);
     }
+}
 
+void TimeSeries::inc(TimePoint tp, uint64_t value) {
     std::size_t key = calculate_key(tp);
-    auto current_value = ((key <= max_key_) && (size() > 0)) ? get_key(key) : 0;
-    set_key(key, current_value + value);
+    auto bucket = get_key(key);
+    bucket.add(value);
+    set_key(key, bucket);
+}
+
+void TimeSeries::merge(TimePoint tp, const Bucket &bucket) {
+    std::size_t key = calculate_key(tp);
+    auto merged = get_key(key);
+    merged.merge(bucket);
+    set_key(key, merged);
 }
 
 uint64_t TimeSeries::get(TimePoint tp) const {
+    std::size_t key = calculate_key(tp);
+    return get_key(key).sum;
+}
+
+Bucket TimeSeries::get_bucket(TimePoint tp) const {
     std::size_t key = calculate_key(tp);
     return get_key(key);
 }
 
 TimeSeriesSlice TimeSeries::get_slice_from_point(TimePoint tp, std::size_t len,
                                                  Statistic stat) const {
+    return get_slice_from_point(tp, len, stat, start_, Bucket{});
+}
+
+TimeSeriesSlice TimeSeries::get_slice_from_point(TimePoint tp, std::size_t len,
+                                                 Statistic stat,
+                                                 TimePoint pending_tp,
+                                                 const Bucket &pending) const {
     auto last_key = calculate_key(tp);
     auto first_key = len > (last_key + 1) ? 0 : last_key + 1 - len;
-
     auto agg_window = aggregation_window();
 
-    uint64_t divisor = 1;
-    if (stat == Statistic::AVERAGE) {
-        divisor = U64(agg_window);
+    // Keys that have fallen off the ring are not part of the slice
+    first_key = std::max(first_key, min_key_);
+    if (last_key < first_key) {
+        return TimeSeriesSlice{this, first_key, 0, reverse_key(first_key),
+                               agg_window};
     }
 
-    std::vector<TimePoint> time_points(last_key + 1 - first_key);
-    std::vector<uint64_t> values(time_points.size());
-    std::size_t i = 0;
+    TimeSeriesSlice slice{this, first_key, last_key + 1 - first_key,
+                          reverse_key(first_key), agg_window};
+
+    slice.set_field(get_field(stat));
+
+    // The series starts at its first bucket, the pending one is as far as
+    // it goes. An empty bucket in between is a gap, the keys before it were
+    // never sampled and the ones after it are yet to be.
+    auto pending_key = calculate_key(pending_tp);
+    auto first_recorded = size_ > 0 ? min_key_ : pending_key;
+    auto last_recorded = size_ > 0 ? std::max(max_key_, pending_key)
+                                   : pending_key;
+    if ((last_recorded >= first_key) && (first_recorded <= last_key)) {
+        slice.set_recorded(std::max(first_recorded, first_key) - first_key,
+                           std::min(last_recorded, last_key) + 1 - first_key);
+    } else if (first_recorded > last_key) {
+        slice.set_recorded(last_key + 1 - first_key, last_key + 1 - first_key);
+    } else {
+        slice.set_recorded(0, 0);
+    }
 
-    for (auto cursor = first_key; cursor <= last_key; ++cursor) {
-        auto tp = reverse_key(cursor);
-        auto value = get_key(cursor);
+    if ((pending_key >= first_key) && (pending_key <= last_key)) {
+        // The percentiles of the pending bucket are already for the lot
+        auto combined = get_key(pending_key);
+        combined.merge(pending);
+        combined.p95 = std::max(combined.p95, pending.p95);
+        combined.p99 = std::max(combined.p99, pending.p99);
 
-        time_points[i] = tp;
-        values[i] = value / divisor;
+        slice.set_pending(pending_key - first_key, combined);
+    }
 
-        ++i;
+    // Averages are per second. The other statistics are over the individual
+    // values, which are taken to be one per bucket here.
+    if (stat != Statistic::SUM) {
+        slice.set_rate_per_second(sampling_interval_);
     }
 
-    TimeSeriesSlice slice{time_points, values, agg_window};
     return slice;
 }
 
-TimePoint TimeSeries::min() const { return start_; }
+uint64_t Bucket::*TimeSeries::get_field(Statistic stat) {
+    switch (stat) {
+    case Statistic::AVERAGE:
+    case Statistic::SUM:
+        return &Bucket::sum;
+    case Statistic::MAX:
+        return &Bucket::max;
+    case Statistic::P95:
+        return &Bucket::p95;
+    case Statistic::P99:
+        return &Bucket::p99;
+    }
+
+    return &Bucket::sum;
+}
+
+TimePoint TimeSeries::min() const { return reverse_key(min_key_); }
 
 TimePoint TimeSeries::max() const { return reverse_key(max_key_); }
 
 std::optional<TimePoint> TimeSeries::minus_one(TimePoint tp) const {
-    int key = INT(calculate_key(tp));
-    --key;
+    auto key = calculate_key(tp);
 
-    if ((key < 0) || (key > INT(max_key_))) {
+    if ((key <= min_key_) || (key > max_key_ + 1)) {
         return std::nullopt;
     }
 
-    TimePoint res = reverse_key(SIZE_T(key));
+    TimePoint res = reverse_key(key - 1);
     return std::optional<TimePoint>(res);
 }
 
 std::optional<TimePoint> TimeSeries::plus_one(TimePoint tp) const {
-    int key = INT(calculate_key(tp));
-    ++key;
+    auto key = calculate_key(tp);
 
-    if ((key < 0) || (key > INT(max_key_))) {
+    if ((key + 1 < min_key_) || (key + 1 > max_key_)) {
         return std::nullopt;
     }
 
-    TimePoint res = reverse_key(SIZE_T(key));
+    TimePoint res = reverse_key(key + 1);
     return std::optional<TimePoint>(res);
 }
 
-void TimeSeries::set_key(std::size_t key, uint64_t value) {
-    // We can't use operator[] to set an element that doesn't exist in the
-    // vector yet so we need to enlarge it proactively. The new slots will be
-    // filled with zeroes, which is our null value anyway.
-    if (key >= storage_.size()) {
-        // double the vector size
-        storage_.resize((key + 1) * 2);
+TimePoint TimeSeries::floor(TimePoint tp) const {
+    return reverse_key(calculate_key(tp));
+}
+
+void TimeSeries::set_key(std::size_t key, const Bucket &bucket) {
+    auto capacity = capacity_;
+
+    // The first bucket starts the series, nothing was recorded before it
+    if (size_ == 0) {
+        min_key_ = key;
+        max_key_ = key;
     }
 
-    storage_[key] = value;
+    // Too old, this slot has already been reused for a newer key
+    if (key < min_key_) {
+        return;
+    }
+
+    if (key > max_key_) {
+        // Moving forward: the slots between the old and the new max key still
+        // hold values from a previous lap of the ring, so clear them out. An
+        // empty bucket is our null value. At most one full lap needs clearing.
+        auto lap_start = key + 1 > capacity ? key + 1 - capacity : 0;
+        auto first = std::max(max_key_ + 1, lap_start);
+        for (auto cursor = first; cursor < key; ++cursor) {
+            set_slot(cursor % capacity, Bucket{});
+        }
+
+        // update invariants
+        max_key_ = key;
+        min_key_ = std::max(min_key_, lap_start);
+    }
 
-    // update invariants
-    max_key_ = key > max_key_ ? key : max_key_;
-    size_ = max_key_ + 1;
+    set_slot(key % capacity, bucket);
+    size_ = max_key_ + 1 - min_key_;
 }
 
-uint64_t TimeSeries::get_key(std::size_t key) const { return storage_.at(key); }
+Bucket TimeSeries::get_key(std::size_t key) const {
+    if ((size_ == 0) || (key < min_key_) || (key > max_key_)) {
+        return Bucket{};
+    }
 
-AggregationWindow TimeSeries::aggregation_window() const {
-    Millis one_sec{1000};
-    uint32_t multiplier = sampling_interval_ / one_sec;
+    return get_slot(key % capacity_);
+}
 
-    // this will fail if sampling_interval_ does not match any
-    // AggregationWindow
-    return static_cast<AggregationWindow>(multiplier);
+Bucket TimeSeries::get_slot(std::size_t slot) const {
+    if (storage_kind_ == BucketStorage::FULL) {
+        return storage_[slot];
+    }
+
+    auto packed = packed_[slot];
+    if (packed == EMPTY_SLOT) {
+        return Bucket{};
+    }
+
+    if (packed == ESCAPED_SLOT) {
+        return escaped_.at(slot);
+    }
+
+    // The percentiles of a single sample are the sample
+    uint64_t value{packed};
+    return Bucket{value, value, value, 1, value, value};
 }
 
-std::size_t TimeSeries::size() const { return size_; }
+void TimeSeries::set_slot(std::size_t slot, const Bucket &bucket) {
+    if (storage_kind_ == BucketStorage::FULL) {
+        storage_[slot] = bucket;
+        return;
+    }
 
-std::size_t TimeSeries::capacity() const { return storage_.capacity(); }
+    auto &packed = packed_[slot];
+    if (packed == ESCAPED_SLOT) {
+        escaped_.erase(slot);
+    }
 
-void TimeSeries::truncate() {
-    int num_to_remove = size() - max_capacity_;
-    storage_.erase(storage_.begin(), storage_.begin() + num_to_remove);
+    // The percentiles are only set once the bucket closes
+    auto value = bucket.sum;
+    bool is_single = (bucket.count == 1) && (bucket.min == value) &&
+                     (bucket.max == value) &&
+                     ((bucket.p95 == 0) || (bucket.p95 == value)) &&
+                     ((bucket.p99 == 0) || (bucket.p99 == value));
+
+    if (bucket.count == 0) {
+        packed = EMPTY_SLOT;
+    } else if (is_single && (value < ESCAPED_SLOT)) {
+        packed = U32(value);
+    } else {
+        packed = ESCAPED_SLOT;
+        escaped_[slot] = bucket;
+    }
+}
 
-    // update invariants
-    start_ += sampling_interval_ * num_to_remove;
-    max_key_ -= num_to_remove;
-    size_ -= num_to_remove;
+AggregationWindow TimeSeries::aggregation_window() const {
+    // this will fail if sampling_interval_ does not match any
+    // AggregationWindow
+    return static_cast<AggregationWindow>(sampling_interval_.count());
 }
 
+std::size_t TimeSeries::size() const { return size_; }
+
+std::size_t TimeSeries::capacity() const { return capacity_; }
+
 std::size_t TimeSeries::calculate_key(TimePoint tp) const {
     auto distance = (tp - start_);
     auto num_units = distance / sampling_interval_;
@@ -130,5 +258,135 @@ TimePoint TimeSeries::reverse_key(std::size_t index) const {
     return tp;
 }
 
+void TimeSeries::encode(tools::ByteWriter *writer) const {
+    writer->put_u64(U64(sampling_interval_.count()));
+    writer->put_i64(tools::to_nanos(start_));
+    writer->put_u64(capacity_);
+    writer->put_u64(min_key_);
+    writer->put_u64(max_key_);
+    writer->put_u64(size_);
+
+    for (std::size_t i = 0; i < size_; ++i) {
+        auto bucket = get_slot((min_key_ + i) % capacity_);
+        writer->put_u64(bucket.sum);
+        writer->put_u64(bucket.min);
+        writer->put_u64(bucket.max);
+        writer->put_u64(bucket.count);
+        writer->put_u64(bucket.p95);
+        writer->put_u64(bucket.p99);
+    }
+}
+
+std::unique_ptr<TimeSeries> TimeSeries::decode(tools::ByteReader *reader,
+                                               BucketStorage storage) {
+    Millis interval{static_cast<Millis::rep>(reader->get_u64())};
+    TimePoint start = tools::from_nanos(reader->get_i64());
+    auto capacity = SIZE_T(reader->get_u64());
+
+    if ((interval.count() <= 0) || (capacity == 0)) {
+        THROW_MSG(std::runtime_error, "TimeSeries.decode got a bad header");
+    }
+
+    auto ts = std::make_unique<TimeSeries>(interval, start, capacity, storage);
+    ts->min_key_ = SIZE_T(reader->get_u64());
+    ts->max_key_ = SIZE_T(reader->get_u64());
+    ts->size_ = SIZE_T(reader->get_u64());
+
+    if (!is_consistent(ts->min_key_, ts->max_key_, ts->size_, capacity)) {
+        THROW_MSG(std::runtime_error, "TimeSeries.decode got bad keys");
+    }
+
+    for (std::size_t i = 0; i < ts->size_; ++i) {
+        Bucket bucket{};
+        bucket.sum = reader->get_u64();
+        bucket.min = reader->get_u64();
+        bucket.max = reader->get_u64();
+        bucket.count = reader->get_u64();
+        bucket.p95 = reader->get_u64();
+        bucket.p99 = reader->get_u64();
+        ts->set_slot((ts->min_key_ + i) % capacity, bucket);
+    }
+
+    return ts;
+}
+
+std::size_t TimeSeries::get_image_size() const {
+    return sizeof(TimeSeriesImage) + capacity_ * sizeof(Bucket);
+}
+
+void TimeSeries::write_image(char *image) const {
+    auto *header = reinterpret_cast<TimeSeriesImage *>(image);
+    auto *buckets = reinterpret_cast<Bucket *>(image + sizeof(*header));
+    auto capacity = capacity_;
+
+    // Everything from the newest key the image has seen on may have changed,
+    // unless the image is blank or a full lap behind
+    auto first_key = min_key_;
+    bool is_behind = (header->capacity != capacity) || (header->size == 0) ||
+                     (max_key_ >= header->max_key + capacity);
+    if (!is_behind) {
+        first_key = std::max(first_key, SIZE_T(header->max_key));
+    }
+
+    if (size_ > 0) {
+        for (auto key = first_key; key <= max_key_; ++key) {
+            buckets[key % capacity] = get_slot(key % capacity);
+        }
+    }
+
+    header->interval_ms = U64(sampling_interval_.count());
+    header->start_ns = tools::to_nanos(start_);
+    header->capacity = capacity;
+    header->min_key = min_key_;
+    header->max_key = max_key_;
+    header->size = size_;
+}
+
+std::unique_ptr<TimeSeries> TimeSeries::read_image(const char *image,
+                                                   std::size_t len,
+                                                   BucketStorage storage) {
+    if (len < sizeof(TimeSeriesImage)) {
+        THROW_MSG(std::runtime_error, "TimeSeries.read_image: image too short");
+    }
+
+    const auto *header = reinterpret_cast<const TimeSeriesImage *>(image);
+    const auto *buckets =
+        reinterpret_cast<const Bucket *>(image + sizeof(*header));
+
+    Millis interval{static_cast<Millis::rep>(header->interval_ms)};
+    auto capacity = SIZE_T(header->capacity);
+
+    if ((interval.count() <= 0) || (capacity == 0) ||
+        (capacity > (len - sizeof(*header)) / sizeof(Bucket))) {
+        THROW_MSG(std::runtime_error, "TimeSeries.read_image got a bad header");
+    }
+
+    auto ts = std::make_unique<TimeSeries>(
+        interval, tools::from_nanos(header->start_ns), capacity, storage);
+    ts->min_key_ = SIZE_T(header->min_key);
+    ts->max_key_ = SIZE_T(header->max_key);
+    ts->size_ = SIZE_T(header->size);
+
+    if (!is_consistent(ts->min_key_, ts->max_key_, ts->size_, capacity)) {
+        THROW_MSG(std::runtime_error, "TimeSeries.read_image got bad keys");
+    }
+
+    // Only the retained keys are read, the other slots are cleared before
+    // they are used again
+    if (ts->size_ > 0) {
+        for (auto key = ts->min_key_; key <= ts->max_key_; ++key) {
+            ts->set_slot(key % capacity, buckets[key % capacity]);
+        }
+    }
+
+    return ts;
+}
+
+bool TimeSeries::is_consistent(std::size_t min_key, std::size_t max_key,
+                               std::size_t size, std::size_t capacity) {
+    return (size == 0) || ((size <= capacity) && (min_key <= max_key) &&
+                           (max_key + 1 - min_key == size));
+}
+
 } // namespace sampling
 } // namespace bandwit
\ No newline at end of file
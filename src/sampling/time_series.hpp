@@ -1,52 +1,133 @@
 #ifndef TIME_SERIES_H
 #define TIME_SERIES_H
 
+#include <memory>
 #include <optional>
+#include <unordered_map>
 #include <vector>
 
 #include "aliases.hpp"
 #include "sampling/agg_window.hpp"
+#include "sampling/bucket.hpp"
 #include "sampling/statistic.hpp"
 #include "sampling/time_series_slice.hpp"
+#include "tools/byte_stream.hpp"
 
 namespace bandwit {
 namespace sampling {
 
+// The header of a TimeSeries laid out flat in memory, so that it can be
+// shared with other processes. The capacity buckets follow it, at the same
+// indexes as in the ring buffer.
+struct TimeSeriesImage {
+    uint64_t interval_ms;
+    int64_t start_ns;
+    uint64_t capacity;
+    uint64_t min_key;
+    uint64_t max_key;
+    uint64_t size;
+};
+
+// How the buckets of a TimeSeries are kept in memory
+enum class BucketStorage {
+    // every field of every bucket, for buckets that aggregate many samples
+    FULL,
+    // 4 bytes per bucket for buckets of a single sample under 4 GB, which is
+    // what nearly every bucket of the sampling interval is. Any other bucket
+    // is escaped into a map on the side.
+    PACKED,
+};
+
+// A fixed capacity series of buckets, one per sampling interval, stored in a
+// ring buffer. Keys count intervals from `start` and keep growing; only the
+// most recent `capacity` keys are retained, older ones fall off the left edge.
 class TimeSeries {
   public:
-    TimeSeries(Millis sampling_interval, TimePoint start)
-        : sampling_interval_{sampling_interval}, start_{start} {}
+    TimeSeries(Millis sampling_interval, TimePoint start,
+               std::size_t capacity = 512,
+               BucketStorage storage = BucketStorage::FULL);
 
     // convenience API using time points
     void inc(TimePoint tp, uint64_t value);
+    void merge(TimePoint tp, const Bucket &bucket);
     uint64_t get(TimePoint tp) const;
+    Bucket get_bucket(TimePoint tp) const;
     TimeSeriesSlice get_slice_from_point(TimePoint tp, std::size_t len,
                                          Statistic stat) const;
 
+    // Same as above, but with `pending` merged into the bucket at
+    // `pending_tp` for values that are accounted for elsewhere
+    TimeSeriesSlice get_slice_from_point(TimePoint tp, std::size_t len,
+                                         Statistic stat, TimePoint pending_tp,
+                                         const Bucket &pending) const;
+
+    // the start of the bucket that tp falls into
+    TimePoint floor(TimePoint tp) const;
+
     TimePoint min() const;
     TimePoint max() const;
     std::optional<TimePoint> minus_one(TimePoint tp) const;
     std::optional<TimePoint> plus_one(TimePoint tp) const;
 
-    // underlying API using vector indices
-    void set_key(std::size_t key, uint64_t value);
-    uint64_t get_key(std::size_t key) const;
+    // underlying API using keys
+    void set_key(std::size_t key, const Bucket &bucket);
+    Bucket get_key(std::size_t key) const;
 
     AggregationWindow aggregation_window() const;
     std::size_t size() const;
     std::size_t capacity() const;
-    void truncate();
 
     std::size_t calculate_key(TimePoint tp) const;
     TimePoint reverse_key(std::size_t index) const;
 
+    // Only the retained buckets are written out, not the whole capacity.
+    // The storage is not part of the encoding, whoever decodes a series
+    // picks it.
+    void encode(tools::ByteWriter *writer) const;
+    static std::unique_ptr<TimeSeries>
+    decode(tools::ByteReader *reader,
+           BucketStorage storage = BucketStorage::FULL);
+
+    // The image always holds the whole capacity, so its size never changes.
+    // Writing only copies the buckets that changed since the image was last
+    // written, new keys are only ever written from the newest key on. The
+    // image has every field of every bucket whatever the storage.
+    std::size_t get_image_size() const;
+    void write_image(char *image) const;
+    static std::unique_ptr<TimeSeries>
+    read_image(const char *image, std::size_t len,
+               BucketStorage storage = BucketStorage::FULL);
+
+    // The field of the buckets that a statistic is computed from
+    static uint64_t Bucket::*get_field(Statistic stat);
+
   private:
+    // The packed slots of empty and of escaped buckets, no sum that is
+    // packed gets this high
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+    static constexpr uint32_t ESCAPED_SLOT = UINT32_MAX - 1;
+
+    static bool is_consistent(std::size_t min_key, std::size_t max_key,
+                              std::size_t size, std::size_t capacity);
+
+    // the bucket in the slot key % capacity_, whatever the storage
+    Bucket get_slot(std::size_t slot) const;
+    void set_slot(std::size_t slot, const Bucket &bucket);
+
     Millis sampling_interval_{};
     TimePoint start_{};
-    std::size_t max_capacity_{512};
-    double oversize_factor_{1.2};
+    BucketStorage storage_kind_{BucketStorage::FULL};
+    std::size_t capacity_{0};
+
+    // FULL: storage_[key % capacity_] holds the bucket for key
+    std::vector<Bucket> storage_{};
+
+    // PACKED: packed_[key % capacity_] holds the single sample of the bucket
+    // for key, or one of the slot markers. Escaped buckets are kept by slot.
+    std::vector<uint32_t> packed_{};
+    std::unordered_map<std::size_t, Bucket> escaped_{};
 
-    std::vector<uint64_t> storage_{};
+    std::size_t min_key_{0};
     std::size_t max_key_{0};
     std::size_t size_{0};
 };
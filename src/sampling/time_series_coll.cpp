@@ -1,5 +1,8 @@
+#include <algorithm>
 #include <chrono>
+#include <stdexcept>
 
+#include "except.hpp"
 #include "macros.hpp"
 #include "time_series_coll.hpp"
 
@@ -7,56 +10,418 @@ namespace bandwit {
 namespace sampling {
 
 TimeSeriesCollection::TimeSeriesCollection(
-    TimePoint tp, const std::vector<AggregationWindow> &windows) {
-    std::chrono::seconds one_sec{1};
+    TimePoint tp, const std::vector<AggregationWindow> &windows,
+    const Retention &retention)
+    : windows_{windows}, rolled_up_{tp} {
+    // Roll ups go from finer to coarser windows. Every window must be a
+    // multiple of the finer ones for the bucket boundaries to line up.
+    std::sort(windows_.begin(), windows_.end(),
+              [](AggregationWindow lhs, AggregationWindow rhs) {
+                  return get_duration(lhs) < get_duration(rhs);
+              });
 
-    for (const auto window : windows) {
-        auto interval = one_sec * INT(window);
-        coll_[window] = std::make_unique<TimeSeries>(interval, tp);
+    for (std::size_t tier = 0; tier < windows_.size(); ++tier) {
+        auto window = windows_[tier];
+        tiers_.push_back(std::make_unique<TimeSeries>(
+            get_duration(window), tp, retention.get_num_buckets(window),
+            get_storage(tier)));
+        open_.push_back(tp);
     }
+
+    sketches_.resize(tiers_.size());
 }
 
 void TimeSeriesCollection::inc(TimePoint tp, uint64_t value) {
-    for (const auto &pair : coll_) {
-        const auto &ts = pair.second;
-        ts->inc(tp, value);
+    auto bucket_tp = advance(tp);
+    tiers_.front()->inc(bucket_tp, value);
+
+    // The coarser tiers get the sample when it is rolled up
+    sketches_.front().add(value);
+}
+
+void TimeSeriesCollection::spread(TimePoint tp, uint64_t value,
+                                  uint32_t num_buckets) {
+    auto interval = get_duration(windows_.front());
+    auto share = value / num_buckets;
+    auto rest = value % num_buckets;
+
+    // The oldest first, the rest goes to the latest ones
+    for (uint32_t i = num_buckets; i-- > 0;) {
+        inc(tp - interval * i, share + (i < rest ? 1 : 0));
     }
 }
 
+void TimeSeriesCollection::skip(TimePoint tp) { advance(tp); }
+
 TimeSeriesSlice
 TimeSeriesCollection::get_slice_from_point(AggregationWindow window,
                                            TimePoint tp, std::size_t len,
                                            Statistic stat) const {
-    const auto &ts = coll_.at(window);
-    return ts->get_slice_from_point(tp, len, stat);
+    auto tier = get_rolled_up_tier(window);
+    const auto &ts = tiers_[tier];
+
+    // The open buckets of the finer tiers have not been rolled up into this
+    // one yet, but they belong in its open bucket
+    auto slice = ts->get_slice_from_point(tp, len, stat, open_[tier],
+                                          get_pending(tier));
+
+    // The statistics over individual samples are rates over the sampling
+    // interval, not over the window. An average is over the samples that
+    // the bucket actually holds.
+    auto finest = get_duration(windows_.front());
+    if (stat == Statistic::AVERAGE) {
+        slice.set_coverage(U64(get_duration(window) / finest));
+    } else if (stat != Statistic::SUM) {
+        slice.set_rate_per_second(finest);
+    }
+
+    return slice;
+}
+
+Bucket TimeSeriesCollection::get_bucket(AggregationWindow window,
+                                        TimePoint tp) const {
+    const auto &ts = tiers_[get_rolled_up_tier(window)];
+    return ts->get_bucket(tp);
 }
 
 TimePoint TimeSeriesCollection::min(AggregationWindow window) const {
-    const auto &ts = coll_.at(window);
+    const auto &ts = tiers_[get_rolled_up_tier(window)];
     return ts->min();
 }
 
 TimePoint TimeSeriesCollection::max(AggregationWindow window) const {
-    const auto &ts = coll_.at(window);
-    return ts->max();
+    // The open bucket is the latest one, even if nothing was rolled up into
+    // it yet
+    return open_[get_rolled_up_tier(window)];
 }
 
 std::optional<TimePoint>
 TimeSeriesCollection::minus_one(AggregationWindow window, TimePoint tp) const {
-    const auto &ts = coll_.at(window);
+    const auto &ts = tiers_[get_rolled_up_tier(window)];
     return ts->minus_one(tp);
 }
 
 std::optional<TimePoint>
 TimeSeriesCollection::plus_one(AggregationWindow window, TimePoint tp) const {
-    const auto &ts = coll_.at(window);
+    const auto &ts = tiers_[get_rolled_up_tier(window)];
     return ts->plus_one(tp);
 }
 
+TimePoint TimeSeriesCollection::offset(AggregationWindow window, TimePoint tp,
+                                       std::ptrdiff_t num_buckets) const {
+    // The buckets all have the same duration, so there is no need to walk
+    // them
+    return clamp(window, tp + get_duration(window) * num_buckets);
+}
+
+TimePoint TimeSeriesCollection::clamp(AggregationWindow window,
+                                      TimePoint tp) const {
+    auto first = min(window);
+    auto last = max(window);
+
+    if (tp <= first) {
+        return first;
+    }
+    if (tp >= last) {
+        return last;
+    }
+
+    return tiers_[get_tier(window)]->floor(tp);
+}
+
+TimePoint TimeSeriesCollection::floor(AggregationWindow window,
+                                      TimePoint tp) const {
+    // every tier is keyed from the same start, nothing to roll up
+    return tiers_[get_tier(window)]->floor(tp);
+}
+
 std::size_t TimeSeriesCollection::size(AggregationWindow window) const {
-    const auto &ts = coll_.at(window);
+    const auto &ts = tiers_[get_rolled_up_tier(window)];
     return ts->size();
 }
 
+std::size_t TimeSeriesCollection::get_tier(AggregationWindow window) const {
+    auto it = std::find(windows_.begin(), windows_.end(), window);
+    if (it == windows_.end()) {
+        THROW_ARGS(std::out_of_range,
+                   "TimeSeriesCollection has no aggregation window: %s",
+                   get_label(window).c_str());
+    }
+
+    return SIZE_T(it - windows_.begin());
+}
+
+std::size_t
+TimeSeriesCollection::get_rolled_up_tier(AggregationWindow window) const {
+    auto tier = get_tier(window);
+    if (tier > 0) {
+        roll_up();
+    }
+
+    return tier;
+}
+
+TimePoint TimeSeriesCollection::advance(TimePoint tp) {
+    auto &finest = *tiers_.front();
+
+    // A late sample cannot go into a bucket that was already closed
+    auto bucket_tp = std::max(finest.floor(tp), open_.front());
+    if (bucket_tp == open_.front()) {
+        return bucket_tp;
+    }
+
+    close_bucket(0, bucket_tp);
+
+    // Writing the new bucket drops the ones that are a lap of the ring
+    // behind it, they have to be rolled up before that
+    auto lap_start = bucket_tp - get_duration(windows_.front()) *
+                                     (finest.capacity() - 1);
+    if (rolled_up_ < lap_start) {
+        roll_up();
+    }
+
+    return bucket_tp;
+}
+
+// A finest bucket is a single sample, bar the odd late one whose samples are
+// only known by their min, max and sum
+static void add_samples(const Bucket &bucket, QuantileSketch *sketch) {
+    if (bucket.count == 0) {
+        return;
+    }
+
+    sketch->add(bucket.min);
+    if (bucket.count == 1) {
+        return;
+    }
+
+    sketch->add(bucket.max);
+
+    auto num_rest = bucket.count - 2;
+    for (uint64_t i = 0; i < num_rest; ++i) {
+        sketch->add((bucket.sum - bucket.min - bucket.max) / num_rest);
+    }
+}
+
+void TimeSeriesCollection::roll_up() const {
+    if ((tiers_.size() == 1) || (rolled_up_ >= open_.front())) {
+        return;
+    }
+
+    // Only the stored keys can have anything in them, and none of those
+    // that fell off the ring are left to roll up
+    const auto &finest = *tiers_.front();
+    auto interval = get_duration(windows_.front());
+    auto first = std::max(rolled_up_, finest.min());
+    auto end = std::min(open_.front(), finest.max() + interval);
+
+    for (auto tp = first; tp < end; tp += interval) {
+        auto bucket = finest.get_bucket(tp);
+        for (std::size_t tier = 1; tier < sketches_.size(); ++tier) {
+            add_samples(bucket, &sketches_[tier]);
+        }
+
+        auto next = tp + interval < end ? tp + interval : open_.front();
+        merge_into(1, tp, bucket, next);
+    }
+
+    // Even with nothing to roll up the coarser buckets move on with the
+    // finest one
+    auto open = tiers_[1]->floor(open_.front());
+    if (open > open_[1]) {
+        close_bucket(1, open);
+    }
+
+    rolled_up_ = open_.front();
+}
+
+void TimeSeriesCollection::merge_into(std::size_t tier, TimePoint tp,
+                                      const Bucket &bucket,
+                                      TimePoint next) const {
+    auto &ts = *tiers_[tier];
+    ts.merge(tp, bucket);
+
+    // If the next bucket of the finer tier is in a new bucket of this one
+    // then this one closes
+    auto open = ts.floor(next);
+    if (open > open_[tier]) {
+        close_bucket(tier, open);
+    }
+}
+
+void TimeSeriesCollection::close_bucket(std::size_t tier,
+                                        TimePoint next_open) const {
+    auto closed = open_[tier];
+    open_[tier] = next_open;
+
+    auto &sketch = sketches_[tier];
+    if (!sketch.empty()) {
+        auto key = tiers_[tier]->calculate_key(closed);
+        auto closed_bucket = tiers_[tier]->get_key(key);
+        closed_bucket.p95 = sketch.get_percentile(95);
+        closed_bucket.p99 = sketch.get_percentile(99);
+        tiers_[tier]->set_key(key, closed_bucket);
+        sketch.clear();
+    }
+
+    // The finest tier is rolled up lazily, by roll_up()
+    if ((tier == 0) || (tier + 1 == tiers_.size())) {
+        return;
+    }
+
+    // Roll the closed bucket up into the open bucket of the next tier
+    merge_into(tier + 1, closed, tiers_[tier]->get_bucket(closed), next_open);
+}
+
+void TimeSeriesCollection::encode(tools::ByteWriter *writer) const {
+    roll_up();
+    writer->put_u32(U32(tiers_.size()));
+
+    for (std::size_t tier = 0; tier < tiers_.size(); ++tier) {
+        writer->put_u64(U64(windows_[tier]));
+        writer->put_i64(tools::to_nanos(open_[tier]));
+        tiers_[tier]->encode(writer);
+    }
+}
+
+std::unique_ptr<TimeSeriesCollection>
+TimeSeriesCollection::decode(tools::ByteReader *reader) {
+    // the default constructor is private
+    std::unique_ptr<TimeSeriesCollection> coll{new TimeSeriesCollection{}};
+
+    auto num_tiers = reader->get_u32();
+    if (num_tiers == 0) {
+        THROW_MSG(std::runtime_error,
+                  "TimeSeriesCollection.decode got no tiers");
+    }
+
+    for (uint32_t tier = 0; tier < num_tiers; ++tier) {
+        auto window = static_cast<AggregationWindow>(reader->get_u64());
+        auto open = tools::from_nanos(reader->get_i64());
+        auto ts = TimeSeries::decode(reader, get_storage(tier));
+
+        if (ts->aggregation_window() != window) {
+            THROW_MSG(std::runtime_error,
+                      "TimeSeriesCollection.decode got mismatched tiers");
+        }
+
+        coll->windows_.push_back(window);
+        coll->open_.push_back(open);
+        coll->tiers_.push_back(std::move(ts));
+    }
+
+    // everything was rolled up before it was encoded
+    coll->sketches_.resize(coll->tiers_.size());
+    coll->rolled_up_ = coll->open_.front();
+    return coll;
+}
+
+std::size_t TimeSeriesCollection::get_image_size() const {
+    std::size_t size = sizeof(uint64_t);
+
+    for (const auto &ts : tiers_) {
+        size += sizeof(TierImage) + ts->get_image_size();
+    }
+
+    return size;
+}
+
+void TimeSeriesCollection::write_image(char *image) const {
+    roll_up();
+    *reinterpret_cast<uint64_t *>(image) = tiers_.size();
+    image += sizeof(uint64_t);
+
+    for (std::size_t tier = 0; tier < tiers_.size(); ++tier) {
+        auto *header = reinterpret_cast<TierImage *>(image);
+        header->window_ms = U64(windows_[tier]);
+        header->open_ns = tools::to_nanos(open_[tier]);
+        image += sizeof(*header);
+
+        tiers_[tier]->write_image(image);
+        image += tiers_[tier]->get_image_size();
+    }
+}
+
+std::unique_ptr<TimeSeriesCollection>
+TimeSeriesCollection::read_image(const char *image, std::size_t len) {
+    // the default constructor is private
+    std::unique_ptr<TimeSeriesCollection> coll{new TimeSeriesCollection{}};
+
+    if (len < sizeof(uint64_t)) {
+        THROW_MSG(std::runtime_error,
+                  "TimeSeriesCollection.read_image: image too short");
+    }
+
+    auto num_tiers = *reinterpret_cast<const uint64_t *>(image);
+    std::size_t pos = sizeof(uint64_t);
+
+    if (num_tiers == 0) {
+        THROW_MSG(std::runtime_error,
+                  "TimeSeriesCollection.read_image got no tiers");
+    }
+
+    for (uint64_t tier = 0; tier < num_tiers; ++tier) {
+        if (len - pos < sizeof(TierImage)) {
+            THROW_MSG(std::runtime_error,
+                      "TimeSeriesCollection.read_image: image too short");
+        }
+
+        const auto *header = reinterpret_cast<const TierImage *>(image + pos);
+        auto window = static_cast<AggregationWindow>(header->window_ms);
+        auto open = tools::from_nanos(header->open_ns);
+        pos += sizeof(*header);
+
+        auto ts =
+            TimeSeries::read_image(image + pos, len - pos, get_storage(tier));
+        pos += ts->get_image_size();
+
+        if (ts->aggregation_window() != window) {
+            THROW_MSG(std::runtime_error,
+                      "TimeSeriesCollection.read_image got mismatched tiers");
+        }
+
+        coll->windows_.push_back(window);
+        coll->open_.push_back(open);
+        coll->tiers_.push_back(std::move(ts));
+    }
+
+    // everything was rolled up before it was encoded
+    coll->sketches_.resize(coll->tiers_.size());
+    coll->rolled_up_ = coll->open_.front();
+    return coll;
+}
+
+BucketStorage TimeSeriesCollection::get_storage(std::size_t tier) {
+    // The finest tier has a bucket per sample, the others aggregate them
+    return tier == 0 ? BucketStorage::PACKED : BucketStorage::FULL;
+}
+
+Bucket TimeSeriesCollection::get_pending(std::size_t tier) const {
+    Bucket pending{};
+
+    for (std::size_t finer = 0; finer < tier; ++finer) {
+        pending.merge(tiers_[finer]->get_bucket(open_[finer]));
+    }
+
+    // The sketch covers the whole open bucket, bar the finest open bucket
+    // that is not rolled up yet. Without one, eg. after the collection was
+    // decoded, the max is the best we have.
+    auto open = tiers_[tier]->get_bucket(open_[tier]);
+    if (sketches_[tier].empty() && (open.count > 0)) {
+        pending.p95 = std::max(pending.max, open.max);
+        pending.p99 = pending.p95;
+    } else if (tier == 0) {
+        pending.p95 = sketches_[tier].get_percentile(95);
+        pending.p99 = sketches_[tier].get_percentile(99);
+    } else {
+        auto sketch = sketches_[tier];
+        add_samples(tiers_.front()->get_bucket(open_.front()), &sketch);
+        pending.p95 = sketch.get_percentile(95);
+        pending.p99 = sketch.get_percentile(99);
+    }
+
+    return pending;
+}
+
 } // namespace sampling
 } // namespace bandwit
\ No newline at end of file
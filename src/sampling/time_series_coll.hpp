@@ -3,27 +3,71 @@
 
 #include <memory>
 #include <unistd.h>
-#include <unordered_map>
 #include <vector>
 
 #include "aliases.hpp"
+#include "quantile_sketch.hpp"
 #include "sampling/agg_window.hpp"
+#include "sampling/retention.hpp"
 #include "sampling/statistic.hpp"
 #include "sampling/time_series_slice.hpp"
 #include "time_series.hpp"
+#include "tools/byte_stream.hpp"
 
 namespace bandwit {
 namespace sampling {
 
+// The flat image of a TimeSeriesCollection starts with the number of tiers.
+// Each tier is a TierImage followed by the image of its TimeSeries.
+struct TierImage {
+    uint64_t window_ms;
+    int64_t open_ns;
+};
+
+// One TimeSeries per aggregation window, finest first. Samples are only
+// written to the finest series. The closed buckets of the finest series are
+// rolled up into the next coarser series, and so on, so the coarser series
+// cascade from the finest one.
+//
+// The roll up is lazy: it only happens once a coarser series is looked at,
+// or once the finest buckets that were not rolled up yet are about to fall
+// off its ring. Sampling into a collection that is only ever viewed at the
+// finest window does not touch the coarser series at all. How far the finest
+// series was rolled up is kept, so each bucket is only rolled up once.
+//
+// Percentiles cannot be rolled up. Instead every tier keeps a sketch of the
+// samples in its open bucket, and the percentiles are stored into the bucket
+// when it closes. Only the open buckets have a sketch, so it is not part of
+// the encoding or the image, and a decoded collection shows the max as the
+// percentiles of its open buckets.
+//
+// The buckets of the finest tier are packed, since they only ever hold a
+// single sample, bar the odd late one.
 class TimeSeriesCollection {
   public:
-    explicit TimeSeriesCollection(
-        TimePoint tp, const std::vector<AggregationWindow> &windows);
+    TimeSeriesCollection(TimePoint tp,
+                         const std::vector<AggregationWindow> &windows,
+                         const Retention &retention = Retention{});
 
     void inc(TimePoint tp, uint64_t value);
+
+    // Spreads the value of a sample that covers num_buckets intervals
+    // evenly over their finest buckets, up to the one for tp. The shares add
+    // up to the value, so every coarser bucket that holds all of them gets
+    // it exactly.
+    void spread(TimePoint tp, uint64_t value, uint32_t num_buckets);
+
+    // Moves on to the bucket for tp without a sample in it, for a sample
+    // whose value is not known. A bucket with only gaps in it is empty.
+    void skip(TimePoint tp);
+
     TimeSeriesSlice get_slice_from_point(AggregationWindow window, TimePoint tp,
                                          std::size_t len, Statistic stat) const;
 
+    // The bucket of the window that tp falls into. Only complete once the
+    // bucket has closed, ie. tp is before max(window).
+    Bucket get_bucket(AggregationWindow window, TimePoint tp) const;
+
     TimePoint min(AggregationWindow window) const;
     TimePoint max(AggregationWindow window) const;
     std::optional<TimePoint> minus_one(AggregationWindow window,
@@ -31,10 +75,68 @@ class TimeSeriesCollection {
     std::optional<TimePoint> plus_one(AggregationWindow window,
                                       TimePoint tp) const;
 
+    // The bucket num_buckets away from the one tp falls into, or the oldest
+    // or the latest bucket if that is out of range. Jumps any distance in
+    // one go.
+    TimePoint offset(AggregationWindow window, TimePoint tp,
+                     std::ptrdiff_t num_buckets) const;
+
+    // the bucket tp falls into, or the nearest bucket there is
+    TimePoint clamp(AggregationWindow window, TimePoint tp) const;
+
+    // The start of the bucket of the window that tp falls into, whether it
+    // is kept or not
+    TimePoint floor(AggregationWindow window, TimePoint tp) const;
+
     std::size_t size(AggregationWindow window) const;
 
+    void encode(tools::ByteWriter *writer) const;
+    static std::unique_ptr<TimeSeriesCollection>
+    decode(tools::ByteReader *reader);
+
+    std::size_t get_image_size() const;
+    void write_image(char *image) const;
+    static std::unique_ptr<TimeSeriesCollection>
+    read_image(const char *image, std::size_t len);
+
   private:
-    std::unordered_map<AggregationWindow, std::unique_ptr<TimeSeries>> coll_{};
+    TimeSeriesCollection() = default;
+
+    static BucketStorage get_storage(std::size_t tier);
+
+    std::size_t get_tier(AggregationWindow window) const;
+
+    // The tier of the window, with everything rolled up into it. Every
+    // accessor of a coarser tier goes through this.
+    std::size_t get_rolled_up_tier(AggregationWindow window) const;
+
+    // closes the finest bucket if tp is past it and returns the one it goes
+    // into
+    TimePoint advance(TimePoint tp);
+
+    // Rolls the closed finest buckets that were not rolled up yet up into
+    // the coarser tiers. It only updates what is derived from the finest
+    // tier, so it is done on demand from the const accessors too.
+    void roll_up() const;
+    void merge_into(std::size_t tier, TimePoint tp, const Bucket &bucket,
+                    TimePoint next) const;
+    void close_bucket(std::size_t tier, TimePoint next_open) const;
+
+    Bucket get_pending(std::size_t tier) const;
+
+    std::vector<AggregationWindow> windows_{};
+    std::vector<std::unique_ptr<TimeSeries>> tiers_{};
+
+    // The start of the bucket in each tier that is still open, ie. that has
+    // not been rolled up into the next tier yet. Past the finest tier they
+    // are only up to date after a roll_up().
+    mutable std::vector<TimePoint> open_{};
+
+    // the samples in the open bucket of each tier
+    mutable std::vector<QuantileSketch> sketches_{};
+
+    // the finest buckets before this have been rolled up
+    mutable TimePoint rolled_up_{};
 };
 
 } // namespace sampling
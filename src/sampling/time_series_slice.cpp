@@ -0,0 +1,90 @@
+#include <algorithm>
+
+#include "macros.hpp"
+#include "sampling/time_series_slice.hpp"
+#include "time_series.hpp"
+
+namespace bandwit {
+namespace sampling {
+
+TimeSeriesSlice::TimeSeriesSlice(const TimeSeries *series,
+                                 std::size_t first_key, std::size_t len,
+                                 TimePoint start, AggregationWindow agg_win)
+    : agg_window{agg_win}, series_{series}, first_key_{first_key}, len_{len},
+      start_{start} {}
+
+void TimeSeriesSlice::set_field(uint64_t Bucket::*field) { field_ = field; }
+
+void TimeSeriesSlice::set_pending(std::size_t index, const Bucket &bucket) {
+    pending_index_ = index;
+    pending_ = bucket;
+}
+
+void TimeSeriesSlice::set_recorded(std::size_t first, std::size_t end) {
+    first_recorded_ = first;
+    end_recorded_ = end;
+}
+
+void TimeSeriesSlice::set_coverage(uint64_t num_samples) {
+    num_samples_ = num_samples;
+}
+
+void TimeSeriesSlice::set_rate(uint64_t multiplier, uint64_t divisor) {
+    multiplier_ = multiplier;
+    divisor_ = divisor;
+}
+
+void TimeSeriesSlice::set_rate_per_second(Millis interval) {
+    // divide intervals longer than a second, multiply the shorter ones
+    auto interval_ms = U64(interval.count());
+    if (interval_ms >= 1000) {
+        set_rate(1, interval_ms / 1000);
+    } else {
+        set_rate(1000 / interval_ms, 1);
+    }
+}
+
+uint64_t TimeSeriesSlice::get_value(std::size_t i) const {
+    auto bucket = get_bucket(i);
+    auto value = bucket.*field_;
+    if ((bucket.count == 0) || (bucket.count >= num_samples_)) {
+        return value;
+    }
+
+    // value * num_samples_ / count without overflowing on the way
+    return value / bucket.count * num_samples_ +
+           value % bucket.count * num_samples_ / bucket.count;
+}
+
+bool TimeSeriesSlice::is_gap(std::size_t i) const {
+    return !is_blank(i) && !is_pending(i) && (get_bucket(i).count == 0);
+}
+
+bool TimeSeriesSlice::is_blank(std::size_t i) const {
+    return i < first_recorded_;
+}
+
+bool TimeSeriesSlice::is_pending(std::size_t i) const {
+    return i >= end_recorded_;
+}
+
+uint64_t TimeSeriesSlice::get_max_value() const {
+    uint64_t max_value{0};
+
+    for (std::size_t i = 0; i < len_; ++i) {
+        max_value = std::max(max_value, get_value(i));
+    }
+
+    return max_value;
+}
+
+Bucket TimeSeriesSlice::get_bucket(std::size_t i) const {
+    if (i == pending_index_) {
+        return pending_;
+    }
+
+    return series_->get_key(first_key_ + i);
+}
+
+} // namespace sampling
+} // namespace bandwit
@@ -0,0 +1,81 @@
+#include <stdexcept>
+
+#include "client.hpp"
+#include "except.hpp"
+
+namespace bandwit {
+namespace service {
+
+Client::Client(const std::string &socket_path)
+    : conn_{connect_unix(socket_path)} {
+    MessageType type{};
+    std::string_view payload{};
+    conn_->receive_frame(&reader_, &type, &payload);
+
+    if (type != MessageType::SNAPSHOT) {
+        THROW_MSG(std::runtime_error,
+                  "Client: expected a snapshot from the daemon");
+    }
+
+    history_ = parse_snapshot(payload, &interval_);
+
+    // The snapshot may have arrived together with the first ticks
+    while (reader_.next(&type, &payload)) {
+        if (type == MessageType::TICK) {
+            apply_tick(payload);
+        }
+    }
+
+    // from now on we only read what the event loop says is there
+    conn_->set_nonblocking();
+}
+
+int Client::get_fd() const { return conn_->get_fd(); }
+
+Millis Client::get_interval() const { return interval_; }
+
+const sampling::History &Client::get_history() const { return *history_; }
+
+bool Client::receive() {
+    if (!conn_->receive(&reader_)) {
+        THROW_MSG(std::runtime_error, "Client.receive: the daemon went away");
+    }
+
+    bool is_changed = false;
+    changed_ifaces_.clear();
+
+    MessageType type{};
+    std::string_view payload{};
+    while (reader_.next(&type, &payload)) {
+        // Unknown messages are skipped, so a newer daemon can send more
+        if (type == MessageType::TICK) {
+            apply_tick(payload);
+            is_changed = true;
+        }
+    }
+
+    return is_changed;
+}
+
+const std::vector<std::size_t> &Client::get_changed_ifaces() const {
+    return changed_ifaces_;
+}
+
+void Client::apply_tick(std::string_view payload) {
+    parse_tick(payload, history_->get_quantities(), &tick_);
+
+    if (tick_.deltas.size() != history_->num_ifaces()) {
+        THROW_MSG(std::runtime_error,
+                  "Client.apply_tick: tick does not match the ifaces");
+    }
+
+    for (std::size_t i = 0; i < tick_.deltas.size(); ++i) {
+        history_->record(i, tick_.tp, tick_.deltas[i]);
+        if (tick_.deltas[i].num_intervals != 0) {
+            changed_ifaces_.push_back(i);
+        }
+    }
+}
+
+} // namespace service
+} // namespace bandwit
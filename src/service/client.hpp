@@ -0,0 +1,54 @@
+#ifndef CLIENT_H
+#define CLIENT_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "protocol.hpp"
+#include "sampling/history.hpp"
+#include "service/unix_socket.hpp"
+
+namespace bandwit {
+namespace service {
+
+// Attaches to a Daemon and keeps a copy of its history up to date
+class Client {
+  public:
+    // Blocks until the daemon has sent the snapshot of its history
+    explicit Client(const std::string &socket_path);
+
+    CLASS_DISABLE_COPIES(Client)
+    CLASS_DISABLE_MOVES(Client)
+
+    // readable when there are ticks to receive
+    int get_fd() const;
+
+    Millis get_interval() const;
+    const sampling::History &get_history() const;
+
+    // Applies the ticks that have arrived to the history. Returns whether
+    // there were any, and throws if the daemon went away.
+    bool receive();
+    // The ifaces that got a sample in the last receive(), an iface may be
+    // in it more than once
+    const std::vector<std::size_t> &get_changed_ifaces() const;
+
+  private:
+    void apply_tick(std::string_view payload);
+
+    std::unique_ptr<Connection> conn_{nullptr};
+    FrameReader reader_{};
+    Tick tick_{};
+    std::vector<std::size_t> changed_ifaces_{};
+
+    Millis interval_{};
+    std::unique_ptr<sampling::History> history_{nullptr};
+};
+
+} // namespace service
+} // namespace bandwit
+
+#endif // CLIENT_H
@@ -0,0 +1,248 @@
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+
+#include "daemon.hpp"
+#include "protocol.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/sampler_detector.hpp"
+#include "sampling/snapshot.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace service {
+
+// A client that falls this far behind on the ticks, on top of the snapshot
+// it starts with, is dropped rather than queued for without bound
+constexpr std::size_t MAX_BACKLOG_LEN = 1024 * 1024;
+
+Daemon::Daemon(const std::vector<std::string> &iface_names,
+               const DaemonConfig &config)
+    : interval_{config.interval}, snapshot_path_{config.snapshot_path} {
+    sampling::SamplerDetector detector{};
+    auto det_result = detector.detect_sampler(iface_names, config.quantities);
+
+    // Clients that go away are noticed as failed sends, not as a SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+
+    event_loop_ = std::make_unique<tools::EventLoop>();
+    event_loop_->watch_signal(SIGINT);
+    event_loop_->watch_signal(SIGTERM);
+
+    listener_ = std::make_unique<UnixListener>(config.socket_path);
+    event_loop_->watch_fd(listener_->get_fd());
+
+    // The time series are keyed on the scheduler's deadlines, so both have
+    // to start at the same point in time
+    auto start = SteadyClock::now();
+    scheduler_ =
+        std::make_unique<tools::DeadlineScheduler>(config.interval, start);
+
+    auto windows = sampling::get_windows_for_interval(config.interval);
+    auto counter_bits = det_result.sampler->get_counter_bits();
+    recorder_ = std::make_unique<sampling::Recorder>(
+        std::move(det_result.sampler), counter_bits, iface_names,
+        std::move(det_result.samples),
+        tools::MonotonicClock::from_steady(start), windows, config.retention,
+        config.quantities);
+
+    max_queued_len_ = recorder_->get_history().get_image_size() +
+                      MAX_BACKLOG_LEN;
+
+    if (!config.history_dir.empty()) {
+        recorder_->open_history_files(config.history_dir, config.interval);
+    }
+
+    if (!snapshot_path_.empty()) {
+        recorder_->restore_snapshot(snapshot_path_, config.interval);
+        event_loop_->watch_signal(SIGUSR1);
+    }
+
+    // of the history as it was restored
+    if (config.adaptive_threshold.has_value()) {
+        recorder_->set_adaptive(tools::MonotonicClock::from_steady(start),
+                                config.interval,
+                                config.adaptive_threshold.value());
+    }
+
+    if (!config.shm_name.empty()) {
+        publisher_ = std::make_unique<ShmPublisher>(
+            config.shm_name, config.interval, recorder_->get_history());
+    }
+
+    if (!config.metrics_address.empty()) {
+        metrics_server_ = std::make_unique<MetricsServer>(
+            config.metrics_address, windows, event_loop_.get());
+    }
+
+    if (!config.serve_address.empty()) {
+        remote_server_ = std::make_unique<RemoteServer>(
+            config.serve_address, config.interval,
+            tools::MonotonicClock::from_steady(start),
+            recorder_->get_history(), event_loop_.get());
+    }
+}
+
+void Daemon::run_forever() {
+    tools::Events events{};
+    event_loop_->set_deadline(scheduler_->get_deadline());
+
+    while (true) {
+        event_loop_->wait(&events);
+
+        if (!events.signals.empty()) {
+            bool is_stopping = std::any_of(
+                events.signals.begin(), events.signals.end(),
+                [](int signo) { return signo != SIGUSR1; });
+
+            if (!snapshot_path_.empty()) {
+                take_snapshot(is_stopping);
+            }
+
+            if (is_stopping) {
+                return;
+            }
+        }
+
+        auto now = SteadyClock::now();
+        if (scheduler_->is_due(now)) {
+            take_sample(now);
+        }
+
+        for (auto fd : events.ready_fds) {
+            if (fd == listener_->get_fd()) {
+                accept_client();
+            } else if ((metrics_server_ != nullptr) &&
+                       metrics_server_->handle(fd, now)) {
+                continue;
+            } else if ((remote_server_ != nullptr) &&
+                       remote_server_->handle(fd, now)) {
+                continue;
+            } else {
+                flush_client(fd);
+            }
+        }
+    }
+}
+
+void Daemon::take_sample(SteadyTimePoint now) {
+    // Record the sample in the bucket of the deadline it was taken for, not
+    // the time we actually got around to it
+    auto tp = tools::MonotonicClock::from_steady(scheduler_->get_deadline());
+    recorder_->sample(tp);
+
+    scheduler_->advance(now);
+    event_loop_->set_deadline(scheduler_->get_deadline());
+
+    if (publisher_ != nullptr) {
+        publisher_->publish(recorder_->get_history());
+    }
+
+    if (metrics_server_ != nullptr) {
+        metrics_server_->update(*recorder_);
+        metrics_server_->expire(now);
+    }
+
+    if (remote_server_ != nullptr) {
+        remote_server_->publish(tp, recorder_->get_deltas(), now);
+    }
+
+    if (clients_.empty()) {
+        return;
+    }
+
+    frame_.clear();
+    append_tick(tp, recorder_->get_history().get_quantities(),
+                recorder_->get_deltas(), &frame_);
+
+    // Nobody is waited for, a client that cannot take the tick right away
+    // gets it queued
+    std::vector<int> failed_fds{};
+    for (const auto &client : clients_) {
+        bool was_queued = client->get_queued_size() > 0;
+        if ((client->get_queued_size() + frame_.size() > max_queued_len_) ||
+            !client->queue(frame_)) {
+            failed_fds.push_back(client->get_fd());
+        } else if (!was_queued) {
+            watch_client(*client);
+        }
+    }
+
+    for (auto fd : failed_fds) {
+        drop_client(fd);
+    }
+}
+
+void Daemon::take_snapshot(bool is_stopping) {
+    if (is_stopping) {
+        sampling::write_snapshot(snapshot_path_, interval_,
+                                 recorder_->get_history());
+        return;
+    }
+
+    try {
+        sampling::write_snapshot(snapshot_path_, interval_,
+                                 recorder_->get_history());
+    } catch (std::runtime_error &e) {
+        std::cerr << e.what() << "\n";
+    }
+
+    // Sampling stalls while the snapshot is written. A SIGUSR1 that arrived
+    // meanwhile asked for what it holds already.
+    event_loop_->discard_signal(SIGUSR1);
+}
+
+void Daemon::accept_client() {
+    auto client = listener_->accept_connection();
+    client->set_nonblocking();
+
+    frame_.clear();
+    append_snapshot(interval_, recorder_->get_history(), &frame_);
+
+    if (!client->queue(frame_)) {
+        return;
+    }
+
+    watch_client(*client);
+    clients_.push_back(std::move(client));
+}
+
+void Daemon::flush_client(int fd) {
+    auto it = std::find_if(
+        clients_.begin(), clients_.end(),
+        [fd](const auto &client) { return client->get_fd() == fd; });
+    if (it == clients_.end()) {
+        return;
+    }
+
+    // Clients never send anything, so readable means gone
+    auto &client = *it;
+    if ((client->get_queued_size() == 0) || !client->flush()) {
+        drop_client(fd);
+        return;
+    }
+
+    if (client->get_queued_size() == 0) {
+        watch_client(*client);
+    }
+}
+
+void Daemon::watch_client(const Connection &client) {
+    auto events = client.get_queued_size() > 0 ? POLLOUT : POLLIN;
+    event_loop_->watch_fd(client.get_fd(), events);
+}
+
+void Daemon::drop_client(int fd) {
+    event_loop_->unwatch_fd(fd);
+
+    clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                  [fd](const auto &client) {
+                                      return client->get_fd() == fd;
+                                  }),
+                   clients_.end());
+}
+
+} // namespace service
+} // namespace bandwit
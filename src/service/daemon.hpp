@@ -0,0 +1,102 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/quantity.hpp"
+#include "sampling/recorder.hpp"
+#include "sampling/retention.hpp"
+#include "service/metrics_server.hpp"
+#include "service/remote_server.hpp"
+#include "service/shm_segment.hpp"
+#include "service/unix_socket.hpp"
+#include "tools/deadline_scheduler.hpp"
+#include "tools/event_loop.hpp"
+
+namespace bandwit {
+namespace service {
+
+struct DaemonConfig {
+    Millis interval{1000};
+    std::string socket_path{};
+    sampling::Retention retention{};
+    std::vector<sampling::Quantity> quantities{sampling::Quantity::BYTES};
+
+    // Optional, each is off when empty
+    std::string shm_name{};
+    std::string history_dir{};
+    std::string metrics_address{};
+    std::string serve_address{};
+    std::string snapshot_path{};
+    // back off on the ifaces that count fewer bytes a second than this
+    std::optional<uint64_t> adaptive_threshold{};
+};
+
+// Samples the ifaces on a schedule without a terminal and serves the history
+// to clients that attach over a unix socket. Each client gets a snapshot of
+// the history when it connects and a tick after every sample from then on,
+// so it can keep an identical copy of the history and render it itself.
+// Sampling never waits for a client: what its socket cannot take right away
+// is queued, and a client that falls too far behind is dropped.
+//
+// With a history_dir the history is kept in files there and survives
+// restarts. With a shm_name the history is also published into a shared
+// memory segment, which viewers map and read without the daemon doing any
+// work per viewer. With a metrics_address the counters and rates are served
+// to Prometheus. With a serve_address the deltas of every sample are
+// streamed to viewers on other hosts. With a snapshot_path the history is
+// restored from the snapshot there, and a snapshot is taken on SIGUSR1 and
+// on the way out. With an adaptive_threshold it backs off on the ifaces that
+// are idle.
+class Daemon {
+  public:
+    Daemon(const std::vector<std::string> &iface_names,
+           const DaemonConfig &config);
+
+    CLASS_DISABLE_COPIES(Daemon)
+    CLASS_DISABLE_MOVES(Daemon)
+
+    // Returns on SIGINT or SIGTERM
+    void run_forever();
+
+  private:
+    void take_sample(SteadyTimePoint now);
+    // One that is asked for and fails is reported and sampling carries on,
+    // the one on the way out throws
+    void take_snapshot(bool is_stopping);
+    void accept_client();
+    // sends more of what is queued for the client at fd, once it has room
+    void flush_client(int fd);
+    // for room in its socket while it has frames queued, for it going away
+    // otherwise
+    void watch_client(const Connection &client);
+    void drop_client(int fd);
+
+    Millis interval_{};
+    std::string snapshot_path_{};
+
+    std::unique_ptr<UnixListener> listener_{nullptr};
+    std::vector<std::unique_ptr<Connection>> clients_{};
+    // a snapshot and MAX_BACKLOG_LEN of ticks
+    std::size_t max_queued_len_{0};
+
+    // reused for every frame that goes out
+    std::string frame_{};
+
+    std::unique_ptr<sampling::Recorder> recorder_{nullptr};
+    std::unique_ptr<ShmPublisher> publisher_{nullptr};
+    std::unique_ptr<MetricsServer> metrics_server_{nullptr};
+    std::unique_ptr<RemoteServer> remote_server_{nullptr};
+    std::unique_ptr<tools::DeadlineScheduler> scheduler_{nullptr};
+    std::unique_ptr<tools::EventLoop> event_loop_{nullptr};
+};
+
+} // namespace service
+} // namespace bandwit
+
+#endif // DAEMON_H
@@ -0,0 +1,165 @@
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "exporter.hpp"
+#include "sampling/counter_delta.hpp"
+#include "sampling/sampler_detector.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace service {
+
+Exporter::Exporter(const std::vector<std::string> &iface_names,
+                   Millis interval, ExportFormat format,
+                   const std::string &path,
+                   std::optional<sampling::AggregationWindow> window,
+                   const sampling::Retention &retention,
+                   const std::vector<sampling::Quantity> &quantities)
+    : window_{window} {
+    sampling::SamplerDetector detector{};
+    auto det_result = detector.detect_sampler(iface_names, quantities);
+
+    fd_ = STDOUT_FILENO;
+    if (!path.empty()) {
+        fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                   0644);
+        if (fd_ < 0) {
+            THROW_ARGS(std::runtime_error, "Exporter failed to open %s: %s",
+                       path.c_str(), strerror(errno));
+        }
+        is_own_fd_ = true;
+    }
+
+    // A reader that goes away is noticed as EPIPE, not as a SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+
+    event_loop_ = std::make_unique<tools::EventLoop>();
+    event_loop_->watch_signal(SIGINT);
+    event_loop_->watch_signal(SIGTERM);
+
+    // The time series are keyed on the scheduler's deadlines, so both have
+    // to start at the same point in time
+    auto start = SteadyClock::now();
+    scheduler_ = std::make_unique<tools::DeadlineScheduler>(interval, start);
+
+    auto counter_bits = det_result.sampler->get_counter_bits();
+    recorder_ = std::make_unique<sampling::Recorder>(
+        std::move(det_result.sampler), counter_bits, iface_names,
+        std::move(det_result.samples),
+        tools::MonotonicClock::from_steady(start),
+        sampling::get_windows_for_interval(interval), retention, quantities);
+
+    if (window_.has_value()) {
+        open_ = recorder_->get_history().get_rx(0).max(window_.value());
+    }
+
+    auto record_window =
+        window_.has_value() ? sampling::get_duration(window_.value())
+                            : interval;
+    encoder_ =
+        make_record_encoder(format, iface_names, quantities, record_window);
+
+    writer_ = std::make_unique<tools::FdWriter>(fd_);
+    encoder_->append_header(writer_->get_buffer());
+}
+
+Exporter::~Exporter() {
+    if (is_own_fd_) {
+        close(fd_);
+    }
+}
+
+void Exporter::run_forever() {
+    tools::Events events{};
+    event_loop_->set_deadline(scheduler_->get_deadline());
+
+    // the header goes out straight away
+    if (!writer_->flush()) {
+        return;
+    }
+
+    while (true) {
+        event_loop_->wait(&events);
+
+        if (!events.signals.empty()) {
+            return;
+        }
+
+        auto now = SteadyClock::now();
+        if (scheduler_->is_due(now) && !take_sample(now)) {
+            return;
+        }
+    }
+}
+
+bool Exporter::take_sample(SteadyTimePoint now) {
+    // Record the sample in the bucket of the deadline it was taken for, not
+    // the time we actually got around to it
+    auto tp = tools::MonotonicClock::from_steady(scheduler_->get_deadline());
+    recorder_->sample(tp);
+
+    scheduler_->advance(now);
+    event_loop_->set_deadline(scheduler_->get_deadline());
+
+    if (window_.has_value()) {
+        append_closed_buckets();
+    } else {
+        append_samples(tp);
+    }
+
+    // One write for all the ifaces
+    return writer_->flush();
+}
+
+void Exporter::append_samples(TimePoint tp) {
+    const auto &deltas = recorder_->get_deltas();
+
+    for (std::size_t i = 0; i < deltas.size(); ++i) {
+        encoder_->append_record(ExportRecord{tp, i, deltas[i]},
+                                writer_->get_buffer());
+    }
+}
+
+// A bucket of nothing but gaps is a gap too, rather than a bucket of 0 bytes
+static uint64_t get_bucket_count(const sampling::Bucket &bucket) {
+    return bucket.count > 0 ? bucket.sum : sampling::GAP_DELTA;
+}
+
+void Exporter::append_closed_buckets() {
+    const auto &history = recorder_->get_history();
+    auto window = window_.value();
+
+    // Every iface is sampled at the same time, so the buckets of all of them
+    // close together
+    auto open = history.get_rx(0).max(window);
+    if (open <= open_) {
+        return;
+    }
+
+    // Several buckets close at once after a stall, and each of them gets
+    // its records
+    auto duration = sampling::get_duration(window);
+    for (auto closed = open_; closed < open; closed += duration) {
+        for (std::size_t i = 0; i < history.num_ifaces(); ++i) {
+            ExportRecord record{closed, i, {}};
+            for (auto qtty : history.get_quantities()) {
+                auto idx = SIZE_T(qtty);
+                record.delta.rx.values[idx] = get_bucket_count(
+                    history.get_rx(i, qtty).get_bucket(window, closed));
+                record.delta.tx.values[idx] = get_bucket_count(
+                    history.get_tx(i, qtty).get_bucket(window, closed));
+            }
+            encoder_->append_record(record, writer_->get_buffer());
+        }
+    }
+
+    open_ = open;
+}
+
+} // namespace service
+} // namespace bandwit
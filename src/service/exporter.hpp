@@ -0,0 +1,66 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "record_encoder.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/quantity.hpp"
+#include "sampling/recorder.hpp"
+#include "sampling/retention.hpp"
+#include "tools/deadline_scheduler.hpp"
+#include "tools/event_loop.hpp"
+#include "tools/fd_writer.hpp"
+
+namespace bandwit {
+namespace service {
+
+// Samples the ifaces on a schedule and streams the deltas as records,
+// without a terminal. With a window it streams one record per iface for
+// every bucket of that window as it closes, instead of one per sample.
+class Exporter {
+  public:
+    // An empty path is stdout
+    Exporter(const std::vector<std::string> &iface_names, Millis interval,
+             ExportFormat format, const std::string &path,
+             std::optional<sampling::AggregationWindow> window,
+             const sampling::Retention &retention,
+             const std::vector<sampling::Quantity> &quantities);
+    ~Exporter();
+
+    CLASS_DISABLE_COPIES(Exporter)
+    CLASS_DISABLE_MOVES(Exporter)
+
+    // Returns on SIGINT or SIGTERM, or when the reader of a pipe goes away
+    void run_forever();
+
+  private:
+    // Returns false if the reader went away
+    bool take_sample(SteadyTimePoint now);
+    void append_samples(TimePoint tp);
+    void append_closed_buckets();
+
+    std::optional<sampling::AggregationWindow> window_{};
+
+    // the open bucket of window_
+    TimePoint open_{};
+
+    int fd_{-1};
+    bool is_own_fd_{false};
+    std::unique_ptr<tools::FdWriter> writer_{nullptr};
+    std::unique_ptr<RecordEncoder> encoder_{nullptr};
+
+    std::unique_ptr<sampling::Recorder> recorder_{nullptr};
+    std::unique_ptr<tools::DeadlineScheduler> scheduler_{nullptr};
+    std::unique_ptr<tools::EventLoop> event_loop_{nullptr};
+};
+
+} // namespace service
+} // namespace bandwit
+
+#endif // EXPORTER_H
@@ -0,0 +1,156 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "inet_socket.hpp"
+
+namespace bandwit {
+namespace service {
+
+static std::string strip_brackets(const std::string &host) {
+    if ((host.size() >= 2) && (host.front() == '[') && (host.back() == ']')) {
+        return host.substr(1, host.size() - 2);
+    }
+
+    return host;
+}
+
+void split_listen_address(const std::string &address, std::string *host,
+                          std::string *port) {
+    host->clear();
+    *port = address;
+
+    auto colon = address.rfind(':');
+    if (colon != std::string::npos) {
+        *host = strip_brackets(address.substr(0, colon));
+        *port = address.substr(colon + 1);
+    }
+}
+
+void split_host_address(const std::string &address,
+                        const std::string &default_port, std::string *host,
+                        std::string *port) {
+    *host = address;
+    *port = default_port;
+
+    // Either one colon before the port, or a bracketed host before it. An
+    // IPv6 address without brackets has more than one and no port.
+    auto colon = address.rfind(':');
+    bool has_port = (colon != std::string::npos) &&
+                    ((address.find(':') == colon) ||
+                     ((colon > 0) && (address[colon - 1] == ']')));
+    if (has_port) {
+        *host = address.substr(0, colon);
+        *port = address.substr(colon + 1);
+    }
+
+    *host = strip_brackets(*host);
+}
+
+InetAddress resolve_inet(const std::string &host, const std::string &port,
+                         int socktype) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = socktype;
+
+    addrinfo *res{nullptr};
+    int rv = getaddrinfo(host.c_str(), port.c_str(), &hints, &res);
+    if (rv != 0) {
+        THROW_ARGS(std::runtime_error, "resolve_inet: bad address %s:%s: %s",
+                   host.c_str(), port.c_str(), gai_strerror(rv));
+    }
+
+    InetAddress address{};
+    memcpy(&address.storage, res->ai_addr, res->ai_addrlen);
+    address.len = res->ai_addrlen;
+
+    freeaddrinfo(res);
+    return address;
+}
+
+int bind_inet(const std::string &address, int socktype) {
+    std::string host{};
+    std::string port{};
+    split_listen_address(address, &host, &port);
+
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = socktype;
+    hints.ai_flags = AI_PASSIVE;
+
+    addrinfo *res{nullptr};
+    int rv = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+                         &hints, &res);
+    if (rv != 0) {
+        THROW_ARGS(std::runtime_error, "bind_inet: bad address %s: %s",
+                   address.c_str(), gai_strerror(rv));
+    }
+
+    int bound_fd{-1};
+    int errno_bind{0};
+    for (auto *ai = res; ai != nullptr; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            errno_bind = errno;
+            continue;
+        }
+
+        // a restarted daemon must not wait for TIME_WAIT to pass
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        if ((bind(fd, ai->ai_addr, ai->ai_addrlen) == 0) &&
+            ((socktype != SOCK_STREAM) || (listen(fd, 16) == 0))) {
+            bound_fd = fd;
+            break;
+        }
+
+        errno_bind = errno;
+        close(fd);
+    }
+
+    freeaddrinfo(res);
+
+    if (bound_fd < 0) {
+        errno = errno_bind;
+        THROW_CERROR(std::runtime_error, "bind_inet failed in bind()");
+    }
+
+    set_nonblocking(bound_fd);
+    return bound_fd;
+}
+
+int connect_inet(const InetAddress &address, int socktype) {
+    int fd = socket(address.storage.ss_family, socktype, 0);
+    if (fd < 0) {
+        THROW_CERROR(std::runtime_error, "connect_inet failed in socket()");
+    }
+
+    set_nonblocking(fd);
+
+    auto *addr = reinterpret_cast<const sockaddr *>(&address.storage);
+    if ((connect(fd, addr, address.len) < 0) && (errno != EINPROGRESS)) {
+        int errno_orig = errno;
+        close(fd);
+        errno = errno_orig;
+        return -1;
+    }
+
+    return fd;
+}
+
+void set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        THROW_CERROR(std::runtime_error,
+                     "set_nonblocking failed in fcntl()");
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+} // namespace service
+} // namespace bandwit
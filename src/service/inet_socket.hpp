@@ -0,0 +1,48 @@
+#ifndef INET_SOCKET_H
+#define INET_SOCKET_H
+
+#include <string>
+#include <sys/socket.h>
+
+namespace bandwit {
+namespace service {
+
+// A resolved IPv4 or IPv6 address and port
+struct InetAddress {
+    sockaddr_storage storage{};
+    socklen_t len{0};
+};
+
+// Splits an address to listen on, PORT, HOST:PORT or [HOST]:PORT. Without a
+// host it is empty, for all addresses.
+void split_listen_address(const std::string &address, std::string *host,
+                          std::string *port);
+
+// Splits an address to connect to, HOST, HOST:PORT, [HOST] or [HOST]:PORT.
+// Without a port it is default_port. An IPv6 address with a port has to be
+// in brackets.
+void split_host_address(const std::string &address,
+                        const std::string &default_port, std::string *host,
+                        std::string *port);
+
+// The first address the host resolves to, which blocks on the resolver
+InetAddress resolve_inet(const std::string &host, const std::string &port,
+                         int socktype);
+
+// A socket of socktype, SOCK_STREAM or SOCK_DGRAM, bound to an address to
+// listen on and listening if it is a stream. It is non-blocking.
+int bind_inet(const std::string &address, int socktype);
+
+// A non-blocking socket that is connecting to the address. A stream is
+// writable once it has connected or failed to, which SO_ERROR tells apart.
+// A datagram socket only takes datagrams from the address from now on.
+// Returns -1 with errno set if it failed straight away, eg. without a route
+// to the address, which is no more of an error than a refused connection.
+int connect_inet(const InetAddress &address, int socktype);
+
+void set_nonblocking(int fd);
+
+} // namespace service
+} // namespace bandwit
+
+#endif // INET_SOCKET_H
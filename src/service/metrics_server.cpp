@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "inet_socket.hpp"
+#include "metrics_server.hpp"
+
+namespace bandwit {
+namespace service {
+
+// More connections than this at once are turned away
+constexpr std::size_t MAX_CONNECTIONS = 64;
+
+// A request line and headers don't take more than this
+constexpr std::size_t MAX_REQUEST_LEN = 8 * 1024;
+
+// A scrape that takes longer than this is given up on
+constexpr Millis CONNECTION_TIMEOUT{10000};
+
+template <typename T> static void append_number(T num, std::string *out) {
+    char digits[24];
+    auto res = std::to_chars(digits, digits + sizeof(digits), num);
+    out->append(digits, res.ptr);
+}
+
+static std::string make_response(const char *status, const char *content_type,
+                                 const std::string &body) {
+    std::string response{"HTTP/1.1 "};
+    response.append(status);
+    response.append("\r\nContent-Type: ");
+    response.append(content_type);
+    response.append("\r\nContent-Length: ");
+    append_number(body.size(), &response);
+    response.append("\r\nConnection: close\r\n\r\n");
+    response.append(body);
+    return response;
+}
+
+static std::string quote_label(const std::string &value) {
+    std::string quoted{"\""};
+
+    for (auto ch : value) {
+        if ((ch == '"') || (ch == '\\')) {
+            quoted.push_back('\\');
+            quoted.push_back(ch);
+        } else if (ch == '\n') {
+            quoted.append("\\n");
+        } else {
+            quoted.push_back(ch);
+        }
+    }
+
+    quoted.push_back('"');
+    return quoted;
+}
+
+// what the counter of one quantity of one direction counts
+static const char *get_counter_help(sampling::Quantity qtty, bool is_rx) {
+    switch (qtty) {
+    case sampling::Quantity::BYTES:
+        return is_rx ? "Bytes received by the interface."
+                     : "Bytes transmitted by the interface.";
+    case sampling::Quantity::PACKETS:
+        return is_rx ? "Packets received by the interface."
+                     : "Packets transmitted by the interface.";
+    case sampling::Quantity::ERRORS:
+        return is_rx ? "Receive errors of the interface."
+                     : "Transmit errors of the interface.";
+    case sampling::Quantity::DROPS:
+        return is_rx ? "Received packets dropped by the interface."
+                     : "Packets to transmit dropped by the interface.";
+    }
+
+    THROW_MSG(std::logic_error, "unknown quantity");
+}
+
+static std::string get_window_label(sampling::AggregationWindow window) {
+    // in seconds, the unit Prometheus prefers
+    auto millis = sampling::get_duration(window).count();
+    std::string label = std::to_string(millis / 1000);
+
+    if (millis % 1000 != 0) {
+        label = "0." + std::to_string(millis % 1000);
+        while (label.back() == '0') {
+            label.pop_back();
+        }
+    }
+
+    return "\"" + label + "s\"";
+}
+
+MetricsServer::MetricsServer(const std::string &address,
+                             std::vector<sampling::AggregationWindow> windows,
+                             tools::EventLoop *event_loop)
+    : windows_{std::move(windows)}, event_loop_{event_loop} {
+    const char *text_plain = "text/plain; charset=utf-8";
+    bad_request_response_ = std::make_shared<const std::string>(
+        make_response("400 Bad Request", text_plain, "bad request\n"));
+    not_found_response_ = std::make_shared<const std::string>(make_response(
+        "404 Not Found", text_plain, "bandwit serves /metrics\n"));
+    metrics_response_ = std::make_shared<const std::string>(
+        make_response("503 Service Unavailable", text_plain,
+                      "no sample taken yet\n"));
+
+    listen_fd_ = bind_inet(address, SOCK_STREAM);
+    event_loop_->watch_fd(listen_fd_);
+}
+
+MetricsServer::~MetricsServer() {
+    for (const auto &conn : connections_) {
+        close(conn->fd);
+    }
+    close(listen_fd_);
+}
+
+void MetricsServer::update(const sampling::Recorder &recorder) {
+    const auto &history = recorder.get_history();
+    const auto &samples = recorder.get_samples();
+
+    std::vector<std::string> ifaces{};
+    for (std::size_t i = 0; i < history.num_ifaces(); ++i) {
+        ifaces.push_back(quote_label(history.get_iface_name(i)));
+    }
+
+    std::string body{};
+    body.reserve(metrics_response_->size());
+
+    auto append_counter = [&](sampling::Quantity qtty, bool is_rx) {
+        std::string name{is_rx ? "bandwit_receive_" : "bandwit_transmit_"};
+        name.append(sampling::get_label(qtty)).append("_total");
+        body.append("# HELP ").append(name).append(" ");
+        body.append(get_counter_help(qtty, is_rx));
+        body.append("\n# TYPE ").append(name).append(" counter\n");
+
+        // An iface that is gone has no counters to export
+        for (std::size_t i = 0; i < samples.size(); ++i) {
+            if (samples[i].error != sampling::SampleError::NONE) {
+                continue;
+            }
+
+            body.append(name).append("{iface=").append(ifaces[i]);
+            body.append("} ");
+            append_number(is_rx ? samples[i].rx[qtty] : samples[i].tx[qtty],
+                          &body);
+            body.push_back('\n');
+        }
+    };
+
+    // Only the quantities that are recorded are sampled at all
+    for (auto qtty : history.get_quantities()) {
+        append_counter(qtty, true);
+        append_counter(qtty, false);
+    }
+
+    // every sample is over the finest window
+    auto sample_ms = U64(sampling::get_duration(windows_.front()).count());
+
+    auto append_rate = [&](const char *name, const char *help, bool is_rx) {
+        body.append("# HELP ").append(name).append(" ").append(help);
+        body.append("\n# TYPE ").append(name).append(" gauge\n");
+
+        for (auto window : windows_) {
+            auto window_label = get_window_label(window);
+
+            for (std::size_t i = 0; i < history.num_ifaces(); ++i) {
+                const auto &ts_coll =
+                    is_rx ? history.get_rx(i) : history.get_tx(i);
+
+                // The latest complete bucket is the one before the open one,
+                // if there is one yet
+                auto open = ts_coll.max(window);
+                if (open <= ts_coll.min(window)) {
+                    continue;
+                }
+
+                // The rate is over the samples in the bucket, a bucket
+                // without any has no rate
+                auto bucket = ts_coll.get_bucket(
+                    window, open - sampling::get_duration(window));
+                if (bucket.count == 0) {
+                    continue;
+                }
+
+                body.append(name).append("{iface=").append(ifaces[i]);
+                body.append(",window=").append(window_label).append("} ");
+                append_number(bucket.sum * 1000 / (bucket.count * sample_ms),
+                              &body);
+                body.push_back('\n');
+            }
+        }
+    };
+
+    append_rate("bandwit_receive_rate_bytes_per_second",
+                "Bytes received per second over the latest complete window.",
+                true);
+    append_rate("bandwit_transmit_rate_bytes_per_second",
+                "Bytes transmitted per second over the latest complete "
+                "window.",
+                false);
+
+    metrics_response_ = std::make_shared<const std::string>(make_response(
+        "200 OK", "text/plain; version=0.0.4; charset=utf-8", body));
+}
+
+bool MetricsServer::handle(int fd, SteadyTimePoint now) {
+    if (fd == listen_fd_) {
+        accept_connections(now);
+        return true;
+    }
+
+    auto it = std::find_if(
+        connections_.begin(), connections_.end(),
+        [fd](const auto &conn) { return conn->fd == fd; });
+    if (it == connections_.end()) {
+        return false;
+    }
+
+    auto *conn = it->get();
+    if (conn->response == nullptr) {
+        read_request(conn);
+    } else {
+        write_response(conn);
+    }
+
+    return true;
+}
+
+void MetricsServer::expire(SteadyTimePoint now) {
+    std::vector<int> expired_fds{};
+
+    for (const auto &conn : connections_) {
+        if (now - conn->opened > CONNECTION_TIMEOUT) {
+            expired_fds.push_back(conn->fd);
+        }
+    }
+
+    for (auto fd : expired_fds) {
+        close_connection(fd);
+    }
+}
+
+void MetricsServer::accept_connections(SteadyTimePoint now) {
+    while (true) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            // EAGAIN once there are no more, anything else is the client's
+            // problem
+            return;
+        }
+
+        if (connections_.size() >= MAX_CONNECTIONS) {
+            close(fd);
+            continue;
+        }
+
+        set_nonblocking(fd);
+        event_loop_->watch_fd(fd);
+
+        auto conn = std::make_unique<HttpConnection>();
+        conn->fd = fd;
+        conn->opened = now;
+        connections_.push_back(std::move(conn));
+    }
+}
+
+void MetricsServer::read_request(HttpConnection *conn) {
+    char buf[2048];
+
+    while (true) {
+        ssize_t rv = recv(conn->fd, buf, sizeof(buf), 0);
+
+        if (rv == 0) {
+            close_connection(conn->fd);
+            return;
+        }
+
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                return;
+            }
+
+            close_connection(conn->fd);
+            return;
+        }
+
+        conn->request.append(buf, SIZE_T(rv));
+
+        // Only the request line matters, the headers are skipped
+        if (conn->request.find("\r\n\r\n") != std::string::npos ||
+            conn->request.find("\n\n") != std::string::npos) {
+            respond(conn);
+            return;
+        }
+
+        if (conn->request.size() > MAX_REQUEST_LEN) {
+            conn->response = bad_request_response_;
+            write_response(conn);
+            return;
+        }
+    }
+}
+
+void MetricsServer::respond(HttpConnection *conn) {
+    // GET /metrics HTTP/1.1
+    std::string_view request{conn->request};
+    auto line = request.substr(0, request.find_first_of("\r\n"));
+
+    auto method_end = line.find(' ');
+    auto target_end = line.find(' ', method_end + 1);
+
+    if ((method_end == std::string_view::npos) ||
+        (target_end == std::string_view::npos)) {
+        conn->response = bad_request_response_;
+    } else {
+        auto method = line.substr(0, method_end);
+        auto target =
+            line.substr(method_end + 1, target_end - method_end - 1);
+        auto path = target.substr(0, target.find('?'));
+
+        if ((method == "GET") && (path == "/metrics")) {
+            conn->response = metrics_response_;
+        } else {
+            conn->response = not_found_response_;
+        }
+    }
+
+    write_response(conn);
+}
+
+void MetricsServer::write_response(HttpConnection *conn) {
+    const auto &response = *conn->response;
+
+#ifdef MSG_NOSIGNAL
+    // A scraper that went away must not kill us with SIGPIPE
+    int flags = MSG_NOSIGNAL;
+#else
+    int flags = 0;
+#endif
+
+    while (conn->sent < response.size()) {
+        ssize_t rv = send(conn->fd, response.data() + conn->sent,
+                          response.size() - conn->sent, flags);
+
+        if (rv >= 0) {
+            conn->sent += SIZE_T(rv);
+            continue;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        // Carry on when the socket has room again
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            event_loop_->watch_fd(conn->fd, POLLOUT);
+            return;
+        }
+
+        break;
+    }
+
+    close_connection(conn->fd);
+}
+
+void MetricsServer::close_connection(int fd) {
+    event_loop_->unwatch_fd(fd);
+    close(fd);
+
+    connections_.erase(std::remove_if(connections_.begin(), connections_.end(),
+                                      [fd](const auto &conn) {
+                                          return conn->fd == fd;
+                                      }),
+                       connections_.end());
+}
+
+} // namespace service
+} // namespace bandwit
@@ -0,0 +1,79 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/recorder.hpp"
+#include "tools/event_loop.hpp"
+
+namespace bandwit {
+namespace service {
+
+// Serves the latest counters and the per window rates of a Recorder at
+// /metrics, in the Prometheus text format. Every connection gets one
+// response and is closed after it.
+//
+// Nothing blocks and there are no threads: the server watches its fds in
+// the caller's EventLoop and is handed the ones that are ready. The response
+// is rebuilt once per sample and every scrape until the next one is served
+// from that same buffer.
+class MetricsServer {
+  public:
+    // address is [HOST:]PORT, without a host it listens on all addresses
+    MetricsServer(const std::string &address,
+                  std::vector<sampling::AggregationWindow> windows,
+                  tools::EventLoop *event_loop);
+    ~MetricsServer();
+
+    CLASS_DISABLE_COPIES(MetricsServer)
+    CLASS_DISABLE_MOVES(MetricsServer)
+
+    // Rebuilds the response after a sample
+    void update(const sampling::Recorder &recorder);
+
+    // Handles an fd that the event loop says is ready. Returns false if the
+    // fd is not one of ours.
+    bool handle(int fd, SteadyTimePoint now);
+
+    // Closes the connections that have been open for too long, so that
+    // clients that never send a request can't use up all of them
+    void expire(SteadyTimePoint now);
+
+  private:
+    struct HttpConnection {
+        int fd{-1};
+        SteadyTimePoint opened{};
+        std::string request{};
+
+        // shared so that an update does not disturb a response that is
+        // half written
+        std::shared_ptr<const std::string> response{nullptr};
+        std::size_t sent{0};
+    };
+
+    void accept_connections(SteadyTimePoint now);
+    void read_request(HttpConnection *conn);
+    void respond(HttpConnection *conn);
+    void write_response(HttpConnection *conn);
+    void close_connection(int fd);
+
+    std::vector<sampling::AggregationWindow> windows_{};
+    tools::EventLoop *event_loop_{nullptr};
+
+    int listen_fd_{-1};
+    std::vector<std::unique_ptr<HttpConnection>> connections_{};
+
+    std::shared_ptr<const std::string> metrics_response_{nullptr};
+    std::shared_ptr<const std::string> bad_request_response_{nullptr};
+    std::shared_ptr<const std::string> not_found_response_{nullptr};
+};
+
+} // namespace service
+} // namespace bandwit
+
+#endif // METRICS_SERVER_H
@@ -0,0 +1,199 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "protocol.hpp"
+#include "sampling/adaptive_schedule.hpp"
+#include "tools/byte_stream.hpp"
+
+namespace bandwit {
+namespace service {
+
+void append_frame(MessageType type, std::string_view payload,
+                  std::string *out) {
+    tools::ByteWriter writer{out};
+    writer.put_u32(U32(payload.size()));
+    writer.put_u8(static_cast<uint8_t>(type));
+    out->append(payload);
+}
+
+bool parse_frame(std::string_view data, MessageType *type,
+                 std::string_view *payload) {
+    if (data.size() < FRAME_HEADER_LEN) {
+        return false;
+    }
+
+    tools::ByteReader reader{data.substr(0, FRAME_HEADER_LEN)};
+    auto len = reader.get_u32();
+    auto type_byte = reader.get_u8();
+
+    if (len != data.size() - FRAME_HEADER_LEN) {
+        return false;
+    }
+
+    *type = static_cast<MessageType>(type_byte);
+    *payload = data.substr(FRAME_HEADER_LEN);
+    return true;
+}
+
+void append_snapshot(Millis interval, const sampling::History &history,
+                     std::string *out) {
+    std::string payload{};
+    tools::ByteWriter writer{&payload};
+
+    writer.put_u32(PROTOCOL_VERSION);
+    writer.put_u64(U64(interval.count()));
+    history.encode(&writer);
+
+    append_frame(MessageType::SNAPSHOT, payload, out);
+}
+
+void append_tick(TimePoint tp, const std::vector<sampling::Quantity> &qttys,
+                 const std::vector<sampling::Delta> &deltas,
+                 std::string *out) {
+    std::string payload{};
+    tools::ByteWriter writer{&payload};
+
+    writer.put_i64(tools::to_nanos(tp));
+    writer.put_u32(U32(deltas.size()));
+    for (const auto &delta : deltas) {
+        writer.put_u32(delta.num_intervals);
+        for (auto qtty : qttys) {
+            writer.put_u64(delta.rx[qtty]);
+            writer.put_u64(delta.tx[qtty]);
+        }
+    }
+
+    append_frame(MessageType::TICK, payload, out);
+}
+
+std::unique_ptr<sampling::History> parse_snapshot(std::string_view payload,
+                                                  Millis *interval) {
+    tools::ByteReader reader{payload};
+
+    auto version = reader.get_u32();
+    if (version != PROTOCOL_VERSION) {
+        THROW_ARGS(std::runtime_error,
+                   "parse_snapshot: unsupported protocol version: %u",
+                   version);
+    }
+
+    *interval = Millis{static_cast<Millis::rep>(reader.get_u64())};
+    return sampling::History::decode(&reader);
+}
+
+void parse_tick(std::string_view payload,
+                const std::vector<sampling::Quantity> &qttys, Tick *tick) {
+    tools::ByteReader reader{payload};
+
+    tick->tp = tools::from_nanos(reader.get_i64());
+
+    // Each delta is its intervals and two u64 per quantity, more than fit in
+    // the payload is garbage
+    auto num_deltas = reader.get_u32();
+    auto delta_len = sizeof(uint32_t) + (2 * sizeof(uint64_t) * qttys.size());
+    if (num_deltas > payload.size() / delta_len) {
+        THROW_ARGS(std::runtime_error, "parse_tick: too many deltas: %u",
+                   num_deltas);
+    }
+
+    tick->deltas.resize(num_deltas);
+    for (auto &delta : tick->deltas) {
+        delta.num_intervals = reader.get_u32();
+        if (delta.num_intervals > sampling::AdaptiveSchedule::MAX_BACKOFF) {
+            THROW_ARGS(std::runtime_error,
+                       "parse_tick: a delta of too many intervals: %u",
+                       delta.num_intervals);
+        }
+
+        for (auto qtty : qttys) {
+            delta.rx[qtty] = reader.get_u64();
+            delta.tx[qtty] = reader.get_u64();
+        }
+    }
+}
+
+void FrameReader::append(const char *data, std::size_t len) {
+    // Drop the frames that were consumed already before growing the buffer
+    if (pos_ > 0) {
+        buffer_.erase(0, pos_);
+        pos_ = 0;
+    }
+
+    buffer_.append(data, len);
+}
+
+bool FrameReader::next(MessageType *type, std::string_view *payload) {
+    std::string_view available{buffer_};
+    available.remove_prefix(pos_);
+
+    if (available.size() < FRAME_HEADER_LEN) {
+        return false;
+    }
+
+    tools::ByteReader reader{available.substr(0, FRAME_HEADER_LEN)};
+    auto len = reader.get_u32();
+    auto type_byte = reader.get_u8();
+
+    if (len > MAX_PAYLOAD_LEN) {
+        THROW_ARGS(std::runtime_error, "FrameReader.next: frame too large: %u",
+                   len);
+    }
+
+    if (available.size() < FRAME_HEADER_LEN + len) {
+        return false;
+    }
+
+    *type = static_cast<MessageType>(type_byte);
+    *payload = available.substr(FRAME_HEADER_LEN, len);
+    pos_ += FRAME_HEADER_LEN + len;
+
+    return true;
+}
+
+static std::string get_fallback_socket_dir() {
+    return "/tmp/bandwit-" + std::to_string(getuid());
+}
+
+std::string get_default_socket_path() {
+    const char *runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if ((runtime_dir != nullptr) && (*runtime_dir != '\0')) {
+        return std::string{runtime_dir} + "/bandwit.sock";
+    }
+
+    return get_fallback_socket_dir() + "/bandwit.sock";
+}
+
+void prepare_socket_dir(const std::string &socket_path) {
+    auto dir = get_fallback_socket_dir();
+    if (socket_path.compare(0, dir.size() + 1, dir + "/") != 0) {
+        return;
+    }
+
+    if ((mkdir(dir.c_str(), 0700) < 0) && (errno != EEXIST)) {
+        THROW_ARGS(std::runtime_error, "failed to create %s: %s", dir.c_str(),
+                   strerror(errno));
+    }
+
+    // lstat, so that a symlink to a directory of ours is refused too
+    struct stat st {};
+    if (lstat(dir.c_str(), &st) < 0) {
+        THROW_ARGS(std::runtime_error, "failed to stat %s: %s", dir.c_str(),
+                   strerror(errno));
+    }
+
+    if (!S_ISDIR(st.st_mode) || (st.st_uid != getuid()) ||
+        ((st.st_mode & 0077) != 0)) {
+        THROW_ARGS(std::runtime_error,
+                   "%s is not a private directory of ours, remove it or set "
+                   "XDG_RUNTIME_DIR",
+                   dir.c_str());
+    }
+}
+
+} // namespace service
+} // namespace bandwit
@@ -0,0 +1,95 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aliases.hpp"
+#include "sampling/history.hpp"
+#include "sampling/recorder.hpp"
+
+namespace bandwit {
+namespace service {
+
+// A daemon sends an attached client one SNAPSHOT of the history recorded so
+// far, then a TICK with the deltas of every sample it takes after that. A
+// tick only has the deltas of the quantities that the snapshot said are
+// recorded. A delta of a counter that was reset is a GAP_DELTA. Each delta
+// also has the intervals it covers, so that the client spreads it over the
+// same buckets as the daemon.
+//
+// Every message is a frame: a u32 payload length, a u8 MessageType and the
+// payload, all encoded by tools::ByteWriter. The messages of the remote
+// viewers are in remote_protocol.hpp.
+enum class MessageType : uint8_t {
+    SNAPSHOT = 1,
+    TICK = 2,
+    HELLO = 3,
+    SAMPLES = 4,
+    SUBSCRIBE = 5,
+};
+
+constexpr uint32_t PROTOCOL_VERSION = 5;
+
+// The header is the length and the type
+constexpr std::size_t FRAME_HEADER_LEN = 5;
+
+// Anything larger than this is garbage rather than a frame
+constexpr std::size_t MAX_PAYLOAD_LEN = 256 * 1024 * 1024;
+
+struct Tick {
+    TimePoint tp{};
+    std::vector<sampling::Delta> deltas{};
+};
+
+void append_frame(MessageType type, std::string_view payload,
+                  std::string *out);
+
+// The frame that a datagram holds, which has to be all of it. Returns false
+// for anything else, eg. a truncated datagram.
+bool parse_frame(std::string_view data, MessageType *type,
+                 std::string_view *payload);
+
+void append_snapshot(Millis interval, const sampling::History &history,
+                     std::string *out);
+void append_tick(TimePoint tp, const std::vector<sampling::Quantity> &qttys,
+                 const std::vector<sampling::Delta> &deltas,
+                 std::string *out);
+
+// Parsing the payload of a frame
+std::unique_ptr<sampling::History> parse_snapshot(std::string_view payload,
+                                                  Millis *interval);
+void parse_tick(std::string_view payload,
+                const std::vector<sampling::Quantity> &qttys, Tick *tick);
+
+// Reassembles frames from a byte stream that arrives in arbitrary chunks
+class FrameReader {
+  public:
+    void append(const char *data, std::size_t len);
+
+    // Extracts the next complete frame, if there is one. The payload is only
+    // valid until the next call.
+    bool next(MessageType *type, std::string_view *payload);
+
+  private:
+    std::string buffer_{};
+
+    // where the next frame starts in buffer_
+    std::size_t pos_{0};
+};
+
+// $XDG_RUNTIME_DIR/bandwit.sock, or /tmp/bandwit-<uid>/bandwit.sock if that
+// isn't set
+std::string get_default_socket_path();
+
+// When socket_path is the one in /tmp, creates its directory 0700 if it is
+// not there yet and throws if it is not ours alone: anyone can create it
+// before we do, and put a socket of their own in it
+void prepare_socket_dir(const std::string &socket_path);
+
+} // namespace service
+} // namespace bandwit
+
+#endif // PROTOCOL_H
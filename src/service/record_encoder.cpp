@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+
+#include "record_encoder.hpp"
+#include "sampling/counter_delta.hpp"
+#include "tools/byte_stream.hpp"
+
+namespace bandwit {
+namespace service {
+
+bool parse_export_format(std::string_view name, ExportFormat *format) {
+    if (name == "csv") {
+        *format = ExportFormat::CSV;
+    } else if (name == "jsonl") {
+        *format = ExportFormat::JSONL;
+    } else if (name == "binary") {
+        *format = ExportFormat::BINARY;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+template <typename T> static void append_number(T num, std::string *out) {
+    char digits[24];
+    auto res = std::to_chars(digits, digits + sizeof(digits), num);
+    out->append(digits, res.ptr);
+}
+
+// the count, or gap if there is none
+static void append_count(uint64_t count, std::string_view gap,
+                         std::string *out) {
+    if (count == sampling::GAP_DELTA) {
+        out->append(gap);
+    } else {
+        append_number(count, out);
+    }
+}
+
+static int64_t to_millis(TimePoint tp) {
+    return std::chrono::duration_cast<Millis>(tp.time_since_epoch()).count();
+}
+
+CsvEncoder::CsvEncoder(std::vector<std::string> iface_names,
+                       std::vector<sampling::Quantity> qttys)
+    : iface_names_{std::move(iface_names)}, qttys_{std::move(qttys)} {}
+
+void CsvEncoder::append_header(std::string *out) const {
+    out->append("timestamp_ms,iface");
+    for (auto qtty : qttys_) {
+        auto label = sampling::get_label(qtty);
+        out->append(",rx_").append(label).append(",tx_").append(label);
+    }
+    out->push_back('\n');
+}
+
+void CsvEncoder::append_record(const ExportRecord &record,
+                               std::string *out) const {
+    append_number(to_millis(record.tp), out);
+    out->push_back(',');
+    out->append(iface_names_[record.iface_idx]);
+    for (auto qtty : qttys_) {
+        out->push_back(',');
+        append_count(record.delta.rx[qtty], "", out);
+        out->push_back(',');
+        append_count(record.delta.tx[qtty], "", out);
+    }
+    out->push_back('\n');
+}
+
+JsonlEncoder::JsonlEncoder(std::vector<std::string> iface_names,
+                           std::vector<sampling::Quantity> qttys)
+    : qttys_{std::move(qttys)} {
+    for (auto qtty : qttys_) {
+        auto label = sampling::get_label(qtty);
+        keys_.push_back(",\"rx_" + label + "\":");
+        keys_.push_back(",\"tx_" + label + "\":");
+    }
+
+    for (const auto &name : iface_names) {
+        std::string quoted{"\""};
+
+        for (auto ch : name) {
+            if ((ch == '"') || (ch == '\\')) {
+                quoted.push_back('\\');
+            }
+            quoted.push_back(ch);
+        }
+
+        quoted.push_back('"');
+        quoted_names_.push_back(std::move(quoted));
+    }
+}
+
+void JsonlEncoder::append_header(std::string * /*out*/) const {}
+
+void JsonlEncoder::append_record(const ExportRecord &record,
+                                 std::string *out) const {
+    out->append("{\"timestamp_ms\":");
+    append_number(to_millis(record.tp), out);
+    out->append(",\"iface\":");
+    out->append(quoted_names_[record.iface_idx]);
+    for (std::size_t i = 0; i < qttys_.size(); ++i) {
+        out->append(keys_[2 * i]);
+        append_count(record.delta.rx[qttys_[i]], "null", out);
+        out->append(keys_[(2 * i) + 1]);
+        append_count(record.delta.tx[qttys_[i]], "null", out);
+    }
+    out->append("}\n");
+}
+
+BinaryEncoder::BinaryEncoder(std::vector<std::string> iface_names,
+                             std::vector<sampling::Quantity> qttys,
+                             Millis window)
+    : iface_names_{std::move(iface_names)}, qttys_{std::move(qttys)},
+      window_{window} {}
+
+void BinaryEncoder::append_header(std::string *out) const {
+    tools::ByteWriter writer{out};
+    writer.put_u64(BINARY_MAGIC);
+    writer.put_u32(BINARY_VERSION);
+    writer.put_u32(U32(iface_names_.size()));
+    writer.put_u64(U64(window_.count()));
+    writer.put_u32(sampling::get_mask(qttys_));
+    writer.put_u32(U32(BINARY_RECORD_HEADER_LEN +
+                       (2 * sizeof(uint64_t) * qttys_.size())));
+
+    for (const auto &name : iface_names_) {
+        // always leaves room for the terminating nul
+        auto len = std::min(name.size(), BINARY_NAME_LEN - 1);
+        out->append(name, 0, len);
+        out->append(BINARY_NAME_LEN - len, '\0');
+    }
+}
+
+void BinaryEncoder::append_record(const ExportRecord &record,
+                                  std::string *out) const {
+    tools::ByteWriter writer{out};
+    writer.put_i64(tools::to_nanos(record.tp));
+    writer.put_u32(U32(record.iface_idx));
+    writer.put_u32(0);
+    for (auto qtty : qttys_) {
+        writer.put_u64(record.delta.rx[qtty]);
+        writer.put_u64(record.delta.tx[qtty]);
+    }
+}
+
+std::unique_ptr<RecordEncoder>
+make_record_encoder(ExportFormat format, std::vector<std::string> iface_names,
+                    std::vector<sampling::Quantity> qttys, Millis window) {
+    switch (format) {
+    case ExportFormat::CSV:
+        return std::make_unique<CsvEncoder>(std::move(iface_names),
+                                            std::move(qttys));
+    case ExportFormat::JSONL:
+        return std::make_unique<JsonlEncoder>(std::move(iface_names),
+                                              std::move(qttys));
+    case ExportFormat::BINARY:
+        return std::make_unique<BinaryEncoder>(std::move(iface_names),
+                                               std::move(qttys), window);
+    }
+
+    return nullptr;
+}
+
+} // namespace service
+} // namespace bandwit
@@ -0,0 +1,123 @@
+#ifndef RECORD_ENCODER_H
+#define RECORD_ENCODER_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/counter_delta.hpp"
+#include "sampling/quantity.hpp"
+
+namespace bandwit {
+namespace service {
+
+enum class ExportFormat {
+    CSV,
+    JSONL,
+    BINARY,
+};
+
+// Returns false if the name is not one of csv, jsonl or binary
+bool parse_export_format(std::string_view name, ExportFormat *format);
+
+// What one iface counted in one sampling interval, or in one aggregation
+// window, of every quantity that is exported. Any of it is GAP_DELTA if it is
+// not known because the counter was reset.
+struct ExportRecord {
+    TimePoint tp{};
+    std::size_t iface_idx{0};
+    sampling::Delta delta{};
+};
+
+class RecordEncoder {
+  public:
+    RecordEncoder() = default;
+    virtual ~RecordEncoder() = default;
+
+    CLASS_DISABLE_COPIES(RecordEncoder)
+    CLASS_DISABLE_MOVES(RecordEncoder)
+
+    // what goes at the start of the stream, once
+    virtual void append_header(std::string *out) const = 0;
+    virtual void append_record(const ExportRecord &record,
+                               std::string *out) const = 0;
+};
+
+// timestamp_ms,iface,rx_bytes,tx_bytes followed by rx_packets,tx_packets and
+// so on for the other quantities, a gap is an empty field
+class CsvEncoder : public RecordEncoder {
+  public:
+    CsvEncoder(std::vector<std::string> iface_names,
+               std::vector<sampling::Quantity> qttys);
+
+    void append_header(std::string *out) const override;
+    void append_record(const ExportRecord &record,
+                       std::string *out) const override;
+
+  private:
+    std::vector<std::string> iface_names_{};
+    std::vector<sampling::Quantity> qttys_{};
+};
+
+// {"timestamp_ms":...,"iface":"...","rx_bytes":...,"tx_bytes":...} and the
+// same for the other quantities, a gap is null
+class JsonlEncoder : public RecordEncoder {
+  public:
+    JsonlEncoder(std::vector<std::string> iface_names,
+                 std::vector<sampling::Quantity> qttys);
+
+    void append_header(std::string *out) const override;
+    void append_record(const ExportRecord &record,
+                       std::string *out) const override;
+
+  private:
+    // the names quoted and escaped once up front
+    std::vector<std::string> quoted_names_{};
+    std::vector<sampling::Quantity> qttys_{};
+    // eg. ,"rx_packets": per quantity, rx then tx
+    std::vector<std::string> keys_{};
+};
+
+// Little endian throughout. The header is the magic "BWEXPORT", a u32
+// version, a u32 number of ifaces, a u64 window in milliseconds that every
+// record covers, a u32 mask of the quantities, with bit 0 the bytes, 1 the
+// packets, 2 the errors and 3 the drops, a u32 length of the records, then
+// each iface name nul padded to BINARY_NAME_LEN. Every record is an i64
+// timestamp in nanoseconds, a u32 iface index, a u32 of padding, then the
+// u64 rx and tx of every quantity in the mask, in the order of the bits,
+// which are all ones for a gap.
+class BinaryEncoder : public RecordEncoder {
+  public:
+    static constexpr uint64_t BINARY_MAGIC = 0x54524f5058455742; // "BWEXPORT"
+    static constexpr uint32_t BINARY_VERSION = 3;
+    // the header without the names
+    static constexpr std::size_t BINARY_HEADER_LEN = 32;
+    static constexpr std::size_t BINARY_NAME_LEN = 64;
+    // the record without the quantities
+    static constexpr std::size_t BINARY_RECORD_HEADER_LEN = 16;
+
+    BinaryEncoder(std::vector<std::string> iface_names,
+                  std::vector<sampling::Quantity> qttys, Millis window);
+
+    void append_header(std::string *out) const override;
+    void append_record(const ExportRecord &record,
+                       std::string *out) const override;
+
+  private:
+    std::vector<std::string> iface_names_{};
+    std::vector<sampling::Quantity> qttys_{};
+    Millis window_{};
+};
+
+std::unique_ptr<RecordEncoder>
+make_record_encoder(ExportFormat format, std::vector<std::string> iface_names,
+                    std::vector<sampling::Quantity> qttys, Millis window);
+
+} // namespace service
+} // namespace bandwit
+
+#endif // RECORD_ENCODER_H
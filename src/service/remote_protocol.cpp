@@ -0,0 +1,142 @@
+#include <stdexcept>
+
+#include "except.hpp"
+#include "remote_protocol.hpp"
+#include "sampling/adaptive_schedule.hpp"
+#include "tools/byte_stream.hpp"
+
+namespace bandwit {
+namespace service {
+
+void append_hello(const Hello &hello, std::string *out) {
+    std::string payload{};
+    tools::ByteWriter writer{&payload};
+
+    writer.put_u32(REMOTE_VERSION);
+    writer.put_u32(hello.session);
+    writer.put_u32(hello.nonce);
+    writer.put_u64(U64(hello.interval.count()));
+    writer.put_i64(tools::to_nanos(hello.start));
+    writer.put_u32(sampling::get_mask(hello.qttys));
+    writer.put_u32(U32(hello.iface_names.size()));
+    for (const auto &name : hello.iface_names) {
+        writer.put_string(name);
+    }
+
+    append_frame(MessageType::HELLO, payload, out);
+}
+
+void append_samples(const Hello &hello, TimePoint tp,
+                    const std::vector<sampling::Delta> &deltas,
+                    std::string *out) {
+    std::string payload{};
+    tools::ByteWriter writer{&payload};
+
+    writer.put_u32(hello.session);
+    writer.put_varint(U64((tp - hello.start) / hello.interval));
+
+    // no need for a count, the hello has it
+    for (const auto &delta : deltas) {
+        writer.put_varint(delta.num_intervals);
+        for (auto qtty : hello.qttys) {
+            writer.put_varint(delta.rx[qtty] + 1);
+            writer.put_varint(delta.tx[qtty] + 1);
+        }
+    }
+
+    append_frame(MessageType::SAMPLES, payload, out);
+}
+
+void append_subscribe(uint32_t nonce, std::string *out) {
+    std::string payload{};
+    tools::ByteWriter writer{&payload};
+    writer.put_u32(REMOTE_VERSION);
+    writer.put_u32(nonce);
+
+    append_frame(MessageType::SUBSCRIBE, payload, out);
+}
+
+void parse_hello(std::string_view payload, Hello *hello) {
+    tools::ByteReader reader{payload};
+
+    auto version = reader.get_u32();
+    if (version != REMOTE_VERSION) {
+        THROW_ARGS(std::runtime_error,
+                   "parse_hello: unsupported protocol version: %u", version);
+    }
+
+    hello->session = reader.get_u32();
+    hello->nonce = reader.get_u32();
+    hello->interval = Millis{static_cast<Millis::rep>(reader.get_u64())};
+    hello->start = tools::from_nanos(reader.get_i64());
+    hello->qttys = sampling::from_mask(reader.get_u32());
+
+    if (hello->interval.count() <= 0) {
+        THROW_MSG(std::runtime_error, "parse_hello: no interval");
+    }
+
+    // Every name takes at least its length, more than fit in the payload is
+    // garbage
+    auto num_ifaces = reader.get_u32();
+    if (num_ifaces > payload.size() / sizeof(uint32_t)) {
+        THROW_ARGS(std::runtime_error, "parse_hello: too many ifaces: %u",
+                   num_ifaces);
+    }
+
+    hello->iface_names.resize(num_ifaces);
+    for (auto &name : hello->iface_names) {
+        name = reader.get_string();
+    }
+}
+
+void parse_samples(std::string_view payload, const Hello &hello,
+                   RemoteSamples *samples) {
+    tools::ByteReader reader{payload};
+
+    samples->session = reader.get_u32();
+    if (samples->session != hello.session) {
+        samples->deltas.clear();
+        return;
+    }
+
+    auto index = reader.get_varint();
+    samples->tp =
+        hello.start + hello.interval * static_cast<Millis::rep>(index);
+
+    // The deltas wrap back around from 0 to a GAP_DELTA
+    samples->deltas.resize(hello.iface_names.size());
+    for (auto &delta : samples->deltas) {
+        auto num_intervals = reader.get_varint();
+        if (num_intervals > sampling::AdaptiveSchedule::MAX_BACKOFF) {
+            THROW_MSG(std::runtime_error,
+                      "parse_samples: a delta of too many intervals");
+        }
+
+        delta.num_intervals = U32(num_intervals);
+        for (auto qtty : hello.qttys) {
+            delta.rx[qtty] = reader.get_varint() - 1;
+            delta.tx[qtty] = reader.get_varint() - 1;
+        }
+    }
+
+    if (!reader.at_end()) {
+        THROW_MSG(std::runtime_error,
+                  "parse_samples: samples do not match the hello");
+    }
+}
+
+uint32_t parse_subscribe(std::string_view payload) {
+    tools::ByteReader reader{payload};
+
+    auto version = reader.get_u32();
+    if (version != REMOTE_VERSION) {
+        THROW_ARGS(std::runtime_error,
+                   "parse_subscribe: unsupported protocol version: %u",
+                   version);
+    }
+
+    return reader.get_u32();
+}
+
+} // namespace service
+} // namespace bandwit
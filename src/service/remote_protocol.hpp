@@ -0,0 +1,84 @@
+#ifndef REMOTE_PROTOCOL_H
+#define REMOTE_PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aliases.hpp"
+#include "protocol.hpp"
+#include "sampling/counter_delta.hpp"
+#include "sampling/quantity.hpp"
+
+namespace bandwit {
+namespace service {
+
+// A daemon that serves remote viewers sends each one a HELLO with what it
+// samples, then the SAMPLES of every sample it takes from then on. Over TCP
+// the hello goes out when a viewer connects. Over UDP a viewer SUBSCRIBEs,
+// and again every REMOTE_SUBSCRIBE_INTERVAL to stay subscribed, and every
+// subscribe is answered with a hello. Each datagram is one frame, a lost
+// one is the gap of one sample.
+//
+// The samples are compact since there are as many as there are hosts: the
+// deadline of a sample is its index since the start in the hello, and each
+// delta is a varint of one more than the delta, so that a GAP_DELTA wraps
+// around to 0 and an idle iface takes one byte per quantity and direction.
+// Each delta starts with a varint of the intervals it covers, 0 while the
+// adaptive schedule of the daemon backs off on the iface.
+// Both carry the session of the daemon, which changes when it restarts, so
+// that samples of a session the viewer has not had the hello of are skipped.
+//
+// Over UDP the address of a subscribe could be anyone's, so the daemon only
+// streams to one that proved it is there: the hello in answer to a subscribe
+// carries a nonce for its address, and only a subscribe that echoes it back
+// subscribes. Over TCP the nonce is 0.
+constexpr uint32_t REMOTE_VERSION = 3;
+
+// for --serve and --connect without a port
+constexpr const char *DEFAULT_REMOTE_PORT = "7437";
+
+constexpr Millis REMOTE_SUBSCRIBE_INTERVAL{10000};
+// A viewer that did not subscribe again for this long is gone
+constexpr Millis REMOTE_SUBSCRIPTION_TIMEOUT{3 * REMOTE_SUBSCRIBE_INTERVAL};
+
+struct Hello {
+    uint32_t session{0};
+    // of the address it is sent to, to echo in the subscribes
+    uint32_t nonce{0};
+    Millis interval{};
+    // the deadline of the sample at index 0
+    TimePoint start{};
+    std::vector<sampling::Quantity> qttys{};
+    std::vector<std::string> iface_names{};
+};
+
+struct RemoteSamples {
+    uint32_t session{0};
+    TimePoint tp{};
+    // one per iface, of the quantities in the hello
+    std::vector<sampling::Delta> deltas{};
+};
+
+void append_hello(const Hello &hello, std::string *out);
+// tp has to be a deadline of the hello, ie. a whole number of intervals
+// after its start
+void append_samples(const Hello &hello, TimePoint tp,
+                    const std::vector<sampling::Delta> &deltas,
+                    std::string *out);
+// with the nonce of the last hello, 0 before there was one
+void append_subscribe(uint32_t nonce, std::string *out);
+
+// Parsing the payload of a frame. Of samples that are not of the session of
+// the hello only the session is parsed.
+void parse_hello(std::string_view payload, Hello *hello);
+void parse_samples(std::string_view payload, const Hello &hello,
+                   RemoteSamples *samples);
+// Returns the nonce
+uint32_t parse_subscribe(std::string_view payload);
+
+} // namespace service
+} // namespace bandwit
+
+#endif // REMOTE_PROTOCOL_H
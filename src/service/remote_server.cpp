@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "remote_server.hpp"
+
+namespace bandwit {
+namespace service {
+
+// More viewers than this at once are turned away, of each transport
+constexpr std::size_t MAX_VIEWERS = 64;
+
+// A subscribe is all header, anything larger is not one
+constexpr std::size_t MAX_DATAGRAM_LEN = 64;
+
+// Nonces that are pending at once, a new one takes the place of the oldest
+constexpr std::size_t MAX_CHALLENGES = 4 * MAX_VIEWERS;
+
+static bool is_same_address(const InetAddress &lhs, const InetAddress &rhs) {
+    return (lhs.len == rhs.len) &&
+           (memcmp(&lhs.storage, &rhs.storage, lhs.len) == 0);
+}
+
+RemoteServer::RemoteServer(const std::string &address, Millis interval,
+                           TimePoint start, const sampling::History &history,
+                           tools::EventLoop *event_loop)
+    : event_loop_{event_loop} {
+    hello_.session = random_();
+    hello_.interval = interval;
+    hello_.start = start;
+    hello_.qttys = history.get_quantities();
+    for (std::size_t i = 0; i < history.num_ifaces(); ++i) {
+        hello_.iface_names.push_back(history.get_iface_name(i));
+    }
+    append_hello(hello_, &hello_frame_);
+
+    listen_fd_ = bind_inet(address, SOCK_STREAM);
+    udp_fd_ = bind_inet(address, SOCK_DGRAM);
+    event_loop_->watch_fd(listen_fd_);
+    event_loop_->watch_fd(udp_fd_);
+}
+
+RemoteServer::~RemoteServer() {
+    close(udp_fd_);
+    close(listen_fd_);
+}
+
+void RemoteServer::publish(TimePoint tp,
+                           const std::vector<sampling::Delta> &deltas,
+                           SteadyTimePoint now) {
+    frame_.clear();
+    append_samples(hello_, tp, deltas, &frame_);
+
+    // The sockets are non-blocking, so a viewer that cannot take the frame
+    // right away is one that fell too far behind
+    std::vector<int> failed_fds{};
+    for (const auto &viewer : viewers_) {
+        if (!viewer->send_all(frame_)) {
+            failed_fds.push_back(viewer->get_fd());
+        }
+    }
+
+    for (auto fd : failed_fds) {
+        drop_viewer(fd);
+    }
+
+    subscribers_.erase(
+        std::remove_if(subscribers_.begin(), subscribers_.end(),
+                       [now](const Subscriber &subscriber) {
+                           return now - subscriber.last_seen >
+                                  REMOTE_SUBSCRIPTION_TIMEOUT;
+                       }),
+        subscribers_.end());
+
+    for (const auto &subscriber : subscribers_) {
+        sendto(udp_fd_, frame_.data(), frame_.size(), 0,
+               reinterpret_cast<const sockaddr *>(&subscriber.address.storage),
+               subscriber.address.len);
+    }
+}
+
+bool RemoteServer::handle(int fd, SteadyTimePoint now) {
+    if (fd == listen_fd_) {
+        accept_viewers();
+        return true;
+    }
+
+    if (fd == udp_fd_) {
+        read_subscribes(now);
+        return true;
+    }
+
+    auto it = std::find_if(
+        viewers_.begin(), viewers_.end(),
+        [fd](const auto &viewer) { return viewer->get_fd() == fd; });
+    if (it == viewers_.end()) {
+        return false;
+    }
+
+    // Viewers never send anything over TCP, so readable means gone
+    drop_viewer(fd);
+    return true;
+}
+
+void RemoteServer::accept_viewers() {
+    while (true) {
+        int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            // EAGAIN once there are no more, anything else is the viewer's
+            // problem
+            return;
+        }
+
+        auto viewer = std::make_unique<Connection>(fd);
+        if (viewers_.size() >= MAX_VIEWERS) {
+            continue;
+        }
+
+        set_nonblocking(fd);
+        if (!viewer->send_all(hello_frame_)) {
+            continue;
+        }
+
+        event_loop_->watch_fd(fd);
+        viewers_.push_back(std::move(viewer));
+    }
+}
+
+void RemoteServer::read_subscribes(SteadyTimePoint now) {
+    char buf[MAX_DATAGRAM_LEN];
+
+    while (true) {
+        InetAddress from{};
+        from.len = sizeof(from.storage);
+        ssize_t rv = recvfrom(udp_fd_, buf, sizeof(buf), 0,
+                              reinterpret_cast<sockaddr *>(&from.storage),
+                              &from.len);
+
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            // EAGAIN once there are no more
+            return;
+        }
+
+        MessageType type{};
+        std::string_view payload{};
+        if (!parse_frame(std::string_view{buf, SIZE_T(rv)}, &type,
+                         &payload) ||
+            (type != MessageType::SUBSCRIBE)) {
+            continue;
+        }
+
+        // a subscribe of another version is none of ours
+        uint32_t nonce{0};
+        try {
+            nonce = parse_subscribe(payload);
+        } catch (std::runtime_error &) {
+            continue;
+        }
+
+        auto it = std::find_if(subscribers_.begin(), subscribers_.end(),
+                               [&from](const Subscriber &subscriber) {
+                                   return is_same_address(subscriber.address,
+                                                          from);
+                               });
+        if ((it != subscribers_.end()) && (it->nonce == nonce)) {
+            it->last_seen = now;
+        } else if (!is_echoed(from, nonce)) {
+            nonce = challenge(from, now);
+        } else if (it != subscribers_.end()) {
+            // eg. a viewer that restarted on the same port
+            it->nonce = nonce;
+            it->last_seen = now;
+        } else if (subscribers_.size() < MAX_VIEWERS) {
+            subscribers_.push_back(Subscriber{from, nonce, now});
+        } else {
+            continue;
+        }
+
+        // Every subscribe is answered, a hello that got lost is sent again
+        // with the next one
+        send_hello(from, nonce);
+    }
+}
+
+bool RemoteServer::is_echoed(const InetAddress &address, uint32_t nonce) {
+    auto it = std::find_if(challenges_.begin(), challenges_.end(),
+                           [&address](const Challenge &challenge) {
+                               return is_same_address(challenge.address,
+                                                      address);
+                           });
+    if ((it == challenges_.end()) || (it->nonce != nonce)) {
+        return false;
+    }
+
+    challenges_.erase(it);
+    return true;
+}
+
+uint32_t RemoteServer::challenge(const InetAddress &address,
+                                 SteadyTimePoint now) {
+    // A viewer echoes the nonce as soon as it has the hello
+    challenges_.erase(std::remove_if(challenges_.begin(), challenges_.end(),
+                                     [now](const Challenge &challenge) {
+                                         return now - challenge.sent >
+                                                REMOTE_SUBSCRIBE_INTERVAL;
+                                     }),
+                      challenges_.end());
+
+    auto it = std::find_if(challenges_.begin(), challenges_.end(),
+                           [&address](const Challenge &challenge) {
+                               return is_same_address(challenge.address,
+                                                      address);
+                           });
+    if (it != challenges_.end()) {
+        return it->nonce;
+    }
+
+    if (challenges_.size() >= MAX_CHALLENGES) {
+        challenges_.erase(std::min_element(
+            challenges_.begin(), challenges_.end(),
+            [](const Challenge &lhs, const Challenge &rhs) {
+                return lhs.sent < rhs.sent;
+            }));
+    }
+
+    // 0 is what a viewer echoes before it has a nonce
+    uint32_t nonce{0};
+    while (nonce == 0) {
+        nonce = random_();
+    }
+
+    challenges_.push_back(Challenge{address, nonce, now});
+    return nonce;
+}
+
+void RemoteServer::send_hello(const InetAddress &address, uint32_t nonce) {
+    hello_.nonce = nonce;
+    datagram_.clear();
+    append_hello(hello_, &datagram_);
+    hello_.nonce = 0;
+
+    sendto(udp_fd_, datagram_.data(), datagram_.size(), 0,
+           reinterpret_cast<const sockaddr *>(&address.storage), address.len);
+}
+
+void RemoteServer::drop_viewer(int fd) {
+    event_loop_->unwatch_fd(fd);
+
+    viewers_.erase(std::remove_if(viewers_.begin(), viewers_.end(),
+                                  [fd](const auto &viewer) {
+                                      return viewer->get_fd() == fd;
+                                  }),
+                   viewers_.end());
+}
+
+} // namespace service
+} // namespace bandwit
@@ -0,0 +1,102 @@
+#ifndef REMOTE_SERVER_H
+#define REMOTE_SERVER_H
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "aliases.hpp"
+#include "inet_socket.hpp"
+#include "macros.hpp"
+#include "remote_protocol.hpp"
+#include "sampling/counter_delta.hpp"
+#include "sampling/history.hpp"
+#include "service/unix_socket.hpp"
+#include "tools/event_loop.hpp"
+
+namespace bandwit {
+namespace service {
+
+// Streams the deltas of every sample of a daemon to the viewers that
+// --connect from other hosts: over TCP to the ones that connect and over
+// UDP to the ones that subscribe, on the same port. The samples of every
+// sample are encoded once for all of them.
+//
+// Like the MetricsServer it watches its fds in the caller's EventLoop and
+// never blocks on a viewer. A TCP viewer that falls a whole socket buffer
+// behind is dropped, it reconnects. A datagram that does not go out is a
+// lost one. Samples only go to a UDP address that echoed the nonce of its
+// hello, so a subscribe with a forged address gets its victim one hello and
+// nothing more.
+class RemoteServer {
+  public:
+    // address is [HOST:]PORT, without a host it listens on all addresses.
+    // start is the time point the history of the daemon started at, every
+    // sample is a whole number of intervals after it.
+    RemoteServer(const std::string &address, Millis interval, TimePoint start,
+                 const sampling::History &history,
+                 tools::EventLoop *event_loop);
+    ~RemoteServer();
+
+    CLASS_DISABLE_COPIES(RemoteServer)
+    CLASS_DISABLE_MOVES(RemoteServer)
+
+    // Sends the deltas of the sample for tp to every viewer
+    void publish(TimePoint tp, const std::vector<sampling::Delta> &deltas,
+                 SteadyTimePoint now);
+
+    // Handles an fd that the event loop says is ready. Returns false if the
+    // fd is not one of ours.
+    bool handle(int fd, SteadyTimePoint now);
+
+  private:
+    // of UDP
+    struct Subscriber {
+        InetAddress address{};
+        // that its subscribes echo
+        uint32_t nonce{0};
+        SteadyTimePoint last_seen{};
+    };
+
+    // a nonce that was sent to an address that is not subscribed yet
+    struct Challenge {
+        InetAddress address{};
+        uint32_t nonce{0};
+        SteadyTimePoint sent{};
+    };
+
+    void accept_viewers();
+    void read_subscribes(SteadyTimePoint now);
+    // Whether nonce is the one that was sent to the address, which is then
+    // no longer pending
+    bool is_echoed(const InetAddress &address, uint32_t nonce);
+    // the nonce for an address to echo
+    uint32_t challenge(const InetAddress &address, SteadyTimePoint now);
+    void send_hello(const InetAddress &address, uint32_t nonce);
+    void drop_viewer(int fd);
+
+    Hello hello_{};
+    // sent to every viewer that connects, the one to a subscriber is
+    // encoded with its nonce
+    std::string hello_frame_{};
+    // reused for every sample, and every hello over UDP
+    std::string frame_{};
+    std::string datagram_{};
+
+    // the nonces have to be unguessable to anyone who does not receive them
+    std::random_device random_{};
+
+    tools::EventLoop *event_loop_{nullptr};
+    int listen_fd_{-1};
+    int udp_fd_{-1};
+
+    std::vector<std::unique_ptr<Connection>> viewers_{};
+    std::vector<Subscriber> subscribers_{};
+    std::vector<Challenge> challenges_{};
+};
+
+} // namespace service
+} // namespace bandwit
+
+#endif // REMOTE_SERVER_H
@@ -0,0 +1,473 @@
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+#include <sys/socket.h>
+
+#include "except.hpp"
+#include "remote_viewer.hpp"
+#include "sampling/agg_window.hpp"
+#include "tools/monotonic_clock.hpp"
+
+namespace bandwit {
+namespace service {
+
+// How long the hosts have to say hello at first
+constexpr Millis STARTUP_TIMEOUT{5000};
+
+// How long a host that went away is left alone before connecting again, and
+// how often an unanswered subscribe is sent again
+constexpr Millis RECONNECT_INTERVAL{2000};
+
+// How long connecting and saying hello may take
+constexpr Millis CONNECT_TIMEOUT{5000};
+
+// A host that sent nothing for this long is gone, even if no connection
+// says so, eg. after a network partition
+constexpr Millis SILENCE_TIMEOUT{5000};
+
+// The ifaces of a host that sent no samples for this many intervals are
+// gaps until it does again
+constexpr Millis::rep QUIET_INTERVALS = 3;
+
+// Anything larger than this is not a datagram of a daemon
+constexpr std::size_t MAX_DATAGRAM_LEN = 64 * 1024;
+
+RemoteViewer::RemoteViewer(const std::vector<std::string> &addresses,
+                           bool is_udp, const sampling::Retention &retention)
+    : is_udp_{is_udp} {
+    own_loop_ = std::make_unique<tools::EventLoop>();
+    event_loop_ = own_loop_.get();
+
+    auto now = SteadyClock::now();
+    for (const auto &address : addresses) {
+        std::string host{};
+        std::string port{};
+        split_host_address(address, DEFAULT_REMOTE_PORT, &host, &port);
+
+        auto src = std::make_unique<Source>();
+        src->label = address;
+        src->address =
+            resolve_inet(host, port, is_udp_ ? SOCK_DGRAM : SOCK_STREAM);
+        connect(src.get(), now);
+        sources_.push_back(std::move(src));
+    }
+
+    auto is_up = [](const auto &src) { return src->state == State::UP; };
+
+    tools::Events events{};
+    auto deadline = now + STARTUP_TIMEOUT;
+    while (!std::all_of(sources_.begin(), sources_.end(), is_up) &&
+           (now < deadline)) {
+        own_loop_->set_deadline(std::min(deadline, now + RECONNECT_INTERVAL));
+        own_loop_->wait(&events);
+
+        now = SteadyClock::now();
+        receive(events, now);
+        poll(now);
+    }
+
+    if (std::none_of(sources_.begin(), sources_.end(), is_up)) {
+        THROW_MSG(std::runtime_error, "RemoteViewer: no hello from any host");
+    }
+
+    // The others are tried again like hosts that went away, and added once
+    // they answer
+    for (const auto &src : sources_) {
+        if (!is_up(src)) {
+            std::cerr << "no hello from " << src->label
+                      << " yet, it is added once it answers\n";
+        }
+    }
+
+    retention_ = retention;
+    create_history(now);
+}
+
+void RemoteViewer::watch(tools::EventLoop *event_loop) {
+    event_loop_ = event_loop;
+
+    for (const auto &src : sources_) {
+        if (src->conn != nullptr) {
+            event_loop_->watch_fd(src->conn->get_fd(),
+                                  src->state == State::CONNECTING ? POLLOUT
+                                                                  : POLLIN);
+        }
+    }
+
+    own_loop_.reset();
+}
+
+Millis RemoteViewer::get_interval() const { return interval_; }
+
+const sampling::History &RemoteViewer::get_history() const {
+    return *history_;
+}
+
+const std::vector<std::size_t> &RemoteViewer::get_changed_ifaces() const {
+    return changed_ifaces_;
+}
+
+bool RemoteViewer::receive(const tools::Events &events, SteadyTimePoint now) {
+    bool is_sampled = false;
+    changed_ifaces_.clear();
+
+    for (const auto &src : sources_) {
+        if ((src->conn == nullptr) || !events.is_ready(src->conn->get_fd())) {
+            continue;
+        }
+
+        if (is_udp_) {
+            is_sampled = read_datagrams(src.get(), now) || is_sampled;
+        } else {
+            is_sampled = read_stream(src.get(), now) || is_sampled;
+        }
+    }
+
+    return is_sampled;
+}
+
+bool RemoteViewer::poll(SteadyTimePoint now) {
+    bool is_gap = false;
+    changed_ifaces_.clear();
+
+    for (const auto &src_ptr : sources_) {
+        auto *src = src_ptr.get();
+
+        switch (src->state) {
+        case State::DOWN:
+            if (now >= src->since) {
+                connect(src, now);
+            }
+            break;
+        case State::CONNECTING:
+        case State::WAITING:
+            if (is_udp_ && (now >= src->next_subscribe)) {
+                subscribe(src, now, RECONNECT_INTERVAL);
+            } else if (!is_udp_ && (now - src->since > CONNECT_TIMEOUT)) {
+                disconnect(src, now);
+            }
+            break;
+        case State::UP:
+            if (now - src->last_heard > SILENCE_TIMEOUT) {
+                if (is_udp_) {
+                    set_state(src, State::WAITING, now);
+                    subscribe(src, now, RECONNECT_INTERVAL);
+                } else {
+                    disconnect(src, now);
+                }
+            } else if (is_udp_ && (now >= src->next_subscribe)) {
+                subscribe(src, now, REMOTE_SUBSCRIBE_INTERVAL);
+            }
+            break;
+        }
+
+        if ((history_ == nullptr) || !src->is_recorded ||
+            (now - src->last_sampled <= QUIET_INTERVALS * interval_)) {
+            continue;
+        }
+
+        // Nothing is known about the time it is quiet for, the buckets move
+        // on without it
+        sampling::Delta gap{};
+        gap.rx.values.fill(sampling::GAP_DELTA);
+        gap.tx.values.fill(sampling::GAP_DELTA);
+
+        auto tp = tools::MonotonicClock::from_steady(now);
+        for (std::size_t i = 0; i < src->iface_names.size(); ++i) {
+            history_->record(src->first_iface + i, tp, gap);
+            changed_ifaces_.push_back(src->first_iface + i);
+        }
+        is_gap = true;
+    }
+
+    return is_gap;
+}
+
+void RemoteViewer::connect(Source *src, SteadyTimePoint now) {
+    int fd = connect_inet(src->address, is_udp_ ? SOCK_DGRAM : SOCK_STREAM);
+    if (fd < 0) {
+        src->since = now + RECONNECT_INTERVAL;
+        return;
+    }
+
+    src->conn = std::make_unique<Connection>(fd);
+    src->reader = FrameReader{};
+
+    if (is_udp_) {
+        set_state(src, State::WAITING, now);
+        subscribe(src, now, RECONNECT_INTERVAL);
+    } else {
+        set_state(src, State::CONNECTING, now);
+    }
+}
+
+void RemoteViewer::disconnect(Source *src, SteadyTimePoint now) {
+    event_loop_->unwatch_fd(src->conn->get_fd());
+    src->conn.reset();
+
+    set_state(src, State::DOWN, now);
+    src->since = now + RECONNECT_INTERVAL;
+}
+
+void RemoteViewer::set_state(Source *src, State state, SteadyTimePoint now) {
+    src->state = state;
+    src->since = now;
+
+    if (src->conn != nullptr) {
+        event_loop_->watch_fd(src->conn->get_fd(),
+                              state == State::CONNECTING ? POLLOUT : POLLIN);
+    }
+}
+
+void RemoteViewer::subscribe(Source *src, SteadyTimePoint now, Millis next) {
+    frame_.clear();
+    append_subscribe(src->hello.nonce, &frame_);
+
+    // A subscribe that is lost, or refused while the daemon is away, is
+    // sent again
+    send(src->conn->get_fd(), frame_.data(), frame_.size(), 0);
+    src->next_subscribe = now + next;
+}
+
+bool RemoteViewer::read_stream(Source *src, SteadyTimePoint now) {
+    if (src->state == State::CONNECTING) {
+        int error{0};
+        socklen_t len = sizeof(error);
+        getsockopt(src->conn->get_fd(), SOL_SOCKET, SO_ERROR, &error, &len);
+
+        if (error != 0) {
+            disconnect(src, now);
+        } else {
+            set_state(src, State::WAITING, now);
+        }
+        return false;
+    }
+
+    bool is_sampled = false;
+
+    try {
+        if (!src->conn->receive(&src->reader)) {
+            disconnect(src, now);
+            return false;
+        }
+
+        MessageType type{};
+        std::string_view payload{};
+        while (src->reader.next(&type, &payload)) {
+            is_sampled = handle_frame(src, type, payload, now) || is_sampled;
+
+            if (src->conn == nullptr) {
+                break;
+            }
+        }
+    } catch (std::runtime_error &) {
+        // a host that sends garbage is as good as gone
+        disconnect(src, now);
+    }
+
+    return is_sampled;
+}
+
+bool RemoteViewer::read_datagrams(Source *src, SteadyTimePoint now) {
+    bool is_sampled = false;
+    datagram_.resize(MAX_DATAGRAM_LEN);
+
+    while (true) {
+        ssize_t rv =
+            recv(src->conn->get_fd(), datagram_.data(), datagram_.size(), 0);
+
+        if (rv < 0) {
+            // A refused datagram is a daemon that is away, which the
+            // subscribes find out about
+            if ((errno == EINTR) || (errno == ECONNREFUSED)) {
+                continue;
+            }
+
+            // EAGAIN once there are no more
+            return is_sampled;
+        }
+
+        MessageType type{};
+        std::string_view payload{};
+        if (!parse_frame(std::string_view{datagram_.data(), SIZE_T(rv)},
+                         &type, &payload)) {
+            continue;
+        }
+
+        // a datagram that cannot be parsed is dropped like a lost one
+        try {
+            is_sampled = handle_frame(src, type, payload, now) || is_sampled;
+        } catch (std::runtime_error &) {
+        }
+    }
+}
+
+bool RemoteViewer::handle_frame(Source *src, MessageType type,
+                                std::string_view payload,
+                                SteadyTimePoint now) {
+    // Unknown messages are skipped, so a newer daemon can send more
+    if (type == MessageType::HELLO) {
+        Hello hello{};
+        parse_hello(payload, &hello);
+
+        // eg. a host that was set up anew, a connection again gets the
+        // same, a subscribe is sent again anyway
+        if (!is_same_host(*src, hello)) {
+            if (!is_udp_) {
+                disconnect(src, now);
+            }
+            return false;
+        }
+
+        bool is_new_nonce = is_udp_ && (hello.nonce != src->hello.nonce);
+        src->hello = std::move(hello);
+        src->last_heard = now;
+        if (src->state != State::UP) {
+            set_state(src, State::UP, now);
+            src->next_subscribe = now + REMOTE_SUBSCRIBE_INTERVAL;
+        }
+
+        // a host that did not answer in time at first
+        if ((history_ != nullptr) && !src->is_recorded) {
+            add_host(src, now);
+        }
+
+        // The samples only come once the daemon has the nonce back, and
+        // soon again if that was lost
+        if (is_new_nonce) {
+            subscribe(src, now, RECONNECT_INTERVAL);
+        }
+        return false;
+    }
+
+    if ((type != MessageType::SAMPLES) || (src->state != State::UP)) {
+        return false;
+    }
+
+    parse_samples(payload, src->hello, &samples_);
+    src->last_heard = now;
+
+    // The daemon restarted, which only a hello says more about
+    if (samples_.session != src->hello.session) {
+        src->next_subscribe = now;
+        return false;
+    }
+
+    if ((history_ == nullptr) || !src->is_recorded) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < samples_.deltas.size(); ++i) {
+        history_->record(src->first_iface + i, samples_.tp,
+                         samples_.deltas[i]);
+        if (samples_.deltas[i].num_intervals != 0) {
+            changed_ifaces_.push_back(src->first_iface + i);
+        }
+    }
+    src->last_sampled = now;
+
+    return true;
+}
+
+bool RemoteViewer::is_same_host(const Source &src, const Hello &hello) const {
+    // Anything goes until the history is made of the hellos
+    if (history_ == nullptr) {
+        return true;
+    }
+
+    // One that is added late can have any ifaces, only what the history
+    // records is up to the hosts that were there at first
+    const auto &qttys = hello.qttys;
+    return (hello.interval == interval_) &&
+           (!src.is_recorded || (hello.iface_names == src.iface_names)) &&
+           std::all_of(history_->get_quantities().begin(),
+                       history_->get_quantities().end(),
+                       [&qttys](sampling::Quantity qtty) {
+                           return std::find(qttys.begin(), qttys.end(),
+                                            qtty) != qttys.end();
+                       });
+}
+
+void RemoteViewer::create_history(SteadyTimePoint now) {
+    auto is_up = [](const auto &src) { return src->state == State::UP; };
+    const auto &first = **std::find_if(sources_.begin(), sources_.end(), is_up);
+    interval_ = first.hello.interval;
+
+    // the quantities of the first host that all the others have too
+    auto qttys = first.hello.qttys;
+    std::vector<std::string> iface_names{};
+
+    for (const auto &src : sources_) {
+        if (!is_up(src)) {
+            continue;
+        }
+
+        const auto &hello = src->hello;
+        if (hello.interval != interval_) {
+            THROW_ARGS(std::runtime_error,
+                       "RemoteViewer: %s samples every %lld ms, %s every "
+                       "%lld ms",
+                       first.label.c_str(),
+                       static_cast<long long>(interval_.count()),
+                       src->label.c_str(),
+                       static_cast<long long>(hello.interval.count()));
+        }
+
+        qttys.erase(std::remove_if(qttys.begin(), qttys.end(),
+                                   [&hello](sampling::Quantity qtty) {
+                                       return std::find(hello.qttys.begin(),
+                                                        hello.qttys.end(),
+                                                        qtty) ==
+                                              hello.qttys.end();
+                                   }),
+                    qttys.end());
+
+        append_ifaces(src.get(), now, &iface_names);
+    }
+
+    if (qttys.empty()) {
+        THROW_MSG(std::runtime_error,
+                  "RemoteViewer: the hosts have no counters in common");
+    }
+
+    if (iface_names.empty()) {
+        THROW_MSG(std::runtime_error, "RemoteViewer: the hosts have no ifaces");
+    }
+
+    history_ = std::make_unique<sampling::History>(
+        iface_names, tools::MonotonicClock::from_steady(now),
+        sampling::get_windows_for_interval(interval_), retention_, qttys);
+}
+
+void RemoteViewer::add_host(Source *src, SteadyTimePoint now) {
+    std::vector<std::string> iface_names{};
+    for (std::size_t i = 0; i < history_->num_ifaces(); ++i) {
+        iface_names.push_back(history_->get_iface_name(i));
+    }
+    append_ifaces(src, now, &iface_names);
+
+    // The ifaces that are there already keep their buckets, which are moved
+    // over rather than copied
+    auto history = std::make_unique<sampling::History>(
+        iface_names, tools::MonotonicClock::from_steady(now),
+        sampling::get_windows_for_interval(interval_), retention_,
+        history_->get_quantities());
+    history->restore(history_.get());
+    history_ = std::move(history);
+}
+
+void RemoteViewer::append_ifaces(Source *src, SteadyTimePoint now,
+                                 std::vector<std::string> *iface_names) {
+    src->iface_names = src->hello.iface_names;
+    src->first_iface = iface_names->size();
+    src->last_sampled = now;
+    src->is_recorded = true;
+
+    for (const auto &name : src->iface_names) {
+        iface_names->push_back(src->label + ":" + name);
+    }
+}
+
+} // namespace service
+} // namespace bandwit
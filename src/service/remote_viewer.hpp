@@ -0,0 +1,146 @@
+#ifndef REMOTE_VIEWER_H
+#define REMOTE_VIEWER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aliases.hpp"
+#include "inet_socket.hpp"
+#include "macros.hpp"
+#include "protocol.hpp"
+#include "remote_protocol.hpp"
+#include "sampling/history.hpp"
+#include "sampling/retention.hpp"
+#include "service/unix_socket.hpp"
+#include "tools/event_loop.hpp"
+
+namespace bandwit {
+namespace service {
+
+// Keeps one history of the ifaces of the daemons on many hosts that
+// --serve, each iface named after its host, eg. web1:eth0 for eth0 on web1.
+// The samples of every host go into the history as they arrive, keyed on
+// the deadline they were taken for on the host.
+//
+// A host that goes away, or that was not there at first, is connected to
+// again, over TCP, or subscribed to again, over UDP, every few seconds for
+// as long as it is away. The
+// buckets of its ifaces are gaps in the meantime, rather than frozen at the
+// last sample it sent. Only the samples of the host it was at first, with
+// the same ifaces, are taken when it is back.
+class RemoteViewer {
+  public:
+    // Each address is HOST or HOST:PORT. Blocks until every host has said
+    // hello, or for a few seconds, and throws if none did. The ones that did
+    // not are warned about on stderr and tried again from then on, their
+    // ifaces are added once they answer. Every host has to sample at the
+    // same interval, the history records the quantities that all of the
+    // first ones have.
+    RemoteViewer(const std::vector<std::string> &addresses, bool is_udp,
+                 const sampling::Retention &retention);
+
+    CLASS_DISABLE_COPIES(RemoteViewer)
+    CLASS_DISABLE_MOVES(RemoteViewer)
+
+    // Watches the sockets of the hosts in the event loop from now on
+    void watch(tools::EventLoop *event_loop);
+
+    Millis get_interval() const;
+    // A host that is added late replaces the history with one that has its
+    // ifaces too, after the others
+    const sampling::History &get_history() const;
+
+    // Handles the sockets that are ready. Returns whether any samples came
+    // in.
+    bool receive(const tools::Events &events, SteadyTimePoint now);
+
+    // Connects again to the hosts that went away and records the gaps of
+    // the ones that went quiet, about once per interval. Returns whether
+    // there were any gaps.
+    bool poll(SteadyTimePoint now);
+    // The ifaces that got samples or gaps in the last receive() or poll(),
+    // an iface may be in it more than once
+    const std::vector<std::size_t> &get_changed_ifaces() const;
+
+  private:
+    enum class State {
+        // connecting again once it is time to
+        DOWN,
+        // over TCP until the connection is up
+        CONNECTING,
+        // for the hello
+        WAITING,
+        UP,
+    };
+
+    struct Source {
+        // the address as it was given, which names its ifaces
+        std::string label{};
+        InetAddress address{};
+
+        std::unique_ptr<Connection> conn{nullptr};
+        State state{State::DOWN};
+        // when it went into the state, or when to connect again if DOWN
+        SteadyTimePoint since{};
+        // when it last sent anything, and samples in particular
+        SteadyTimePoint last_heard{};
+        SteadyTimePoint last_sampled{};
+        // over UDP
+        SteadyTimePoint next_subscribe{};
+        // over TCP
+        FrameReader reader{};
+
+        // of the current session
+        Hello hello{};
+        // the ifaces it had at first, from the first one on in the history
+        std::vector<std::string> iface_names{};
+        std::size_t first_iface{0};
+        // whether its ifaces are in the history yet
+        bool is_recorded{false};
+    };
+
+    void connect(Source *src, SteadyTimePoint now);
+    void disconnect(Source *src, SteadyTimePoint now);
+    void set_state(Source *src, State state, SteadyTimePoint now);
+    void subscribe(Source *src, SteadyTimePoint now, Millis next);
+
+    bool read_stream(Source *src, SteadyTimePoint now);
+    bool read_datagrams(Source *src, SteadyTimePoint now);
+    // Returns whether they were samples. A frame that cannot be parsed
+    // throws.
+    bool handle_frame(Source *src, MessageType type, std::string_view payload,
+                      SteadyTimePoint now);
+    // whether it has what the history records of the host
+    bool is_same_host(const Source &src, const Hello &hello) const;
+
+    // of the hosts that are up
+    void create_history(SteadyTimePoint now);
+    void add_host(Source *src, SteadyTimePoint now);
+    // appends the names of the ifaces of src in the history
+    void append_ifaces(Source *src, SteadyTimePoint now,
+                       std::vector<std::string> *iface_names);
+
+    bool is_udp_{false};
+    std::vector<std::unique_ptr<Source>> sources_{};
+
+    // until the event loop of the caller watches the sockets
+    std::unique_ptr<tools::EventLoop> own_loop_{nullptr};
+    tools::EventLoop *event_loop_{nullptr};
+
+    Millis interval_{};
+    sampling::Retention retention_{};
+    std::unique_ptr<sampling::History> history_{nullptr};
+    std::vector<std::size_t> changed_ifaces_{};
+
+    // reused for every frame
+    RemoteSamples samples_{};
+    std::string frame_{};
+    std::string datagram_{};
+};
+
+} // namespace service
+} // namespace bandwit
+
+#endif // REMOTE_VIEWER_H
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "record_encoder.hpp"
+#include "replay_sampler.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/counter_delta.hpp"
+#include "tools/byte_stream.hpp"
+
+namespace bandwit {
+namespace service {
+
+// A gap is replayed as a jump that no counter can make, which the Recorder
+// turns into a gap all the same. Replaying it as a failed sample instead
+// would take the sample after it down with it.
+constexpr uint64_t GAP_JUMP = uint64_t{1} << 62U;
+
+ReplaySampler::ReplaySampler(const std::string &path) : path_{path} {
+    int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        THROW_ARGS(std::runtime_error, "ReplaySampler failed to open %s: %s",
+                   path_.c_str(), strerror(errno));
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        THROW_CERROR(std::runtime_error, "ReplaySampler failed in fstat()");
+    }
+
+    len_ = SIZE_T(st.st_size);
+    if (len_ < BinaryEncoder::BINARY_HEADER_LEN) {
+        close(fd);
+        THROW_ARGS(std::runtime_error,
+                   "%s is not a recording of --output=binary", path_.c_str());
+    }
+
+    void *addr = mmap(nullptr, len_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        THROW_CERROR(std::runtime_error, "ReplaySampler failed in mmap()");
+    }
+
+    data_ = static_cast<const char *>(addr);
+
+    try {
+        read_header();
+    } catch (...) {
+        munmap(const_cast<char *>(data_), len_);
+        throw;
+    }
+}
+
+ReplaySampler::~ReplaySampler() { munmap(const_cast<char *>(data_), len_); }
+
+void ReplaySampler::read_header() {
+    tools::ByteReader reader{
+        std::string_view{data_, BinaryEncoder::BINARY_HEADER_LEN}};
+
+    auto magic = reader.get_u64();
+    auto version = reader.get_u32();
+    if ((magic != BinaryEncoder::BINARY_MAGIC) ||
+        (version != BinaryEncoder::BINARY_VERSION)) {
+        THROW_ARGS(std::runtime_error,
+                   "%s is not a recording of --output=binary of this version",
+                   path_.c_str());
+    }
+
+    auto num_ifaces = SIZE_T(reader.get_u32());
+    interval_ = Millis{reader.get_u64()};
+    qttys_ = sampling::from_mask(reader.get_u32());
+    record_len_ = SIZE_T(reader.get_u32());
+
+    // The window of a record has to be one a sample can be over, a bucket
+    // of a longer window is already aggregated
+    if (!sampling::is_sampling_interval(interval_)) {
+        THROW_ARGS(std::runtime_error,
+                   "%s has a record per window of %lld ms, only a recording "
+                   "of every sample can be replayed",
+                   path_.c_str(), static_cast<long long>(interval_.count()));
+    }
+
+    auto names_len = num_ifaces * BinaryEncoder::BINARY_NAME_LEN;
+    records_offset_ = BinaryEncoder::BINARY_HEADER_LEN + names_len;
+    if ((num_ifaces == 0) || (records_offset_ > len_) ||
+        (record_len_ != BinaryEncoder::BINARY_RECORD_HEADER_LEN +
+                            (2 * sizeof(uint64_t) * qttys_.size()))) {
+        THROW_ARGS(std::runtime_error, "%s has a corrupt header",
+                   path_.c_str());
+    }
+
+    const char *name = data_ + BinaryEncoder::BINARY_HEADER_LEN;
+    for (std::size_t i = 0; i < num_ifaces; ++i) {
+        iface_names_.emplace_back(
+            name, strnlen(name, BinaryEncoder::BINARY_NAME_LEN));
+        name += BinaryEncoder::BINARY_NAME_LEN;
+    }
+
+    num_records_ = (len_ - records_offset_) / record_len_;
+    if (num_records_ == 0) {
+        THROW_ARGS(std::runtime_error, "%s has nothing to replay",
+                   path_.c_str());
+    }
+
+    start_ = get_next_time_point().value() - interval_;
+    tp_ = start_;
+
+    first_samples_.resize(num_ifaces);
+    for (auto &sample : first_samples_) {
+        sample.ts = start_;
+    }
+    samples_ = first_samples_;
+}
+
+std::string_view ReplaySampler::get_record(std::size_t record_idx) const {
+    auto offset = records_offset_ + (record_idx * record_len_);
+    return std::string_view{data_ + offset, record_len_};
+}
+
+sampling::Sample ReplaySampler::get_sample(const std::string &iface_name) {
+    auto it = std::find(iface_names_.begin(), iface_names_.end(), iface_name);
+    if (it == iface_names_.end()) {
+        sampling::Sample sample{};
+        sample.ts = tp_;
+        sample.error = sampling::SampleError::NO_SUCH_IFACE;
+        return sample;
+    }
+
+    return samples_[SIZE_T(it - iface_names_.begin())];
+}
+
+void ReplaySampler::get_samples(
+    [[maybe_unused]] const std::vector<std::string> &iface_names,
+    std::vector<sampling::Sample> *samples) {
+    auto next_tp = get_next_time_point();
+    if (next_tp.has_value()) {
+        tp_ = next_tp.value();
+    }
+
+    // All the ifaces of a sample were exported together, the records of the
+    // next time point are the ones after them
+    for (; next_record_ < num_records_; ++next_record_) {
+        tools::ByteReader reader{get_record(next_record_)};
+        if (tools::from_nanos(reader.get_i64()) != tp_) {
+            break;
+        }
+
+        auto idx = SIZE_T(reader.get_u32());
+        reader.get_u32();
+        if (idx >= samples_.size()) {
+            THROW_ARGS(std::runtime_error,
+                       "%s has a record of iface %zu of %zu", path_.c_str(),
+                       idx, samples_.size());
+        }
+
+        auto &sample = samples_[idx];
+        for (auto qtty : qttys_) {
+            auto rx = reader.get_u64();
+            auto tx = reader.get_u64();
+            sample.rx[qtty] += rx == sampling::GAP_DELTA ? GAP_JUMP : rx;
+            sample.tx[qtty] += tx == sampling::GAP_DELTA ? GAP_JUMP : tx;
+        }
+    }
+
+    for (auto &sample : samples_) {
+        sample.ts = tp_;
+    }
+
+    samples->assign(samples_.begin(), samples_.end());
+}
+
+const std::vector<std::string> &ReplaySampler::get_iface_names() const {
+    return iface_names_;
+}
+
+Millis ReplaySampler::get_interval() const { return interval_; }
+
+const std::vector<sampling::Quantity> &
+ReplaySampler::get_quantities() const {
+    return qttys_;
+}
+
+TimePoint ReplaySampler::get_time_point() const { return tp_; }
+
+std::optional<TimePoint> ReplaySampler::get_next_time_point() const {
+    if (next_record_ == num_records_) {
+        return std::nullopt;
+    }
+
+    tools::ByteReader reader{get_record(next_record_)};
+    return tools::from_nanos(reader.get_i64());
+}
+
+const std::vector<sampling::Sample> &
+ReplaySampler::get_first_samples() const {
+    return first_samples_;
+}
+
+TimePoint ReplaySampler::get_start() const { return start_; }
+
+} // namespace service
+} // namespace bandwit
@@ -0,0 +1,84 @@
+#ifndef REPLAY_SAMPLER_H
+#define REPLAY_SAMPLER_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/quantity.hpp"
+#include "sampling/sample.hpp"
+#include "sampling/sampler.hpp"
+
+namespace bandwit {
+namespace service {
+
+// Samples the ifaces of a recording made with the binary export, as if they
+// were being sampled live. The recording is memory mapped and read in place.
+// Every get_samples() moves on to the next time point in it and adds the
+// deltas recorded for that onto counters that start at 0, so that a Recorder
+// works out and records the very same deltas again, gaps and all.
+class ReplaySampler : public sampling::Sampler {
+  public:
+    explicit ReplaySampler(const std::string &path);
+    ~ReplaySampler() override;
+
+    CLASS_DISABLE_COPIES(ReplaySampler)
+    CLASS_DISABLE_MOVES(ReplaySampler)
+
+    // The counters as of the time point that was replayed last, this does
+    // not move on
+    sampling::Sample get_sample(const std::string &iface_name) override;
+
+    // The names are the ones of the recording
+    void get_samples(const std::vector<std::string> &iface_names,
+                     std::vector<sampling::Sample> *samples) override;
+
+    const std::vector<std::string> &get_iface_names() const;
+    // every sample of the recording is over this
+    Millis get_interval() const;
+    const std::vector<sampling::Quantity> &get_quantities() const;
+
+    // the time point that was replayed last, the start before the first
+    TimePoint get_time_point() const;
+    // the time point the next get_samples() replays, nullopt at the end
+    std::optional<TimePoint> get_next_time_point() const;
+
+    // The samples before the first time point, the point in time the
+    // history of the replay starts at. One interval before the first time
+    // point, the same as a live history starts one deadline before it.
+    const std::vector<sampling::Sample> &get_first_samples() const;
+    TimePoint get_start() const;
+
+  private:
+    void read_header();
+    std::string_view get_record(std::size_t record_idx) const;
+
+    std::string path_{};
+    const char *data_{nullptr};
+    std::size_t len_{0};
+
+    std::vector<std::string> iface_names_{};
+    Millis interval_{};
+    std::vector<sampling::Quantity> qttys_{};
+
+    // a trailing record that was being written when the copy was taken is
+    // not counted
+    std::size_t records_offset_{0};
+    std::size_t record_len_{0};
+    std::size_t num_records_{0};
+    std::size_t next_record_{0};
+
+    TimePoint start_{};
+    TimePoint tp_{};
+    std::vector<sampling::Sample> first_samples_{};
+    // the counters so far
+    std::vector<sampling::Sample> samples_{};
+};
+
+} // namespace service
+} // namespace bandwit
+
+#endif // REPLAY_SAMPLER_H
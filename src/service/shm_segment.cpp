@@ -0,0 +1,187 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "shm_segment.hpp"
+
+namespace bandwit {
+namespace service {
+
+// "BANDWSHM"
+constexpr uint64_t SHM_MAGIC = 0x4d485357444e4142;
+constexpr uint32_t SHM_VERSION = 3;
+
+// A reader that keeps catching the writer mid update gives up until the
+// next refresh rather than spin
+constexpr int MAX_COPY_ATTEMPTS = 100;
+
+ShmPublisher::ShmPublisher(std::string name, Millis interval,
+                           const sampling::History &history)
+    : name_{std::move(name)},
+      len_{sizeof(ShmHeader) + history.get_image_size()} {
+    // Never take over a segment that is there already: it may be another
+    // daemon's, or one that somebody else created for us to write into
+    int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if ((fd < 0) && (errno == EEXIST)) {
+        THROW_ARGS(std::runtime_error, "a segment is already published as: %s",
+                   name_.c_str());
+    }
+    if (fd < 0) {
+        THROW_CERROR(std::runtime_error, "ShmPublisher failed in shm_open()");
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(len_)) < 0) {
+        close(fd);
+        shm_unlink(name_.c_str());
+        THROW_CERROR(std::runtime_error, "ShmPublisher failed in ftruncate()");
+    }
+
+    void *addr = mmap(nullptr, len_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        shm_unlink(name_.c_str());
+        THROW_CERROR(std::runtime_error, "ShmPublisher failed in mmap()");
+    }
+
+    // The segment starts out zeroed, which is an empty image and seq 0
+    segment_ = static_cast<char *>(addr);
+    header_ = new (segment_) ShmHeader{};
+    header_->interval_ms = U64(interval.count());
+    header_->image_len = len_ - sizeof(ShmHeader);
+    header_->version = SHM_VERSION;
+
+    publish(history);
+
+    // Viewers check the magic first, so it goes in last
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = SHM_MAGIC;
+}
+
+ShmPublisher::~ShmPublisher() {
+    header_->is_closed.store(1, std::memory_order_release);
+
+    munmap(segment_, len_);
+    shm_unlink(name_.c_str());
+}
+
+void ShmPublisher::publish(const sampling::History &history) {
+    auto seq = header_->seq.load(std::memory_order_relaxed);
+
+    header_->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    history.write_image(segment_ + sizeof(ShmHeader));
+
+    header_->seq.store(seq + 2, std::memory_order_release);
+}
+
+ShmViewer::ShmViewer(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        THROW_CERROR(std::runtime_error, "ShmViewer failed in shm_open()");
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        THROW_CERROR(std::runtime_error, "ShmViewer failed in fstat()");
+    }
+
+    len_ = SIZE_T(st.st_size);
+    if (len_ < sizeof(ShmHeader)) {
+        close(fd);
+        THROW_MSG(std::runtime_error, "ShmViewer: segment too short");
+    }
+
+    void *addr = mmap(nullptr, len_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        THROW_CERROR(std::runtime_error, "ShmViewer failed in mmap()");
+    }
+
+    segment_ = static_cast<const char *>(addr);
+    header_ = reinterpret_cast<const ShmHeader *>(segment_);
+
+    bool is_valid = (header_->magic == SHM_MAGIC) &&
+                    (header_->version == SHM_VERSION) &&
+                    (header_->image_len == len_ - sizeof(ShmHeader));
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (!is_valid) {
+        munmap(const_cast<char *>(segment_), len_);
+        THROW_MSG(std::runtime_error, "ShmViewer: not a bandwit segment");
+    }
+
+    if (!refresh()) {
+        munmap(const_cast<char *>(segment_), len_);
+        THROW_MSG(std::runtime_error, "ShmViewer: could not read the segment");
+    }
+}
+
+ShmViewer::~ShmViewer() { munmap(const_cast<char *>(segment_), len_); }
+
+Millis ShmViewer::get_interval() const {
+    return Millis{static_cast<Millis::rep>(header_->interval_ms)};
+}
+
+const sampling::History &ShmViewer::get_history() const { return *history_; }
+
+bool ShmViewer::refresh() {
+    if (header_->is_closed.load(std::memory_order_acquire) != 0) {
+        THROW_MSG(std::runtime_error,
+                  "ShmViewer.refresh: the daemon went away");
+    }
+
+    if ((history_ != nullptr) &&
+        (header_->seq.load(std::memory_order_acquire) == seq_)) {
+        return false;
+    }
+
+    for (int attempt = 0; attempt < MAX_COPY_ATTEMPTS; ++attempt) {
+        if (try_copy()) {
+            // Only a consistent copy is worth validating
+            history_ =
+                sampling::History::read_image(image_.data(), image_.size());
+            return true;
+        }
+
+        sched_yield();
+    }
+
+    return false;
+}
+
+bool ShmViewer::try_copy() {
+    auto seq_before = header_->seq.load(std::memory_order_acquire);
+    if ((seq_before % 2) != 0) {
+        return false;
+    }
+
+    image_.assign(segment_ + sizeof(ShmHeader), len_ - sizeof(ShmHeader));
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto seq_after = header_->seq.load(std::memory_order_relaxed);
+
+    if (seq_before != seq_after) {
+        return false;
+    }
+
+    seq_ = seq_after;
+    return true;
+}
+
+std::string get_default_shm_name() {
+    return "/bandwit-" + std::to_string(getuid());
+}
+
+} // namespace service
+} // namespace bandwit
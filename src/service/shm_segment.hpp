@@ -0,0 +1,96 @@
+#ifndef SHM_SEGMENT_H
+#define SHM_SEGMENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "sampling/history.hpp"
+
+namespace bandwit {
+namespace service {
+
+// A POSIX shared memory segment holds the flat image of a History right
+// after this header. The publisher updates the image in place and readers
+// copy it out, guarded by a seqlock: seq is odd while an update is in
+// progress, and a copy is only consistent if seq was even and unchanged
+// from before to after taking it.
+struct ShmHeader {
+    uint64_t magic;
+    uint32_t version;
+
+    // set when the publisher goes away, the segment is stale from then on
+    std::atomic<uint32_t> is_closed;
+    std::atomic<uint64_t> seq;
+
+    uint64_t interval_ms;
+    uint64_t image_len;
+};
+
+// Readers live in other processes, the atomics must not hide a lock
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+// Publishes a History into a shared memory segment for any number of
+// ShmViewers to read. Publishing costs the same however many there are.
+class ShmPublisher {
+  public:
+    ShmPublisher(std::string name, Millis interval,
+                 const sampling::History &history);
+    ~ShmPublisher();
+
+    CLASS_DISABLE_COPIES(ShmPublisher)
+    CLASS_DISABLE_MOVES(ShmPublisher)
+
+    // The history must be the one the publisher was created with. Only the
+    // buckets that changed since the last publish are copied.
+    void publish(const sampling::History &history);
+
+  private:
+    std::string name_{};
+    std::size_t len_{0};
+    char *segment_{nullptr};
+    ShmHeader *header_{nullptr};
+};
+
+// Maps a segment created by a ShmPublisher read-only
+class ShmViewer {
+  public:
+    explicit ShmViewer(const std::string &name);
+    ~ShmViewer();
+
+    CLASS_DISABLE_COPIES(ShmViewer)
+    CLASS_DISABLE_MOVES(ShmViewer)
+
+    Millis get_interval() const;
+    const sampling::History &get_history() const;
+
+    // Takes a fresh copy of the history if it was published since the last
+    // one. Returns whether it did, and throws if the publisher went away.
+    // Replaces the History that get_history() returned.
+    bool refresh();
+
+  private:
+    bool try_copy();
+
+    std::size_t len_{0};
+    const char *segment_{nullptr};
+    const ShmHeader *header_{nullptr};
+
+    // the last consistent copy of the image and the seq it was taken at
+    std::string image_{};
+    uint64_t seq_{0};
+
+    std::unique_ptr<sampling::History> history_{nullptr};
+};
+
+// /bandwit-<uid>
+std::string get_default_shm_name();
+
+} // namespace service
+} // namespace bandwit
+
+#endif // SHM_SEGMENT_H
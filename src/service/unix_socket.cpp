@@ -0,0 +1,247 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "unix_socket.hpp"
+
+namespace bandwit {
+namespace service {
+
+static sockaddr_un make_address(const std::string &path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+        THROW_ARGS(std::runtime_error, "socket path too long: %s",
+                   path.c_str());
+    }
+
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+static int open_socket() {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        THROW_CERROR(std::runtime_error, "open_socket failed in socket()");
+    }
+
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return fd;
+}
+
+Connection::~Connection() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+int Connection::get_fd() const { return fd_; }
+
+void Connection::set_nonblocking() {
+    int flags = fcntl(fd_, F_GETFL);
+    if ((flags < 0) || (fcntl(fd_, F_SETFL, flags | O_NONBLOCK) < 0)) {
+        THROW_CERROR(std::runtime_error,
+                     "Connection.set_nonblocking failed in fcntl()");
+    }
+}
+
+bool Connection::send_all(std::string_view data) {
+    std::size_t sent{0};
+
+#ifdef MSG_NOSIGNAL
+    // A peer that went away must not kill us with SIGPIPE
+    int flags = MSG_NOSIGNAL;
+#else
+    int flags = 0;
+#endif
+
+    while (sent < data.size()) {
+        ssize_t rv = send(fd_, data.data() + sent, data.size() - sent, flags);
+
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        sent += SIZE_T(rv);
+    }
+
+    return true;
+}
+
+bool Connection::queue(std::string_view data) {
+    // Drop what went out already once it is most of the buffer, so that a
+    // peer that never quite catches up does not grow it without bound
+    if (output_start_ > output_.size() / 2) {
+        output_.erase(0, output_start_);
+        output_start_ = 0;
+    }
+
+    output_.append(data);
+    return flush();
+}
+
+bool Connection::flush() {
+#ifdef MSG_NOSIGNAL
+    int flags = MSG_NOSIGNAL;
+#else
+    int flags = 0;
+#endif
+
+    while (output_start_ < output_.size()) {
+        ssize_t rv = send(fd_, output_.data() + output_start_,
+                          output_.size() - output_start_, flags);
+
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+
+        output_start_ += SIZE_T(rv);
+    }
+
+    // All of it went out, the buffer is kept for the next frames
+    output_.clear();
+    output_start_ = 0;
+    return true;
+}
+
+std::size_t Connection::get_queued_size() const {
+    return output_.size() - output_start_;
+}
+
+bool Connection::receive(FrameReader *reader) {
+    char buf[16 * 1024];
+
+    while (true) {
+        ssize_t rv = recv(fd_, buf, sizeof(buf), 0);
+
+        if (rv > 0) {
+            reader->append(buf, SIZE_T(rv));
+            continue;
+        }
+
+        if (rv == 0) {
+            return false;
+        }
+
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            return true;
+        }
+
+        if (errno != EINTR) {
+            THROW_CERROR(std::runtime_error,
+                         "Connection.receive failed in recv()");
+        }
+    }
+}
+
+void Connection::receive_frame(FrameReader *reader, MessageType *type,
+                               std::string_view *payload) {
+    char buf[16 * 1024];
+
+    while (!reader->next(type, payload)) {
+        ssize_t rv = recv(fd_, buf, sizeof(buf), 0);
+
+        if (rv == 0) {
+            THROW_MSG(std::runtime_error,
+                      "Connection.receive_frame: connection closed");
+        }
+
+        if (rv < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            THROW_CERROR(std::runtime_error,
+                         "Connection.receive_frame failed in recv()");
+        }
+
+        reader->append(buf, SIZE_T(rv));
+    }
+}
+
+UnixListener::UnixListener(std::string path) : path_{std::move(path)} {
+    auto addr = make_address(path_);
+    prepare_socket_dir(path_);
+    remove_stale_socket();
+
+    fd_ = open_socket();
+
+    if (bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        THROW_CERROR(std::runtime_error, "UnixListener failed in bind()");
+    }
+
+    // Only we get to connect, wherever the socket is
+    if (chmod(path_.c_str(), 0600) < 0) {
+        THROW_CERROR(std::runtime_error, "UnixListener failed in chmod()");
+    }
+
+    if (listen(fd_, 8) < 0) {
+        THROW_CERROR(std::runtime_error, "UnixListener failed in listen()");
+    }
+}
+
+UnixListener::~UnixListener() {
+    if (fd_ >= 0) {
+        close(fd_);
+        unlink(path_.c_str());
+    }
+}
+
+int UnixListener::get_fd() const { return fd_; }
+
+std::unique_ptr<Connection> UnixListener::accept_connection() {
+    int fd = accept(fd_, nullptr, nullptr);
+    if (fd < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "UnixListener.accept_connection failed in accept()");
+    }
+
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    return std::make_unique<Connection>(fd);
+}
+
+void UnixListener::remove_stale_socket() {
+    auto addr = make_address(path_);
+
+    int fd = open_socket();
+    int rv = connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+    int errno_orig = errno;
+    close(fd);
+
+    if (rv == 0) {
+        THROW_ARGS(std::runtime_error,
+                   "a daemon is already listening on: %s", path_.c_str());
+    }
+
+    if (errno_orig == ECONNREFUSED) {
+        unlink(path_.c_str());
+    }
+}
+
+std::unique_ptr<Connection> connect_unix(const std::string &path) {
+    auto addr = make_address(path);
+    prepare_socket_dir(path);
+    auto conn = std::make_unique<Connection>(open_socket());
+
+    if (connect(conn->get_fd(), reinterpret_cast<sockaddr *>(&addr),
+                sizeof(addr)) < 0) {
+        THROW_CERROR(std::runtime_error, "connect_unix failed in connect()");
+    }
+
+    return conn;
+}
+
+} // namespace service
+} // namespace bandwit
@@ -0,0 +1,84 @@
+#ifndef UNIX_SOCKET_H
+#define UNIX_SOCKET_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+#include "protocol.hpp"
+
+namespace bandwit {
+namespace service {
+
+// A connected stream socket, closed on destruction
+class Connection {
+  public:
+    explicit Connection(int fd) : fd_{fd} {}
+    ~Connection();
+
+    CLASS_DISABLE_COPIES(Connection)
+    CLASS_DISABLE_MOVES(Connection)
+
+    int get_fd() const;
+
+    void set_nonblocking();
+
+    // Blocks until all of data is sent, or on a non-blocking socket until
+    // the socket buffer is full. Returns false if the peer went away or
+    // could not take all of it.
+    bool send_all(std::string_view data);
+
+    // On a non-blocking socket: queues data behind what is still queued and
+    // sends as much of it as the socket takes right away. The rest goes out
+    // with flush once the socket has room again. Return false if the peer
+    // went away.
+    bool queue(std::string_view data);
+    bool flush();
+    // what is queued and not sent yet
+    std::size_t get_queued_size() const;
+
+    // Reads whatever is available into the reader. Returns false on EOF.
+    bool receive(FrameReader *reader);
+
+    // Blocks until a complete frame has arrived
+    void receive_frame(FrameReader *reader, MessageType *type,
+                       std::string_view *payload);
+
+  private:
+    int fd_{-1};
+
+    // [output_start_, output_.size()) is not sent yet
+    std::string output_{};
+    std::size_t output_start_{0};
+};
+
+// Listens on a unix socket at a path in the filesystem, which is removed
+// again on destruction.
+class UnixListener {
+  public:
+    explicit UnixListener(std::string path);
+    ~UnixListener();
+
+    CLASS_DISABLE_COPIES(UnixListener)
+    CLASS_DISABLE_MOVES(UnixListener)
+
+    int get_fd() const;
+    std::unique_ptr<Connection> accept_connection();
+
+  private:
+    // A socket file that is left over from a process that is gone is
+    // removed, one that someone is still listening on is an error
+    void remove_stale_socket();
+
+    std::string path_{};
+    int fd_{-1};
+};
+
+std::unique_ptr<Connection> connect_unix(const std::string &path);
+
+} // namespace service
+} // namespace bandwit
+
+#endif // UNIX_SOCKET_H
@@ -1,10 +1,11 @@
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <limits>
 #include <numeric>
-#include <sstream>
 
 #include "bar_chart.hpp"
+#include "glyph.hpp"
 #include "macros.hpp"
 #include "terminal_surface.hpp"
 
@@ -18,131 +19,435 @@ void BarChart::draw_bars_from_right(const std::string &iface_name,
                                     const TimeSeriesSlice &slice,
                                     DisplayScale scale, Statistic stat) {
     auto dim = surface_->get_size();
-    std::vector<uint16_t> scaled{};
 
-    auto max = std::max_element(slice.values.begin(), slice.values.end());
-    uint64_t max_value = *max;
+    // Find the max of the raw sums and only then apply the statistic, which
+    // the linear scale does not even need since it cancels out
+    uint64_t max_raw = get_max_raw(slice, scale, stat);
+    uint64_t max_value = slice.to_stat(max_raw);
 
-    if (scale == DisplayScale::LINEAR) {
+    surface_->clear_surface();
+
+    uint16_t bottom_edge = dim.height - chart_offset_;
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::SCALE};
+        scale_bars(slice, max_raw, scale, bottom_edge);
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::DRAW};
+        draw_bars(dim, bottom_edge, Direction::UP);
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::FORMAT};
+        draw_yaxis(dim, max_value, scale, stat);
+        draw_xaxis(dim, slice);
+        draw_yaxis_label(dim, scale);
+        draw_title(title, slice, stat);
+        draw_menu(iface_name, dim);
+    }
+
+    tools::StageTimer timer{profiler_, tools::Stage::FLUSH};
+    surface_->flush();
+}
+
+void BarChart::draw_mirrored_bars(const std::string &iface_name,
+                                  const TimeSeriesSlice &slice_up,
+                                  const TimeSeriesSlice &slice_down,
+                                  DisplayScale scale, Statistic stat) {
+    auto dim = surface_->get_size();
+
+    // Both halves share the scale, so that they can be compared
+    uint64_t max_raw = std::max(get_max_raw(slice_up, scale, stat),
+                                get_max_raw(slice_down, scale, stat));
+    uint64_t max_value = slice_up.to_stat(max_raw);
+
+    surface_->clear_surface();
+
+    // The halves are the same height, an odd row left over goes to the top
+    // where the title is
+    uint16_t bottom_edge = dim.height - chart_offset_;
+    uint16_t half_height = bottom_edge / 2;
+    uint16_t baseline = bottom_edge - half_height;
+
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::SCALE};
+        scale_bars(slice_up, max_raw, scale, half_height);
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::DRAW};
+        draw_bars(dim, baseline, Direction::UP);
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::SCALE};
+        scale_bars(slice_down, max_raw, scale, half_height);
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::DRAW};
+        draw_bars(dim, baseline + 1, Direction::DOWN);
+    }
+    {
+        // The labels are laid out as for a chart of half the height
+        tools::StageTimer timer{profiler_, tools::Stage::FORMAT};
+        update_yaxis(half_height + chart_offset_, max_value, scale, stat);
+        put_yaxis(baseline, Direction::UP);
+        put_yaxis(baseline + 1, Direction::DOWN);
+
+        draw_xaxis(dim, slice_up);
+        draw_yaxis_label(dim, scale);
+        draw_title("rx (up) tx (down)", slice_up, stat);
+        draw_menu(iface_name, dim);
+    }
+
+    tools::StageTimer timer{profiler_, tools::Stage::FLUSH};
+    surface_->flush();
+}
+
+// 2^(k/8) and 10^(k/8), where the top cell of a log bar gets its kth eighth
+constexpr std::array<double, 8> EIGHTHS_LOG2{
+    1.0,
+    1.0905077326652577,
+    1.189207115002721,
+    1.2968395546510096,
+    1.4142135623730951,
+    1.5422108254079407,
+    1.681792830507429,
+    1.8340080864093424,
+};
+
+constexpr std::array<double, 8> EIGHTHS_LOG10{
+    1.0,
+    1.333521432163324,
+    1.7782794100389228,
+    2.371373705661655,
+    3.1622776601683795,
+    4.216965034285822,
+    5.623413251903491,
+    7.498942093324558,
+};
+
+constexpr std::array<uint64_t, 20> POWERS_OF_10{
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL,
+};
+
+// Number of bits needed to hold value, 0 for 0. Same as the integer part of
+// log2(value) + 1.
+static uint16_t get_bit_width(uint64_t value) {
+    return value == 0 ? 0 : U16(64 - __builtin_clzll(value));
+}
+
+// Number of decimal digits of value, 0 for 0. Same as the integer part of
+// log10(value) + 1.
+static uint16_t get_num_digits(uint64_t value) {
+    // 1233 / 4096 is just under log10(2), so this is the number of digits
+    // or one less
+    auto guess = SIZE_T(get_bit_width(value)) * 1233 >> 12U;
+    return U16(guess + (value >= POWERS_OF_10[guess] ? 1 : 0));
+}
+
+// The height of a bar without any samples, which is drawn apart from a bar
+// of zero. No real bar is anywhere near as high.
+constexpr uint16_t GAP_HEIGHT = UINT16_MAX;
+// and of a bucket from before the first sample, which has no bar at all
+constexpr uint16_t BLANK_HEIGHT = UINT16_MAX - 1;
+// and of one whose sample is still to come, which is dotted
+constexpr uint16_t PENDING_HEIGHT = UINT16_MAX - 2;
+
+// How many eighths of the next cell value reaches past base, where base is
+// the power of 2 or 10 that the whole cells of the bar stand for
+static uint16_t get_log_eighths(uint64_t value, uint64_t base,
+                                const std::array<double, 8> &thresholds) {
+    uint16_t eighths{0};
+    for (std::size_t k = 1; k < thresholds.size(); ++k) {
+        eighths += F64(value) >= F64(base) * thresholds[k] ? 1 : 0;
+    }
+    return eighths;
+}
+
+uint64_t BarChart::get_max_raw(const TimeSeriesSlice &slice,
+                               DisplayScale scale, Statistic stat) const {
+    if (scale != DisplayScale::LINE_RATE) {
+        return slice.get_max_value();
+    }
+
+    // Nothing to scan, the line rate is a rate and a sum is of a whole
+    // bucket
+    auto max_value = line_rate_;
+    if (stat == Statistic::SUM) {
+        max_value = line_rate_ * U64(slice.get_interval().count()) / 1000;
+    }
+    return slice.from_stat(max_value);
+}
+
+void BarChart::scale_bars(const TimeSeriesSlice &slice, uint64_t max_raw,
+                          DisplayScale scale, uint16_t max_height) {
+    auto len = slice.size();
+
+    // Everything below is in sub cells, which are eighths for EIGHTHS
+    uint16_t resolution = style_ == BarStyle::EIGHTHS ? 8 : 1;
+    max_height = U16(max_height * resolution);
+
+    // Gather the values into one array first, so that the loops below run
+    // over plain arrays and can be vectorized
+    bar_values_.resize(len);
+    bar_heights_.resize(len);
+
+    for (std::size_t i = 0; i < len; ++i) {
+        bar_values_[i] = slice.get_value(i);
+    }
+
+    const uint64_t *values = bar_values_.data();
+    uint16_t *heights = bar_heights_.data();
+
+    if ((scale == DisplayScale::LINEAR) ||
+        (scale == DisplayScale::LINE_RATE)) {
+        // The linear scale is relative to the max of the raw sums, which the
+        // statistic would cancel out of. Bars above the line rate, eg. of
+        // a late sample, are cut off at the top.
+        double factor = max_raw > 0 ? F64(max_height) / F64(max_raw) : 0.0;
+
+        // The reciprocal can be off by one either way when the height is a
+        // whole number of cells, eg. half the max on an even height. As long
+        // as it cannot overflow this is fixed up in integers.
+        bool is_exact = max_raw <= UINT64_MAX / (U64(max_height) + 1);
+        uint64_t height = max_height;
+
+        for (std::size_t i = 0; i < len; ++i) {
+            auto cells = U64(F64(values[i]) * factor);
+
+            if (is_exact) {
+                uint64_t scaled = values[i] * height;
+                cells += (cells + 1) * max_raw <= scaled ? 1 : 0;
+                cells -= cells * max_raw > scaled ? 1 : 0;
+            }
 
-        for (auto it = slice.values.rbegin(); it != slice.values.rend(); ++it) {
-            double perc = F64(*it) / F64(max_value);
-            auto magnitude = U64(perc * F64(dim.height - chart_offset_));
-            scaled.push_back(magnitude);
+            heights[i] = U16(std::min(cells, height));
         }
 
-    } else if (scale == DisplayScale::LOG10) {
+        mark_gaps(slice);
+        return;
+    }
 
-        for (auto it = slice.values.rbegin(); it != slice.values.rend(); ++it) {
-            auto magnitude = U64(std::log10(F64(*it)) + 1);
-            scaled.push_back(magnitude);
+    // log(0) is -inf, give it no bar at all
+    for (std::size_t i = 0; i < len; ++i) {
+        auto stat_value = slice.to_stat(values[i]);
+        auto height = scale == DisplayScale::LOG10 ? get_num_digits(stat_value)
+                                                   : get_bit_width(stat_value);
+
+        if ((resolution > 1) && (height > 0)) {
+            auto exponent = U64(height - 1);
+            auto eighths =
+                scale == DisplayScale::LOG10
+                    ? get_log_eighths(stat_value, POWERS_OF_10[exponent],
+                                      EIGHTHS_LOG10)
+                    : get_log_eighths(stat_value, 1ULL << exponent,
+                                      EIGHTHS_LOG2);
+            height = U16(height * resolution + eighths);
         }
 
-    } else if (scale == DisplayScale::LOG2) {
+        heights[i] = std::min(height, max_height);
+    }
+
+    mark_gaps(slice);
+}
 
-        for (auto it = slice.values.rbegin(); it != slice.values.rend(); ++it) {
-            auto magnitude = U64(std::log2(F64(*it)) + 1);
-            scaled.push_back(magnitude);
+void BarChart::mark_gaps(const TimeSeriesSlice &slice) {
+    for (std::size_t i = 0; i < bar_heights_.size(); ++i) {
+        if (slice.is_gap(i)) {
+            bar_heights_[i] = GAP_HEIGHT;
+        } else if (slice.is_blank(i)) {
+            bar_heights_[i] = BLANK_HEIGHT;
+        } else if (slice.is_pending(i)) {
+            bar_heights_[i] = PENDING_HEIGHT;
         }
     }
+}
 
-    surface_->clear_surface();
+void BarChart::draw_bars(const Dimensions &dim, uint16_t baseline,
+                         Direction direction) {
+    uint16_t resolution = style_ == BarStyle::EIGHTHS ? 8 : 1;
+    bool is_up = direction == Direction::UP;
+
+    // The bars are drawn right aligned, the last one in the last column
+    auto col_cur = INT(dim.width) - INT(bar_heights_.size()) + 1;
+    for (auto height : bar_heights_) {
+        if (col_cur < 1) {
+            ++col_cur;
+            continue;
+        }
 
-    uint16_t col_cur = dim.width;
-    uint16_t bottom_edge = dim.height - chart_offset_;
-    uint16_t vertical_space = bottom_edge;
-    for (auto value : scaled) {
-        if (value == 0) {
-            Point pt{col_cur, bottom_edge};
-            surface_->put_uchar(pt, u8"▁");
+        auto x = U16(col_cur);
+        auto num_cells = U16(height / resolution);
+        auto num_eighths = SIZE_T(height % resolution);
+
+        if (height == GAP_HEIGHT) {
+            surface_->put_glyph(Point{x, baseline}, GLYPH_DASHED_LINE);
+            ++col_cur;
+            continue;
         }
 
-        for (uint16_t j = 0; j < value && j < vertical_space; ++j) {
-            uint16_t y = bottom_edge - j;
-            Point pt{col_cur, y};
-            surface_->put_uchar(pt, u8"█");
+        if (height == PENDING_HEIGHT) {
+            surface_->put_glyph(Point{x, baseline}, GLYPH_MIDDLE_DOT);
+            ++col_cur;
+            continue;
         }
 
-        --col_cur;
-    }
+        if (height == BLANK_HEIGHT) {
+            ++col_cur;
+            continue;
+        }
 
-    draw_yaxis(dim, max_value, scale, stat);
-    draw_xaxis(dim, slice);
-    draw_yaxis_label(dim, scale);
-    draw_title(title, slice, stat);
-    draw_menu(iface_name, dim);
+        if (height == 0) {
+            surface_->put_glyph(Point{x, baseline}, is_up ? GLYPH_LOWER_EIGHTH
+                                                          : GLYPH_UPPER_EIGHTH);
+        } else if (is_up) {
+            surface_->fill_column(Point{x, baseline}, num_cells,
+                                  GLYPH_FULL_BLOCK);
+        } else {
+            auto bottom = U16(baseline + num_cells - 1);
+            surface_->fill_column(Point{x, bottom}, num_cells,
+                                  GLYPH_FULL_BLOCK);
+        }
 
-    surface_->flush();
+        // The only blocks that hang from the top of a cell are the upper
+        // eighth and the upper half
+        if (num_eighths > 0) {
+            if (is_up) {
+                Point top{x, U16(baseline - num_cells)};
+                surface_->put_glyph(top, GLYPH_LOWER_EIGHTHS[num_eighths]);
+            } else {
+                Point top{x, U16(baseline + num_cells)};
+                surface_->put_glyph(top, num_eighths >= 4 ? GLYPH_UPPER_HALF
+                                                          : GLYPH_UPPER_EIGHTH);
+            }
+        }
+
+        ++col_cur;
+    }
+}
+
+bool BarChart::YAxisKey::operator==(const YAxisKey &other) const {
+    return (max_value == other.max_value) && (scale == other.scale) &&
+           (stat == other.stat) && (qtty == other.qtty) &&
+           (height == other.height);
 }
 
 void BarChart::draw_yaxis(const Dimensions &dim, uint64_t max_value,
                           DisplayScale scale, Statistic stat) {
+    update_yaxis(dim.height, max_value, scale, stat);
+    put_yaxis(dim.height - chart_offset_, Direction::UP);
+}
+
+void BarChart::update_yaxis(uint16_t height, uint64_t max_value,
+                            DisplayScale scale, Statistic stat) {
+    // The log scales and the line rate have the same ticks whatever the max
+    // is
+    if (scale != DisplayScale::LINEAR) {
+        max_value = 0;
+    }
+
+    YAxisKey key{max_value, scale, stat, qtty_, height};
+    if (!(yaxis_key_ && (*yaxis_key_ == key))) {
+        format_yaxis(key);
+        yaxis_key_ = key;
+    }
+}
+
+void BarChart::put_yaxis(uint16_t baseline, Direction direction) {
+    int step = direction == Direction::UP ? -1 : 1;
+    int row_cur = baseline;
+
+    for (const auto &label : yaxis_labels_) {
+        Point pt{1, U16(row_cur)};
+        surface_->put_string(pt, label);
+        row_cur += step;
+    }
+}
+
+void BarChart::format_yaxis(const YAxisKey &key) {
     std::vector<uint64_t> ticks{};
-    std::vector<std::string> ticks_fmt{};
     YAxisScale y_scale = YAxisScale::BASE2;
+    int num_rows = key.height - chart_offset_;
 
-    if (scale == DisplayScale::LINEAR) {
+    if (key.scale == DisplayScale::LINEAR) {
 
-        double factor = 1.0 / F64(dim.height);
-        for (int x = 1; x <= dim.height - chart_offset_; ++x) {
-            auto tick = U64(F64(max_value) * (x * factor));
+        double factor = 1.0 / F64(key.height);
+        for (int x = 1; x <= num_rows; ++x) {
+            auto tick = U64(F64(key.max_value) * (x * factor));
             ticks.push_back(tick);
         }
 
-    } else if (scale == DisplayScale::LOG10) {
+    } else if (key.scale == DisplayScale::LOG10) {
         y_scale = YAxisScale::BASE10;
 
-        for (int x = 0; x < dim.height - chart_offset_; ++x) {
+        for (int x = 0; x < num_rows; ++x) {
             double tick = std::pow(10.0, F64(x));
             if (tick < std::numeric_limits<uint64_t>::max()) {
                 ticks.push_back(U64(tick));
             }
         }
 
-    } else if (scale == DisplayScale::LOG2) {
+    } else if (key.scale == DisplayScale::LOG2) {
 
-        for (int x = 0; x < dim.height - chart_offset_; ++x) {
+        for (int x = 0; x < num_rows; ++x) {
             double tick = std::pow(2.0, F64(x));
             if (tick < std::numeric_limits<uint64_t>::max()) {
                 ticks.push_back(U64(tick));
             }
         }
-    }
 
-    for (const auto &tick : ticks) {
-        std::string tick_fmt{};
-        if (stat == Statistic::AVERAGE) {
-            tick_fmt = formatter_.format_num_bytes_rate(y_scale, tick, "s");
-        } else if (stat == Statistic::SUM) {
-            tick_fmt = formatter_.format_num_bytes(y_scale, tick);
+    } else if (key.scale == DisplayScale::LINE_RATE) {
+        // In percent, where the top row is all of the line rate
+        yaxis_labels_.resize(SIZE_T(std::max(num_rows, 0)));
+
+        NumBytesBuffer buf{};
+        for (int x = 1; x <= num_rows; ++x) {
+            auto milli_pct = U64(x) * 100 * 1000 / U64(num_rows);
+            yaxis_labels_[SIZE_T(x - 1)].assign(formatter_.format_decimal(
+                &buf, milli_pct / 1000, milli_pct % 1000, "%"));
         }
-        ticks_fmt.push_back(std::move(tick_fmt));
+        return;
     }
 
-    uint16_t row_cur = dim.height - chart_offset_;
-    for (const auto &tick_fmt : ticks_fmt) {
-        Point pt{1, row_cur--};
-        surface_->put_string(pt, tick_fmt);
+    // Reuse the strings, so that their buffers are reused too
+    yaxis_labels_.resize(ticks.size());
+
+    NumBytesBuffer buf{};
+    for (std::size_t i = 0; i < ticks.size(); ++i) {
+        std::string_view label{};
+        if (key.qtty != sampling::Quantity::BYTES) {
+            label = key.stat == Statistic::SUM
+                        ? formatter_.format_count(&buf, ticks[i])
+                        : formatter_.format_count_rate(&buf, ticks[i], "s");
+        } else if (key.stat == Statistic::SUM) {
+            label = formatter_.format_num_bytes(&buf, y_scale, ticks[i]);
+        } else {
+            label = formatter_.format_num_bytes_rate(&buf, y_scale, ticks[i],
+                                                     "s");
+        }
+        yaxis_labels_[i].assign(label);
     }
 }
 
 void BarChart::draw_xaxis(const Dimensions &dim, const TimeSeriesSlice &slice) {
-    FormattedString axis{};
-
-    switch (slice.agg_window) {
-    case AggregationWindow::ONE_SECOND:
-        axis = formatter_.format_xaxis_per_sec(slice.time_points);
-        break;
-    case AggregationWindow::ONE_MINUTE:
-        axis = formatter_.format_xaxis_per_min(slice.time_points);
-        break;
-    case AggregationWindow::ONE_HOUR:
-        axis = formatter_.format_xaxis_per_hour(slice.time_points);
-        break;
-    case AggregationWindow::ONE_DAY:
-        axis = formatter_.format_xaxis_per_day(slice.time_points);
-        break;
-    }
+    const auto &axis = formatter_.format_xaxis(slice);
 
     uint16_t col = dim.width - axis.size() + 1;
     auto y = U16(dim.height - xaxis_offset_);
@@ -152,11 +457,8 @@ void BarChart::draw_xaxis(const Dimensions &dim, const TimeSeriesSlice &slice) {
 }
 
 void BarChart::draw_yaxis_label(const Dimensions &dim, DisplayScale scale) {
-    std::string label = get_label(scale);
-
-    std::stringstream ss{};
-    ss << "<" << label << ">";
-    std::string label_fmt = ss.str();
+    auto &label_fmt = text_;
+    label_fmt.assign("<").append(get_label(scale)).append(">");
 
     auto col = U16((INT(scale_width_) / 2) - (INT(label_fmt.size()) / 2));
     uint16_t y = dim.height - 1;
@@ -165,15 +467,19 @@ void BarChart::draw_yaxis_label(const Dimensions &dim, DisplayScale scale) {
     surface_->put_string(pt, label_fmt);
 }
 
-void BarChart::draw_title(const std::string &title,
+void BarChart::draw_title(std::string_view title,
                           const TimeSeriesSlice &slice, Statistic stat) {
     auto dim = surface_->get_size();
     auto interval_label = sampling::get_label(slice.agg_window);
     auto stat_label = sampling::get_label(stat);
 
-    std::stringstream ss{};
-    ss << "[" << stat_label << " " << title << "/" << interval_label << "]";
-    std::string title_fmt = ss.str();
+    // eg. [avg received/sec], or [avg received packets/sec] for a count
+    auto &title_fmt = text_;
+    title_fmt.assign("[").append(stat_label).append(" ").append(title);
+    if (qtty_ != sampling::Quantity::BYTES) {
+        title_fmt.append(" ").append(sampling::get_label(qtty_));
+    }
+    title_fmt.append("/").append(interval_label).append("]");
 
     auto col = U16((INT(dim.width) / 2) - (INT(title_fmt.size()) / 2));
     uint16_t y = 1;
@@ -183,28 +489,52 @@ void BarChart::draw_title(const std::string &title,
 }
 
 void BarChart::draw_menu(const std::string &iface_name, const Dimensions &dim) {
-    std::string menu{" (q)uit (r)x (t)x s(c)ale (s)tat (arrow keys)"};
+    auto &menu = menu_;
+    if (prompt_.empty()) {
+        menu.assign(" (q)uit (r)x (t)x (d)ual s(c)ale (s)tat (i)face (b)ars "
+                    "(g)oto t(o)p (h)eat (arrow keys)");
+    } else {
+        menu.assign(" ").append(prompt_);
+    }
     menu.resize(dim.width, ' ');
 
-    // format iface
-    std::stringstream ss{};
-    ss << "[" << iface_name << "]";
-    std::string iface_label = ss.str();
-
-    // insert iface at the end
-    auto to_index = menu.size() - 0;
-    auto from_index = to_index - iface_label.size();
-    menu.replace(from_index, to_index, iface_label);
+    // insert iface at the end, eg. [eth0]
+    auto label_len = iface_name.size() + 2;
+    auto from_index = menu.size() - std::min(label_len, menu.size());
+    menu.replace(from_index, menu.size(), "[").append(iface_name).append("]");
 
     uint16_t col = 1;
     uint16_t y = dim.height;
 
-    std::string menu_fmt = formatter_.reverse_video(menu);
+    auto &menu_fmt = text_;
+    menu_fmt.clear();
+
+    // the alert takes the place of the start of the menu
+    std::string_view menu_view{menu};
+    if (!alert_.empty() && (menu_view.size() > 2)) {
+        auto alert_len = std::min(alert_.size(), menu_view.size() - 2);
+        menu_fmt.append(" ");
+        formatter_.bold(&menu_fmt,
+                        std::string_view{alert_}.substr(0, alert_len));
+        menu_fmt.append(" ");
+        menu_view.remove_prefix(alert_len + 2);
+    }
+    formatter_.reverse_video(&menu_fmt, menu_view);
 
     Point pt{col, y};
     surface_->put_string(pt, menu_fmt);
 }
 
+void BarChart::set_style(BarStyle style) { style_ = style; }
+
+void BarChart::set_quantity(sampling::Quantity qtty) { qtty_ = qtty; }
+
+void BarChart::set_prompt(const std::string &prompt) { prompt_ = prompt; }
+
+void BarChart::set_alert(const std::string &alert) { alert_ = alert; }
+
+void BarChart::set_line_rate(uint64_t line_rate) { line_rate_ = line_rate; }
+
 uint16_t BarChart::get_width() const {
     auto dim = surface_->get_size();
     return dim.width - scale_width_;
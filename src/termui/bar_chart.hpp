@@ -2,14 +2,20 @@
 #define BAR_CHART_H
 
 #include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "formatter.hpp"
 #include "sampling/agg_window.hpp"
+#include "sampling/quantity.hpp"
 #include "sampling/statistic.hpp"
 #include "sampling/time_series_slice.hpp"
+#include "termui/bar_style.hpp"
 #include "termui/dimensions.hpp"
 #include "termui/display_scale.hpp"
+#include "tools/profiler.hpp"
 
 namespace bandwit {
 namespace termui {
@@ -22,24 +28,108 @@ class BarChart {
     using TimeSeriesSlice = bandwit::sampling::TimeSeriesSlice;
 
   public:
-    explicit BarChart(TerminalSurface *surface) : surface_{surface} {}
+    // Times the stages of every frame into the profiler, if there is one
+    explicit BarChart(TerminalSurface *surface,
+                      tools::Profiler *profiler = nullptr)
+        : surface_{surface}, profiler_{profiler} {}
     void draw_bars_from_right(const std::string &iface_name,
                               const std::string &title,
                               const TimeSeriesSlice &slice, DisplayScale scale,
                               Statistic stat);
+
+    // Two charts in one frame on a shared scale, the bars of slice_up
+    // growing up from the middle and the bars of slice_down hanging below
+    void draw_mirrored_bars(const std::string &iface_name,
+                            const TimeSeriesSlice &slice_up,
+                            const TimeSeriesSlice &slice_down,
+                            DisplayScale scale, Statistic stat);
+
     void draw_yaxis(const Dimensions &dim, uint64_t max_value,
                     DisplayScale scale, Statistic stat);
     void draw_xaxis(const Dimensions &dim, const TimeSeriesSlice &slice);
     void draw_yaxis_label(const Dimensions &dim, DisplayScale scale);
-    void draw_title(const std::string &title, const TimeSeriesSlice &slice,
+    void draw_title(std::string_view title, const TimeSeriesSlice &slice,
                     Statistic stat);
     void draw_menu(const std::string &iface_name, const Dimensions &dim);
 
+    void set_style(BarStyle style);
+
+    // What the slices count, the bytes unless set
+    void set_quantity(sampling::Quantity qtty);
+
+    // Shown instead of the menu while it is not empty
+    void set_prompt(const std::string &prompt);
+
+    // Shown in bold at the start of the menu bar, out of its reverse video,
+    // while it is not empty, eg. "! eth0 rx>90%/30s"
+    void set_alert(const std::string &alert);
+
+    // What a full bar of the LINE_RATE scale stands for, in bytes a second.
+    // Unused by the other scales.
+    void set_line_rate(uint64_t line_rate);
+
     uint16_t get_width() const;
 
   private:
+    enum class Direction {
+        UP,
+        DOWN,
+    };
+
+    // Everything the y axis labels depend on
+    struct YAxisKey {
+        uint64_t max_value;
+        DisplayScale scale;
+        Statistic stat;
+        sampling::Quantity qtty;
+        uint16_t height;
+
+        bool operator==(const YAxisKey &other) const;
+    };
+
+    void update_yaxis(uint16_t height, uint64_t max_value, DisplayScale scale,
+                      Statistic stat);
+    void format_yaxis(const YAxisKey &key);
+    void put_yaxis(uint16_t baseline, Direction direction);
+
+    // The raw value of a full bar, the max of the slice but on the scale of
+    // the line rate
+    uint64_t get_max_raw(const TimeSeriesSlice &slice, DisplayScale scale,
+                         Statistic stat) const;
+
+    // The height of every bar of the slice, in cells or in eighths of a
+    // cell, into bar_heights_
+    void scale_bars(const TimeSeriesSlice &slice, uint64_t max_raw,
+                    DisplayScale scale, uint16_t max_height);
+    // gives the bars of buckets without samples the GAP_HEIGHT, the ones
+    // from before the first sample the BLANK_HEIGHT and the ones still to
+    // be sampled the PENDING_HEIGHT
+    void mark_gaps(const TimeSeriesSlice &slice);
+    void draw_bars(const Dimensions &dim, uint16_t baseline,
+                   Direction direction);
+
     TerminalSurface *surface_{nullptr};
+    tools::Profiler *profiler_{nullptr};
     Formatter formatter_{};
+    BarStyle style_{BarStyle::BLOCKS};
+    sampling::Quantity qtty_{sampling::Quantity::BYTES};
+    std::string prompt_{};
+    std::string alert_{};
+    uint64_t line_rate_{0};
+
+    // The y axis labels of the last frame, bottom to top, which a steady
+    // frame draws again without formatting anything
+    std::optional<YAxisKey> yaxis_key_{};
+    std::vector<std::string> yaxis_labels_{};
+
+    // Reused from frame to frame
+    std::vector<uint64_t> bar_values_{};
+    std::vector<uint16_t> bar_heights_{};
+
+    // The labels, the title and the menu are formatted into these, so once
+    // they have grown to the longest no frame allocates anything
+    std::string menu_{};
+    std::string text_{};
 
     // 4 digits, a space, 4 chars, a space to delimit
     uint16_t scale_width_{10};
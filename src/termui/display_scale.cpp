@@ -1,3 +1,6 @@
+#include <stdexcept>
+
+#include "except.hpp"
 #include "termui/display_scale.hpp"
 
 namespace bandwit {
@@ -10,8 +13,12 @@ DisplayScale next_scale(DisplayScale scale) {
     case DisplayScale::LOG10:
         return DisplayScale::LOG2;
     case DisplayScale::LOG2:
+        return DisplayScale::LINE_RATE;
+    case DisplayScale::LINE_RATE:
         return DisplayScale::LINEAR;
     }
+
+    THROW_MSG(std::logic_error, "unknown display scale");
 }
 
 std::string get_label(DisplayScale scale) {
@@ -22,7 +29,11 @@ std::string get_label(DisplayScale scale) {
         return "log10";
     case DisplayScale::LOG2:
         return "log2";
+    case DisplayScale::LINE_RATE:
+        return "line";
     }
+
+    THROW_MSG(std::logic_error, "unknown display scale");
 }
 
 } // namespace termui
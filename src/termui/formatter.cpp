@@ -1,8 +1,9 @@
-#include <cmath>
-#include <iomanip>
-#include <iostream>
+#include <algorithm>
+#include <charconv>
 #include <sstream>
+#include <stdexcept>
 
+#include "except.hpp"
 #include "formatter.hpp"
 #include "macros.hpp"
 
@@ -11,6 +12,8 @@ namespace termui {
 
 const std::string &FormattedString::get() const { return str_; }
 
+std::string *FormattedString::get_buffer() { return &str_; }
+
 std::size_t FormattedString::size() const {
     bool in_escape = false;
     std::size_t count{0};
@@ -34,99 +37,349 @@ std::size_t FormattedString::size() const {
     return count;
 }
 
+struct ByteUnit {
+    uint64_t divisor;
+    int exponent;
+    std::string_view label;
+};
+
+// Largest unit first, so that the first one that fits is the one to use
+constexpr std::array<ByteUnit, 7> UNITS_BASE2{{
+    {1ULL << 60U, 60, "eb"},
+    {1ULL << 50U, 50, "pb"},
+    {1ULL << 40U, 40, "tb"},
+    {1ULL << 30U, 30, "gb"},
+    {1ULL << 20U, 20, "mb"},
+    {1ULL << 10U, 10, "kb"},
+    {1ULL, 0, "b"},
+}};
+
+constexpr std::array<ByteUnit, 7> UNITS_BASE10{{
+    {1000000000000000000ULL, 18, "eb"},
+    {1000000000000000ULL, 15, "pb"},
+    {1000000000000ULL, 12, "tb"},
+    {1000000000ULL, 9, "gb"},
+    {1000000ULL, 6, "mb"},
+    {1000ULL, 3, "kb"},
+    {1ULL, 0, "b"},
+}};
+
+// The same for counts, which have no unit of their own
+constexpr std::array<ByteUnit, 7> UNITS_COUNT{{
+    {1000000000000000000ULL, 18, "E"},
+    {1000000000000000ULL, 15, "P"},
+    {1000000000000ULL, 12, "T"},
+    {1000000000ULL, 9, "G"},
+    {1000000ULL, 6, "M"},
+    {1000ULL, 3, "k"},
+    {1ULL, 0, ""},
+}};
+
 std::string Formatter::format_decimal(uint64_t int_part, uint64_t dec_part,
                                       const std::string &unit) {
-    std::stringstream sd{};
-    std::string truncated{};
+    NumBytesBuffer buf{};
+    return std::string{format_decimal(&buf, int_part, dec_part, unit)};
+}
+
+std::string Formatter::format_num_bytes(YAxisScale scale, uint64_t num) {
+    NumBytesBuffer buf{};
+    return std::string{format_num_bytes(&buf, scale, num)};
+}
+
+std::string Formatter::format_num_bytes_rate(YAxisScale scale, uint64_t num,
+                                             const std::string &time_unit) {
+    NumBytesBuffer buf{};
+    return std::string{format_num_bytes_rate(&buf, scale, num, time_unit)};
+}
+
+std::string_view Formatter::format_decimal(NumBytesBuffer *buf,
+                                           uint64_t int_part,
+                                           uint64_t dec_part,
+                                           std::string_view unit) {
+    // the digits go to the right of this, so they can be right aligned
+    std::array<char, 32> digits{};
+    auto *digits_end = digits.data() + digits.size();
+    std::size_t len{0};
 
     if (dec_part == 0) {
         // decimal part is zero, no need for a decimal part
-        sd << int_part;
-        truncated = sd.str();
+        auto res = std::to_chars(digits.data(), digits_end, int_part);
+        len = SIZE_T(res.ptr - digits.data());
 
     } else {
         // we need to glue together the int and dec parts
         double reconstructed = F64(int_part) + F64(dec_part) / 1000.0;
 
-        sd.precision(3);
-        sd << std::fixed << reconstructed;
-        std::string formatted = sd.str();
+        auto res = std::to_chars(digits.data(), digits_end, reconstructed,
+                                 std::chars_format::fixed, 3);
+        len = SIZE_T(res.ptr - digits.data());
 
         if (reconstructed >= 1000) {
             // 1023.45 -> 1023
-            truncated = formatted.substr(0, 4);
+            len = std::min<std::size_t>(len, 4);
         } else if (reconstructed >= 100) {
             // 123.456 -> 123
-            truncated = formatted.substr(0, 3);
+            len = std::min<std::size_t>(len, 3);
         } else {
             // 12.345 -> 12.3
-            truncated = formatted.substr(0, 4);
+            len = std::min<std::size_t>(len, 4);
         }
     }
 
-    std::stringstream ss{};
-    ss << std::setw(4); // right align numbers
-    ss << truncated << " " << unit;
-    return ss.str();
+    // right align numbers
+    std::size_t padding = len < 4 ? 4 - len : 0;
+    std::size_t total = padding + len + 1 + unit.size();
+    if (total > buf->size()) {
+        THROW_ARGS(std::invalid_argument,
+                   "Formatter.format_decimal: unit too long: %.*s",
+                   INT(unit.size()), unit.data());
+    }
+
+    auto *cur = buf->data();
+    cur = std::fill_n(cur, padding, ' ');
+    cur = std::copy_n(digits.data(), len, cur);
+    *cur++ = ' ';
+    std::copy_n(unit.data(), unit.size(), cur);
+
+    return std::string_view{buf->data(), total};
 }
 
-std::string Formatter::format_num_bytes(YAxisScale scale, uint64_t num) {
+std::string_view Formatter::format_num_bytes(NumBytesBuffer *buf,
+                                             YAxisScale scale, uint64_t num) {
+    const auto &units =
+        scale == YAxisScale::BASE10 ? UNITS_BASE10 : UNITS_BASE2;
+
     uint64_t int_part = 0;
     uint64_t dec_part = 0;
-    std::string unit = "b";
+    std::string_view unit = "b";
+
+    for (const auto &candidate : units) {
+        uint64_t val = num / candidate.divisor;
+        if (val == 0) {
+            continue;
+        }
+
+        int_part = val;
+        unit = candidate.label;
 
-    if (scale == YAxisScale::BASE2) {
+        // only base2 shows a decimal part, in 1024ths
+        if ((scale == YAxisScale::BASE2) && (candidate.exponent >= 10)) {
+            auto next_exponent = U64(candidate.exponent - 10);
+            dec_part = (num >> next_exponent) - (val << 10UL);
+        }
 
-        for (auto it = units_base2_.rbegin(); it != units_base2_.rend(); ++it) {
-            auto pair = *it;
-            auto exponent = U64(pair.first);
+        break;
+    }
 
-            uint64_t val = num >> exponent;
-            if (val > 0) {
-                int_part = val;
-                unit = pair.second;
+    return format_decimal(buf, int_part, dec_part, unit);
+}
 
-                if (exponent >= 10) {
-                    uint64_t next_exponent = exponent - 10UL;
-                    dec_part = (num >> next_exponent) - (val << 10UL);
-                }
+std::string_view Formatter::format_num_bytes_rate(NumBytesBuffer *buf,
+                                                  YAxisScale scale,
+                                                  uint64_t num,
+                                                  std::string_view time_unit) {
+    auto num_fmt = format_num_bytes(buf, scale, num);
+
+    std::size_t total = num_fmt.size() + 1 + time_unit.size();
+    if (total > buf->size()) {
+        THROW_ARGS(std::invalid_argument,
+                   "Formatter.format_num_bytes_rate: time unit too long: %.*s",
+                   INT(time_unit.size()), time_unit.data());
+    }
 
-                break;
-            }
+    auto *cur = buf->data() + num_fmt.size();
+    *cur++ = '/';
+    std::copy_n(time_unit.data(), time_unit.size(), cur);
+
+    return std::string_view{buf->data(), total};
+}
+
+std::string_view Formatter::format_count(NumBytesBuffer *buf, uint64_t num) {
+    const auto *unit = &UNITS_COUNT.back();
+    for (const auto &candidate : UNITS_COUNT) {
+        if (num / candidate.divisor > 0) {
+            unit = &candidate;
+            break;
         }
+    }
+
+    // the decimal part in thousandths, there are none below a thousand
+    uint64_t dec_part{0};
+    if (unit->exponent >= 3) {
+        dec_part = (num % unit->divisor) / (unit->divisor / 1000);
+    }
+
+    return format_decimal(buf, num / unit->divisor, dec_part, unit->label);
+}
+
+std::string_view Formatter::format_count_rate(NumBytesBuffer *buf,
+                                              uint64_t num,
+                                              std::string_view time_unit) {
+    auto num_fmt = format_count(buf, num);
 
-    } else if (scale == YAxisScale::BASE10) {
+    std::size_t total = num_fmt.size() + 1 + time_unit.size();
+    if (total > buf->size()) {
+        THROW_ARGS(std::invalid_argument,
+                   "Formatter.format_count_rate: time unit too long: %.*s",
+                   INT(time_unit.size()), time_unit.data());
+    }
+
+    auto *cur = buf->data() + num_fmt.size();
+    *cur++ = '/';
+    std::copy_n(time_unit.data(), time_unit.size(), cur);
+
+    return std::string_view{buf->data(), total};
+}
 
-        for (auto it = units_base10_.rbegin(); it != units_base10_.rend();
-             ++it) {
-            auto pair = *it;
-            auto exponent = U64(pair.first);
+const FormattedString &Formatter::format_xaxis(const TimeSeriesSlice &slice) {
+    // A steady frame shows the same columns as the previous one
+    if (xaxis_ && (xaxis_->agg_window == slice.agg_window) &&
+        (xaxis_->start == slice.get_time_point(0)) &&
+        (xaxis_->len == slice.size())) {
+        return xaxis_->axis;
+    }
+
+    // Formatted into the previous axis, so as to reuse its buffer
+    if (!xaxis_) {
+        xaxis_ = XAxis{};
+    }
+    xaxis_->agg_window = slice.agg_window;
+    xaxis_->start = slice.get_time_point(0);
+    xaxis_->len = slice.size();
+
+    auto *out = xaxis_->axis.get_buffer();
+    out->clear();
+
+    switch (slice.agg_window) {
+    case AggregationWindow::TENTH_SECOND:
+    case AggregationWindow::QUARTER_SECOND:
+    case AggregationWindow::HALF_SECOND:
+        format_xaxis_per_subsec(slice, out);
+        break;
+    case AggregationWindow::ONE_SECOND:
+        format_xaxis_per_sec(slice, out);
+        break;
+    case AggregationWindow::ONE_MINUTE:
+        format_xaxis_per_min(slice, out);
+        break;
+    case AggregationWindow::ONE_HOUR:
+        format_xaxis_per_hour(slice, out);
+        break;
+    case AggregationWindow::ONE_DAY:
+        format_xaxis_per_day(slice, out);
+        break;
+    }
 
-            uint64_t divisor = U64(std::pow(10.0, F64(exponent)));
-            uint64_t val = divisor > 0 ? num / divisor : 0;
+    return xaxis_->axis;
+}
 
-            if (val > 0) {
-                int_part = val;
-                unit = pair.second;
-                break;
+const std::vector<tools::LocalTime> &
+Formatter::get_local_times(const TimeSeriesSlice &slice) {
+    auto interval = slice.get_interval();
+    auto start = slice.get_time_point(0);
+
+    // Columns that were already shown are copied over, wherever they moved
+    // to, so only the ones that scrolled in are converted to local time
+    bool is_same_window = local_times_window_ == slice.agg_window;
+    auto old_start = local_times_start_;
+    auto old_len = local_times_.size();
+
+    // Both grow together, so that the one swapped in next frame is as large
+    // already
+    if (new_local_times_.capacity() < slice.size()) {
+        new_local_times_.reserve(slice.size());
+        local_times_.reserve(slice.size());
+    }
+    new_local_times_.resize(slice.size());
+
+    // not a std::optional, which gcc takes for uninitialized at -O2
+    bool has_prev_tt{false};
+    std::time_t prev_tt{0};
+    for (std::size_t i = 0; i < slice.size(); ++i) {
+        auto tp = start + interval * i;
+
+        if (is_same_window && (tp >= old_start)) {
+            auto old_idx = SIZE_T((tp - old_start) / interval);
+            if (old_idx < old_len) {
+                new_local_times_[i] = local_times_[old_idx];
+                has_prev_tt = false;
+                continue;
             }
         }
+
+        // sub second columns share their second
+        std::time_t tt = Clock::to_time_t(tp);
+        if (has_prev_tt && (prev_tt == tt)) {
+            new_local_times_[i] = new_local_times_[i - 1];
+            continue;
+        }
+
+        new_local_times_[i] = time_keeping_.get_local_time(tp);
+        prev_tt = tt;
+        has_prev_tt = true;
     }
 
-    return format_decimal(int_part, dec_part, unit);
+    std::swap(local_times_, new_local_times_);
+    local_times_window_ = slice.agg_window;
+    local_times_start_ = start;
+
+    return local_times_;
 }
 
-std::string Formatter::format_num_bytes_rate(YAxisScale scale, uint64_t num,
-                                             const std::string &time_unit) {
-    auto num_fmt = format_num_bytes(scale, num);
+void Formatter::format_xaxis_per_subsec(const TimeSeriesSlice &slice,
+                                        std::string *out) {
+    const auto &times = get_local_times(slice);
+    out->reserve(slice.size() * 2);
 
-    std::stringstream ss{};
-    ss << num_fmt << "/" << time_unit;
-    return ss.str();
+    // If we need to write more than one char for a given point then successive
+    // iterations through the loop will need to skip outputing anything at all
+    // to make up for the space used.
+    int chars_to_skip{0};
+
+    int num_chars_after_this_one{-1};
+
+    // Label every second, unless there are too few columns per second to
+    // leave a gap between the labels
+    auto interval = slice.get_interval();
+    auto points_per_sec = std::chrono::seconds{1} / interval;
+    int secs_step = points_per_sec >= 3 ? 1 : 2;
+
+    for (std::size_t i = 0; i < slice.size(); i++) {
+        num_chars_after_this_one = slice.size() - 1 - i;
+
+        auto tp = slice.get_time_point(i);
+        int secs = times[i].seconds;
+
+        // Only the first point within a second gets a label
+        auto into_sec = tp.time_since_epoch() % std::chrono::seconds{1};
+        bool starts_sec = into_sec < interval;
+
+        if (chars_to_skip > 0) {
+            chars_to_skip--;
+            continue;
+        }
+
+        if (starts_sec && (secs == 0) && (num_chars_after_this_one >= 4)) {
+            // We need to output HH:MM
+            out->append(ansi_reverse_video_);
+            append_HH_MM(out, times[i]);
+            out->append(ansi_reset_);
+            chars_to_skip = 4;
+        } else if (starts_sec && (secs % secs_step == 0) &&
+                   (num_chars_after_this_one >= 1)) {
+            // We need to output SS
+            append_two_digits(out, secs);
+            chars_to_skip = 1;
+        } else {
+            out->push_back(' ');
+        }
+    }
 }
 
-FormattedString Formatter::format_xaxis_per_sec(std::vector<TimePoint> points) {
-    std::stringstream ss{};
+void Formatter::format_xaxis_per_sec(const TimeSeriesSlice &slice,
+                                     std::string *out) {
+    const auto &times = get_local_times(slice);
+    out->reserve(slice.size() * 2);
 
     // If we need to write more than one char for a given point then successive
     // iterations through the loop will need to skip outputing anything at all
@@ -135,11 +388,10 @@ FormattedString Formatter::format_xaxis_per_sec(std::vector<TimePoint> points) {
 
     int num_chars_after_this_one{-1};
 
-    for (std::size_t i = 0; i < points.size(); i++) {
-        num_chars_after_this_one = points.size() - 1 - i;
+    for (std::size_t i = 0; i < slice.size(); i++) {
+        num_chars_after_this_one = slice.size() - 1 - i;
 
-        auto tp = points[i];
-        int secs = time_keeping_.get_seconds(tp);
+        int secs = times[i].seconds;
 
         if (chars_to_skip > 0) {
             chars_to_skip--;
@@ -148,24 +400,24 @@ FormattedString Formatter::format_xaxis_per_sec(std::vector<TimePoint> points) {
 
         if ((secs == 0) && (num_chars_after_this_one >= 4)) {
             // We need to output HH:MM
-            auto tick = format_HH_MM(tp);
-            ss << reverse_video(tick);
+            out->append(ansi_reverse_video_);
+            append_HH_MM(out, times[i]);
+            out->append(ansi_reset_);
             chars_to_skip = 4;
         } else if ((secs % 4 == 0) && (num_chars_after_this_one >= 1)) {
             // We need to output SS
-            auto tick = format_SS(tp);
-            ss << tick;
+            append_two_digits(out, secs);
             chars_to_skip = 1;
         } else {
-            ss << ' ';
+            out->push_back(' ');
         }
     }
-
-    return FormattedString{ss.str()};
 }
 
-FormattedString Formatter::format_xaxis_per_min(std::vector<TimePoint> points) {
-    std::stringstream ss{};
+void Formatter::format_xaxis_per_min(const TimeSeriesSlice &slice,
+                                     std::string *out) {
+    const auto &times = get_local_times(slice);
+    out->reserve(slice.size() * 2);
 
     // If we need to write more than one char for a given point then successive
     // iterations through the loop will need to skip outputing anything at all
@@ -174,12 +426,11 @@ FormattedString Formatter::format_xaxis_per_min(std::vector<TimePoint> points) {
 
     int num_chars_after_this_one{-1};
 
-    for (std::size_t i = 0; i < points.size(); i++) {
-        num_chars_after_this_one = points.size() - 1 - i;
+    for (std::size_t i = 0; i < slice.size(); i++) {
+        num_chars_after_this_one = slice.size() - 1 - i;
 
-        auto tp = points[i];
-        int hours = time_keeping_.get_hours(tp);
-        int mins = time_keeping_.get_minutes(tp);
+        int hours = times[i].hours;
+        int mins = times[i].minutes;
 
         if (chars_to_skip > 0) {
             chars_to_skip--;
@@ -188,30 +439,31 @@ FormattedString Formatter::format_xaxis_per_min(std::vector<TimePoint> points) {
 
         if ((hours == 0) && (mins == 0) && (num_chars_after_this_one >= 2)) {
             // We need to output Fri
-            auto tick = format_Day(tp);
-            ss << reverse_video(tick);
+            out->append(ansi_reverse_video_);
+            append_Day(out, times[i]);
+            out->append(ansi_reset_);
             chars_to_skip = 2;
         } else if ((mins == 0) && (num_chars_after_this_one >= 2)) {
             // We need to output HHh
-            auto tick = format_HH_h(tp);
-            ss << reverse_video(tick);
+            out->append(ansi_reverse_video_);
+            append_two_digits(out, hours);
+            out->push_back('h');
+            out->append(ansi_reset_);
             chars_to_skip = 2;
         } else if ((mins % 4 == 0) && (num_chars_after_this_one >= 1)) {
             // We need to output MM
-            auto tick = format_MM(tp);
-            ss << tick;
+            append_two_digits(out, mins);
             chars_to_skip = 1;
         } else {
-            ss << ' ';
+            out->push_back(' ');
         }
     }
-
-    return FormattedString{ss.str()};
 }
 
-FormattedString
-Formatter::format_xaxis_per_hour(std::vector<TimePoint> points) {
-    std::stringstream ss{};
+void Formatter::format_xaxis_per_hour(const TimeSeriesSlice &slice,
+                                      std::string *out) {
+    const auto &times = get_local_times(slice);
+    out->reserve(slice.size() * 2);
 
     // If we need to write more than one char for a given point then successive
     // iterations through the loop will need to skip outputing anything at all
@@ -220,11 +472,10 @@ Formatter::format_xaxis_per_hour(std::vector<TimePoint> points) {
 
     int num_chars_after_this_one{-1};
 
-    for (std::size_t i = 0; i < points.size(); i++) {
-        num_chars_after_this_one = points.size() - 1 - i;
+    for (std::size_t i = 0; i < slice.size(); i++) {
+        num_chars_after_this_one = slice.size() - 1 - i;
 
-        auto tp = points[i];
-        int hours = time_keeping_.get_hours(tp);
+        int hours = times[i].hours;
 
         if (chars_to_skip > 0) {
             chars_to_skip--;
@@ -233,24 +484,24 @@ Formatter::format_xaxis_per_hour(std::vector<TimePoint> points) {
 
         if ((hours == 0) && (num_chars_after_this_one >= 2)) {
             // We need to output Fri
-            auto tick = format_Day(tp);
-            ss << reverse_video(tick);
+            out->append(ansi_reverse_video_);
+            append_Day(out, times[i]);
+            out->append(ansi_reset_);
             chars_to_skip = 2;
         } else if ((hours % 4 == 0) && (num_chars_after_this_one >= 1)) {
             // We need to output HH
-            auto tick = format_HH(tp);
-            ss << tick;
+            append_two_digits(out, hours);
             chars_to_skip = 1;
         } else {
-            ss << ' ';
+            out->push_back(' ');
         }
     }
-
-    return FormattedString{ss.str()};
 }
 
-FormattedString Formatter::format_xaxis_per_day(std::vector<TimePoint> points) {
-    std::stringstream ss{};
+void Formatter::format_xaxis_per_day(const TimeSeriesSlice &slice,
+                                     std::string *out) {
+    const auto &times = get_local_times(slice);
+    out->reserve(slice.size() * 2);
 
     // If we need to write more than one char for a given point then successive
     // iterations through the loop will need to skip outputing anything at all
@@ -259,11 +510,10 @@ FormattedString Formatter::format_xaxis_per_day(std::vector<TimePoint> points) {
 
     int num_chars_after_this_one{-1};
 
-    for (std::size_t i = 0; i < points.size(); i++) {
-        num_chars_after_this_one = points.size() - 1 - i;
+    for (std::size_t i = 0; i < slice.size(); i++) {
+        num_chars_after_this_one = slice.size() - 1 - i;
 
-        auto tp = points[i];
-        int day = time_keeping_.get_wday(tp);
+        int day = times[i].wday;
 
         if (chars_to_skip > 0) {
             chars_to_skip--;
@@ -272,81 +522,75 @@ FormattedString Formatter::format_xaxis_per_day(std::vector<TimePoint> points) {
 
         if ((day == 1) && (num_chars_after_this_one >= 2)) {
             // We need to output Mon
-            auto tick = format_Day(tp);
-            ss << tick;
+            append_Day(out, times[i]);
             chars_to_skip = 2;
         } else {
-            ss << ' ';
+            out->push_back(' ');
         }
     }
-
-    return FormattedString{ss.str()};
 }
 
 std::string Formatter::format_Day(TimePoint tp) {
-    int wday = time_keeping_.get_wday(tp);
-
-    switch (wday) {
-    case 0:
-        return "Sun";
-    case 1:
-        return "Mon";
-    case 2:
-        return "Tue";
-    case 3:
-        return "Wed";
-    case 4:
-        return "Thu";
-    case 5:
-        return "Fri";
-    case 6:
-        return "Sat";
-    }
-
-    return "N/A";
+    std::string out{};
+    append_Day(&out, time_keeping_.get_local_time(tp));
+    return out;
 }
 
 std::string Formatter::format_HH_MM(TimePoint tp) {
-    int hours = time_keeping_.get_hours(tp);
-    int mins = time_keeping_.get_minutes(tp);
-
-    std::stringstream ss{};
-    ss << std::setfill('0') << std::setw(2) << hours;
-    ss << ':';
-    ss << std::setfill('0') << std::setw(2) << mins;
-    return ss.str();
+    std::string out{};
+    append_HH_MM(&out, time_keeping_.get_local_time(tp));
+    return out;
 }
 
 std::string Formatter::format_HH_h(TimePoint tp) {
-    int hours = time_keeping_.get_hours(tp);
-
-    std::stringstream ss{};
-    ss << std::setfill('0') << std::setw(2) << hours << 'h';
-    return ss.str();
+    std::string out{};
+    append_two_digits(&out, time_keeping_.get_hours(tp));
+    out.push_back('h');
+    return out;
 }
 
 std::string Formatter::format_HH(TimePoint tp) {
-    int hours = time_keeping_.get_hours(tp);
-
-    std::stringstream ss{};
-    ss << std::setfill('0') << std::setw(2) << hours;
-    return ss.str();
+    std::string out{};
+    append_two_digits(&out, time_keeping_.get_hours(tp));
+    return out;
 }
 
 std::string Formatter::format_MM(TimePoint tp) {
-    int mins = time_keeping_.get_minutes(tp);
-
-    std::stringstream ss{};
-    ss << std::setfill('0') << std::setw(2) << mins;
-    return ss.str();
+    std::string out{};
+    append_two_digits(&out, time_keeping_.get_minutes(tp));
+    return out;
 }
 
 std::string Formatter::format_SS(TimePoint tp) {
-    int secs = time_keeping_.get_seconds(tp);
+    std::string out{};
+    append_two_digits(&out, time_keeping_.get_seconds(tp));
+    return out;
+}
 
-    std::stringstream ss{};
-    ss << std::setfill('0') << std::setw(2) << secs;
-    return ss.str();
+void Formatter::append_two_digits(std::string *out, int num) {
+    // zero padded, all the fields are below 100
+    out->push_back(static_cast<char>('0' + (num / 10) % 10));
+    out->push_back(static_cast<char>('0' + num % 10));
+}
+
+void Formatter::append_HH_MM(std::string *out,
+                             const LocalTime &local_time) {
+    append_two_digits(out, local_time.hours);
+    out->push_back(':');
+    append_two_digits(out, local_time.minutes);
+}
+
+void Formatter::append_Day(std::string *out, const LocalTime &local_time) {
+    static constexpr std::array<std::string_view, 7> DAYS{
+        "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat",
+    };
+
+    if ((local_time.wday < 0) || (local_time.wday >= INT(DAYS.size()))) {
+        out->append("N/A");
+        return;
+    }
+
+    out->append(DAYS[SIZE_T(local_time.wday)]);
 }
 
 std::string Formatter::bold(const std::string &str) {
@@ -361,5 +605,13 @@ std::string Formatter::reverse_video(const std::string &str) {
     return ss.str();
 }
 
+void Formatter::bold(std::string *out, std::string_view str) {
+    out->append(ansi_bold).append(str).append(ansi_reset_);
+}
+
+void Formatter::reverse_video(std::string *out, std::string_view str) {
+    out->append(ansi_reverse_video_).append(str).append(ansi_reset_);
+}
+
 } // namespace termui
 } // namespace bandwit
@@ -1,12 +1,15 @@
 #ifndef FORMATTER_H
 #define FORMATTER_H
 
+#include <array>
 #include <cstdint>
-#include <map>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "aliases.hpp"
+#include "sampling/time_series_slice.hpp"
 #include "termui/yaxis_scale.hpp"
 #include "tools/time_keeping.hpp"
 
@@ -21,11 +24,21 @@ class FormattedString {
     const std::string &get() const;
     std::size_t size() const;
 
+    // To format into in place, which keeps the capacity of the last string
+    std::string *get_buffer();
+
   private:
     std::string str_{};
 };
 
+// Room for the longest number of bytes, eg. "1023 kb", plus a time unit
+using NumBytesBuffer = std::array<char, 32>;
+
 class Formatter {
+    using AggregationWindow = sampling::AggregationWindow;
+    using LocalTime = tools::LocalTime;
+    using TimeSeriesSlice = sampling::TimeSeriesSlice;
+
   public:
     std::string format_decimal(uint64_t int_part, uint64_t dec_part,
                                const std::string &unit);
@@ -33,10 +46,33 @@ class Formatter {
     std::string format_num_bytes_rate(YAxisScale scale, uint64_t num,
                                       const std::string &time_unit);
 
-    FormattedString format_xaxis_per_sec(std::vector<TimePoint> points);
-    FormattedString format_xaxis_per_min(std::vector<TimePoint> points);
-    FormattedString format_xaxis_per_hour(std::vector<TimePoint> points);
-    FormattedString format_xaxis_per_day(std::vector<TimePoint> points);
+    // Same as above, but formatted into buf without allocating. The result
+    // points into buf and is valid until buf is reused.
+    std::string_view format_decimal(NumBytesBuffer *buf, uint64_t int_part,
+                                    uint64_t dec_part, std::string_view unit);
+    std::string_view format_num_bytes(NumBytesBuffer *buf, YAxisScale scale,
+                                      uint64_t num);
+    std::string_view format_num_bytes_rate(NumBytesBuffer *buf,
+                                           YAxisScale scale, uint64_t num,
+                                           std::string_view time_unit);
+
+    // A count of packets, errors or drops, in thousands rather than in
+    // 1024ths whatever the scale, eg. "12.3 k"
+    std::string_view format_count(NumBytesBuffer *buf, uint64_t num);
+    std::string_view format_count_rate(NumBytesBuffer *buf, uint64_t num,
+                                       std::string_view time_unit);
+
+    // The axis for the slice's aggregation window, reused for as long as the
+    // slice covers the same columns
+    const FormattedString &format_xaxis(const TimeSeriesSlice &slice);
+
+    // Appended to out
+    void format_xaxis_per_subsec(const TimeSeriesSlice &slice,
+                                 std::string *out);
+    void format_xaxis_per_sec(const TimeSeriesSlice &slice, std::string *out);
+    void format_xaxis_per_min(const TimeSeriesSlice &slice, std::string *out);
+    void format_xaxis_per_hour(const TimeSeriesSlice &slice, std::string *out);
+    void format_xaxis_per_day(const TimeSeriesSlice &slice, std::string *out);
 
     std::string format_Day(TimePoint tp);
     std::string format_HH_MM(TimePoint tp);
@@ -48,22 +84,40 @@ class Formatter {
     std::string bold(const std::string &str);
     std::string reverse_video(const std::string &str);
 
+    // Same as above, but appended to out, which allocates nothing once out
+    // has the room
+    void bold(std::string *out, std::string_view str);
+    void reverse_video(std::string *out, std::string_view str);
+
   private:
+    struct XAxis {
+        AggregationWindow agg_window{AggregationWindow::ONE_SECOND};
+        TimePoint start{};
+        std::size_t len{0};
+        FormattedString axis{};
+    };
+
+    // The local time of every column of the slice, converted only for the
+    // columns that were not in the previous slice
+    const std::vector<LocalTime> &
+    get_local_times(const TimeSeriesSlice &slice);
+
+    static void append_two_digits(std::string *out, int num);
+    static void append_HH_MM(std::string *out, const LocalTime &local_time);
+    static void append_Day(std::string *out, const LocalTime &local_time);
+
     bandwit::tools::TimeKeeping time_keeping_{};
 
+    std::optional<XAxis> xaxis_{};
+
+    AggregationWindow local_times_window_{AggregationWindow::ONE_SECOND};
+    TimePoint local_times_start_{};
+    std::vector<LocalTime> local_times_{};
+    std::vector<LocalTime> new_local_times_{};
+
     std::string ansi_bold{"\033[1m"};
     std::string ansi_reverse_video_{"\033[7m"};
     std::string ansi_reset_{"\033[0m"};
-
-    std::map<int, std::string> units_base2_ = {
-        {0, "b"},   {10, "kb"}, {20, "mb"}, {30, "gb"},
-        {40, "tb"}, {50, "pb"}, {60, "eb"},
-    };
-
-    std::map<int, std::string> units_base10_{
-        {0, "b"},   {3, "kb"},  {6, "mb"},  {9, "gb"},
-        {12, "tb"}, {15, "pb"}, {18, "eb"},
-    };
 };
 
 } // namespace termui
@@ -0,0 +1,29 @@
+#include "frame_scheduler.hpp"
+
+namespace bandwit {
+namespace termui {
+
+FrameScheduler::FrameScheduler(unsigned max_fps)
+    : frame_interval_{Millis{1000} / max_fps} {}
+
+void FrameScheduler::mark_dirty() { is_dirty_ = true; }
+
+SteadyTimePoint FrameScheduler::get_deadline() const {
+    if (!is_dirty_) {
+        return SteadyTimePoint::max();
+    }
+
+    return last_frame_ + frame_interval_;
+}
+
+bool FrameScheduler::is_due(SteadyTimePoint now) const {
+    return now >= get_deadline();
+}
+
+void FrameScheduler::on_frame(SteadyTimePoint now) {
+    last_frame_ = now;
+    is_dirty_ = false;
+}
+
+} // namespace termui
+} // namespace bandwit
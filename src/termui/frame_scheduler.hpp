@@ -0,0 +1,36 @@
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+#include "aliases.hpp"
+
+namespace bandwit {
+namespace termui {
+
+// Decides when the view is redrawn. Whatever changes the view, a key press,
+// a sample or a resize, only marks it dirty, and a dirty view is redrawn at
+// most once per frame interval. A burst of changes within one frame is drawn
+// once, with all of them in it, and the first change after a quiet spell is
+// drawn straight away.
+class FrameScheduler {
+  public:
+    explicit FrameScheduler(unsigned max_fps);
+
+    void mark_dirty();
+
+    // When the dirty view is to be drawn, max() while it is not dirty
+    SteadyTimePoint get_deadline() const;
+    bool is_due(SteadyTimePoint now) const;
+
+    // The view was drawn at now
+    void on_frame(SteadyTimePoint now);
+
+  private:
+    Millis frame_interval_{};
+    SteadyTimePoint last_frame_{};
+    bool is_dirty_{false};
+};
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // FRAME_SCHEDULER_H
@@ -0,0 +1,74 @@
+#ifndef GLYPH_H
+#define GLYPH_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "macros.hpp"
+
+namespace bandwit {
+namespace termui {
+
+// One UTF-8 encoded character, held inline. 4 bytes fit any UTF-8 sequence,
+// so a glyph can be copied into a cell without ever allocating.
+class Glyph {
+  public:
+    constexpr Glyph() = default;
+
+    // Anything past the 4th byte is cut off
+    constexpr explicit Glyph(std::string_view str) {
+        len_ = U8(str.size() < bytes_.size() ? str.size() : bytes_.size());
+        for (std::size_t i = 0; i < bytes_.size(); ++i) {
+            bytes_[i] = i < len_ ? str[i] : '\0';
+        }
+    }
+
+    constexpr std::string_view get() const {
+        return std::string_view{bytes_.data(), len_};
+    }
+
+    constexpr bool operator==(const Glyph &other) const {
+        return (len_ == other.len_) && (bytes_[0] == other.bytes_[0]) &&
+               (bytes_[1] == other.bytes_[1]) &&
+               (bytes_[2] == other.bytes_[2]) &&
+               (bytes_[3] == other.bytes_[3]);
+    }
+
+    constexpr bool operator!=(const Glyph &other) const {
+        return !(*this == other);
+    }
+
+  private:
+    std::array<char, 4> bytes_{' ', '\0', '\0', '\0'};
+    uint8_t len_{1};
+};
+
+// ref: https://en.wikipedia.org/wiki/Block_Elements
+constexpr Glyph GLYPH_FULL_BLOCK{u8"█"};
+constexpr Glyph GLYPH_UPPER_HALF{u8"▀"};
+constexpr Glyph GLYPH_UPPER_EIGHTH{u8"▔"};
+constexpr Glyph GLYPH_LOWER_EIGHTH{u8"▁"};
+
+// Indexed by how dark the cell is, 0 for an empty cell
+constexpr std::array<Glyph, 5> GLYPH_SHADES{
+    Glyph{" "},   Glyph{u8"░"}, Glyph{u8"▒"},
+    Glyph{u8"▓"}, Glyph{u8"█"},
+};
+
+// ref: https://en.wikipedia.org/wiki/Box-drawing_character
+constexpr Glyph GLYPH_DASHED_LINE{u8"╌"};
+constexpr Glyph GLYPH_MIDDLE_DOT{u8"·"};
+
+// Indexed by the number of eighths of a cell that are filled from the
+// bottom, 0 for an empty cell
+constexpr std::array<Glyph, 9> GLYPH_LOWER_EIGHTHS{
+    Glyph{" "},   Glyph{u8"▁"}, Glyph{u8"▂"},
+    Glyph{u8"▃"}, Glyph{u8"▄"}, Glyph{u8"▅"},
+    Glyph{u8"▆"}, Glyph{u8"▇"}, Glyph{u8"█"},
+};
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // GLYPH_H
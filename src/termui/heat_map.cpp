@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include "glyph.hpp"
+#include "heat_map.hpp"
+#include "macros.hpp"
+#include "terminal_surface.hpp"
+
+namespace bandwit {
+namespace termui {
+
+// names are padded to the longest one, within these bounds
+constexpr uint16_t MIN_NAME_WIDTH = 6;
+constexpr uint16_t MAX_NAME_WIDTH = 24;
+
+// no samples in the bucket, as in the chart
+constexpr uint64_t GAP_VALUE = UINT64_MAX;
+// before the first sample, nothing is drawn
+constexpr uint64_t BLANK_VALUE = UINT64_MAX - 1;
+// still to be sampled, which is dotted
+constexpr uint64_t PENDING_VALUE = UINT64_MAX - 2;
+
+static void append_number(std::size_t num, std::string *out) {
+    char digits[24];
+    auto res = std::to_chars(digits, digits + sizeof(digits), num);
+    out->append(digits, res.ptr);
+}
+
+std::size_t HeatMap::get_num_rows() const {
+    auto dim = surface_->get_size();
+    return dim.height > 2 ? SIZE_T(dim.height - 2) : 0;
+}
+
+uint16_t HeatMap::get_name_width(std::size_t name_width) const {
+    auto dim = surface_->get_size();
+    auto max_width = std::min(MAX_NAME_WIDTH, U16(dim.width / 3));
+    return U16(std::clamp(name_width, SIZE_T(MIN_NAME_WIDTH),
+                          SIZE_T(std::max(MIN_NAME_WIDTH, max_width))));
+}
+
+uint16_t HeatMap::get_map_width(std::size_t name_width) const {
+    auto dim = surface_->get_size();
+    auto used = 1 + get_name_width(name_width) + 1;
+    return dim.width > used ? U16(dim.width - used) : 0;
+}
+
+void HeatMap::draw(const std::string &title, const std::vector<Row> &rows,
+                   std::size_t first_iface, std::size_t num_ifaces,
+                   AggregationWindow window, DisplayScale scale,
+                   Statistic stat) {
+    surface_->clear_surface();
+
+    std::size_t name_width{0};
+    for (const auto &row : rows) {
+        name_width = std::max(name_width, row.iface_name.size());
+    }
+    auto row_name_width = get_name_width(name_width);
+
+    uint64_t max_value{0};
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::SCALE};
+        max_value = load_values(rows);
+        set_thresholds(max_value, scale);
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::DRAW};
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            draw_row(U16(i + 2), rows[i], i, row_name_width);
+        }
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::FORMAT};
+        draw_title(title, first_iface, rows.size(), max_value, window, scale,
+                   stat);
+        draw_menu(num_ifaces);
+    }
+
+    tools::StageTimer timer{profiler_, tools::Stage::FLUSH};
+    surface_->flush();
+}
+
+void HeatMap::set_prompt(const std::string &prompt) { prompt_ = prompt; }
+
+void HeatMap::set_quantity(sampling::Quantity qtty) { qtty_ = qtty; }
+
+uint64_t HeatMap::load_values(const std::vector<Row> &rows) {
+    values_.clear();
+    row_offsets_.clear();
+
+    uint64_t max_value{0};
+    for (const auto &row : rows) {
+        row_offsets_.push_back(values_.size());
+
+        for (std::size_t i = 0; i < row.slice.size(); ++i) {
+            bool is_gap = row.slice.is_gap(i);
+            bool is_blank = row.slice.is_blank(i);
+            bool is_pending = row.slice.is_pending(i);
+            uint64_t value = row.slice.to_stat(row.slice.get_value(i));
+            if (row.other_slice.has_value()) {
+                is_gap = is_gap && row.other_slice->is_gap(i);
+                is_blank = is_blank && row.other_slice->is_blank(i);
+                is_pending = is_pending && row.other_slice->is_pending(i);
+                value += row.other_slice->to_stat(
+                    row.other_slice->get_value(i));
+            }
+
+            if (is_blank) {
+                values_.push_back(BLANK_VALUE);
+            } else if (is_pending) {
+                values_.push_back(PENDING_VALUE);
+            } else if (is_gap) {
+                values_.push_back(GAP_VALUE);
+            } else {
+                values_.push_back(value);
+                max_value = std::max(max_value, value);
+            }
+        }
+    }
+    row_offsets_.push_back(values_.size());
+
+    return max_value;
+}
+
+void HeatMap::set_thresholds(uint64_t max_value, DisplayScale scale) {
+    // A cell gets the first shade whose threshold it is under, so that a
+    // cell with anything at all in it is never left empty. On a log scale
+    // the thresholds are the same whatever the base.
+    for (std::size_t i = 0; i < NUM_SHADES; ++i) {
+        auto frac = F64(i + 1) / F64(NUM_SHADES);
+        thresholds_[i] =
+            scale == DisplayScale::LINEAR
+                ? U64(std::ceil(F64(max_value) * frac))
+                : U64(std::ceil(std::pow(F64(max_value), frac)));
+    }
+    thresholds_[NUM_SHADES - 1] = max_value;
+}
+
+void HeatMap::draw_row(uint16_t y, const Row &row, std::size_t row_idx,
+                       uint16_t name_width) {
+    line_.assign(" ");
+    auto name = row.iface_name.substr(0, name_width);
+    line_.append(name).append(name_width - name.size(), ' ');
+    surface_->put_string(Point{1, y}, line_);
+
+    // Right aligned, the way the chart has the latest bucket at the right
+    // edge even while there are fewer buckets than columns
+    auto dim = surface_->get_size();
+    auto from = row_offsets_[row_idx];
+    auto to = row_offsets_[row_idx + 1];
+    auto x = U16(std::max(INT(line_.size()) + 2, INT(dim.width) -
+                                                     INT(to - from) + 1));
+
+    for (auto i = from; i < to; ++i) {
+        Point pt{x++, y};
+        auto value = values_[i];
+        if (value == GAP_VALUE) {
+            surface_->put_glyph(pt, GLYPH_DASHED_LINE);
+            continue;
+        }
+        if (value == PENDING_VALUE) {
+            surface_->put_glyph(pt, GLYPH_MIDDLE_DOT);
+            continue;
+        }
+        if (value == BLANK_VALUE) {
+            continue;
+        }
+
+        std::size_t shade{0};
+        if (value > 0) {
+            shade = 1;
+            while ((shade < NUM_SHADES) && (value > thresholds_[shade - 1])) {
+                ++shade;
+            }
+        }
+        surface_->put_glyph(pt, GLYPH_SHADES[shade]);
+    }
+}
+
+void HeatMap::draw_title(const std::string &title, std::size_t first_iface,
+                         std::size_t num_rows, uint64_t max_value,
+                         AggregationWindow window, DisplayScale scale,
+                         Statistic stat) {
+    auto dim = surface_->get_size();
+
+    auto y_scale = scale == DisplayScale::LOG10 ? YAxisScale::BASE10
+                                                : YAxisScale::BASE2;
+    NumBytesBuffer buf{};
+    std::string_view max_fmt{};
+    if (qtty_ != sampling::Quantity::BYTES) {
+        max_fmt = stat == Statistic::SUM
+                      ? formatter_.format_count(&buf, max_value)
+                      : formatter_.format_count_rate(&buf, max_value, "s");
+    } else {
+        max_fmt =
+            stat == Statistic::SUM
+                ? formatter_.format_num_bytes(&buf, y_scale, max_value)
+                : formatter_.format_num_bytes_rate(&buf, y_scale, max_value,
+                                                   "s");
+    }
+
+    // the numbers are padded for the y-axis
+    max_fmt.remove_prefix(std::min(max_fmt.find_first_not_of(' '),
+                                   max_fmt.size()));
+
+    // [avg rx/sec 1-16 max 1.20 mb/s <linear>], or [avg rx packets/sec ...]
+    auto &title_fmt = text_;
+    title_fmt.assign("[").append(sampling::get_label(stat)).append(" ");
+    title_fmt.append(title);
+    if (qtty_ != sampling::Quantity::BYTES) {
+        title_fmt.append(" ").append(sampling::get_label(qtty_));
+    }
+    title_fmt.append("/").append(sampling::get_label(window)).append(" ");
+    append_number(first_iface + 1, &title_fmt);
+    title_fmt.append("-");
+    append_number(first_iface + num_rows, &title_fmt);
+    title_fmt.append(" max ").append(max_fmt).append(" <");
+    title_fmt.append(get_label(scale)).append(">]");
+
+    auto col = U16(std::max(1, (INT(dim.width) / 2) -
+                                   (INT(title_fmt.size()) / 2)));
+    surface_->put_string(Point{col, 1}, title_fmt);
+}
+
+void HeatMap::draw_menu(std::size_t num_ifaces) {
+    auto dim = surface_->get_size();
+
+    auto &menu = menu_;
+    if (prompt_.empty()) {
+        menu.assign(" (q)uit (r)x (t)x (d)ual s(c)ale (s)tat (i)face (g)oto "
+                    "(h) chart (arrow keys)");
+    } else {
+        menu.assign(" ").append(prompt_);
+    }
+    menu.resize(dim.width, ' ');
+
+    // the number of ifaces at the end, where the chart has the iface
+    auto &label = text_;
+    label.assign("[");
+    append_number(num_ifaces, &label);
+    label.append(" ifaces]");
+    if (label.size() < menu.size()) {
+        menu.replace(menu.size() - label.size(), label.size(), label);
+    }
+
+    auto &menu_fmt = text_;
+    menu_fmt.clear();
+    formatter_.reverse_video(&menu_fmt, menu);
+
+    surface_->put_string(Point{1, dim.height}, menu_fmt);
+}
+
+} // namespace termui
+} // namespace bandwit
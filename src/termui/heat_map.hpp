@@ -0,0 +1,107 @@
+#ifndef HEAT_MAP_H
+#define HEAT_MAP_H
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "formatter.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/quantity.hpp"
+#include "sampling/statistic.hpp"
+#include "sampling/time_series_slice.hpp"
+#include "termui/display_scale.hpp"
+#include "termui/point.hpp"
+#include "tools/profiler.hpp"
+
+namespace bandwit {
+namespace termui {
+
+class TerminalSurface;
+
+// The buckets of many ifaces side by side, a row per iface in the order they
+// are monitored and a cell per bucket, shaded by how large the bucket is next
+// to the largest one on display. Meant for the queues of a NIC, where the one
+// queue that takes all the traffic stands out as the one dark row. Drawn on
+// the same surface as the BarChart, in its place.
+class HeatMap {
+    using AggregationWindow = sampling::AggregationWindow;
+    using Statistic = sampling::Statistic;
+    using TimeSeriesSlice = sampling::TimeSeriesSlice;
+
+  public:
+    struct Row {
+        std::string_view iface_name{};
+        // The buckets of the row, the current one last. With a second slice
+        // both are added up, eg. rx and tx.
+        TimeSeriesSlice slice{};
+        std::optional<TimeSeriesSlice> other_slice{};
+    };
+
+    // Times the stages of every frame into the profiler, if there is one
+    explicit HeatMap(TerminalSurface *surface,
+                     tools::Profiler *profiler = nullptr)
+        : surface_{surface}, profiler_{profiler} {}
+
+    // How many rows fit under the title and above the menu
+    std::size_t get_num_rows() const;
+
+    // How many buckets the rows with names of up to name_width chars show
+    uint16_t get_map_width(std::size_t name_width) const;
+
+    // title is eg. "rx", the rows are those of the ifaces from first_iface
+    // on out of num_ifaces
+    void draw(const std::string &title, const std::vector<Row> &rows,
+              std::size_t first_iface, std::size_t num_ifaces,
+              AggregationWindow window, DisplayScale scale, Statistic stat);
+
+    // Shown instead of the menu while it is not empty
+    void set_prompt(const std::string &prompt);
+
+    // What the values count, the bytes unless set
+    void set_quantity(sampling::Quantity qtty);
+
+  private:
+    // the shades there are besides an empty cell
+    static constexpr std::size_t NUM_SHADES = 4;
+
+    uint16_t get_name_width(std::size_t name_width) const;
+
+    // All the buckets of all the rows into values_, returns the largest
+    uint64_t load_values(const std::vector<Row> &rows);
+    // The largest bucket of every shade
+    void set_thresholds(uint64_t max_value, DisplayScale scale);
+    void draw_row(uint16_t y, const Row &row, std::size_t row_idx,
+                  uint16_t name_width);
+    void draw_title(const std::string &title, std::size_t first_iface,
+                    std::size_t num_rows, uint64_t max_value,
+                    AggregationWindow window, DisplayScale scale,
+                    Statistic stat);
+    void draw_menu(std::size_t num_ifaces);
+
+    TerminalSurface *surface_{nullptr};
+    tools::Profiler *profiler_{nullptr};
+    Formatter formatter_{};
+    std::string prompt_{};
+    sampling::Quantity qtty_{sampling::Quantity::BYTES};
+
+    std::array<uint64_t, NUM_SHADES> thresholds_{};
+
+    // reused from frame to frame, the buckets of the rows one after the
+    // other
+    std::vector<uint64_t> values_{};
+    // where the buckets of each row start, and where the last one ends
+    std::vector<std::size_t> row_offsets_{};
+    std::string line_{};
+    // the title and the menu are formatted into these, as in the chart
+    std::string menu_{};
+    std::string text_{};
+};
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // HEAT_MAP_H
@@ -1,75 +1,211 @@
-#include <cstdio>
-#include <cstring>
-#include <thread>
+#include <cerrno>
+#include <unistd.h>
 
 #include "keyboard_input.hpp"
+#include "macros.hpp"
 
 namespace bandwit {
 namespace termui {
 
-KeyPress KeyboardInputReader::read_keypress(Millis interval) {
-    KeyPress key{KeyPress::NOTHING};
+bool Key::operator==(const Key &other) const {
+    return (press == other.press) && (ch == other.ch);
+}
+
+bool Key::operator!=(const Key &other) const { return !(*this == other); }
 
-    // Sleep first to give the user time to press a key
-    std::this_thread::sleep_for(interval);
+const KeyDecoder::KeyTable KeyDecoder::CHAR_KEYS = make_char_keys();
+const KeyDecoder::KeyTable KeyDecoder::FINAL_KEYS = make_final_keys();
+const KeyDecoder::KeyTable KeyDecoder::TILDE_KEYS = make_tilde_keys();
 
-    // Read the key press non blocking
-    char chars[4096] = {0};
-    int i = 0;
+KeyDecoder::KeyTable KeyDecoder::make_char_keys() {
+    KeyTable table{};
+    table.fill(KeyPress::NOTHING);
 
-    char ch = fgetc(fl_);
-    while (ch >= 0) {
-        chars[i++] = ch;
-        ch = fgetc(fl_);
+    for (auto ch = ' '; ch <= '~'; ++ch) {
+        table[SIZE_T(ch)] = KeyPress::CHAR;
     }
 
-    if ((strlen(chars) == 1) && (chars[0] == '\n')) {
-        key = KeyPress::CARRIAGE_RETURN;
-    } else if ((strlen(chars) == 1) && (chars[0] == 'r')) {
-        key = KeyPress::LETTER_R;
-    } else if ((strlen(chars) == 1) && (chars[0] == 't')) {
-        key = KeyPress::LETTER_T;
-    } else if ((strlen(chars) == 1) && (chars[0] == 'c')) {
-        key = KeyPress::LETTER_C;
-    } else if ((strlen(chars) == 1) && (chars[0] == 's')) {
-        key = KeyPress::LETTER_S;
-    } else if ((strlen(chars) == 1) && (chars[0] == 'q')) {
-        key = KeyPress::QUIT;
-    } else if ((strlen(chars) == 3) && (chars[0] == '\033') &&
-               chars[2] == 'A') {
-        key = KeyPress::ARROW_UP;
-    } else if ((strlen(chars) == 3) && (chars[0] == '\033') &&
-               chars[2] == 'B') {
-        key = KeyPress::ARROW_DOWN;
-    } else if ((strlen(chars) == 3) && (chars[0] == '\033') &&
-               chars[2] == 'C') {
-        key = KeyPress::ARROW_RIGHT;
-    } else if ((strlen(chars) == 3) && (chars[0] == '\033') &&
-               chars[2] == 'D') {
-        key = KeyPress::ARROW_LEFT;
+    table['\n'] = KeyPress::CARRIAGE_RETURN;
+    // ^H or DEL, depending on the terminal
+    table['\b'] = KeyPress::BACKSPACE;
+    table[0x7f] = KeyPress::BACKSPACE;
+    table['r'] = KeyPress::LETTER_R;
+    table['t'] = KeyPress::LETTER_T;
+    table['d'] = KeyPress::LETTER_D;
+    table['c'] = KeyPress::LETTER_C;
+    table['s'] = KeyPress::LETTER_S;
+    table['i'] = KeyPress::LETTER_I;
+    table['b'] = KeyPress::LETTER_B;
+    table['g'] = KeyPress::LETTER_G;
+    table['p'] = KeyPress::LETTER_P;
+    table['o'] = KeyPress::LETTER_O;
+    table['k'] = KeyPress::LETTER_K;
+    table['h'] = KeyPress::LETTER_H;
+    table['q'] = KeyPress::QUIT;
+    return table;
+}
+
+KeyDecoder::KeyTable KeyDecoder::make_final_keys() {
+    KeyTable table{};
+    table.fill(KeyPress::NOTHING);
+
+    // Arrow keys are sent as \033[A (or \033OA in application mode), and
+    // as eg. \033[1;5A with a modifier held down
+    table['A'] = KeyPress::ARROW_UP;
+    table['B'] = KeyPress::ARROW_DOWN;
+    table['C'] = KeyPress::ARROW_RIGHT;
+    table['D'] = KeyPress::ARROW_LEFT;
+    table['H'] = KeyPress::HOME;
+    table['F'] = KeyPress::END;
+    return table;
+}
+
+KeyDecoder::KeyTable KeyDecoder::make_tilde_keys() {
+    KeyTable table{};
+    table.fill(KeyPress::NOTHING);
+
+    // The vt220 numbers, and the rxvt ones for Home and End
+    table[1] = KeyPress::HOME;
+    table[4] = KeyPress::END;
+    table[5] = KeyPress::PAGE_UP;
+    table[6] = KeyPress::PAGE_DOWN;
+    table[7] = KeyPress::HOME;
+    table[8] = KeyPress::END;
+    return table;
+}
+
+void KeyDecoder::decode(std::string_view input, std::vector<Key> *keys) {
+    for (auto ch : input) {
+        if (!decode_char(ch, keys)) {
+            decode_char(ch, keys);
+        }
     }
-    return key;
 }
 
-KeyPress KeyboardInputReader::read_nonblocking(Millis interval) {
-    // We have `interval` of time in which to read a key press. Once we read it
-    // we immediately return it. If there is no input we keep spinning and
-    // trying again.
-    auto num_loops = interval / read_char_interval_;
-    auto frac_read_interval = interval - (num_loops * read_char_interval_);
-
-    // spin for num_loops + 1 and use the fractional interval in one of the
-    // loops
-    for (auto i = 0; i < num_loops + 1; i++) {
-        auto sleep = i == 0 ? frac_read_interval : read_char_interval_;
-
-        auto key = read_keypress(sleep);
-        if (key != KeyPress::NOTHING) {
-            return key;
+bool KeyDecoder::has_pending_escape() const {
+    return state_ == State::ESCAPE;
+}
+
+void KeyDecoder::flush(std::vector<Key> *keys) {
+    if (state_ == State::ESCAPE) {
+        keys->push_back(Key{KeyPress::ESCAPE});
+        state_ = State::GROUND;
+    }
+}
+
+bool KeyDecoder::decode_char(char ch, std::vector<Key> *keys) {
+    auto byte = U8(ch);
+
+    // Not part of any key, and ends whatever sequence it interrupts
+    if (byte >= CHAR_KEYS.size()) {
+        state_ = State::GROUND;
+        return true;
+    }
+
+    if (state_ == State::GROUND) {
+        if (ch == '\033') {
+            state_ = State::ESCAPE;
+        } else if (CHAR_KEYS[byte] != KeyPress::NOTHING) {
+            keys->push_back(Key{CHAR_KEYS[byte], ch});
         }
+        return true;
     }
 
-    return KeyPress::NOTHING;
+    if (state_ == State::ESCAPE) {
+        if ((ch == '[') || (ch == 'O')) {
+            state_ = State::SEQUENCE;
+            sequence_len_ = 0;
+            sequence_param_ = 0;
+            is_param_done_ = false;
+            return true;
+        }
+
+        // The escape was a key of its own
+        keys->push_back(Key{KeyPress::ESCAPE});
+        state_ = State::GROUND;
+        return false;
+    }
+
+    // Parameter and intermediate bytes, eg. the 1;5 of \033[1;5A
+    if ((byte >= 0x20) && (byte <= 0x3f)) {
+        if ((ch >= '0') && (ch <= '9') && !is_param_done_) {
+            sequence_param_ = sequence_param_ * 10 + SIZE_T(ch - '0');
+        } else {
+            is_param_done_ = true;
+        }
+
+        if (++sequence_len_ > MAX_SEQUENCE_LEN) {
+            state_ = State::GROUND;
+        }
+        return true;
+    }
+
+    state_ = State::GROUND;
+
+    // a control char aborts the sequence and counts by itself
+    if (byte < 0x20) {
+        return false;
+    }
+
+    decode_final(byte, keys);
+    return true;
+}
+
+void KeyDecoder::decode_final(uint8_t byte, std::vector<Key> *keys) {
+    auto press = KeyPress::NOTHING;
+
+    if (byte == '~') {
+        // at most MAX_SEQUENCE_LEN digits, so it could still be anything
+        if (sequence_param_ < TILDE_KEYS.size()) {
+            press = TILDE_KEYS[sequence_param_];
+        }
+    } else {
+        press = FINAL_KEYS[byte];
+    }
+
+    if (press != KeyPress::NOTHING) {
+        keys->push_back(Key{press});
+    }
+}
+
+bool KeyboardInputReader::read_nonblocking(std::vector<Key> *keys) {
+    keys->clear();
+
+    // Read the key presses non blocking. Bypass stdio so that nothing is left
+    // buffered where poll() can't see it.
+    char chars[READ_BUFFER_SIZE];
+    auto nread = read(fileno(fl_), chars, sizeof(chars));
+    if (nread == 0) {
+        return false;
+    }
+
+    // A terminal that hung up fails with EIO
+    if (nread < 0) {
+        return (errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR);
+    }
+
+    decoder_.decode(std::string_view{chars, SIZE_T(nread)}, keys);
+
+    escape_deadline_.reset();
+    if (decoder_.has_pending_escape()) {
+        escape_deadline_ = SteadyClock::now() + ESCAPE_TIMEOUT;
+    }
+    return true;
+}
+
+std::optional<SteadyTimePoint>
+KeyboardInputReader::get_escape_deadline() const {
+    return escape_deadline_;
+}
+
+void KeyboardInputReader::flush_if_due(SteadyTimePoint now,
+                                       std::vector<Key> *keys) {
+    keys->clear();
+
+    if (escape_deadline_.has_value() && (now >= escape_deadline_.value())) {
+        decoder_.flush(keys);
+        escape_deadline_.reset();
+    }
 }
 
 } // namespace termui
@@ -1,9 +1,11 @@
 #ifndef KEYBOARD_INPUT_H
 #define KEYBOARD_INPUT_H
 
+#include <array>
 #include <cstdint>
-#include <map>
-#include <string>
+#include <cstdio>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 #include "aliases.hpp"
@@ -16,29 +18,128 @@ enum class KeyPress {
     CARRIAGE_RETURN,
     LETTER_R,
     LETTER_T,
+    LETTER_D,
     LETTER_C,
     LETTER_S,
+    LETTER_I,
+    LETTER_B,
+    LETTER_G,
+    LETTER_P,
+    LETTER_O,
+    LETTER_K,
+    LETTER_H,
     ARROW_UP,
     ARROW_DOWN,
     ARROW_LEFT,
     ARROW_RIGHT,
+    PAGE_UP,
+    PAGE_DOWN,
+    HOME,
+    END,
+    BACKSPACE,
+    ESCAPE,
     QUIT,
+    // a printable char that is not bound to anything, for typing into a
+    // prompt
+    CHAR,
+};
+
+struct Key {
+    KeyPress press{KeyPress::NOTHING};
+
+    // the char that was typed, or 0 for the keys that send a sequence
+    char ch{0};
+
+    bool operator==(const Key &other) const;
+    bool operator!=(const Key &other) const;
+};
+
+// Splits a stream of terminal input into key presses. Plain chars and the
+// final bytes of escape sequences are looked up in tables, anything that is
+// not bound to a key is skipped. An escape sequence that is cut in two by
+// the end of the input is picked up where it left off by the next decode(),
+// even right after its \033.
+class KeyDecoder {
+  public:
+    // Appends the key presses in input to keys
+    void decode(std::string_view input, std::vector<Key> *keys);
+
+    // Whether the input ended in a \033 that nothing followed yet. The
+    // escape key sends a lone \033, which is told apart from the start of a
+    // sequence by nothing following it for a while.
+    bool has_pending_escape() const;
+
+    // Takes a pending \033 as the escape key
+    void flush(std::vector<Key> *keys);
+
+  private:
+    enum class State {
+        GROUND,
+        // after \033
+        ESCAPE,
+        // after \033[ or \033O, up to the final byte
+        SEQUENCE,
+    };
+
+    // A sequence longer than this is garbage, eg. a stray \033[ followed by
+    // a paste, and is given up on
+    static constexpr std::size_t MAX_SEQUENCE_LEN = 16;
+
+    using KeyTable = std::array<KeyPress, 128>;
+
+    static KeyTable make_char_keys();
+    static KeyTable make_final_keys();
+    static KeyTable make_tilde_keys();
+
+    // decodes ch, returns false if it has to be decoded again in GROUND
+    bool decode_char(char ch, std::vector<Key> *keys);
+    void decode_final(uint8_t byte, std::vector<Key> *keys);
+
+    static const KeyTable CHAR_KEYS;
+    static const KeyTable FINAL_KEYS;
+    // by the number of sequences like \033[5~
+    static const KeyTable TILDE_KEYS;
+
+    State state_{State::GROUND};
+    std::size_t sequence_len_{0};
+
+    // the first number in the sequence, up to the first separator
+    std::size_t sequence_param_{0};
+    bool is_param_done_{false};
 };
 
 class KeyboardInputReader {
   public:
     explicit KeyboardInputReader(FILE *fl) : fl_{fl} {}
 
-    KeyPress read_nonblocking(Millis interval);
+    // Decodes whatever input is available right now into keys, without
+    // blocking, in the order they were pressed. To be called when the event
+    // loop says the input is ready. Returns false once there is no more
+    // input to come, eg. a pipe at EOF or a terminal that hung up, which
+    // would otherwise be ready again straight away.
+    bool read_nonblocking(std::vector<Key> *keys);
+
+    // When a \033 that nothing followed yet is taken as the escape key, if
+    // there is one. To be waited for along with the input.
+    std::optional<SteadyTimePoint> get_escape_deadline() const;
+
+    // Decodes the pending \033 as the escape key once its deadline passed
+    void flush_if_due(SteadyTimePoint now, std::vector<Key> *keys);
 
   private:
-    KeyPress read_keypress(Millis interval);
+    // As much as a held down key repeats in between two frames, and then
+    // some. Anything beyond is read on the next wakeup.
+    static constexpr std::size_t READ_BUFFER_SIZE = 256;
+
+    // How long the rest of a sequence may take to follow its \033. A
+    // terminal writes a sequence at once, but a slow link can split it.
+    static constexpr Millis ESCAPE_TIMEOUT{50};
 
     // Where to read the char from
     FILE *fl_;
 
-    // How much time to allow for a single key press
-    Millis read_char_interval_{10};
+    KeyDecoder decoder_{};
+    std::optional<SteadyTimePoint> escape_deadline_{};
 };
 
 } // namespace termui
@@ -0,0 +1,71 @@
+#include "memory_terminal_driver.hpp"
+
+namespace bandwit {
+namespace termui {
+
+MemoryTerminalDriver::MemoryTerminalDriver(Dimensions dim, Point cursor,
+                                           TerminalCapabilities caps)
+    : dim_{dim}, cursor_{cursor}, caps_{caps} {
+    frame_.reserve(FRAME_CAPACITY);
+    last_frame_.reserve(FRAME_CAPACITY);
+}
+
+TerminalCapabilities MemoryTerminalDriver::get_capabilities() {
+    return caps_;
+}
+
+Dimensions MemoryTerminalDriver::get_terminal_size() { return dim_; }
+
+Point MemoryTerminalDriver::get_cursor_position() { return cursor_; }
+
+void MemoryTerminalDriver::set_cursor_position(const Point &pt) {
+    append_cursor_move(pt);
+    cursor_ = pt;
+    ++num_cursor_moves_;
+}
+
+void MemoryTerminalDriver::put_char(const char &ch) { frame_ += ch; }
+
+void MemoryTerminalDriver::put_uchar(std::string_view ch) { frame_ += ch; }
+
+void MemoryTerminalDriver::put_string(const std::string &str) {
+    frame_ += str;
+}
+
+void MemoryTerminalDriver::flush_output() {
+    num_bytes_written_ += frame_.size();
+    ++num_flushes_;
+
+    frame_.swap(last_frame_);
+    frame_.clear();
+}
+
+std::size_t MemoryTerminalDriver::get_num_bytes_written() const {
+    return num_bytes_written_;
+}
+
+void MemoryTerminalDriver::set_terminal_size(Dimensions dim) { dim_ = dim; }
+
+std::size_t MemoryTerminalDriver::get_num_cursor_moves() const {
+    return num_cursor_moves_;
+}
+
+std::size_t MemoryTerminalDriver::get_num_flushes() const {
+    return num_flushes_;
+}
+
+std::string_view MemoryTerminalDriver::get_last_frame() const {
+    return last_frame_;
+}
+
+void MemoryTerminalDriver::append_cursor_move(const Point &pt) {
+    // \033[y;xH
+    frame_ += "\033[";
+    frame_ += std::to_string(pt.y);
+    frame_ += ';';
+    frame_ += std::to_string(pt.x);
+    frame_ += 'H';
+}
+
+} // namespace termui
+} // namespace bandwit
@@ -0,0 +1,76 @@
+#ifndef MEMORY_TERMINAL_DRIVER_H
+#define MEMORY_TERMINAL_DRIVER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "macros.hpp"
+#include "termui/dimensions.hpp"
+#include "termui/point.hpp"
+#include "termui/terminal_capabilities.hpp"
+#include "termui/terminal_driver.hpp"
+
+namespace bandwit {
+namespace termui {
+
+// A terminal that only exists in memory, to measure what drawing costs
+// without a tty. The output of a frame is kept until the next one is flushed,
+// along with running counts of the bytes, cursor moves and flushes.
+class MemoryTerminalDriver : public TerminalDriver {
+  public:
+    // A modern terminal unless told otherwise
+    explicit MemoryTerminalDriver(
+        Dimensions dim, Point cursor = Point{1, 1},
+        TerminalCapabilities caps = TerminalCapabilities{true, true, true,
+                                                         true});
+
+    CLASS_DISABLE_COPIES(MemoryTerminalDriver)
+    CLASS_DISABLE_MOVES(MemoryTerminalDriver)
+
+    TerminalCapabilities get_capabilities() override;
+    Dimensions get_terminal_size() override;
+    Point get_cursor_position() override;
+    void set_cursor_position(const Point &pt) override;
+    void put_char(const char &ch) override;
+    void put_uchar(std::string_view ch) override;
+    void put_string(const std::string &str) override;
+    void flush_output() override;
+
+    std::size_t get_num_bytes_written() const override;
+
+    // the size that is reported from now on, the window picks it up with
+    // its next on_resize()
+    void set_terminal_size(Dimensions dim);
+
+    std::size_t get_num_cursor_moves() const;
+    std::size_t get_num_flushes() const;
+
+    // the output of the last flush, escape sequences included
+    std::string_view get_last_frame() const;
+
+  private:
+    // the same sequence the tty driver moves the cursor with
+    void append_cursor_move(const Point &pt);
+
+    Dimensions dim_;
+    Point cursor_;
+    TerminalCapabilities caps_;
+
+    // As much as the tty driver reserves, so that neither allocates for a
+    // frame that would not on a tty either
+    static constexpr std::size_t FRAME_CAPACITY = 16 * 1024;
+
+    // swapped on flush so that neither grows past the biggest frame
+    std::string frame_{};
+    std::string last_frame_{};
+
+    std::size_t num_bytes_written_{0};
+    std::size_t num_cursor_moves_{0};
+    std::size_t num_flushes_{0};
+};
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // MEMORY_TERMINAL_DRIVER_H
@@ -15,21 +15,14 @@ void SignalSuspender::suspend() {
         sigaddset(&mask, signo);
     }
 
-    if (sigprocmask(SIG_BLOCK, &mask, nullptr) < 0) {
+    if (sigprocmask(SIG_BLOCK, &mask, &orig_mask_) < 0) {
         THROW_CERROR(std::runtime_error,
                      "SignalSuspender.suspend failed in sigprocmask()");
     }
 }
 
 void SignalSuspender::restore() {
-    sigset_t mask;
-    sigemptyset(&mask);
-
-    for (auto signo : signums_) {
-        sigaddset(&mask, signo);
-    }
-
-    if (sigprocmask(SIG_UNBLOCK, &mask, nullptr) < 0) {
+    if (sigprocmask(SIG_SETMASK, &orig_mask_, nullptr) < 0) {
         THROW_CERROR(std::runtime_error,
                      "SignalSuspender.restore failed in sigprocmask()");
     }
@@ -1,6 +1,7 @@
 #ifndef SIGNALS_H
 #define SIGNALS_H
 
+#include <csignal>
 #include <initializer_list>
 #include <vector>
 
@@ -18,6 +19,10 @@ class SignalSuspender {
 
   private:
     std::vector<int> signums_{};
+
+    // Restoring puts back the mask from before suspending, so that signals
+    // that were already blocked stay blocked
+    sigset_t orig_mask_{};
 };
 
 class SignalGuard {
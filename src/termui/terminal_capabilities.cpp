@@ -0,0 +1,35 @@
+#include <cstring>
+
+#include "terminal_capabilities.hpp"
+
+namespace bandwit {
+namespace termui {
+
+TerminalCapabilities get_term_capabilities(const char *term) {
+    TerminalCapabilities caps{};
+    if ((term == nullptr) || (*term == '\0') || (strcmp(term, "dumb") == 0)) {
+        return caps;
+    }
+
+    caps.relative_moves = true;
+    caps.erase = true;
+    caps.shift_chars = true;
+    return caps;
+}
+
+bool has_synchronized_output(std::string_view replies) {
+    // \033[?2026;Ps$y where Ps is 0 for unknown, 1 for set, 2 for reset, 3
+    // for permanently set and 4 for permanently reset
+    constexpr std::string_view prefix = "\033[?2026;";
+
+    auto pos = replies.find(prefix);
+    if (pos == std::string_view::npos) {
+        return false;
+    }
+
+    auto status = replies.substr(pos + prefix.size(), 3);
+    return (status == "1$y") || (status == "2$y") || (status == "3$y");
+}
+
+} // namespace termui
+} // namespace bandwit
@@ -0,0 +1,43 @@
+#ifndef TERMINAL_CAPABILITIES_H
+#define TERMINAL_CAPABILITIES_H
+
+#include <string_view>
+
+namespace bandwit {
+namespace termui {
+
+// The escape sequences a terminal is known to understand on top of absolute
+// cursor moves and SGR attributes. Drawing picks the shortest sequence that
+// the terminal has.
+struct TerminalCapabilities {
+    // CUF, CUB and CUD, eg. \033[3C, and CR + LF to get to the next line
+    bool relative_moves{false};
+
+    // EL and ED, \033[K and \033[J, to blank the rest of a line or screen
+    bool erase{false};
+
+    // DCH and ICH, eg. \033[2P and \033[2@, to move the rest of a line left
+    // or right by deleting or inserting cells
+    bool shift_chars{false};
+
+    // DEC mode 2026, the terminal holds off showing a frame until all of it
+    // has arrived
+    bool synchronized_output{false};
+};
+
+// What a terminal of type term, as in $TERM, can be taken to support without
+// asking it. Anything but a dumb terminal speaks ECMA-48.
+TerminalCapabilities get_term_capabilities(const char *term);
+
+// The query to send for synchronized output, a DECRQM for mode 2026
+constexpr std::string_view SYNCHRONIZED_OUTPUT_QUERY = "\033[?2026$p";
+
+// Whether the replies a terminal sent to SYNCHRONIZED_OUTPUT_QUERY say that
+// it supports the mode, ie. it is either set or reset but not permanently
+// reset or unknown
+bool has_synchronized_output(std::string_view replies);
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // TERMINAL_CAPABILITIES_H
@@ -1,40 +1,39 @@
 #ifndef TERMINAL_DRIVER_H
 #define TERMINAL_DRIVER_H
 
-#include <iostream>
+#include <cstddef>
+#include <string>
+#include <string_view>
 
 #include "macros.hpp"
 #include "termui/dimensions.hpp"
 #include "termui/point.hpp"
+#include "termui/terminal_capabilities.hpp"
 
 namespace bandwit {
 namespace termui {
 
-class FileStatusSetter;
-
+// Where the window's output goes. Output is buffered until it is flushed, a
+// frame at a time.
 class TerminalDriver {
   public:
-    TerminalDriver(FILE *stdin_file, FILE *stdout_file,
-                   FileStatusSetter *status_setter)
-        : stdin_file_{stdin_file}, stdout_file_{stdout_file},
-          status_setter_{status_setter} {}
-
-    Dimensions get_terminal_size();
-    Point get_cursor_position();
-    void set_cursor_position(const Point &pt);
-    void put_char(const char &ch);
-    void put_uchar(const std::string &ch);
-    void put_string(const std::string &str);
-    void flush_output();
-
-  private:
-    FILE *stdin_file_{};
-    FILE *stdout_file_{};
-
-    FileStatusSetter *status_setter_{nullptr};
-
-    // we need a one char null terminated string
-    char char_str_[2] = {0};
+    TerminalDriver() = default;
+    virtual ~TerminalDriver() = default;
+
+    CLASS_DISABLE_COPIES(TerminalDriver)
+    CLASS_DISABLE_MOVES(TerminalDriver)
+
+    virtual TerminalCapabilities get_capabilities() = 0;
+    virtual Dimensions get_terminal_size() = 0;
+    virtual Point get_cursor_position() = 0;
+    virtual void set_cursor_position(const Point &pt) = 0;
+    virtual void put_char(const char &ch) = 0;
+    virtual void put_uchar(std::string_view ch) = 0;
+    virtual void put_string(const std::string &str) = 0;
+    virtual void flush_output() = 0;
+
+    // all the bytes that were ever flushed
+    virtual std::size_t get_num_bytes_written() const = 0;
 };
 
 } // namespace termui
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
 #include "except.hpp"
@@ -8,6 +12,44 @@
 namespace bandwit {
 namespace termui {
 
+// Erasing takes 3 bytes and a cursor move, fewer changed cells than this are
+// as cheap to write out
+constexpr std::size_t MIN_CELLS_TO_ERASE = 4;
+
+// A row that scrolled sideways by up to this many columns is moved on the
+// terminal instead of being written out again
+constexpr uint16_t MAX_SHIFT = 8;
+
+// Moving the cells of a row on the terminal only pays off for more changed
+// cells than this, and only if it saves writing at least half of them
+constexpr std::size_t MIN_CELLS_TO_SHIFT = 8;
+
+// The ways to get the cursor to a cell while flushing
+enum class CursorMove {
+    ABSOLUTE,
+    // write out the unchanged cells on the way again
+    REWRITE,
+    FORWARD,
+    BACK,
+    CARRIAGE_RETURN,
+    DOWN,
+    // CR and as many LFs as there are lines to go down
+    NEXT_LINE,
+};
+
+static std::size_t get_num_digits(uint16_t num) {
+    std::size_t len = 1;
+    for (; num >= 10; num = U16(num / 10)) {
+        ++len;
+    }
+    return len;
+}
+
+// eg. \033[12C, a count of 1 is left out
+static std::size_t get_csi_len(uint16_t num) {
+    return num == 1 ? 3 : 3 + get_num_digits(num);
+}
+
 TerminalSurface::TerminalSurface(TerminalWindow *win, uint16_t num_lines)
     : win_{win}, num_lines_{num_lines} {
     win_->register_resize_receiver(this);
@@ -50,7 +92,10 @@ void TerminalSurface::on_startup() {
     upper_left_ = Point{win_cur.x, upper_left_y};
     lower_left_ = recompute_lower_left(upper_left_);
 
+    resize_buffers();
     clear_surface();
+    invalidate();
+    flush();
 }
 
 void TerminalSurface::on_window_resize(const Dimensions &win_dim_old,
@@ -85,7 +130,11 @@ void TerminalSurface::on_window_resize(const Dimensions &win_dim_old,
     lower_left_ = recompute_lower_left(upper_left_);
     dim_ = recompute_dimensions(win_dim_new);
 
+    // The terminal may have reflowed whatever was on it, so repaint it all
+    resize_buffers();
     clear_surface();
+    invalidate();
+    flush();
 
     // Notify our receiver
     if (resize_receiver_ != nullptr) {
@@ -122,53 +171,130 @@ void TerminalSurface::on_carriage_return() {
     dim_ = recompute_dimensions(win_dim);
     upper_left_.y -= 1;
     lower_left_ = recompute_lower_left(upper_left_);
+
+    resize_buffers();
+    invalidate();
 }
 
 void TerminalSurface::clear_surface() {
-    auto dim = get_size();
-    auto upper_left = get_upper_left();
-    auto lower_left = get_lower_left();
+    std::fill(back_.begin(), back_.end(), Cell{});
+    pen_attrs_ = 0;
+}
 
-    win_->set_cursor(upper_left);
+void TerminalSurface::put_char(const Point &point, const char &ch) {
+    put_glyph(point, Glyph{std::string_view{&ch, 1}});
+}
 
-    for (int y = 0; y < num_lines_; ++y) {
-        for (int x = 1; x <= dim.width; ++x) {
-            win_->put_char(bg_char_);
-        }
+void TerminalSurface::put_glyph(const Point &point, const Glyph &glyph) {
+    auto *cell = get_cell(point);
+    if (cell == nullptr) {
+        return;
     }
 
-    win_->set_cursor(lower_left);
-    win_->flush();
+    cell->glyph = glyph;
+    cell->attrs = pen_attrs_;
 }
 
-void TerminalSurface::put_char(const Point &point, const char &ch) {
-    auto point_win = translate_point(point);
+void TerminalSurface::fill_column(const Point &bottom, uint16_t len,
+                                  const Glyph &glyph) {
+    if ((len == 0) || (bottom.x < 1) || (bottom.x > dim_.width) ||
+        (bottom.y < 1)) {
+        return;
+    }
 
-    win_->set_cursor(point_win);
-    win_->put_char(ch);
-}
+    // Clip at both the bottom and the top of the surface
+    int y_bottom = std::min(INT(bottom.y), INT(dim_.height));
+    int y_top = std::max(INT(bottom.y) - INT(len) + 1, 1);
 
-void TerminalSurface::put_uchar(const Point &point, const std::string &ch) {
-    auto point_win = translate_point(point);
+    Cell cell{glyph, pen_attrs_};
 
-    win_->set_cursor(point_win);
-    win_->put_uchar(ch);
+    // row major, so the cells of a column are a whole width apart
+    for (int y = y_top; y <= y_bottom; ++y) {
+        back_[SIZE_T(y - 1) * dim_.width + (bottom.x - 1)] = cell;
+    }
 }
 
 void TerminalSurface::put_string(const Point &point, const std::string &str) {
-    auto point_win = translate_point(point);
+    Point cur = point;
+
+    for (std::size_t i = 0; i < str.size();) {
+        auto ch = static_cast<unsigned char>(str[i]);
 
-    win_->set_cursor(point_win);
-    win_->put_string(str);
+        // An escape sequence like \033[7m: only SGR sequences are
+        // interpreted, they set the attributes of the cells that follow
+        if ((ch == '\033') && (i + 1 < str.size()) && (str[i + 1] == '[')) {
+            auto end = str.find_first_of("ABCDEFGHJKSTfhlmnsu", i + 2);
+            if (end == std::string::npos) {
+                break;
+            }
+
+            if (str[end] == 'm') {
+                auto params = std::string_view{str}.substr(i + 2, end - i - 2);
+                apply_sgr(params);
+            }
+
+            i = end + 1;
+            continue;
+        }
+
+        // The length of a UTF-8 sequence is encoded in its first byte
+        std::size_t len = 1;
+        if ((ch & 0xE0) == 0xC0) {
+            len = 2;
+        } else if ((ch & 0xF0) == 0xE0) {
+            len = 3;
+        } else if ((ch & 0xF8) == 0xF0) {
+            len = 4;
+        }
+
+        put_glyph(cur, Glyph{std::string_view{str}.substr(i, len)});
+        cur.x++;
+        i += len;
+    }
 }
 
 void TerminalSurface::flush() {
+    // Each flush starts and ends with the default attributes
+    flush_cursor_valid_ = false;
+    flush_attrs_ = 0;
+    flush_has_output_ = false;
+
+    const auto &caps = win_->get_capabilities();
+    auto no_blank_x = U16(dim_.width + 1);
+    auto blank_y = caps.erase ? get_blank_rows() : U16(dim_.height + 1);
+
+    for (uint16_t y = 1; y <= dim_.height; ++y) {
+        if ((y == blank_y) && erase_display(y)) {
+            break;
+        }
+
+        // Most rows of a big surface are the same as in the last frame
+        if (front_valid_ && is_row_unchanged(y)) {
+            continue;
+        }
+
+        if (front_valid_ && caps.shift_chars) {
+            shift_row(y);
+        }
+
+        flush_row(y, caps.erase ? get_blank_tail(y) : no_blank_x);
+    }
+
+    write_attrs(0);
+    front_valid_ = true;
+
     auto lower_left = get_lower_left();
     win_->set_cursor(lower_left);
 
+    if (flush_has_output_ && caps.synchronized_output) {
+        win_->put_uchar("\033[?2026l");
+    }
+
     win_->flush();
 }
 
+void TerminalSurface::invalidate() { front_valid_ = false; }
+
 const Dimensions &TerminalSurface::get_size() const { return dim_; }
 
 const Point &TerminalSurface::get_upper_left() const { return upper_left_; }
@@ -214,5 +340,410 @@ Point TerminalSurface::translate_point(const Point &point) {
     return point_win;
 }
 
+void TerminalSurface::resize_buffers() {
+    auto num_cells = SIZE_T(dim_.width) * dim_.height;
+    if (back_.size() == num_cells) {
+        return;
+    }
+
+    back_.assign(num_cells, Cell{});
+    front_.assign(num_cells, Cell{});
+    front_valid_ = false;
+}
+
+Cell *TerminalSurface::get_cell(const Point &point) {
+    // Anything drawn off the surface is clipped
+    if ((point.x < 1) || (point.x > dim_.width) || (point.y < 1) ||
+        (point.y > dim_.height)) {
+        return nullptr;
+    }
+
+    auto idx = SIZE_T(point.y - 1) * dim_.width + (point.x - 1);
+    return &back_[idx];
+}
+
+void TerminalSurface::apply_sgr(std::string_view params) {
+    // An empty parameter list means reset, same as 0
+    if (params.empty()) {
+        pen_attrs_ = 0;
+        return;
+    }
+
+    while (!params.empty()) {
+        auto end = params.find(';');
+        auto param = params.substr(0, end);
+        params = end == std::string_view::npos ? std::string_view{}
+                                               : params.substr(end + 1);
+
+        if ((param == "0") || param.empty()) {
+            pen_attrs_ = 0;
+        } else if (param == "1") {
+            pen_attrs_ |= Cell::ATTR_BOLD;
+        } else if (param == "7") {
+            pen_attrs_ |= Cell::ATTR_REVERSE;
+        } else if (param == "22") {
+            pen_attrs_ &= U8(~Cell::ATTR_BOLD);
+        } else if (param == "27") {
+            pen_attrs_ &= U8(~Cell::ATTR_REVERSE);
+        }
+    }
+}
+
+bool TerminalSurface::needs_write(std::size_t idx) const {
+    return !front_valid_ || (back_[idx] != front_[idx]);
+}
+
+bool TerminalSurface::is_row_unchanged(uint16_t y) const {
+    auto row = SIZE_T(y - 1) * dim_.width;
+    return memcmp(&back_[row], &front_[row], dim_.width * sizeof(Cell)) == 0;
+}
+
+uint16_t TerminalSurface::get_blank_tail(uint16_t y) const {
+    // The first x of the blank cells that the row ends with
+    auto row = SIZE_T(y - 1) * dim_.width;
+    auto x = U16(dim_.width + 1);
+    while ((x > 1) && (back_[row + x - 2] == Cell{})) {
+        --x;
+    }
+    return x;
+}
+
+uint16_t TerminalSurface::get_blank_rows() const {
+    // The first y of the blank rows that the surface ends with
+    auto y = U16(dim_.height + 1);
+    while ((y > 1) && (get_blank_tail(U16(y - 1)) == 1)) {
+        --y;
+    }
+    return y;
+}
+
+void TerminalSurface::shift_row(uint16_t y) {
+    // The bars of a chart that scrolled are the ones on the terminal moved a
+    // few columns to the side. Deleting or inserting that many cells where
+    // the rows start to differ has the terminal move them, then only the
+    // columns that came in are left to write.
+    const auto *back = &back_[SIZE_T(y - 1) * dim_.width];
+    auto *front = &front_[SIZE_T(y - 1) * dim_.width];
+    std::size_t width = dim_.width;
+
+    std::size_t first{0};
+    while ((first < width) && (back[first] == front[first])) {
+        ++first;
+    }
+
+    std::size_t num_changed{0};
+    for (auto i = first; i < width; ++i) {
+        num_changed += back[i] != front[i] ? 1 : 0;
+    }
+
+    if (num_changed < MIN_CELLS_TO_SHIFT) {
+        return;
+    }
+
+    // The cells that would still change after the shift, counting the ones
+    // that come in as changed. Left is what a chart does as time goes on,
+    // right what it does when scrolled back.
+    std::size_t best_cols{0};
+    bool best_is_left{true};
+    std::size_t best_changed = num_changed / 2;
+
+    for (std::size_t num_cols = 1;
+         (num_cols <= MAX_SHIFT) && (first + num_cols < width); ++num_cols) {
+        for (auto is_left : {true, false}) {
+            const auto *from = is_left ? front + num_cols : front;
+            const auto *to = is_left ? back : back + num_cols;
+
+            auto changed = num_cols;
+            for (auto i = first; (i + num_cols < width) &&
+                                 (changed < best_changed);
+                 ++i) {
+                changed += to[i] != from[i] ? 1 : 0;
+            }
+
+            if (changed < best_changed) {
+                best_cols = num_cols;
+                best_is_left = is_left;
+                best_changed = changed;
+            }
+        }
+
+        // Nothing but the columns that come in, no other shift does better
+        if (best_changed == best_cols) {
+            break;
+        }
+    }
+
+    if (best_cols == 0) {
+        return;
+    }
+
+    // DCH and ICH fill in blanks, in the current background
+    begin_output();
+    move_cursor(U16(first + 1), y);
+    write_attrs(0);
+    put_csi(U16(best_cols), best_is_left ? 'P' : '@');
+
+    if (best_is_left) {
+        std::copy(front + first + best_cols, front + width, front + first);
+        std::fill(front + width - best_cols, front + width, Cell{});
+    } else {
+        std::copy_backward(front + first, front + width - best_cols,
+                           front + width);
+        std::fill(front + first, front + first + best_cols, Cell{});
+    }
+}
+
+void TerminalSurface::flush_row(uint16_t y, uint16_t blank_x) {
+    auto row = SIZE_T(y - 1) * dim_.width;
+
+    for (uint16_t x = 1; x <= dim_.width;) {
+        if ((x == blank_x) && erase_line(x, y)) {
+            return;
+        }
+
+        auto idx = row + x - 1;
+        if (!needs_write(idx)) {
+            ++x;
+            continue;
+        }
+
+        // The changed cells that follow with the same attributes go out in
+        // one piece, up to where the blank tail might be erased
+        auto end_x = U16(x + 1);
+        while ((end_x <= dim_.width) && (end_x != blank_x) &&
+               needs_write(row + end_x - 1) &&
+               (back_[row + end_x - 1].attrs == back_[idx].attrs)) {
+            ++end_x;
+        }
+
+        write_cells(x, end_x, y);
+        std::copy(back_.begin() + INT(idx),
+                  back_.begin() + INT(row + end_x - 1),
+                  front_.begin() + INT(idx));
+        x = end_x;
+    }
+}
+
+bool TerminalSurface::erase_line(uint16_t x, uint16_t y) {
+    // Everything from x to the end of the row is blank
+    auto row = SIZE_T(y - 1) * dim_.width;
+    auto first_x = U16(0);
+    std::size_t num_changed{0};
+
+    for (auto cur_x = x; cur_x <= dim_.width; ++cur_x) {
+        if (needs_write(row + cur_x - 1)) {
+            first_x = first_x == 0 ? cur_x : first_x;
+            ++num_changed;
+        }
+    }
+
+    if (num_changed < MIN_CELLS_TO_ERASE) {
+        return false;
+    }
+
+    // EL blanks from the cursor on, in the current background
+    begin_output();
+    move_cursor(first_x, y);
+    write_attrs(0);
+    win_->put_uchar("\033[K");
+
+    auto first = front_.begin() + INT(row + first_x - 1);
+    std::fill(first, front_.begin() + INT(row + dim_.width), Cell{});
+    return true;
+}
+
+bool TerminalSurface::erase_display(uint16_t y) {
+    // Everything from the row y down is blank. ED blanks the rest of the
+    // window, so only if the surface reaches down to its bottom.
+    if (lower_left_.y != win_->get_size().height) {
+        return false;
+    }
+
+    auto start = SIZE_T(y - 1) * dim_.width;
+    auto first = front_.size();
+    std::size_t num_changed{0};
+
+    for (auto idx = start; idx < front_.size(); ++idx) {
+        if (needs_write(idx)) {
+            first = std::min(first, idx);
+            ++num_changed;
+        }
+    }
+
+    if (num_changed < MIN_CELLS_TO_ERASE) {
+        return false;
+    }
+
+    begin_output();
+    move_cursor(U16(first % dim_.width + 1), U16(first / dim_.width + 1));
+    write_attrs(0);
+    win_->put_uchar("\033[J");
+
+    std::fill(front_.begin() + INT(first), front_.end(), Cell{});
+    return true;
+}
+
+void TerminalSurface::begin_output() {
+    if (flush_has_output_) {
+        return;
+    }
+
+    flush_has_output_ = true;
+
+    // The terminal shows nothing of the frame until it has all of it
+    if (win_->get_capabilities().synchronized_output) {
+        win_->put_uchar("\033[?2026h");
+    }
+}
+
+void TerminalSurface::move_cursor(uint16_t x, uint16_t y) {
+    auto cur = flush_cursor_;
+    if (flush_cursor_valid_ && (cur.x == x) && (cur.y == y)) {
+        return;
+    }
+
+    // An absolute move works from anywhere, the others only from where the
+    // cursor is known to be
+    auto win_pt = translate_point(Point{x, y});
+    auto move = CursorMove::ABSOLUTE;
+    std::size_t len = 4 + get_num_digits(win_pt.y) + get_num_digits(win_pt.x);
+
+    auto consider = [&move, &len](CursorMove other, std::size_t other_len) {
+        if (other_len < len) {
+            move = other;
+            len = other_len;
+        }
+    };
+
+    bool is_relative = win_->get_capabilities().relative_moves;
+    auto column_len = x > 1 ? get_csi_len(U16(x - 1)) : 0;
+
+    if (flush_cursor_valid_ && (cur.y == y) && (cur.x < x)) {
+        consider(CursorMove::REWRITE, get_rewrite_len(cur.x, x, y, len));
+        if (is_relative) {
+            consider(CursorMove::FORWARD, get_csi_len(U16(x - cur.x)));
+        }
+    } else if (flush_cursor_valid_ && is_relative && (cur.y == y)) {
+        consider(CursorMove::BACK, get_csi_len(U16(cur.x - x)));
+        consider(CursorMove::CARRIAGE_RETURN, 1 + column_len);
+    } else if (flush_cursor_valid_ && is_relative && (cur.y < y)) {
+        auto num_lines = U16(y - cur.y);
+        if (cur.x == x) {
+            consider(CursorMove::DOWN, get_csi_len(num_lines));
+        }
+        consider(CursorMove::NEXT_LINE, 1 + num_lines + column_len);
+    }
+
+    switch (move) {
+    case CursorMove::ABSOLUTE:
+        win_->set_cursor(win_pt);
+        break;
+    case CursorMove::REWRITE:
+        // the cells on the way are unchanged, so they are in the back buffer
+        // just as on the terminal
+        write_cells(cur.x, x, y);
+        break;
+    case CursorMove::FORWARD:
+        put_csi(U16(x - cur.x), 'C');
+        break;
+    case CursorMove::BACK:
+        put_csi(U16(cur.x - x), 'D');
+        break;
+    case CursorMove::CARRIAGE_RETURN:
+    case CursorMove::NEXT_LINE:
+        // An LF can be turned into CR LF by the tty, which lands in the same
+        // place after the CR
+        win_->put_char('\r');
+        for (auto i = cur.y; i < y; ++i) {
+            win_->put_char('\n');
+        }
+        if (x > 1) {
+            put_csi(U16(x - 1), 'C');
+        }
+        break;
+    case CursorMove::DOWN:
+        put_csi(U16(y - cur.y), 'B');
+        break;
+    }
+
+    flush_cursor_ = Point{x, y};
+    flush_cursor_valid_ = true;
+}
+
+std::size_t TerminalSurface::get_rewrite_len(uint16_t x_from, uint16_t x_to,
+                                             uint16_t y,
+                                             std::size_t max_len) const {
+    // Only the cells that need no change of attributes, anything else is
+    // not worth working out
+    auto row = SIZE_T(y - 1) * dim_.width;
+    std::size_t len{0};
+
+    for (auto x = x_from; (x < x_to) && (len <= max_len); ++x) {
+        const auto &cell = back_[row + x - 1];
+        if (cell.attrs != flush_attrs_) {
+            return SIZE_MAX;
+        }
+        len += cell.glyph.get().size();
+    }
+
+    return len;
+}
+
+void TerminalSurface::put_csi(uint16_t num, char final) {
+    char buf[16] = "\033[";
+    auto *end = buf + 2;
+    if (num != 1) {
+        end = std::to_chars(end, buf + sizeof(buf) - 1, num).ptr;
+    }
+    *end++ = final;
+    win_->put_uchar(std::string_view{buf, SIZE_T(end - buf)});
+}
+
+void TerminalSurface::write_cells(uint16_t x_from, uint16_t x_to,
+                                  uint16_t y) {
+    auto row = SIZE_T(y - 1) * dim_.width;
+
+    begin_output();
+    move_cursor(x_from, y);
+    write_attrs(back_[row + x_from - 1].attrs);
+
+    run_.clear();
+    for (auto x = x_from; x < x_to; ++x) {
+        run_.append(back_[row + x - 1].glyph.get());
+    }
+    win_->put_uchar(run_);
+
+    // Writing into the last column leaves the cursor in a pending wrap state
+    // that terminals disagree about, so don't rely on where it is
+    if (x_to > dim_.width) {
+        flush_cursor_valid_ = false;
+    } else {
+        flush_cursor_ = Point{x_to, y};
+        flush_cursor_valid_ = true;
+    }
+}
+
+void TerminalSurface::write_attrs(uint8_t attrs) {
+    if (attrs == flush_attrs_) {
+        return;
+    }
+
+    // Reset, then turn on whatever is needed
+    char sgr[16] = "\033[0";
+    std::size_t len = 3;
+    if (attrs & Cell::ATTR_BOLD) {
+        sgr[len++] = ';';
+        sgr[len++] = '1';
+    }
+    if (attrs & Cell::ATTR_REVERSE) {
+        sgr[len++] = ';';
+        sgr[len++] = '7';
+    }
+    sgr[len++] = 'm';
+
+    win_->put_uchar(std::string_view{sgr, len});
+    flush_attrs_ = attrs;
+}
+
 } // namespace termui
 } // namespace bandwit
\ No newline at end of file
@@ -1,6 +1,14 @@
 #ifndef TERMINAL_SURFACE_H
 #define TERMINAL_SURFACE_H
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "glyph.hpp"
 #include "termui/dimensions.hpp"
 #include "termui/point.hpp"
 #include "termui/window_resize.hpp"
@@ -10,6 +18,29 @@ namespace termui {
 
 class TerminalWindow;
 
+// One character cell on the surface: a UTF-8 glyph plus the SGR attributes it
+// is displayed with.
+struct Cell {
+    static constexpr uint8_t ATTR_BOLD = 1 << 0;
+    static constexpr uint8_t ATTR_REVERSE = 1 << 1;
+
+    // A cell is compared for every cell of every frame, as a plain 6 bytes
+    bool operator==(const Cell &other) const {
+        return memcmp(this, &other, sizeof(Cell)) == 0;
+    }
+    bool operator!=(const Cell &other) const { return !(*this == other); }
+
+    Glyph glyph{};
+    uint8_t attrs{0};
+};
+
+// Cells have no padding, so equal cells are equal bytes
+static_assert(std::has_unique_object_representations_v<Cell>,
+              "Cell must be comparable with memcmp");
+
+// Drawing goes into a back buffer of cells. On flush the back buffer is
+// compared to the front buffer, which holds what is on the terminal, and only
+// the cells that changed are written out.
 class TerminalSurface : public WindowResizeReceiver {
   public:
     TerminalSurface(TerminalWindow *win, uint16_t num_lines);
@@ -21,10 +52,19 @@ class TerminalSurface : public WindowResizeReceiver {
 
     void clear_surface();
     void put_char(const Point &point, const char &ch);
-    void put_uchar(const Point &point, const std::string &ch);
+    void put_glyph(const Point &point, const Glyph &glyph);
     void put_string(const Point &point, const std::string &str);
+
+    // The same glyph in len cells going up from bottom, clipped to the
+    // surface
+    void fill_column(const Point &bottom, uint16_t len, const Glyph &glyph);
+
     void flush();
 
+    // Forget what is on the terminal, so that the next flush repaints every
+    // cell
+    void invalidate();
+
     const Dimensions &get_size() const;
     const Point &get_upper_left() const;
     const Point &get_lower_left() const;
@@ -37,6 +77,29 @@ class TerminalSurface : public WindowResizeReceiver {
     Point recompute_lower_left(const Point &upper_left) const;
     Point translate_point(const Point &point);
 
+    void resize_buffers();
+    Cell *get_cell(const Point &point);
+    void apply_sgr(std::string_view params);
+
+    bool needs_write(std::size_t idx) const;
+    bool is_row_unchanged(uint16_t y) const;
+    uint16_t get_blank_tail(uint16_t y) const;
+    uint16_t get_blank_rows() const;
+    void shift_row(uint16_t y);
+    void flush_row(uint16_t y, uint16_t blank_x);
+    bool erase_line(uint16_t x, uint16_t y);
+    bool erase_display(uint16_t y);
+
+    void begin_output();
+    void move_cursor(uint16_t x, uint16_t y);
+    // gives up once it gets past max_len
+    std::size_t get_rewrite_len(uint16_t x_from, uint16_t x_to, uint16_t y,
+                                std::size_t max_len) const;
+    void put_csi(uint16_t num, char final);
+    // The cells from x_from up to x_to, which all have the same attributes
+    void write_cells(uint16_t x_from, uint16_t x_to, uint16_t y);
+    void write_attrs(uint8_t attrs);
+
     TerminalWindow *win_{nullptr};
     WindowResizeReceiver *resize_receiver_{nullptr};
 
@@ -50,6 +113,28 @@ class TerminalSurface : public WindowResizeReceiver {
     Dimensions dim_{};
     Point upper_left_{};
     Point lower_left_{};
+
+    // row major, dim_.width * dim_.height cells
+    std::vector<Cell> back_{};
+    std::vector<Cell> front_{};
+    bool front_valid_{false};
+
+    // The attributes in effect for put_string, changed by SGR sequences
+    uint8_t pen_attrs_{0};
+
+    // Where the terminal cursor is and which attributes are in effect while
+    // flushing, in surface coordinates. Writing a cell moves the cursor one
+    // to the right, a cursor move is only needed when jumping elsewhere.
+    Point flush_cursor_{};
+    bool flush_cursor_valid_{false};
+    uint8_t flush_attrs_{0};
+
+    // Whether anything but the final cursor move went out in this flush, the
+    // synchronized update is only begun once there is
+    bool flush_has_output_{false};
+
+    // The glyphs of a run of cells, to write them out in one go
+    std::string run_{};
 };
 
 } // namespace termui
@@ -1,8 +1,7 @@
-#include <csignal>
-#include <memory>
+#include <cstdio>
+#include <cstdlib>
 
 #include "except.hpp"
-#include "signals.hpp"
 #include "terminal_driver.hpp"
 #include "terminal_surface.hpp"
 #include "terminal_window.hpp"
@@ -10,52 +9,28 @@
 namespace bandwit {
 namespace termui {
 
-// This is what actually owns the TerminalWindow. There can only be one
-// TerminalWindow.
-static std::unique_ptr<TerminalWindow> WINDOW = nullptr;
+TerminalWindow::TerminalWindow(TerminalDriver *driver) : driver_{driver} {
+    // what the terminal can do does not change while we run
+    caps_ = driver_->get_capabilities();
 
-void TerminalWindow_signal_handler([[maybe_unused]] int sig) {
-    if (WINDOW == nullptr) {
-        THROW_MSG(std::runtime_error, "No TerminalWindow exists!");
-    }
-
-    WINDOW->on_resize();
-}
-
-TerminalWindow *TerminalWindow::create(TerminalDriver *driver,
-                                       SignalSuspender *signal_suspender) {
-    if (WINDOW != nullptr) {
-        THROW_MSG(std::runtime_error,
-                  "Cannot construct another TerminalWindow!");
-    }
-
-    WINDOW = std::make_unique<TerminalWindow>(driver, signal_suspender);
-    return WINDOW.get();
-}
-
-TerminalWindow::TerminalWindow(TerminalDriver *driver,
-                               SignalSuspender *signal_suspender)
-    : driver_{driver}, signal_suspender_{signal_suspender} {
     // the window has to know its size at all times
     dim_ = driver_->get_terminal_size();
 
     // and we need to know where the cursor is on startup
     // check cursor within dimensions?
     cursor_ = driver_->get_cursor_position();
-
-    // install handler to update size when it changes
-    install_resize_handler();
 }
 
-TerminalWindow::~TerminalWindow() { WINDOW.release(); }
-
 void TerminalWindow::on_resize() {
-    // make sure we defer the next SIGWINCH while handling the current one
-    // because this function is not reentrant
-    SignalGuard guard{signal_suspender_};
-
     auto dim_new = driver_->get_terminal_size();
     auto dim_old = dim_;
+
+    // A burst of resizes can end up right back where it started
+    if ((dim_new.width == dim_old.width) &&
+        (dim_new.height == dim_old.height)) {
+        return;
+    }
+
     dim_ = dim_new;
 
     if (resize_receiver_ != nullptr) {
@@ -63,6 +38,10 @@ void TerminalWindow::on_resize() {
     }
 }
 
+const TerminalCapabilities &TerminalWindow::get_capabilities() const {
+    return caps_;
+}
+
 const Dimensions &TerminalWindow::get_size() const { return dim_; }
 
 const Point &TerminalWindow::get_cursor() const { return cursor_; }
@@ -80,7 +59,7 @@ void TerminalWindow::put_char(const char &ch) {
     // recalculate and update cursor_ ? (is_printable etc)
 }
 
-void TerminalWindow::put_uchar(const std::string &ch) {
+void TerminalWindow::put_uchar(std::string_view ch) {
     driver_->put_uchar(ch);
 }
 
@@ -123,15 +102,11 @@ void TerminalWindow::check_is_on_window(const Point &point) {
         // Instead of throwing here we abort so that we can get a core dump and
         // investigate the dimensions of the window, the desired cursor position
         // etc.
-        std::cerr << buf << '\n';
+        fprintf(stderr, "%s\n", buf);
         std::abort();
         // throw std::out_of_range(buf);
     }
 }
 
-void TerminalWindow::install_resize_handler() {
-    signal(SIGWINCH, TerminalWindow_signal_handler);
-}
-
 } // namespace termui
 } // namespace bandwit
\ No newline at end of file
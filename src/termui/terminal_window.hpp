@@ -1,37 +1,37 @@
 #ifndef TERMINAL_WINDOW_H
 #define TERMINAL_WINDOW_H
 
+#include <string>
+#include <string_view>
+
 #include "macros.hpp"
 #include "termui/dimensions.hpp"
 #include "termui/point.hpp"
+#include "termui/terminal_capabilities.hpp"
 #include "termui/window_resize.hpp"
 
 namespace bandwit {
 namespace termui {
 
-class SignalSuspender;
 class TerminalDriver;
 
 class TerminalWindow {
   public:
-    // returns a non-owning pointer because the instance is owned by a static
-    // unique_pointer
-    static TerminalWindow *create(TerminalDriver *driver,
-                                  SignalSuspender *signal_suspender);
-
-    TerminalWindow(TerminalDriver *driver, SignalSuspender *signal_suspender);
-    ~TerminalWindow();
+    explicit TerminalWindow(TerminalDriver *driver);
 
     CLASS_DISABLE_COPIES(TerminalWindow)
     CLASS_DISABLE_MOVES(TerminalWindow)
 
+    // To be called from the main loop once a SIGWINCH has been received,
+    // never from the signal handler itself
     void on_resize();
 
+    const TerminalCapabilities &get_capabilities() const;
     const Dimensions &get_size() const;
     const Point &get_cursor() const;
     void set_cursor(const Point &point);
     void put_char(const char &ch);
-    void put_uchar(const std::string &ch);
+    void put_uchar(std::string_view ch);
     void put_string(const std::string &str);
     void flush();
     void clear_screen(const char &fill_char);
@@ -41,13 +41,11 @@ class TerminalWindow {
   private:
     void check_is_on_window(const Point &point);
 
-    void install_resize_handler();
-
     TerminalDriver *driver_{nullptr};
+    TerminalCapabilities caps_{};
     Dimensions dim_{};
     Point cursor_{};
     WindowResizeReceiver *resize_receiver_{nullptr};
-    SignalSuspender *signal_suspender_{nullptr};
 };
 
 } // namespace termui
@@ -1,26 +1,162 @@
+#include <algorithm>
 #include <csignal>
 #include <fcntl.h>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
 #include <unistd.h>
 
+#include "except.hpp"
+#include "logging.hpp"
 #include "sampling/sampler_detector.hpp"
+#include "sampling/snapshot.hpp"
 #include "termui.hpp"
 #include "termui/signals.hpp"
 #include "termui/terminal_window.hpp"
+#include "termui/tty_terminal_driver.hpp"
+#include "tools/monotonic_clock.hpp"
+#include "tools/time_keeping.hpp"
 
 namespace bandwit {
 namespace termui {
 
-TermUi::TermUi(const std::string &iface_name) : iface_name_{iface_name} {
+constexpr const char *JUMP_PROMPT =
+    "jump to [YYYY-MM-DD] HH:MM[:SS], Esc to cancel: ";
+constexpr std::size_t MAX_JUMP_INPUT_LEN = 19;
+
+TermUi::TermUi(const std::vector<std::string> &iface_names, Millis interval,
+               const std::string &history_dir,
+               const std::string &snapshot_path,
+               std::optional<uint64_t> adaptive_threshold,
+               const sampling::Retention &retention,
+               const std::vector<sampling::Quantity> &quantities,
+               unsigned max_fps, tools::Profiler *profiler)
+    : agg_window_{static_cast<AggregationWindow>(interval.count())},
+      windows_{sampling::get_windows_for_interval(interval)},
+      snapshot_path_{snapshot_path}, frame_scheduler_{max_fps},
+      profiler_{profiler} {
     sampling::SamplerDetector detector{};
-    auto det_result = detector.detect_sampler(iface_name);
+    auto det_result = detector.detect_sampler(iface_names, quantities);
+
+    init_terminal();
+
+    // The time series are keyed on the sampler thread's deadlines, so both
+    // have to start at the same point in time
+    auto start = SteadyClock::now();
+
+    // the sampler goes to the sampler thread, the recorder is only handed
+    // the samples
+    recorder_ = std::make_unique<Recorder>(
+        nullptr, det_result.sampler->get_counter_bits(), iface_names,
+        std::move(det_result.samples),
+        tools::MonotonicClock::from_steady(start), windows_, retention,
+        quantities);
+
+    if (!history_dir.empty()) {
+        recorder_->open_history_files(history_dir, interval);
+    }
+
+    if (!snapshot_path_.empty()) {
+        recorder_->restore_snapshot(snapshot_path_, interval);
+        event_loop_->watch_signal(SIGUSR1);
+    }
+
+    history_ = &recorder_->get_history();
+
+    // it goes on with the samples the recorder starts from, and the buckets
+    // of the history once it is restored
+    std::unique_ptr<sampling::AdaptiveSchedule> schedule{nullptr};
+    if (adaptive_threshold.has_value()) {
+        schedule = std::make_unique<sampling::AdaptiveSchedule>(
+            *history_, tools::MonotonicClock::from_steady(start), interval,
+            adaptive_threshold.value(), recorder_->get_samples());
+    }
+
+    sampler_thread_ = std::make_unique<sampling::SamplerThread>(
+        std::move(det_result.sampler), iface_names, interval, start,
+        profiler_, std::move(schedule));
+    event_loop_->watch_fd(sampler_thread_->get_fd());
+}
+
+TermUi::TermUi(std::unique_ptr<service::Client> client, unsigned max_fps,
+               tools::Profiler *profiler)
+    : agg_window_{static_cast<AggregationWindow>(
+          client->get_interval().count())},
+      windows_{sampling::get_windows_for_interval(client->get_interval())},
+      client_{std::move(client)}, frame_scheduler_{max_fps},
+      profiler_{profiler} {
+    init_terminal();
+
+    // the daemon's ticks wake us up instead of a schedule of our own
+    event_loop_->watch_fd(client_->get_fd());
+    history_ = &client_->get_history();
+}
+
+TermUi::TermUi(std::unique_ptr<service::ShmViewer> viewer, unsigned max_fps,
+               tools::Profiler *profiler)
+    : agg_window_{static_cast<AggregationWindow>(
+          viewer->get_interval().count())},
+      windows_{sampling::get_windows_for_interval(viewer->get_interval())},
+      viewer_{std::move(viewer)}, frame_scheduler_{max_fps},
+      profiler_{profiler} {
+    init_terminal();
 
-    sampler_ = std::move(det_result.sampler);
-    prev_sample_ = det_result.sample;
+    // Nothing tells us when the daemon publishes, so look as often as it
+    // samples
+    scheduler_ = std::make_unique<tools::DeadlineScheduler>(
+        viewer_->get_interval(), SteadyClock::now());
+    history_ = &viewer_->get_history();
+}
 
+TermUi::TermUi(std::unique_ptr<service::RemoteViewer> remote,
+               unsigned max_fps, tools::Profiler *profiler)
+    : agg_window_{static_cast<AggregationWindow>(
+          remote->get_interval().count())},
+      windows_{sampling::get_windows_for_interval(remote->get_interval())},
+      remote_{std::move(remote)}, frame_scheduler_{max_fps},
+      profiler_{profiler} {
+    init_terminal();
+
+    // The samples of the hosts wake us up, the schedule only looks after
+    // the hosts that went away
+    remote_->watch(event_loop_.get());
+    scheduler_ = std::make_unique<tools::DeadlineScheduler>(
+        remote_->get_interval(), SteadyClock::now());
+    history_ = &remote_->get_history();
+}
+
+TermUi::TermUi(std::unique_ptr<service::ReplaySampler> replay, double speed,
+               const sampling::Retention &retention, unsigned max_fps,
+               tools::Profiler *profiler)
+    : agg_window_{static_cast<AggregationWindow>(
+          replay->get_interval().count())},
+      windows_{sampling::get_windows_for_interval(replay->get_interval())},
+      replay_{replay.get()}, frame_scheduler_{max_fps}, profiler_{profiler} {
+    init_terminal();
+
+    // The recorder takes the samples itself, on the replay clock
+    auto start = replay_->get_start();
+    auto counter_bits = replay_->get_counter_bits();
+    recorder_ = std::make_unique<Recorder>(
+        std::move(replay), counter_bits, replay_->get_iface_names(),
+        replay_->get_first_samples(), start, windows_, retention,
+        replay_->get_quantities());
+    history_ = &recorder_->get_history();
+
+    replay_clock_ =
+        std::make_unique<tools::ReplayClock>(start, speed, SteadyClock::now());
+}
+
+void TermUi::init_terminal() {
     susp_sigint_ =
         std::make_unique<SignalSuspender>(std::initializer_list<int>{SIGINT});
-    susp_sigwinch_ =
-        std::make_unique<SignalSuspender>(std::initializer_list<int>{SIGWINCH});
+
+    // Resizes are picked up by the event loop and handled in between frames,
+    // so nothing needs guarding against SIGWINCH. Watch it before the window
+    // takes its measurements so that no resize can slip through.
+    event_loop_ = std::make_unique<tools::EventLoop>();
+    event_loop_->watch_fd(STDIN_FILENO);
+    event_loop_->watch_signal(SIGWINCH);
 
     TerminalModeSet mode_set{};
     interactive_mode_setter_ =
@@ -36,13 +172,17 @@ TermUi::TermUi(const std::string &iface_name) : iface_name_{iface_name} {
     blocking_status_setter_ =
         blocking_status_set.status_off(O_NONBLOCK).build_setter(STDIN_FILENO);
 
-    terminal_driver_ = std::make_unique<TerminalDriver>(
+    terminal_driver_ = std::make_unique<TtyTerminalDriver>(
         stdin, stdout, blocking_status_setter_.get());
-    TerminalWindow *terminal_window =
-        TerminalWindow::create(terminal_driver_.get(), susp_sigwinch_.get());
+    terminal_window_ = std::make_unique<TerminalWindow>(terminal_driver_.get());
 
-    terminal_surface_ = std::make_unique<TerminalSurface>(terminal_window, 12);
-    bar_chart_ = std::make_unique<BarChart>(terminal_surface_.get());
+    terminal_surface_ =
+        std::make_unique<TerminalSurface>(terminal_window_.get(), 12);
+    bar_chart_ =
+        std::make_unique<BarChart>(terminal_surface_.get(), profiler_);
+    top_table_ =
+        std::make_unique<TopTable>(terminal_surface_.get(), profiler_);
+    heat_map_ = std::make_unique<HeatMap>(terminal_surface_.get(), profiler_);
 
     FileStatusSet non_blocking_status_set{};
     non_blocking_status_setter_ = non_blocking_status_set.status_on(O_NONBLOCK)
@@ -54,105 +194,783 @@ TermUi::TermUi(const std::string &iface_name) : iface_name_{iface_name} {
 
     kb_reader_ = std::make_unique<KeyboardInputReader>(stdin);
 
-    auto now = Clock::now();
-    const std::vector<AggregationWindow> windows{
-        AggregationWindow::ONE_SECOND,
-        AggregationWindow::ONE_MINUTE,
-        AggregationWindow::ONE_HOUR,
-        AggregationWindow::ONE_DAY,
-    };
-
-    ts_coll_rx_ = std::make_unique<TimeSeriesCollection>(now, windows);
-    ts_coll_tx_ = std::make_unique<TimeSeriesCollection>(now, windows);
+    // Ctrl+C is read from the event loop from now on instead of thrown from
+    // a signal handler, and so are the signals that stop us otherwise, so
+    // that the terminal is restored and the snapshot taken for them too
+    event_loop_->watch_signal(SIGINT);
+    event_loop_->watch_signal(SIGTERM);
+    event_loop_->watch_signal(SIGHUP);
 
     // tell the surface to notify us just after it's redrawn itself
     // following a window resize
     terminal_surface_->register_resize_receiver(this);
 }
 
+void TermUi::write_snapshot() const {
+    // the finest window is the interval
+    sampling::write_snapshot(snapshot_path_,
+                             sampling::get_duration(windows_.front()),
+                             *history_);
+}
+
+// The message of an exception of the THROW macros, without the file and
+// line it was thrown from
+static std::string_view get_reason(const char *what) {
+    std::string_view reason{what};
+    auto pos = reason.find(' ');
+    return pos != std::string_view::npos ? reason.substr(pos + 1) : reason;
+}
+
+void TermUi::take_snapshot() {
+    // The one on the way out tries again, and throws if it cannot either
+    try {
+        write_snapshot();
+        snapshot_error_.clear();
+    } catch (std::runtime_error &e) {
+        LOG_E("%s", e.what());
+        snapshot_error_ = "! ";
+        snapshot_error_.append(get_reason(e.what()));
+    }
+}
+
+void TermUi::quit() const {
+    if (!snapshot_path_.empty()) {
+        write_snapshot();
+    }
+
+    throw InterruptException();
+}
+
 TermUi::~TermUi() {
-    // return stdio to the mode it was before we started
-    non_blocking_status_setter_->reset();
+    // A terminal that hung up has no mode left to return to, and throwing
+    // out of here would abort
+    try {
+        // return stdio to the mode it was before we started
+        non_blocking_status_setter_->reset();
 
-    // return the terminal to the mode it was before we started
-    interactive_mode_setter_->reset();
+        // return the terminal to the mode it was before we started
+        interactive_mode_setter_->reset();
+    } catch (std::runtime_error &) {
+    }
 }
 
 void TermUi::on_window_resize([[maybe_unused]] const Dimensions &win_dim_old,
                               [[maybe_unused]] const Dimensions &win_dim_new) {
-    render();
+    // The surface was laid out anew, whatever was on display before
+    shown_frame_key_.reset();
+    frame_scheduler_.mark_dirty();
+}
+
+void TermUi::set_alerts(std::vector<sampling::AlertRule> rules,
+                        const std::string &hook, Millis hook_interval) {
+    if (rules.empty()) {
+        return;
+    }
+
+    // the finest window, whose buckets close with every sample
+    alert_monitor_ = std::make_unique<sampling::AlertMonitor>(
+        std::move(rules), windows_.front());
+    if (!hook.empty()) {
+        alert_hook_ =
+            std::make_unique<sampling::AlertHook>(hook, hook_interval);
+    }
 }
 
 void TermUi::run_forever() {
-    std::chrono::seconds one_sec{1};
+    tools::Events events{};
+
+    // the first frame
+    frame_scheduler_.mark_dirty();
 
     while (true) {
-        // Time execution of sampling and rendering
-        auto pre = Clock::now();
+        auto deadline = frame_scheduler_.get_deadline();
+        if (scheduler_ != nullptr) {
+            deadline = std::min(deadline, scheduler_->get_deadline());
+        }
+        if ((replay_ != nullptr) && replay_->get_next_time_point()) {
+            // A replay that is behind is due now, the timer only goes off
+            // once for a deadline that stays the same
+            auto due = replay_clock_->get_steady(
+                replay_->get_next_time_point().value());
+            deadline = std::min(deadline, std::max(due, SteadyClock::now()));
+        }
+        if (auto escape = kb_reader_->get_escape_deadline()) {
+            deadline = std::min(deadline, escape.value());
+        }
+        event_loop_->set_deadline(deadline);
+
+        // Sleep until a key press, a signal, a sample was queued, the next
+        // refresh or frame is due or the daemon sent a sample
+        event_loop_->wait(&events);
+
+        bool is_resized = false;
+        bool is_snapshot_due = false;
+        for (auto signo : events.signals) {
+            if ((signo == SIGINT) || (signo == SIGTERM) || (signo == SIGHUP)) {
+                quit();
+            }
+
+            is_snapshot_due = is_snapshot_due || (signo == SIGUSR1);
+            is_resized = is_resized || (signo == SIGWINCH);
+        }
+
+        // The snapshot is written in the loop, which stalls meanwhile. A
+        // SIGUSR1 that arrived while it was being written asked for what
+        // it holds already.
+        if (is_snapshot_due) {
+            take_snapshot();
+            event_loop_->discard_signal(SIGUSR1);
+            frame_scheduler_.mark_dirty();
+        }
+
+        // However many SIGWINCH arrived since the last wakeup, relayout once.
+        // This marks the view dirty through on_window_resize.
+        if (is_resized) {
+            terminal_window_->on_resize();
+        }
+
+        if (events.is_ready(STDIN_FILENO) && read_keyboard_input()) {
+            frame_scheduler_.mark_dirty();
+        }
+
+        if (flush_keyboard_input()) {
+            frame_scheduler_.mark_dirty();
+        }
+
+        bool is_sampled = false;
+        if (client_ != nullptr) {
+            is_sampled = events.is_ready(client_->get_fd()) &&
+                         receive_samples();
+
+        } else if (sampler_thread_ != nullptr) {
+            // Any number of samples may have queued up while we were busy,
+            // they are all drawn at once
+            is_sampled = events.is_ready(sampler_thread_->get_fd()) &&
+                         record_samples();
+
+        } else if (replay_ != nullptr) {
+            is_sampled = replay_samples();
+
+        } else if (remote_ != nullptr) {
+            is_sampled = receive_remote_samples(events);
+
+        } else {
+            auto now = SteadyClock::now();
+
+            if (scheduler_->is_due(now)) {
+                is_sampled = refresh_samples();
+                history_ = &viewer_->get_history();
+
+                scheduler_->advance(now);
+            }
+        }
+
+        if (is_sampled) {
+            is_line_rate_stale_ = true;
+            frame_scheduler_.mark_dirty();
+            update_alerts();
+        }
+
+        render_if_due();
+    }
+}
+
+bool TermUi::record_samples() {
+    bool is_recorded = false;
+
+    sampler_thread_->drain(
+        [this, &is_recorded](const sampling::SampleBatch &batch) {
+            tools::StageTimer timer{profiler_, tools::Stage::RECORD};
+            recorder_->record(batch.tp, batch.samples);
+            mark_changed(recorder_->get_deltas());
+            is_recorded = true;
+        });
 
-        sample();
-        render_no_winch();
+    return is_recorded;
+}
+
+bool TermUi::receive_samples() {
+    tools::StageTimer timer{profiler_, tools::Stage::RECORD};
+    bool is_changed = client_->receive();
+    mark_changed(client_->get_changed_ifaces());
+    return is_changed;
+}
+
+bool TermUi::refresh_samples() {
+    tools::StageTimer timer{profiler_, tools::Stage::RECORD};
+    // the segment only has the buckets, not which ifaces they changed for
+    bool is_changed = viewer_->refresh();
+    is_ranking_stale_ = is_ranking_stale_ || is_changed;
+    return is_changed;
+}
 
-        // Spend the rest of the second reading keyboard input
-        auto elapsed = Clock::now() - pre;
-        auto remaining = MILLIS(one_sec - elapsed);
+bool TermUi::receive_remote_samples(const tools::Events &events) {
+    tools::StageTimer timer{profiler_, tools::Stage::RECORD};
 
-        read_keyboard_input(remaining);
+    auto now = SteadyClock::now();
+    bool is_changed = remote_->receive(events, now);
+    mark_changed(remote_->get_changed_ifaces());
+
+    if (scheduler_->is_due(now)) {
+        is_changed = remote_->poll(now) || is_changed;
+        mark_changed(remote_->get_changed_ifaces());
+        scheduler_->advance(now);
     }
+
+    // a host that turned up late brings a new history
+    history_ = &remote_->get_history();
+    return is_changed;
 }
 
-void TermUi::sample() {
-    sampling::Sample sample = sampler_->get_sample(iface_name_);
+bool TermUi::replay_samples() {
+    auto tp = replay_->get_next_time_point();
+    auto now = SteadyClock::now();
+    if (!tp.has_value() || (tp.value() > replay_clock_->now(now))) {
+        return false;
+    }
 
-    auto tp = Clock::from_time_t(sample.ts);
-    auto rx = sample.rx - prev_sample_.rx;
-    auto tx = sample.tx - prev_sample_.tx;
+    // Every sample that is due goes in, up to when the frame they make
+    // dirty is due. As fast as it can this keeps the frames and the keys
+    // coming while hours of samples are loaded.
+    frame_scheduler_.mark_dirty();
+    auto frame_deadline = frame_scheduler_.get_deadline();
+
+    do {
+        {
+            tools::StageTimer timer{profiler_, tools::Stage::RECORD};
+            recorder_->sample(tp.value());
+            mark_changed(recorder_->get_deltas());
+        }
 
-    ts_coll_rx_->inc(tp, rx);
-    ts_coll_tx_->inc(tp, tx);
+        tp = replay_->get_next_time_point();
+        now = SteadyClock::now();
+    } while (tp.has_value() && (tp.value() <= replay_clock_->now(now)) &&
+             (now < frame_deadline));
 
-    prev_sample_ = sample;
+    return true;
+}
+
+bool TermUi::update_alerts() {
+    if (alert_monitor_ == nullptr) {
+        return false;
+    }
+
+    if (alert_hook_ != nullptr) {
+        alert_hook_->reap();
+    }
+
+    tools::StageTimer timer{profiler_, tools::Stage::RECORD};
+    if (!alert_monitor_->update(*history_)) {
+        return false;
+    }
+
+    if (alert_hook_ != nullptr) {
+        auto now = SteadyClock::now();
+        for (const auto &alert : alert_monitor_->get_changes()) {
+            alert_hook_->run(alert.rule_idx, alert.iface_idx,
+                             history_->get_iface_name(alert.iface_idx),
+                             alert_monitor_->get_rule(alert.rule_idx).text,
+                             alert.is_on, now);
+        }
+    }
+
+    alert_label_ = get_alert_label();
+    return true;
+}
+
+void TermUi::render_if_due() {
+    auto now = SteadyClock::now();
+    if (!frame_scheduler_.is_due(now)) {
+        return;
+    }
+
+    render();
+    frame_scheduler_.on_frame(now);
 }
 
 void TermUi::render() {
-    // When we are called from `on_window_resize` the SIGWINCH signal guard is
-    // already in effect, so there is no need to use it here.
-    // Other callers of this function should suspend SIGWINCH before calling it.
+    if (view_ == View::TOP) {
+        render_top();
+        return;
+    }
+    if (view_ == View::HEAT_MAP) {
+        render_heat_map();
+        return;
+    }
 
     rescue_scroll_cursor();
 
+    const auto &ts_coll_rx = history_->get_rx(iface_idx_, quantity_);
+    const auto &ts_coll_tx = history_->get_tx(iface_idx_, quantity_);
+
     TimePoint cursor{};
     if (scroll_cursor_.has_value()) {
         cursor = scroll_cursor_.value();
     } else {
-        cursor = ts_coll_rx_->max(agg_window_);
+        cursor = ts_coll_rx.max(agg_window_);
     }
 
     TimeSeriesSlice slice{};
     auto width = bar_chart_->get_width();
-    std::string action{};
+    auto scale = get_chart_scale();
+
+    bar_chart_->set_style(bar_style_);
+    bar_chart_->set_quantity(quantity_);
+    auto prompt = get_prompt();
+    bar_chart_->set_prompt(prompt);
+    bar_chart_->set_alert(get_menu_alert());
+
+    auto num_bytes_written = terminal_driver_->get_num_bytes_written();
+
+    if (display_mode_ == DisplayMode::DISPLAY_BOTH) {
+        // slices are views, so this reads each series once for the frame
+        TimeSeriesSlice slice_tx{};
+        {
+            tools::StageTimer timer{profiler_, tools::Stage::SLICE};
+            slice = ts_coll_rx.get_slice_from_point(agg_window_, cursor,
+                                                    width, stat_mode_);
+            slice_tx = ts_coll_tx.get_slice_from_point(agg_window_, cursor,
+                                                       width, stat_mode_);
+        }
+        if (is_same_frame(prompt, cursor, slice, &slice_tx)) {
+            return;
+        }
+
+        bar_chart_->draw_mirrored_bars(get_iface_label(), slice, slice_tx,
+                                       scale, stat_mode_);
 
-    if (display_mode_ == DisplayMode::DISPLAY_RX) {
-        action = "received";
-        slice = ts_coll_rx_->get_slice_from_point(agg_window_, cursor, width,
-                                                  stat_mode_);
     } else {
-        action = "transmitted";
-        slice = ts_coll_tx_->get_slice_from_point(agg_window_, cursor, width,
-                                                  stat_mode_);
+        const auto &ts_coll = display_mode_ == DisplayMode::DISPLAY_RX
+                                  ? ts_coll_rx
+                                  : ts_coll_tx;
+        {
+            tools::StageTimer timer{profiler_, tools::Stage::SLICE};
+            slice = ts_coll.get_slice_from_point(agg_window_, cursor, width,
+                                                 stat_mode_);
+        }
+        if (is_same_frame(prompt, cursor, slice, nullptr)) {
+            return;
+        }
+
+        bar_chart_->draw_bars_from_right(
+            get_iface_label(),
+            display_mode_ == DisplayMode::DISPLAY_RX ? "received"
+                                                     : "transmitted",
+            slice, scale, stat_mode_);
     }
 
-    bar_chart_->draw_bars_from_right(iface_name_, action, slice, display_scale_,
-                                     stat_mode_);
+    if (profiler_ != nullptr) {
+        profiler_->add_flushed_bytes(
+            terminal_driver_->get_num_bytes_written() - num_bytes_written);
+    }
 }
 
-void TermUi::read_keyboard_input(Millis interval) {
-    KeyPress key = kb_reader_->read_nonblocking(interval);
+void TermUi::render_top() {
+    rescue_scroll_cursor();
 
-    if (key == KeyPress::CARRIAGE_RETURN) {
-        // ignore SIGWINCH while we're acting on a resize
-        SignalGuard guard{susp_sigwinch_.get()};
+    // the same point in time for every iface, they are all recorded together
+    TimePoint cursor{};
+    if (scroll_cursor_.has_value()) {
+        cursor = scroll_cursor_.value();
+    } else {
+        cursor = history_->get_rx(iface_idx_).max(agg_window_);
+    }
+
+    update_ranking(cursor);
+    ranking_->get_ranked(&ranked_);
+
+    std::size_t name_width{0};
+    for (auto item : ranked_) {
+        name_width =
+            std::max(name_width, history_->get_iface_name(item).size());
+    }
+    auto width = top_table_->get_sparkline_width(name_width);
+
+    auto prompt = get_prompt();
+    top_table_->set_prompt(prompt);
+    top_table_->set_quantity(quantity_);
+
+    auto num_bytes_written = terminal_driver_->get_num_bytes_written();
+
+    top_rows_.resize(ranked_.size());
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::SLICE};
+        for (std::size_t i = 0; i < ranked_.size(); ++i) {
+            auto item = ranked_[i];
+            auto &row = top_rows_[i];
+
+            row.iface_name = history_->get_iface_name(item);
+            row.value = ranking_->get_value(item);
+
+            const auto &ts_coll_rx = history_->get_rx(item, quantity_);
+            const auto &ts_coll_tx = history_->get_tx(item, quantity_);
+            const auto &ts_coll = display_mode_ == DisplayMode::DISPLAY_TX
+                                      ? ts_coll_tx
+                                      : ts_coll_rx;
+            row.slice = ts_coll.get_slice_from_point(agg_window_, cursor,
+                                                     width, stat_mode_);
+            row.other_slice.reset();
+            if (display_mode_ == DisplayMode::DISPLAY_BOTH) {
+                row.other_slice = ts_coll_tx.get_slice_from_point(
+                    agg_window_, cursor, width, stat_mode_);
+            }
+        }
+    }
+    if (is_same_top_frame(prompt, cursor, top_rows_)) {
+        return;
+    }
+
+    top_table_->draw(get_direction_label(), top_rows_,
+                     history_->num_ifaces(), agg_window_, get_list_scale(),
+                     stat_mode_);
+
+    if (profiler_ != nullptr) {
+        profiler_->add_flushed_bytes(
+            terminal_driver_->get_num_bytes_written() - num_bytes_written);
+    }
+}
+
+void TermUi::render_heat_map() {
+    rescue_scroll_cursor();
+
+    // the same point in time for every iface, as in the top table
+    TimePoint cursor{};
+    if (scroll_cursor_.has_value()) {
+        cursor = scroll_cursor_.value();
+    } else {
+        cursor = history_->get_rx(iface_idx_).max(agg_window_);
+    }
+
+    // The page of ifaces that the one on display is on, cycling through the
+    // ifaces pages through them
+    auto num_rows = std::max(heat_map_->get_num_rows(), std::size_t{1});
+    auto first = iface_idx_ / num_rows * num_rows;
+    auto last = std::min(first + num_rows, history_->num_ifaces());
+
+    std::size_t name_width{0};
+    for (auto i = first; i < last; ++i) {
+        name_width = std::max(name_width, history_->get_iface_name(i).size());
+    }
+    auto width = heat_map_->get_map_width(name_width);
+
+    auto prompt = get_prompt();
+    heat_map_->set_prompt(prompt);
+    heat_map_->set_quantity(quantity_);
+
+    auto num_bytes_written = terminal_driver_->get_num_bytes_written();
+
+    heat_rows_.resize(last - first);
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::SLICE};
+        for (auto i = first; i < last; ++i) {
+            auto &row = heat_rows_[i - first];
+            row.iface_name = history_->get_iface_name(i);
+
+            const auto &ts_coll_rx = history_->get_rx(i, quantity_);
+            const auto &ts_coll_tx = history_->get_tx(i, quantity_);
+            const auto &ts_coll = display_mode_ == DisplayMode::DISPLAY_TX
+                                      ? ts_coll_tx
+                                      : ts_coll_rx;
+            row.slice = ts_coll.get_slice_from_point(agg_window_, cursor,
+                                                     width, stat_mode_);
+            row.other_slice.reset();
+            if (display_mode_ == DisplayMode::DISPLAY_BOTH) {
+                row.other_slice = ts_coll_tx.get_slice_from_point(
+                    agg_window_, cursor, width, stat_mode_);
+            }
+        }
+    }
+    if (is_same_heat_frame(prompt, cursor, first, heat_rows_)) {
+        return;
+    }
+
+    heat_map_->draw(get_direction_label(), heat_rows_, first,
+                    history_->num_ifaces(), agg_window_, get_list_scale(),
+                    stat_mode_);
+
+    if (profiler_ != nullptr) {
+        profiler_->add_flushed_bytes(
+            terminal_driver_->get_num_bytes_written() - num_bytes_written);
+    }
+}
+
+void TermUi::update_ranking(TimePoint cursor) {
+    auto num_ifaces = history_->num_ifaces();
+    if ((ranking_ == nullptr) || (ranking_->get_num_items() != num_ifaces)) {
+        ranking_ = std::make_unique<tools::TopRanking>(
+            num_ifaces, top_table_->get_num_rows());
+        is_ranking_stale_ = true;
+    }
+    ranking_->set_max_ranked(top_table_->get_num_rows());
+
+    // While it follows the latest buckets the cursor moves on with every
+    // sample, an iface that was not sampled keeps its value until it is
+    bool is_rescan = is_ranking_stale_ || (ranking_window_ != agg_window_) ||
+                     (ranking_quantity_ != quantity_) ||
+                     (ranking_mode_ != display_mode_) ||
+                     (ranking_stat_ != stat_mode_) ||
+                     (ranking_cursor_ != scroll_cursor_);
+    if (!is_rescan && changed_ifaces_.empty()) {
+        return;
+    }
+
+    tools::StageTimer timer{profiler_, tools::Stage::SLICE};
+
+    // Ranked by the bucket of the cursor, which is the current rate in the
+    // sampling interval and the one of the minute or the hour so far in the
+    // longer windows. An iface whose value did not change stays put.
+    // An iface that is still to be sampled at the cursor, which one that
+    // is backed off on is at the latest buckets, keeps its latest value.
+    auto get_value = [this, cursor](const TimeSeriesCollection &ts_coll) {
+        auto slice =
+            ts_coll.get_slice_from_point(agg_window_, cursor, 1, stat_mode_);
+        if ((slice.size() > 0) && slice.is_pending(0)) {
+            slice = ts_coll.get_slice_from_point(
+                agg_window_, ts_coll.max(agg_window_), 1, stat_mode_);
+        }
+        return slice.is_gap(0) ? 0 : slice.to_stat(slice.get_value(0));
+    };
+
+    auto update = [this, &get_value](std::size_t i) {
+        uint64_t value{0};
+        if (display_mode_ != DisplayMode::DISPLAY_TX) {
+            value += get_value(history_->get_rx(i, quantity_));
+        }
+        if (display_mode_ != DisplayMode::DISPLAY_RX) {
+            value += get_value(history_->get_tx(i, quantity_));
+        }
+
+        ranking_->update(i, value);
+    };
+
+    if (is_rescan) {
+        for (std::size_t i = 0; i < num_ifaces; ++i) {
+            update(i);
+        }
+    } else {
+        for (auto i : changed_ifaces_) {
+            if (i < num_ifaces) {
+                update(i);
+            }
+        }
+    }
+
+    for (auto i : changed_ifaces_) {
+        is_iface_changed_[i] = false;
+    }
+    changed_ifaces_.clear();
+
+    is_ranking_stale_ = false;
+    ranking_window_ = agg_window_;
+    ranking_quantity_ = quantity_;
+    ranking_mode_ = display_mode_;
+    ranking_stat_ = stat_mode_;
+    ranking_cursor_ = scroll_cursor_;
+}
+
+void TermUi::mark_changed(std::size_t iface) {
+    if (iface >= is_iface_changed_.size()) {
+        is_iface_changed_.resize(iface + 1, false);
+    }
+
+    if (!is_iface_changed_[iface]) {
+        is_iface_changed_[iface] = true;
+        changed_ifaces_.push_back(iface);
+    }
+}
+
+void TermUi::mark_changed(const std::vector<sampling::Delta> &deltas) {
+    // an iface that was not due has nothing new
+    for (std::size_t i = 0; i < deltas.size(); ++i) {
+        if (deltas[i].num_intervals != 0) {
+            mark_changed(i);
+        }
+    }
+}
+
+void TermUi::mark_changed(const std::vector<std::size_t> &ifaces) {
+    for (auto i : ifaces) {
+        mark_changed(i);
+    }
+}
+
+// how the bucket is drawn, as part of the key of the frame
+static uint64_t get_bucket_kind(const sampling::TimeSeriesSlice &slice,
+                                std::size_t i) {
+    if (slice.is_gap(i)) {
+        return 1;
+    }
+    if (slice.is_blank(i)) {
+        return 2;
+    }
+    return slice.is_pending(i) ? 3 : 0;
+}
+
+bool TermUi::FrameKey::operator==(const FrameKey &other) const {
+    return (view == other.view) &&
+           (iface_idx == other.iface_idx) && (quantity == other.quantity) &&
+           (display_mode == other.display_mode) &&
+           (display_scale == other.display_scale) &&
+           (line_rate == other.line_rate) &&
+           (bar_style == other.bar_style) && (stat_mode == other.stat_mode) &&
+           (agg_window == other.agg_window) &&
+           (prompt == other.prompt) && (alert == other.alert) &&
+           (dim.width == other.dim.width) &&
+           (dim.height == other.dim.height) && (cursor == other.cursor) &&
+           (buckets == other.buckets);
+}
+
+void TermUi::fill_frame_key(const std::string &prompt, TimePoint cursor) {
+    auto &key = frame_key_;
+    key.view = view_;
+    key.iface_idx = iface_idx_;
+    key.quantity = quantity_;
+    key.display_mode = display_mode_;
+    key.display_scale = display_scale_;
+    key.line_rate = line_rate_.value_or(0);
+    key.bar_style = bar_style_;
+    key.stat_mode = stat_mode_;
+    key.agg_window = agg_window_;
+    key.prompt = prompt;
+    key.alert = get_menu_alert();
+    key.dim = terminal_surface_->get_size();
+    key.cursor = cursor;
+}
+
+bool TermUi::is_same_frame(const std::string &prompt, TimePoint cursor,
+                           const TimeSeriesSlice &slice,
+                           const TimeSeriesSlice *other_slice) {
+    fill_frame_key(prompt, cursor);
+
+    // the buffer is kept from frame to frame
+    auto &buckets = frame_key_.buckets;
+    buckets.clear();
+    for (const auto *s : {&slice, other_slice}) {
+        for (std::size_t i = 0; (s != nullptr) && (i < s->size()); ++i) {
+            buckets.push_back(s->get_value(i));
+            buckets.push_back(get_bucket_kind(*s, i));
+        }
+    }
+
+    return swap_frame_key();
+}
+
+bool TermUi::is_same_top_frame(const std::string &prompt, TimePoint cursor,
+                               const std::vector<TopTable::Row> &rows) {
+    fill_frame_key(prompt, cursor);
+
+    // the ifaces in the order of their rows
+    auto &buckets = frame_key_.buckets;
+    buckets.clear();
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const auto &row = rows[i];
+        buckets.push_back(ranked_[i]);
+        buckets.push_back(row.value);
+        for (const auto *s : {&row.slice, row.other_slice ? &*row.other_slice
+                                                            : nullptr}) {
+            for (std::size_t j = 0; (s != nullptr) && (j < s->size()); ++j) {
+                buckets.push_back(s->get_value(j));
+                buckets.push_back(get_bucket_kind(*s, j));
+            }
+        }
+    }
+
+    return swap_frame_key();
+}
+
+bool TermUi::is_same_heat_frame(const std::string &prompt, TimePoint cursor,
+                                std::size_t first_iface,
+                                const std::vector<HeatMap::Row> &rows) {
+    fill_frame_key(prompt, cursor);
+
+    // the page of ifaces, then their buckets row by row
+    auto &buckets = frame_key_.buckets;
+    buckets.clear();
+    buckets.push_back(first_iface);
+    for (const auto &row : rows) {
+        for (const auto *s : {&row.slice, row.other_slice ? &*row.other_slice
+                                                            : nullptr}) {
+            for (std::size_t i = 0; (s != nullptr) && (i < s->size()); ++i) {
+                buckets.push_back(s->get_value(i));
+                buckets.push_back(get_bucket_kind(*s, i));
+            }
+        }
+    }
+
+    return swap_frame_key();
+}
+
+bool TermUi::swap_frame_key() {
+    auto &key = frame_key_;
+    if (shown_frame_key_.has_value() && (shown_frame_key_.value() == key)) {
+        return true;
+    }
+
+    // This one goes on display, the old one is filled in next time
+    if (!shown_frame_key_.has_value()) {
+        shown_frame_key_.emplace();
+    }
+    std::swap(shown_frame_key_.value(), key);
+    return false;
+}
+
+bool TermUi::read_keyboard_input() {
+    // Nothing can be typed any more, which is as good as a quit
+    if (!kb_reader_->read_nonblocking(&keys_)) {
+        quit();
+    }
+
+    return handle_keys();
+}
+
+bool TermUi::flush_keyboard_input() {
+    kb_reader_->flush_if_due(SteadyClock::now(), &keys_);
+    return handle_keys();
+}
 
+bool TermUi::handle_keys() {
+    for (std::size_t i = 0; i < keys_.size();) {
+        const auto &key = keys_[i];
+
+        if (jump_input_.has_value()) {
+            handle_jump_key(key);
+            ++i;
+            continue;
+        }
+
+        // A held down key comes in as a run of presses, which for the keys
+        // that scroll is taken as a single scroll
+        std::size_t num_presses = 1;
+        while ((i + num_presses < keys_.size()) &&
+               (keys_[i + num_presses] == key)) {
+            ++num_presses;
+        }
+
+        auto page = std::ptrdiff_t{bar_chart_->get_width()};
+        auto num_steps = static_cast<std::ptrdiff_t>(num_presses);
+
+        if (key.press == KeyPress::ARROW_LEFT) {
+            scroll_by(-num_steps);
+        } else if (key.press == KeyPress::ARROW_RIGHT) {
+            scroll_by(num_steps);
+        } else if (key.press == KeyPress::PAGE_UP) {
+            scroll_by(-num_steps * page);
+        } else if (key.press == KeyPress::PAGE_DOWN) {
+            scroll_by(num_steps * page);
+        } else {
+            for (std::size_t n = 0; n < num_presses; ++n) {
+                handle_key(key.press);
+            }
+        }
+
+        i += num_presses;
+    }
+
+    return !keys_.empty();
+}
+
+void TermUi::handle_key(KeyPress key) {
+    if (key == KeyPress::CARRIAGE_RETURN) {
         terminal_surface_->on_carriage_return();
 
     } else if (key == KeyPress::LETTER_R) {
@@ -161,92 +979,131 @@ void TermUi::read_keyboard_input(Millis interval) {
     } else if (key == KeyPress::LETTER_T) {
         display_mode_ = DisplayMode::DISPLAY_TX;
 
+    } else if (key == KeyPress::LETTER_D) {
+        display_mode_ = DisplayMode::DISPLAY_BOTH;
+
     } else if (key == KeyPress::LETTER_C) {
         display_scale_ = next_scale(display_scale_);
 
     } else if (key == KeyPress::LETTER_S) {
-        if (stat_mode_ == Statistic::AVERAGE) {
-            stat_mode_ = Statistic::SUM;
-        } else if (stat_mode_ == Statistic::SUM) {
-            stat_mode_ = Statistic::AVERAGE;
+        stat_mode_ = sampling::next_statistic(stat_mode_);
+
+    } else if (key == KeyPress::LETTER_I) {
+        iface_idx_ = (iface_idx_ + 1) % history_->num_ifaces();
+
+    } else if (key == KeyPress::LETTER_B) {
+        if (bar_style_ == BarStyle::BLOCKS) {
+            bar_style_ = BarStyle::EIGHTHS;
+        } else if (bar_style_ == BarStyle::EIGHTHS) {
+            bar_style_ = BarStyle::BLOCKS;
         }
 
+    } else if (key == KeyPress::LETTER_G) {
+        jump_input_.emplace();
+
+    } else if (key == KeyPress::LETTER_P) {
+        is_profile_shown_ = !is_profile_shown_;
+
+    } else if (key == KeyPress::LETTER_O) {
+        view_ = view_ == View::TOP ? View::CHART : View::TOP;
+
+    } else if (key == KeyPress::LETTER_H) {
+        view_ = view_ == View::HEAT_MAP ? View::CHART : View::HEAT_MAP;
+
+    } else if (key == KeyPress::LETTER_K) {
+        quantity_ =
+            sampling::next_quantity(quantity_, history_->get_quantities());
+
     } else if (key == KeyPress::ARROW_UP) {
-        agg_window_ = sampling::next_interval(agg_window_);
+        agg_window_ = sampling::next_interval(agg_window_, windows_);
 
     } else if (key == KeyPress::ARROW_DOWN) {
-        agg_window_ = sampling::prev_interval(agg_window_);
+        agg_window_ = sampling::prev_interval(agg_window_, windows_);
 
-    } else if (key == KeyPress::ARROW_LEFT) {
-        scroll_left();
+    } else if (key == KeyPress::HOME) {
+        // the oldest bucket at the left edge
+        const auto &ts_coll_rx = history_->get_rx(iface_idx_);
+        scroll_to(ts_coll_rx.offset(agg_window_, ts_coll_rx.min(agg_window_),
+                                    bar_chart_->get_width() - 1));
 
-    } else if (key == KeyPress::ARROW_RIGHT) {
-        scroll_right();
+    } else if (key == KeyPress::END) {
+        scroll_cursor_.reset();
 
     } else if (key == KeyPress::QUIT) {
-        throw InterruptException();
+        quit();
     }
 }
 
-void TermUi::render_no_winch() {
-    // ignore SIGWINCH while we're rendering
-    SignalGuard guard{susp_sigwinch_.get()};
+void TermUi::handle_jump_key(const Key &key) {
+    auto &input = jump_input_.value();
 
-    render();
-}
+    if (key.press == KeyPress::ESCAPE) {
+        jump_input_.reset();
 
-bool TermUi::scroll_left() {
-    bool cursor_moved = false;
+    } else if (key.press == KeyPress::BACKSPACE) {
+        if (!input.empty()) {
+            input.pop_back();
+        }
 
-    TimePoint cursor{};
-    if (scroll_cursor_.has_value()) {
-        cursor = scroll_cursor_.value();
-    } else {
-        cursor = ts_coll_rx_->max(agg_window_);
-    }
+    } else if (key.press == KeyPress::CARRIAGE_RETURN) {
+        auto opt_tp = tools::TimeKeeping::parse_local_time(input, get_now());
+
+        // Something that is not a time stays up for correcting
+        if (opt_tp.has_value()) {
+            jump_to(opt_tp.value());
+            jump_input_.reset();
+        }
 
-    auto opt_tp = ts_coll_rx_->minus_one(agg_window_, cursor);
-    if (opt_tp.has_value()) {
-        scroll_cursor_.swap(opt_tp);
-        cursor_moved = true;
+    } else if ((key.ch != 0) && (input.size() < MAX_JUMP_INPUT_LEN)) {
+        input.push_back(key.ch);
     }
+}
 
-    return cursor_moved;
+void TermUi::jump_to(TimePoint tp) {
+    // the time in the middle of the screen
+    const auto &ts_coll_rx = history_->get_rx(iface_idx_);
+    auto target = ts_coll_rx.clamp(agg_window_, tp);
+    scroll_to(ts_coll_rx.offset(agg_window_, target,
+                                bar_chart_->get_width() / 2));
 }
 
-bool TermUi::scroll_right() {
-    bool cursor_moved = false;
+void TermUi::scroll_by(std::ptrdiff_t num_buckets) {
+    const auto &ts_coll_rx = history_->get_rx(iface_idx_);
 
     TimePoint cursor{};
     if (scroll_cursor_.has_value()) {
         cursor = scroll_cursor_.value();
     } else {
-        cursor = ts_coll_rx_->max(agg_window_);
+        cursor = ts_coll_rx.max(agg_window_);
     }
 
-    auto opt_tp = ts_coll_rx_->plus_one(agg_window_, cursor);
-    if (opt_tp.has_value()) {
-        scroll_cursor_.swap(opt_tp);
-        cursor_moved = true;
-    } else {
+    scroll_to(ts_coll_rx.offset(agg_window_, cursor, num_buckets));
+}
+
+void TermUi::scroll_to(TimePoint cursor) {
+    // Scrolling all the way to the latest bucket goes back to dynamic update
+    // mode
+    const auto &ts_coll_rx = history_->get_rx(iface_idx_);
+    if (cursor >= ts_coll_rx.max(agg_window_)) {
         scroll_cursor_.reset();
+    } else {
+        scroll_cursor_.emplace(cursor);
     }
-
-    return cursor_moved;
 }
 
 bool TermUi::rescue_scroll_cursor() {
     // If the scroll cursor gets out of bounds we need to rescue it by bringing
     // it within bounds again. This will happen when we are in scrolling mode
     // and the scrolling cursor falls off the left edge of the time series
-    // during a truncate.
+    // as the ring buffer wraps around.
     bool cursor_moved = false;
 
     if (scroll_cursor_.has_value()) {
         auto cursor = scroll_cursor_.value();
+        const auto &ts_coll_rx = history_->get_rx(iface_idx_);
 
-        auto min = ts_coll_rx_->min(agg_window_);
-        auto max = ts_coll_rx_->max(agg_window_);
+        auto min = ts_coll_rx.min(agg_window_);
+        auto max = ts_coll_rx.max(agg_window_);
 
         if (cursor < min) {
             scroll_cursor_.emplace(min);
@@ -260,5 +1117,95 @@ bool TermUi::rescue_scroll_cursor() {
     return cursor_moved;
 }
 
+std::string TermUi::get_prompt() const {
+    // show what has been typed so far
+    if (jump_input_.has_value()) {
+        return JUMP_PROMPT + jump_input_.value() + "_";
+    }
+
+    if (is_profile_shown_ && (profiler_ != nullptr)) {
+        return profiler_->get_summary();
+    }
+
+    return {};
+}
+
+DisplayScale TermUi::get_chart_scale() {
+    if (display_scale_ != DisplayScale::LINE_RATE) {
+        return display_scale_;
+    }
+
+    if (is_line_rate_stale_ || (line_rate_iface_ != iface_idx_)) {
+        line_rate_ = link_speeds_.get(history_->get_iface_name(iface_idx_));
+        line_rate_iface_ = iface_idx_;
+        is_line_rate_stale_ = false;
+    }
+
+    if (!line_rate_.has_value() || (quantity_ != sampling::Quantity::BYTES)) {
+        return DisplayScale::LINEAR;
+    }
+
+    bar_chart_->set_line_rate(line_rate_.value());
+    return DisplayScale::LINE_RATE;
+}
+
+DisplayScale TermUi::get_list_scale() const {
+    return display_scale_ == DisplayScale::LINE_RATE ? DisplayScale::LINEAR
+                                                     : display_scale_;
+}
+
+std::string TermUi::get_alert_label() const {
+    if ((alert_monitor_ == nullptr) || alert_monitor_->get_active().empty()) {
+        return {};
+    }
+
+    const auto &active = alert_monitor_->get_active();
+    const auto &last = active.back();
+
+    std::stringstream ss{};
+    ss << "! " << history_->get_iface_name(last.iface_idx) << " "
+       << alert_monitor_->get_rule(last.rule_idx).text;
+    if (active.size() > 1) {
+        ss << " (+" << (active.size() - 1) << ")";
+    }
+    return ss.str();
+}
+
+const std::string &TermUi::get_menu_alert() const {
+    return snapshot_error_.empty() ? alert_label_ : snapshot_error_;
+}
+
+TimePoint TermUi::get_now() const {
+    return replay_ != nullptr ? replay_->get_time_point()
+                              : tools::MonotonicClock::now();
+}
+
+std::string TermUi::get_iface_label() const {
+    const auto &iface_name = history_->get_iface_name(iface_idx_);
+
+    if (history_->num_ifaces() == 1) {
+        return iface_name;
+    }
+
+    // eth0 2/16
+    std::stringstream ss{};
+    ss << iface_name << " " << (iface_idx_ + 1) << "/"
+       << history_->num_ifaces();
+    return ss.str();
+}
+
+std::string TermUi::get_direction_label() const {
+    switch (display_mode_) {
+    case DisplayMode::DISPLAY_RX:
+        return "rx";
+    case DisplayMode::DISPLAY_TX:
+        return "tx";
+    case DisplayMode::DISPLAY_BOTH:
+        return "rx+tx";
+    }
+
+    THROW_MSG(std::logic_error, "unknown display mode");
+}
+
 } // namespace termui
 } // namespace bandwit
@@ -4,32 +4,86 @@
 #include <chrono>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include "sampling/agg_window.hpp"
-#include "sampling/sampler.hpp"
+#include "sampling/alert_hook.hpp"
+#include "sampling/alert_monitor.hpp"
+#include "sampling/alert_rule.hpp"
+#include "sampling/history.hpp"
+#include "sampling/link_speed.hpp"
+#include "sampling/recorder.hpp"
+#include "sampling/retention.hpp"
+#include "sampling/sampler_thread.hpp"
 #include "sampling/statistic.hpp"
 #include "sampling/time_series_coll.hpp"
+#include "service/client.hpp"
+#include "service/remote_viewer.hpp"
+#include "service/replay_sampler.hpp"
+#include "service/shm_segment.hpp"
 #include "termui/bar_chart.hpp"
+#include "termui/bar_style.hpp"
 #include "termui/display_mode.hpp"
 #include "termui/display_scale.hpp"
 #include "termui/file_status.hpp"
+#include "termui/frame_scheduler.hpp"
+#include "termui/heat_map.hpp"
 #include "termui/keyboard_input.hpp"
 #include "termui/terminal_driver.hpp"
 #include "termui/terminal_mode.hpp"
 #include "termui/terminal_surface.hpp"
+#include "termui/terminal_window.hpp"
+#include "termui/top_table.hpp"
 #include "termui/window_resize.hpp"
+#include "tools/deadline_scheduler.hpp"
+#include "tools/event_loop.hpp"
+#include "tools/profiler.hpp"
+#include "tools/replay_clock.hpp"
+#include "tools/top_ranking.hpp"
 
 namespace bandwit {
 namespace termui {
 
 class TermUi : public WindowResizeReceiver {
     using AggregationWindow = sampling::AggregationWindow;
+    using History = sampling::History;
+    using Recorder = sampling::Recorder;
     using Statistic = sampling::Statistic;
     using TimeSeriesCollection = sampling::TimeSeriesCollection;
     using TimeSeriesSlice = sampling::TimeSeriesSlice;
 
   public:
-    explicit TermUi(const std::string &iface_name);
+    // Samples the quantities of the ifaces itself, and keeps the history in
+    // files in history_dir unless it is empty. Unless snapshot_path is empty
+    // the history is restored from the snapshot there, and a snapshot is
+    // taken on SIGUSR1 and on the way out. With an adaptive_threshold it
+    // backs off on the ifaces that count fewer bytes a second. Redraws at
+    // most max_fps times a second, and times its stages into the profiler.
+    TermUi(const std::vector<std::string> &iface_names, Millis interval,
+           const std::string &history_dir, const std::string &snapshot_path,
+           std::optional<uint64_t> adaptive_threshold,
+           const sampling::Retention &retention,
+           const std::vector<sampling::Quantity> &quantities,
+           unsigned max_fps, tools::Profiler *profiler);
+
+    // Displays the history that a daemon records
+    TermUi(std::unique_ptr<service::Client> client, unsigned max_fps,
+           tools::Profiler *profiler);
+
+    // Displays the history that a daemon publishes to shared memory
+    TermUi(std::unique_ptr<service::ShmViewer> viewer, unsigned max_fps,
+           tools::Profiler *profiler);
+
+    // Displays the ifaces of the daemons on other hosts together
+    TermUi(std::unique_ptr<service::RemoteViewer> remote, unsigned max_fps,
+           tools::Profiler *profiler);
+
+    // Replays a recording speed times as fast as it was recorded, or as fast
+    // as it can with a speed of 0
+    TermUi(std::unique_ptr<service::ReplaySampler> replay, double speed,
+           const sampling::Retention &retention, unsigned max_fps,
+           tools::Profiler *profiler);
+
     ~TermUi() override;
 
     CLASS_DISABLE_COPIES(TermUi)
@@ -38,46 +92,245 @@ class TermUi : public WindowResizeReceiver {
     void on_window_resize(const Dimensions &win_dim_old,
                           const Dimensions &win_dim_new) override;
 
+    // Holds the rules against every iface as its buckets close and shows
+    // the alerts in the menu bar of the chart. Runs the hook when they go on
+    // or off unless it is empty, at most once per hook_interval for each.
+    void set_alerts(std::vector<sampling::AlertRule> rules,
+                    const std::string &hook, Millis hook_interval);
+
     void run_forever();
 
   private:
-    void sample();
+    // What is shown in the place of the chart
+    enum class View {
+        CHART,
+        // the busiest ifaces
+        TOP,
+        // all the ifaces side by side
+        HEAT_MAP,
+    };
+
+    // Everything a frame is drawn from. A frame with the same key as the one
+    // on display would come out just the same.
+    struct FrameKey {
+        View view;
+        std::size_t iface_idx;
+        sampling::Quantity quantity;
+        DisplayMode display_mode;
+        DisplayScale display_scale;
+        // of the iface on display, 0 if it has none
+        uint64_t line_rate;
+        BarStyle bar_style;
+        Statistic stat_mode;
+        AggregationWindow agg_window;
+        std::string prompt;
+        std::string alert;
+        Dimensions dim;
+        TimePoint cursor;
+        // the value and whether it is a gap of every bucket on display
+        std::vector<uint64_t> buckets;
+
+        bool operator==(const FrameKey &other) const;
+    };
+
+    void init_terminal();
+
+    // Writes the history to the snapshot path, throws if it cannot
+    void write_snapshot() const;
+    // The one on SIGUSR1, a failure is shown in the menu bar until one
+    // succeeds rather than thrown
+    void take_snapshot();
+    // Takes a snapshot of the history, if there is a path for it, and stops
+    // with an InterruptException
+    [[noreturn]] void quit() const;
+
+    // Draws the frame if it is due, however many changes it has in it
+    void render_if_due();
     void render();
-    void read_keyboard_input(Millis interval);
+    void render_top();
+    void render_heat_map();
+    // Brings the ranking up to date with the history, only the values of
+    // the ifaces that changed move them
+    void update_ranking(TimePoint cursor);
+    // the ifaces that got samples since the ranking was last updated
+    void mark_changed(std::size_t iface);
+    void mark_changed(const std::vector<sampling::Delta> &deltas);
+    void mark_changed(const std::vector<std::size_t> &ifaces);
+
+    // Whether the frame of the slices would be the one on display. If not
+    // it becomes the one on display.
+    bool is_same_frame(const std::string &prompt, TimePoint cursor,
+                       const TimeSeriesSlice &slice,
+                       const TimeSeriesSlice *other_slice);
+    // the same for the rows of the top table
+    bool is_same_top_frame(const std::string &prompt, TimePoint cursor,
+                           const std::vector<TopTable::Row> &rows);
+    // and for the rows of the heat map, from the first iface on
+    bool is_same_heat_frame(const std::string &prompt, TimePoint cursor,
+                            std::size_t first_iface,
+                            const std::vector<HeatMap::Row> &rows);
+    // fills in everything but the buckets
+    void fill_frame_key(const std::string &prompt, TimePoint cursor);
+    // The key goes on display unless it is the one already on display,
+    // returns whether it was
+    bool swap_frame_key();
+    // Handles all the keys pressed since the last time, returns whether
+    // there were any
+    bool read_keyboard_input();
+    // Handles a lone escape that nothing followed in time, returns whether
+    // there was one
+    bool flush_keyboard_input();
+    bool handle_keys();
+    void handle_key(KeyPress key);
+    void handle_jump_key(const Key &key);
 
-    void render_no_winch();
+    // Records the samples that the sampler thread queued, returns whether
+    // there were any
+    bool record_samples();
+    // the same for the samples from the daemon
+    bool receive_samples();
+    bool refresh_samples();
+    // and from the daemons on other hosts, with the gaps of the quiet ones
+    bool receive_remote_samples(const tools::Events &events);
+    // the same for the samples of the replay that are due
+    bool replay_samples();
+    // Holds the alert rules against the buckets that closed, returns
+    // whether any alert went on or off
+    bool update_alerts();
 
-    bool scroll_left();
-    bool scroll_right();
+    // Every way of scrolling moves the cursor straight to where it ends up,
+    // however far that is
+    void jump_to(TimePoint tp);
+    void scroll_by(std::ptrdiff_t num_buckets);
+    void scroll_to(TimePoint cursor);
     bool rescue_scroll_cursor();
 
-    std::string iface_name_{};
+    // the time it is, which in a replay is the time it got to
+    TimePoint get_now() const;
+
+    std::string get_iface_label() const;
+    // eg. "rx", for the display mode
+    std::string get_direction_label() const;
+    // the jump to time prompt, or the profile if it is shown
+    std::string get_prompt() const;
+    // The scale of the chart of the iface on display. The line rate is
+    // linear for an iface without one and for the counts, and for the views
+    // of many ifaces, which have a line rate each.
+    DisplayScale get_chart_scale();
+    DisplayScale get_list_scale() const;
+
+    // the alert that went on last, eg. "! eth0 rx>90%/30s (+2)", or empty
+    std::string get_alert_label() const;
+    // what goes at the start of the menu bar: a failed snapshot, or else
+    // the alert label
+    const std::string &get_menu_alert() const;
+
+    // the iface currently on display
+    std::size_t iface_idx_{0};
 
     // Cursor is nullopt means we are in dynamic update mode.
     // Cursor is set means that we are scrolling to the left through historical
     // data.
     std::optional<TimePoint> scroll_cursor_{std::nullopt};
 
+    // What has been typed into the jump to time prompt, nullopt unless it is
+    // open. The keys go to the prompt while it is.
+    std::optional<std::string> jump_input_{std::nullopt};
+
+    // whether the latencies of the stages are shown instead of the menu
+    bool is_profile_shown_{false};
+
+    View view_{View::CHART};
+
+    // what is counted, one of the quantities the history records
+    sampling::Quantity quantity_{sampling::Quantity::BYTES};
     DisplayMode display_mode_{DisplayMode::DISPLAY_RX};
     DisplayScale display_scale_{DisplayScale::LINEAR};
+
+    // The line rate of the iface on display. It is checked again with every
+    // sample, which is one small read while the scale is of the line rate.
+    sampling::LinkSpeeds link_speeds_{};
+    std::optional<uint64_t> line_rate_{};
+    std::size_t line_rate_iface_{0};
+    bool is_line_rate_stale_{true};
+    BarStyle bar_style_{BarStyle::BLOCKS};
     Statistic stat_mode_{Statistic::AVERAGE};
     AggregationWindow agg_window_{AggregationWindow::ONE_SECOND};
 
-    sampling::Sample prev_sample_{};
+    // the windows being recorded, from the shortest to the longest
+    std::vector<AggregationWindow> windows_{};
 
     std::unique_ptr<BarChart> bar_chart_{nullptr};
+    std::unique_ptr<TopTable> top_table_{nullptr};
+    std::unique_ptr<HeatMap> heat_map_{nullptr};
     std::unique_ptr<FileStatusSetter> blocking_status_setter_{nullptr};
     std::unique_ptr<FileStatusSetter> non_blocking_status_setter_{nullptr};
     std::unique_ptr<KeyboardInputReader> kb_reader_{nullptr};
+    // reused for every read
+    std::vector<Key> keys_{};
     std::unique_ptr<SignalSuspender> susp_sigint_{nullptr};
-    std::unique_ptr<SignalSuspender> susp_sigwinch_{nullptr};
     std::unique_ptr<TerminalDriver> terminal_driver_{nullptr};
     std::unique_ptr<TerminalModeSetter> interactive_mode_setter_{nullptr};
     std::unique_ptr<TerminalSurface> terminal_surface_{nullptr};
-    std::unique_ptr<sampling::Sampler> sampler_{nullptr};
+    std::unique_ptr<TerminalWindow> terminal_window_{nullptr};
+
+    // Either we sample ourselves and have a recorder, or we are attached to
+    // a daemon and have a client or a viewer, or to the daemons of other
+    // hosts. The samples for the recorder are taken on the sampler thread,
+    // so that a slow terminal cannot delay them, unless they are replayed,
+    // which the replay clock paces. The scheduler drives the viewer and the
+    // reconnects of the remote hosts.
+    std::unique_ptr<Recorder> recorder_{nullptr};
+    // of the recorder, empty without one
+    std::string snapshot_path_{};
+    std::unique_ptr<sampling::SamplerThread> sampler_thread_{nullptr};
+    // owned by the recorder
+    service::ReplaySampler *replay_{nullptr};
+    std::unique_ptr<tools::ReplayClock> replay_clock_{nullptr};
+    std::unique_ptr<service::Client> client_{nullptr};
+    std::unique_ptr<service::ShmViewer> viewer_{nullptr};
+    std::unique_ptr<service::RemoteViewer> remote_{nullptr};
+    std::unique_ptr<tools::DeadlineScheduler> scheduler_{nullptr};
+
+    // what is on display, owned by the recorder, the client or a viewer
+    const History *history_{nullptr};
+
+    // null without any alert rules, and the hook without a command
+    std::unique_ptr<sampling::AlertMonitor> alert_monitor_{nullptr};
+    std::unique_ptr<sampling::AlertHook> alert_hook_{nullptr};
+    std::string alert_label_{};
+
+    // why the last snapshot on SIGUSR1 failed, empty if it did not
+    std::string snapshot_error_{};
+
+    FrameScheduler frame_scheduler_;
+    tools::Profiler *profiler_{nullptr};
+
+    // The key of the frame on display, nullopt when the frame on display
+    // cannot be trusted, eg. after a resize. The other one is filled in for
+    // every frame and swapped with it.
+    std::optional<FrameKey> shown_frame_key_{std::nullopt};
+    FrameKey frame_key_{};
+
+    // The ranking of the ifaces for the top table. The ifaces that got
+    // samples are ranked again, every iface is once what it ranks by
+    // changed or the history was replaced.
+    std::unique_ptr<tools::TopRanking> ranking_{nullptr};
+    bool is_ranking_stale_{true};
+    std::vector<std::size_t> changed_ifaces_{};
+    std::vector<bool> is_iface_changed_{};
+    AggregationWindow ranking_window_{AggregationWindow::ONE_SECOND};
+    sampling::Quantity ranking_quantity_{sampling::Quantity::BYTES};
+    DisplayMode ranking_mode_{DisplayMode::DISPLAY_RX};
+    Statistic ranking_stat_{Statistic::AVERAGE};
+    // nullopt while it follows the latest buckets
+    std::optional<TimePoint> ranking_cursor_{std::nullopt};
+    // reused for every frame
+    std::vector<std::size_t> ranked_{};
+    std::vector<TopTable::Row> top_rows_{};
+    std::vector<HeatMap::Row> heat_rows_{};
 
-    std::unique_ptr<TimeSeriesCollection> ts_coll_rx_{nullptr};
-    std::unique_ptr<TimeSeriesCollection> ts_coll_tx_{nullptr};
+    std::unique_ptr<tools::EventLoop> event_loop_{nullptr};
 };
 
 } // namespace termui
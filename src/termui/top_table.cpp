@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <sstream>
+
+#include "glyph.hpp"
+#include "macros.hpp"
+#include "terminal_surface.hpp"
+#include "top_table.hpp"
+
+namespace bandwit {
+namespace termui {
+
+// eg. " 12 "
+constexpr uint16_t RANK_WIDTH = 4;
+// eg. "1023 kb/s"
+constexpr uint16_t VALUE_WIDTH = 10;
+// names are padded to the longest one, within these bounds
+constexpr uint16_t MIN_NAME_WIDTH = 6;
+constexpr uint16_t MAX_NAME_WIDTH = 24;
+
+// The levels of a bucket, the sparkline of every row is scaled to its own
+// max. The lowest level still has a bar of an eighth.
+constexpr std::size_t NUM_SPARK_LEVELS = 8;
+
+// no samples in the bucket, as in the chart
+constexpr uint64_t GAP_VALUE = UINT64_MAX;
+// before the first sample, nothing is drawn
+constexpr uint64_t BLANK_VALUE = UINT64_MAX - 1;
+// still to be sampled, which is dotted
+constexpr uint64_t PENDING_VALUE = UINT64_MAX - 2;
+
+std::size_t TopTable::get_num_rows() const {
+    auto dim = surface_->get_size();
+    return dim.height > 2 ? SIZE_T(dim.height - 2) : 0;
+}
+
+uint16_t TopTable::get_name_width(std::size_t name_width) const {
+    auto dim = surface_->get_size();
+    auto max_width = std::min(MAX_NAME_WIDTH, U16(dim.width / 3));
+    return U16(std::clamp(name_width, SIZE_T(MIN_NAME_WIDTH),
+                          SIZE_T(std::max(MIN_NAME_WIDTH, max_width))));
+}
+
+uint16_t TopTable::get_sparkline_width(std::size_t name_width) const {
+    auto dim = surface_->get_size();
+    auto used = RANK_WIDTH + get_name_width(name_width) + 1 + VALUE_WIDTH + 1;
+    return dim.width > used ? U16(dim.width - used) : 0;
+}
+
+void TopTable::draw(const std::string &title, const std::vector<Row> &rows,
+                    std::size_t num_ifaces, AggregationWindow window,
+                    DisplayScale scale, Statistic stat) {
+    auto dim = surface_->get_size();
+
+    surface_->clear_surface();
+
+    std::size_t name_width{0};
+    for (const auto &row : rows) {
+        name_width = std::max(name_width, row.iface_name.size());
+    }
+    auto row_name_width = get_name_width(name_width);
+
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::DRAW};
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            draw_row(U16(i + 2), i + 1, rows[i], row_name_width, scale,
+                     stat);
+        }
+    }
+    {
+        tools::StageTimer timer{profiler_, tools::Stage::FORMAT};
+
+        // [avg rx/sec top 10 of 200], or [avg rx packets/sec ...]
+        std::stringstream ss{};
+        ss << "[" << sampling::get_label(stat) << " " << title;
+        if (qtty_ != sampling::Quantity::BYTES) {
+            ss << " " << sampling::get_label(qtty_);
+        }
+        ss << "/" << sampling::get_label(window) << " top " << rows.size()
+           << " of " << num_ifaces << "]";
+        auto title_fmt = ss.str();
+
+        auto col = U16(std::max(1, (INT(dim.width) / 2) -
+                                       (INT(title_fmt.size()) / 2)));
+        surface_->put_string(Point{col, 1}, title_fmt);
+
+        draw_menu(num_ifaces);
+    }
+
+    tools::StageTimer timer{profiler_, tools::Stage::FLUSH};
+    surface_->flush();
+}
+
+void TopTable::set_prompt(const std::string &prompt) { prompt_ = prompt; }
+
+void TopTable::set_quantity(sampling::Quantity qtty) { qtty_ = qtty; }
+
+void TopTable::draw_row(uint16_t y, std::size_t rank, const Row &row,
+                        uint16_t name_width, DisplayScale scale,
+                        Statistic stat) {
+    line_.clear();
+
+    // " 12 eth0       1023 kb/s "
+    auto rank_str = std::to_string(rank);
+    line_.append(RANK_WIDTH - 1 - std::min(rank_str.size(), SIZE_T(2)), ' ');
+    line_.append(rank_str).append(" ");
+
+    auto name = row.iface_name.substr(0, name_width);
+    line_.append(name).append(name_width - name.size(), ' ');
+    line_.append(" ");
+
+    auto y_scale = scale == DisplayScale::LOG10 ? YAxisScale::BASE10
+                                                : YAxisScale::BASE2;
+    NumBytesBuffer buf{};
+    std::string_view value{};
+    if (qtty_ != sampling::Quantity::BYTES) {
+        value = stat == Statistic::SUM
+                    ? formatter_.format_count(&buf, row.value)
+                    : formatter_.format_count_rate(&buf, row.value, "s");
+    } else {
+        value = stat == Statistic::SUM
+                    ? formatter_.format_num_bytes(&buf, y_scale, row.value)
+                    : formatter_.format_num_bytes_rate(&buf, y_scale,
+                                                       row.value, "s");
+    }
+    if (value.size() < VALUE_WIDTH) {
+        line_.append(VALUE_WIDTH - value.size(), ' ');
+    }
+    line_.append(value).append(" ");
+
+    surface_->put_string(Point{1, y}, line_);
+    draw_sparkline(Point{U16(line_.size() + 1), y}, row);
+}
+
+void TopTable::draw_sparkline(const Point &start, const Row &row) {
+    auto len = row.slice.size();
+    spark_values_.resize(len);
+
+    uint64_t max_value{0};
+    for (std::size_t i = 0; i < len; ++i) {
+        bool is_gap = row.slice.is_gap(i);
+        bool is_blank = row.slice.is_blank(i);
+        bool is_pending = row.slice.is_pending(i);
+        uint64_t value = row.slice.get_value(i);
+        if (row.other_slice.has_value()) {
+            is_gap = is_gap && row.other_slice->is_gap(i);
+            is_blank = is_blank && row.other_slice->is_blank(i);
+            is_pending = is_pending && row.other_slice->is_pending(i);
+            value += row.other_slice->get_value(i);
+        }
+
+        if (is_blank) {
+            spark_values_[i] = BLANK_VALUE;
+        } else if (is_pending) {
+            spark_values_[i] = PENDING_VALUE;
+        } else if (is_gap) {
+            spark_values_[i] = GAP_VALUE;
+        } else {
+            spark_values_[i] = value;
+            max_value = std::max(max_value, value);
+        }
+    }
+
+    // Right aligned, the way the chart has the latest bucket at the right
+    // edge even while there are fewer buckets than columns
+    auto dim = surface_->get_size();
+    auto x = U16(std::max(INT(start.x), INT(dim.width) - INT(len) + 1));
+    for (auto value : spark_values_) {
+        Point pt{x++, start.y};
+        if (value == GAP_VALUE) {
+            surface_->put_glyph(pt, GLYPH_DASHED_LINE);
+            continue;
+        }
+        if (value == PENDING_VALUE) {
+            surface_->put_glyph(pt, GLYPH_MIDDLE_DOT);
+            continue;
+        }
+        if (value == BLANK_VALUE) {
+            continue;
+        }
+
+        auto level = max_value > 0 ? SIZE_T(F64(value) / F64(max_value) *
+                                            F64(NUM_SPARK_LEVELS - 1))
+                                   : 0;
+        surface_->put_glyph(pt, GLYPH_LOWER_EIGHTHS[level + 1]);
+    }
+}
+
+void TopTable::draw_menu(std::size_t num_ifaces) {
+    auto dim = surface_->get_size();
+
+    std::string menu{" (q)uit (r)x (t)x (d)ual s(c)ale (s)tat (g)oto "
+                     "(o) chart (arrow keys)"};
+    if (!prompt_.empty()) {
+        menu = " " + prompt_;
+    }
+    menu.resize(dim.width, ' ');
+
+    // the number of ifaces at the end, where the chart has the iface
+    std::stringstream ss{};
+    ss << "[" << num_ifaces << " ifaces]";
+    auto label = ss.str();
+    if (label.size() < menu.size()) {
+        menu.replace(menu.size() - label.size(), label.size(), label);
+    }
+
+    surface_->put_string(Point{1, dim.height}, formatter_.reverse_video(menu));
+}
+
+} // namespace termui
+} // namespace bandwit
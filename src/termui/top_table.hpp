@@ -0,0 +1,88 @@
+#ifndef TOP_TABLE_H
+#define TOP_TABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "formatter.hpp"
+#include "sampling/agg_window.hpp"
+#include "sampling/quantity.hpp"
+#include "sampling/statistic.hpp"
+#include "sampling/time_series_slice.hpp"
+#include "termui/display_scale.hpp"
+#include "termui/point.hpp"
+#include "tools/profiler.hpp"
+
+namespace bandwit {
+namespace termui {
+
+class TerminalSurface;
+
+// The busiest ifaces, one row each with the rank, the name, the current
+// value of the statistic and a sparkline of the buckets leading up to it.
+// Drawn on the same surface as the BarChart, in its place.
+class TopTable {
+    using AggregationWindow = sampling::AggregationWindow;
+    using Statistic = sampling::Statistic;
+    using TimeSeriesSlice = sampling::TimeSeriesSlice;
+
+  public:
+    struct Row {
+        std::string_view iface_name{};
+        // already the statistic, eg. the rate
+        uint64_t value{0};
+        // The buckets of the sparkline, the current one last. With a second
+        // slice both are added up, eg. rx and tx.
+        TimeSeriesSlice slice{};
+        std::optional<TimeSeriesSlice> other_slice{};
+    };
+
+    // Times the stages of every frame into the profiler, if there is one
+    explicit TopTable(TerminalSurface *surface,
+                      tools::Profiler *profiler = nullptr)
+        : surface_{surface}, profiler_{profiler} {}
+
+    // How many rows fit under the title and above the menu
+    std::size_t get_num_rows() const;
+
+    // How many buckets the sparklines of rows with names of up to
+    // name_width chars show
+    uint16_t get_sparkline_width(std::size_t name_width) const;
+
+    // title is eg. "rx", num_ifaces how many were ranked
+    void draw(const std::string &title, const std::vector<Row> &rows,
+              std::size_t num_ifaces, AggregationWindow window,
+              DisplayScale scale, Statistic stat);
+
+    // Shown instead of the menu while it is not empty
+    void set_prompt(const std::string &prompt);
+
+    // What the values count, the bytes unless set
+    void set_quantity(sampling::Quantity qtty);
+
+  private:
+    uint16_t get_name_width(std::size_t name_width) const;
+
+    void draw_row(uint16_t y, std::size_t rank, const Row &row,
+                  uint16_t name_width, DisplayScale scale, Statistic stat);
+    void draw_sparkline(const Point &start, const Row &row);
+    void draw_menu(std::size_t num_ifaces);
+
+    TerminalSurface *surface_{nullptr};
+    tools::Profiler *profiler_{nullptr};
+    Formatter formatter_{};
+    std::string prompt_{};
+    sampling::Quantity qtty_{sampling::Quantity::BYTES};
+
+    // reused from row to row
+    std::vector<uint64_t> spark_values_{};
+    std::string line_{};
+};
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // TOP_TABLE_H
@@ -0,0 +1,175 @@
+#include <cerrno>
+#include <cstdlib>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "file_status.hpp"
+#include "tty_terminal_driver.hpp"
+
+namespace bandwit {
+namespace termui {
+
+TtyTerminalDriver::TtyTerminalDriver(FILE *stdin_file, FILE *stdout_file,
+                                     FileStatusSetter *status_setter)
+    : stdin_file_{stdin_file}, stdout_file_{stdout_file},
+      status_setter_{status_setter} {
+    frame_.reserve(frame_capacity_);
+}
+
+TerminalCapabilities TtyTerminalDriver::get_capabilities() {
+    auto caps = get_term_capabilities(getenv("TERM"));
+    if (!caps.relative_moves) {
+        return caps;
+    }
+
+    // Like reading the cursor position this needs stdin in blocking mode
+    FileStatusGuard guard{status_setter_};
+
+    // A terminal that does not know the query ignores it, but every terminal
+    // answers the cursor position query that follows it, so its reply marks
+    // the end of the replies
+    flush_output();
+    fprintf(stdout_file_, "%s\033[6n", SYNCHRONIZED_OUTPUT_QUERY.data());
+    fflush(stdout_file_);
+
+    std::string replies{};
+    int ch;
+    while ((ch = fgetc(stdin_file_)) != 'R') {
+        if (ch == EOF) {
+            THROW_CERROR(std::runtime_error,
+                         "TtyTerminalDriver.get_capabilities failed in "
+                         "fgetc()");
+        }
+        replies += static_cast<char>(ch);
+    }
+
+    caps.synchronized_output = has_synchronized_output(replies);
+    return caps;
+}
+
+Dimensions TtyTerminalDriver::get_terminal_size() {
+    struct winsize size {};
+    int stdout_fileno = fileno(stdout_file_);
+
+    if (ioctl(stdout_fileno, TIOCGWINSZ, &size) < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "TtyTerminalDriver.get_terminal_size failed in ioctl()");
+    }
+
+    Dimensions dim{size.ws_col, size.ws_row};
+    return dim;
+}
+
+Point TtyTerminalDriver::get_cursor_position() {
+    // For this to work stdin needs to be in blocking mode.
+    FileStatusGuard guard{status_setter_};
+
+    // Reading the cursor position has been known to be flaky. To work around
+    // this we do it only once on program startup, and then we aim to compute it
+    // based on the events we generate (moving the cursor) or the events we
+    // observe (window resizing).
+    // If we did fail to read the cursor pos on startup we could fall back on
+    // taking over the whole terminal window...
+    flush_output();
+    fprintf(stdout_file_, "\033[6n");
+    fflush(stdout_file_);
+
+    int cur_x, cur_y;
+    if (fscanf(stdin_file_, "\033[%d;%dR", &cur_y, &cur_x) < 2) {
+        THROW_CERROR(std::runtime_error,
+                     "TtyTerminalDriver.get_cursor_position failed in "
+                     "fscanf()");
+    }
+
+    Point pt{U16(cur_x), U16(cur_y)};
+    return pt;
+}
+
+void TtyTerminalDriver::set_cursor_position(const Point &pt) {
+    // \033[y;xH
+    frame_ += "\033[";
+    append_number(pt.y);
+    frame_ += ';';
+    append_number(pt.x);
+    frame_ += 'H';
+}
+
+void TtyTerminalDriver::put_char(const char &ch) { frame_ += ch; }
+
+void TtyTerminalDriver::put_uchar(std::string_view ch) {
+    // We can't really validate ch by checking the length or anything, it can be
+    // any sequence of bytes that make up a char. It's supposed to be only one
+    // char.
+    frame_ += ch;
+}
+
+void TtyTerminalDriver::put_string(const std::string &str) { frame_ += str; }
+
+void TtyTerminalDriver::flush_output() {
+    // Anything still buffered in stdio goes first
+    fflush(stdout_file_);
+
+    int stdout_fileno = fileno(stdout_file_);
+    std::size_t written{0};
+
+    while (written < frame_.size()) {
+        ssize_t rv = write(stdout_fileno, frame_.data() + written,
+                           frame_.size() - written);
+
+        if (rv >= 0) {
+            written += SIZE_T(rv);
+            continue;
+        }
+
+        // stdin and stdout share the file status flags of the tty, so when
+        // stdin is made non-blocking stdout is too
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            wait_writable();
+            continue;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        frame_.clear();
+        THROW_CERROR(std::runtime_error,
+                     "TtyTerminalDriver.flush_output failed in write()");
+    }
+
+    num_bytes_written_ += written;
+    frame_.clear();
+}
+
+std::size_t TtyTerminalDriver::get_num_bytes_written() const {
+    return num_bytes_written_;
+}
+
+void TtyTerminalDriver::append_number(uint16_t num) {
+    // At most 5 digits, written from the right
+    char digits[5];
+    char *end = digits + sizeof(digits);
+    char *cur = end;
+
+    do {
+        *--cur = static_cast<char>('0' + (num % 10));
+        num = U16(num / 10);
+    } while (num > 0);
+
+    frame_.append(cur, SIZE_T(end - cur));
+}
+
+void TtyTerminalDriver::wait_writable() {
+    pollfd pfd{fileno(stdout_file_), POLLOUT, 0};
+
+    if ((poll(&pfd, 1, -1) < 0) && (errno != EINTR)) {
+        THROW_CERROR(std::runtime_error,
+                     "TtyTerminalDriver.wait_writable failed in poll()");
+    }
+}
+
+} // namespace termui
+} // namespace bandwit
\ No newline at end of file
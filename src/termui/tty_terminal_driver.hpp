@@ -0,0 +1,59 @@
+#ifndef TTY_TERMINAL_DRIVER_H
+#define TTY_TERMINAL_DRIVER_H
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "macros.hpp"
+#include "termui/dimensions.hpp"
+#include "termui/point.hpp"
+#include "termui/terminal_capabilities.hpp"
+#include "termui/terminal_driver.hpp"
+
+namespace bandwit {
+namespace termui {
+
+class FileStatusSetter;
+
+// Drives a real terminal. Output is appended to a frame buffer and written
+// out with a single write(2) when flushed, bypassing stdio.
+class TtyTerminalDriver : public TerminalDriver {
+  public:
+    TtyTerminalDriver(FILE *stdin_file, FILE *stdout_file,
+                      FileStatusSetter *status_setter);
+
+    CLASS_DISABLE_COPIES(TtyTerminalDriver)
+    CLASS_DISABLE_MOVES(TtyTerminalDriver)
+
+    TerminalCapabilities get_capabilities() override;
+    Dimensions get_terminal_size() override;
+    Point get_cursor_position() override;
+    void set_cursor_position(const Point &pt) override;
+    void put_char(const char &ch) override;
+    void put_uchar(std::string_view ch) override;
+    void put_string(const std::string &str) override;
+    void flush_output() override;
+
+    std::size_t get_num_bytes_written() const override;
+
+  private:
+    void append_number(uint16_t num);
+    void wait_writable();
+
+    FILE *stdin_file_{};
+    FILE *stdout_file_{};
+
+    FileStatusSetter *status_setter_{nullptr};
+
+    // Reused across frames, it only grows if a frame ever exceeds it
+    std::string frame_{};
+    std::size_t frame_capacity_{16 * 1024};
+
+    std::size_t num_bytes_written_{0};
+};
+
+} // namespace termui
+} // namespace bandwit
+
+#endif // TTY_TERMINAL_DRIVER_H
@@ -0,0 +1,105 @@
+#include <chrono>
+#include <stdexcept>
+
+#include "byte_stream.hpp"
+#include "except.hpp"
+
+namespace bandwit {
+namespace tools {
+
+int64_t to_nanos(TimePoint tp) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               tp.time_since_epoch())
+        .count();
+}
+
+TimePoint from_nanos(int64_t nanos) {
+    return TimePoint{std::chrono::duration_cast<Clock::duration>(
+        std::chrono::nanoseconds{nanos})};
+}
+
+void ByteWriter::put_u8(uint8_t value) {
+    out_->push_back(static_cast<char>(value));
+}
+
+void ByteWriter::put_u32(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        put_u8(U8(value >> (8 * i)));
+    }
+}
+
+void ByteWriter::put_u64(uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        put_u8(U8(value >> (8 * i)));
+    }
+}
+
+void ByteWriter::put_i64(int64_t value) { put_u64(U64(value)); }
+
+void ByteWriter::put_varint(uint64_t value) {
+    while (value >= 0x80) {
+        put_u8(U8(value | 0x80));
+        value >>= 7;
+    }
+    put_u8(U8(value));
+}
+
+void ByteWriter::put_string(std::string_view value) {
+    put_u32(U32(value.size()));
+    out_->append(value.data(), value.size());
+}
+
+uint8_t ByteReader::get_u8() { return U8(get_bytes(1)); }
+
+uint32_t ByteReader::get_u32() { return U32(get_bytes(4)); }
+
+uint64_t ByteReader::get_u64() { return get_bytes(8); }
+
+int64_t ByteReader::get_i64() { return static_cast<int64_t>(get_u64()); }
+
+uint64_t ByteReader::get_varint() {
+    uint64_t value{0};
+
+    // ten bytes carry 70 bits, more than that is garbage
+    for (unsigned shift = 0; shift < 70; shift += 7) {
+        auto byte = get_u8();
+        value |= U64(byte & 0x7f) << shift;
+
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+
+    THROW_MSG(std::runtime_error, "ByteReader.get_varint: too long");
+}
+
+std::string ByteReader::get_string() {
+    auto len = get_u32();
+    if (in_.size() - pos_ < len) {
+        THROW_MSG(std::runtime_error, "ByteReader.get_string ran out of bytes");
+    }
+
+    std::string value{in_.substr(pos_, len)};
+    pos_ += len;
+    return value;
+}
+
+bool ByteReader::at_end() const { return pos_ == in_.size(); }
+
+uint64_t ByteReader::get_bytes(std::size_t num_bytes) {
+    if (in_.size() - pos_ < num_bytes) {
+        THROW_MSG(std::runtime_error, "ByteReader.get_bytes ran out of bytes");
+    }
+
+    uint64_t value{0};
+    for (std::size_t i = 0; i < num_bytes; ++i) {
+        auto byte = static_cast<unsigned char>(in_[pos_ + i]);
+        value |= U64(byte) << (8 * i);
+    }
+
+    pos_ += num_bytes;
+    return value;
+}
+
+} // namespace tools
+} // namespace bandwit
@@ -0,0 +1,59 @@
+#ifndef BYTE_STREAM_H
+#define BYTE_STREAM_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "aliases.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// TimePoints travel as nanoseconds since the epoch
+int64_t to_nanos(TimePoint tp);
+TimePoint from_nanos(int64_t nanos);
+
+// Serializes fixed width integers in little endian byte order, so that the
+// bytes mean the same thing on whichever machine reads them.
+class ByteWriter {
+  public:
+    explicit ByteWriter(std::string *out) : out_{out} {}
+
+    void put_u8(uint8_t value);
+    void put_u32(uint32_t value);
+    void put_u64(uint64_t value);
+    void put_i64(int64_t value);
+    // LEB128, one byte for values below 128 and up to ten for the largest
+    void put_varint(uint64_t value);
+    void put_string(std::string_view value);
+
+  private:
+    std::string *out_{nullptr};
+};
+
+// The reverse of ByteWriter. Reading past the end throws.
+class ByteReader {
+  public:
+    explicit ByteReader(std::string_view in) : in_{in} {}
+
+    uint8_t get_u8();
+    uint32_t get_u32();
+    uint64_t get_u64();
+    int64_t get_i64();
+    uint64_t get_varint();
+    std::string get_string();
+
+    bool at_end() const;
+
+  private:
+    uint64_t get_bytes(std::size_t num_bytes);
+
+    std::string_view in_{};
+    std::size_t pos_{0};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // BYTE_STREAM_H
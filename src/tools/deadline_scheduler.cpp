@@ -0,0 +1,20 @@
+#include "deadline_scheduler.hpp"
+
+namespace bandwit {
+namespace tools {
+
+SteadyTimePoint DeadlineScheduler::get_deadline() const { return deadline_; }
+
+bool DeadlineScheduler::is_due(SteadyTimePoint now) const {
+    return now >= deadline_;
+}
+
+void DeadlineScheduler::advance(SteadyTimePoint now) {
+    auto num_ticks = (now - start_) / interval_;
+    deadline_ = start_ + interval_ * (num_ticks + 1);
+}
+
+Millis DeadlineScheduler::get_interval() const { return interval_; }
+
+} // namespace tools
+} // namespace bandwit
@@ -0,0 +1,35 @@
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include "aliases.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// Hands out deadlines at fixed multiples of the interval from the start.
+// Because each deadline is computed from the start rather than from when the
+// previous tick was actually handled, lateness does not accumulate.
+class DeadlineScheduler {
+  public:
+    DeadlineScheduler(Millis interval, SteadyTimePoint start)
+        : interval_{interval}, start_{start}, deadline_{start + interval} {}
+
+    SteadyTimePoint get_deadline() const;
+    bool is_due(SteadyTimePoint now) const;
+
+    // Moves on to the first deadline after now. Any ticks that were missed
+    // altogether (eg. when the system was suspended) are skipped over.
+    void advance(SteadyTimePoint now);
+
+    Millis get_interval() const;
+
+  private:
+    Millis interval_{};
+    SteadyTimePoint start_{};
+    SteadyTimePoint deadline_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // DEADLINE_SCHEDULER_H
@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#endif
+
+#include "event_loop.hpp"
+#include "except.hpp"
+
+namespace bandwit {
+namespace tools {
+
+#ifndef __linux__
+// The signal handler needs a static to find the self-pipe. There is only ever
+// one EventLoop.
+static int SIGNAL_WRITE_FD = -1;
+
+void EventLoop_signal_handler(int sig) {
+    int errno_orig = errno;
+
+    auto byte = static_cast<unsigned char>(sig);
+    [[maybe_unused]] auto rv = write(SIGNAL_WRITE_FD, &byte, 1);
+
+    errno = errno_orig;
+}
+#endif
+
+bool Events::is_ready(int fd) const {
+    return std::find(ready_fds.begin(), ready_fds.end(), fd) !=
+           ready_fds.end();
+}
+
+EventLoop::EventLoop() {
+#ifdef __linux__
+    timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd_ < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "EventLoop failed in timerfd_create()");
+    }
+
+    sigemptyset(&signal_set_);
+    signal_fd_ = signalfd(-1, &signal_set_, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd_ < 0) {
+        THROW_CERROR(std::runtime_error, "EventLoop failed in signalfd()");
+    }
+#else
+    int fds[2];
+    if (pipe(fds) < 0) {
+        THROW_CERROR(std::runtime_error, "EventLoop failed in pipe()");
+    }
+
+    for (auto fd : fds) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    signal_fd_ = fds[0];
+    signal_write_fd_ = fds[1];
+    SIGNAL_WRITE_FD = signal_write_fd_;
+#endif
+
+    poll_fds_.push_back(pollfd{signal_fd_, POLLIN, 0});
+#ifdef __linux__
+    poll_fds_.push_back(pollfd{timer_fd_, POLLIN, 0});
+#endif
+    num_own_fds_ = poll_fds_.size();
+}
+
+EventLoop::~EventLoop() {
+    // Watched signals stay blocked. We only go away when the program is about
+    // to exit, and unblocking could deliver a pending signal to a handler in
+    // the middle of unwinding.
+#ifdef __linux__
+    close(timer_fd_);
+#else
+    SIGNAL_WRITE_FD = -1;
+    close(signal_write_fd_);
+#endif
+    close(signal_fd_);
+}
+
+void EventLoop::watch_fd(int fd, short events) {
+    auto it = std::find_if(
+        poll_fds_.begin() + num_own_fds_, poll_fds_.end(),
+        [fd](const pollfd &pfd) { return pfd.fd == fd; });
+
+    if (it != poll_fds_.end()) {
+        it->events = events;
+        return;
+    }
+
+    poll_fds_.push_back(pollfd{fd, events, 0});
+}
+
+void EventLoop::unwatch_fd(int fd) {
+    poll_fds_.erase(std::remove_if(poll_fds_.begin() + num_own_fds_,
+                                   poll_fds_.end(),
+                                   [fd](const pollfd &pfd) {
+                                       return pfd.fd == fd;
+                                   }),
+                    poll_fds_.end());
+}
+
+void EventLoop::watch_signal(int signo) {
+#ifdef __linux__
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, signo);
+
+    // A blocked signal stays pending until the signalfd reads it
+    if (sigprocmask(SIG_BLOCK, &mask, nullptr) < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "EventLoop.watch_signal failed in sigprocmask()");
+    }
+
+    sigaddset(&signal_set_, signo);
+    if (signalfd(signal_fd_, &signal_set_, 0) < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "EventLoop.watch_signal failed in signalfd()");
+    }
+#else
+    struct sigaction action {};
+    action.sa_handler = EventLoop_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(signo, &action, nullptr) < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "EventLoop.watch_signal failed in sigaction()");
+    }
+#endif
+}
+
+void EventLoop::set_deadline(SteadyTimePoint deadline) {
+    // The timer is already set for it
+    if (deadline == deadline_) {
+        return;
+    }
+
+    deadline_ = deadline;
+
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC, so the deadline can be used as is as
+    // an absolute expiry time
+    auto since_epoch = deadline.time_since_epoch();
+    auto secs = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        since_epoch - secs);
+
+    itimerspec spec{};
+    spec.it_value.tv_sec = secs.count();
+    spec.it_value.tv_nsec = nanos.count();
+
+    // An all zero expiry would disarm the timer instead
+    if ((spec.it_value.tv_sec == 0) && (spec.it_value.tv_nsec == 0)) {
+        spec.it_value.tv_nsec = 1;
+    }
+
+    if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+        THROW_CERROR(std::runtime_error,
+                     "EventLoop.set_deadline failed in timerfd_settime()");
+    }
+#endif
+}
+
+void EventLoop::wait(Events *events) {
+    events->ready_fds.clear();
+    events->is_deadline_due = false;
+    events->signals.clear();
+    events->signals.swap(deferred_signals_);
+
+    int timeout = -1;
+#ifndef __linux__
+    // Round up, waking up early would only mean waiting again
+    if (deadline_ != SteadyTimePoint::max()) {
+        auto remaining =
+            std::chrono::ceil<Millis>(deadline_ - SteadyClock::now());
+        timeout = remaining.count() > 0 ? INT(remaining.count()) : 0;
+    }
+#endif
+
+    // The deferred signals are events already, only look for more
+    if (!events->signals.empty()) {
+        timeout = 0;
+    }
+
+    int rv = poll(poll_fds_.data(), poll_fds_.size(), timeout);
+    if (rv < 0) {
+        if (errno == EINTR) {
+            return;
+        }
+
+        THROW_CERROR(std::runtime_error, "EventLoop.wait failed in poll()");
+    }
+
+    if (poll_fds_[0].revents & POLLIN) {
+        read_signals(events);
+    }
+
+#ifdef __linux__
+    if (poll_fds_[1].revents & POLLIN) {
+        uint64_t num_expirations{0};
+        [[maybe_unused]] auto nread =
+            read(timer_fd_, &num_expirations, sizeof(num_expirations));
+    }
+#endif
+
+    for (auto i = num_own_fds_; i < poll_fds_.size(); ++i) {
+        const auto &pfd = poll_fds_[i];
+        if (pfd.revents & (pfd.events | POLLHUP | POLLERR)) {
+            events->ready_fds.push_back(poll_fds_[i].fd);
+        }
+    }
+
+    events->is_deadline_due = SteadyClock::now() >= deadline_;
+}
+
+void EventLoop::discard_signal(int signo) {
+    Events pending{};
+    read_signals(&pending);
+
+    for (auto pending_signo : pending.signals) {
+        if (pending_signo != signo) {
+            deferred_signals_.push_back(pending_signo);
+        }
+    }
+}
+
+void EventLoop::read_signals(Events *events) {
+#ifdef __linux__
+    signalfd_siginfo info{};
+    while (read(signal_fd_, &info, sizeof(info)) == sizeof(info)) {
+        events->signals.push_back(INT(info.ssi_signo));
+    }
+#else
+    unsigned char byte{0};
+    while (read(signal_fd_, &byte, 1) == 1) {
+        events->signals.push_back(INT(byte));
+    }
+#endif
+}
+
+} // namespace tools
+} // namespace bandwit
@@ -0,0 +1,80 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <csignal>
+#include <poll.h>
+#include <vector>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+
+namespace bandwit {
+namespace tools {
+
+struct Events {
+    bool is_ready(int fd) const;
+
+    // fds that have one of the events they are watched for, or are at EOF
+    std::vector<int> ready_fds{};
+    bool is_deadline_due{false};
+
+    // signal numbers, in the order they arrived
+    std::vector<int> signals{};
+};
+
+// Sleeps until something happens: input on one of the fds, a deadline
+// passing or a watched signal arriving. Watched signals are blocked and read
+// through the loop (a signalfd on Linux, a self-pipe elsewhere), so they are
+// handled in the main flow of the program rather than in a signal handler.
+// On Linux the deadline is a timerfd, elsewhere it is the poll timeout.
+class EventLoop {
+  public:
+    EventLoop();
+    ~EventLoop();
+
+    CLASS_DISABLE_COPIES(EventLoop)
+    CLASS_DISABLE_MOVES(EventLoop)
+
+    // Watching an fd that is already watched changes the events
+    void watch_fd(int fd, short events = POLLIN);
+    void unwatch_fd(int fd);
+    void watch_signal(int signo);
+    void set_deadline(SteadyTimePoint deadline);
+
+    // Blocks until there is at least one event, or an unrelated signal
+    // interrupts
+    void wait(Events *events);
+
+    // Drops signo if it arrived since the last wait, eg. while the last one
+    // was being handled. The other signals that arrived are kept for the
+    // next wait.
+    void discard_signal(int signo);
+
+  private:
+    void read_signals(Events *events);
+
+    SteadyTimePoint deadline_{SteadyTimePoint::max()};
+
+    // read by discard_signal, returned by the next wait
+    std::vector<int> deferred_signals_{};
+
+    // the fds of the loop itself come first, then the watched ones
+    std::vector<pollfd> poll_fds_{};
+    std::size_t num_own_fds_{0};
+
+    // readable when a watched signal is pending
+    int signal_fd_{-1};
+
+#ifdef __linux__
+    int timer_fd_{-1};
+    sigset_t signal_set_{};
+#else
+    // the write end of the self-pipe
+    int signal_write_fd_{-1};
+#endif
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // EVENT_LOOP_H
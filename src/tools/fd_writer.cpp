@@ -0,0 +1,61 @@
+#include <cerrno>
+#include <poll.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "except.hpp"
+#include "fd_writer.hpp"
+
+namespace bandwit {
+namespace tools {
+
+FdWriter::FdWriter(int fd) : fd_{fd} { buffer_.reserve(64 * 1024); }
+
+std::string *FdWriter::get_buffer() { return &buffer_; }
+
+bool FdWriter::flush() {
+    std::size_t written{0};
+
+    while (written < buffer_.size()) {
+        ssize_t rv =
+            write(fd_, buffer_.data() + written, buffer_.size() - written);
+
+        if (rv >= 0) {
+            written += SIZE_T(rv);
+            continue;
+        }
+
+        if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            wait_writable();
+            continue;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno == EPIPE) {
+            buffer_.clear();
+            return false;
+        }
+
+        THROW_CERROR(std::runtime_error, "FdWriter.flush failed in write()");
+    }
+
+    buffer_.clear();
+    return true;
+}
+
+void FdWriter::wait_writable() {
+    pollfd pfd{fd_, POLLOUT, 0};
+
+    while (poll(&pfd, 1, -1) < 0) {
+        if (errno != EINTR) {
+            THROW_CERROR(std::runtime_error,
+                         "FdWriter.wait_writable failed in poll()");
+        }
+    }
+}
+
+} // namespace tools
+} // namespace bandwit
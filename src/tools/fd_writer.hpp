@@ -0,0 +1,37 @@
+#ifndef FD_WRITER_H
+#define FD_WRITER_H
+
+#include <string>
+
+#include "macros.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// Collects output in a buffer and writes it to an fd in as few write(2)
+// calls as possible. Does not own the fd.
+class FdWriter {
+  public:
+    explicit FdWriter(int fd);
+
+    CLASS_DISABLE_COPIES(FdWriter)
+    CLASS_DISABLE_MOVES(FdWriter)
+
+    // append to this, then flush
+    std::string *get_buffer();
+
+    // Writes out everything buffered. Returns false if the reading end of a
+    // pipe went away.
+    bool flush();
+
+  private:
+    void wait_writable();
+
+    int fd_{-1};
+    std::string buffer_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // FD_WRITER_H
@@ -0,0 +1,146 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "aliases.hpp"
+#include "logger.hpp"
+
+namespace bandwit {
+
+void log_message(LogLevel level, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    tools::Logger::get().log(level, fmt, args);
+    va_end(args);
+}
+
+namespace tools {
+
+constexpr const char *LOG_PATH = "log";
+
+// how long a message waits in the ring at most before it is written out
+constexpr Millis WRITE_INTERVAL{100};
+
+constexpr std::array<const char *, 4> LEVEL_LABELS{
+    "DEBUG",
+    "INFO",
+    "WARN",
+    "ERROR",
+};
+
+Logger &Logger::get() {
+    static Logger logger{};
+    return logger;
+}
+
+Logger::Logger() {
+    fd_ = open(LOG_PATH, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+
+    // room for a full ring of short messages, it only grows past that if it
+    // ever has to
+    buffer_.reserve(RING_CAPACITY * 128);
+
+    thread_ = std::thread{&Logger::run, this};
+}
+
+Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        is_stopping_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+void Logger::log(LogLevel level, const char *fmt, va_list args) {
+    std::size_t ticket{0};
+    auto *record = ring_.claim(&ticket);
+    if (record == nullptr) {
+        num_dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    auto now = std::chrono::time_point_cast<Millis>(Clock::now());
+    record->time_ms = now.time_since_epoch().count();
+    record->level = level;
+    vsnprintf(record->text.data(), record->text.size(), fmt, args);
+
+    ring_.push(ticket);
+}
+
+void Logger::run() {
+    // Like the sampler thread, signals are for the thread with the event
+    // loop
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    while (true) {
+        bool is_stopping = stop_cv_.wait_for(lock, WRITE_INTERVAL,
+                                             [this] { return is_stopping_; });
+        lock.unlock();
+
+        // the last messages go out before the thread does
+        write_queued();
+        if (is_stopping) {
+            return;
+        }
+
+        lock.lock();
+    }
+}
+
+void Logger::write_queued() {
+    buffer_.clear();
+
+    // eg. "12:01:59.042 WARN sampler queue full"
+    char prefix[32];
+    for (const auto *record = ring_.front(); record != nullptr;
+         record = ring_.front()) {
+        auto secs = static_cast<time_t>(record->time_ms / 1000);
+        tm local{};
+        localtime_r(&secs, &local);
+
+        auto len = strftime(prefix, sizeof(prefix), "%H:%M:%S", &local);
+        snprintf(prefix + len, sizeof(prefix) - len, ".%03d %s ",
+                 INT(record->time_ms % 1000),
+                 LEVEL_LABELS[SIZE_T(record->level)]);
+
+        buffer_ += prefix;
+        buffer_ += record->text.data();
+        buffer_ += '\n';
+        ring_.pop();
+    }
+
+    auto num_dropped = num_dropped_.exchange(0, std::memory_order_relaxed);
+    if (num_dropped > 0) {
+        buffer_ += "dropped " + std::to_string(num_dropped) +
+                   " messages with the log full\n";
+    }
+
+    // Logging has nowhere to report its own errors, it gives up quietly
+    std::size_t written{0};
+    while ((fd_ >= 0) && (written < buffer_.size())) {
+        auto rv =
+            write(fd_, buffer_.data() + written, buffer_.size() - written);
+
+        if (rv >= 0) {
+            written += SIZE_T(rv);
+        } else if (errno != EINTR) {
+            break;
+        }
+    }
+}
+
+} // namespace tools
+} // namespace bandwit
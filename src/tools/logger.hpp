@@ -0,0 +1,74 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "logging.hpp"
+#include "macros.hpp"
+#include "tools/mpsc_ring.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// What is behind the LOG_* macros. Any thread formats its messages straight
+// into a slot of the ring, and a writer thread of its own wakes up every so
+// often to write all of the queued messages out with as few write(2)s as it
+// takes. Once the logger is destroyed, at exit, whatever is still queued is
+// written out.
+class Logger {
+  public:
+    // the one the macros log to, started on the first message
+    static Logger &get();
+
+    ~Logger();
+
+    CLASS_DISABLE_COPIES(Logger)
+    CLASS_DISABLE_MOVES(Logger)
+
+    void log(LogLevel level, const char *fmt, va_list args);
+
+  private:
+    // longer messages are cut short
+    static constexpr std::size_t MAX_MESSAGE_LEN = 240;
+    static constexpr std::size_t RING_CAPACITY = 1024;
+
+    struct Record {
+        int64_t time_ms{0};
+        LogLevel level{LogLevel::DEBUG};
+        std::array<char, MAX_MESSAGE_LEN> text{};
+    };
+
+    Logger();
+
+    void run();
+    // formats all the queued records into the buffer and writes it out
+    void write_queued();
+
+    // -1 if the file could not be opened, then everything is dropped
+    int fd_{-1};
+
+    MpscRing<Record, RING_CAPACITY> ring_{};
+    std::atomic<uint64_t> num_dropped_{0};
+
+    // Only the writer thread touches the buffer
+    std::string buffer_{};
+
+    // only guards is_stopping_, the messages go through the ring
+    std::mutex mutex_{};
+    std::condition_variable stop_cv_{};
+    bool is_stopping_{false};
+
+    std::thread thread_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // LOGGER_H
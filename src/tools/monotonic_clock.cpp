@@ -0,0 +1,27 @@
+#include "monotonic_clock.hpp"
+
+namespace bandwit {
+namespace tools {
+
+struct ClockAnchor {
+    SteadyTimePoint steady;
+    TimePoint wall;
+};
+
+static const ClockAnchor &get_anchor() {
+    // initialized on first use and never changed again
+    static const ClockAnchor anchor{SteadyClock::now(), Clock::now()};
+    return anchor;
+}
+
+TimePoint MonotonicClock::now() { return from_steady(SteadyClock::now()); }
+
+TimePoint MonotonicClock::from_steady(SteadyTimePoint stp) {
+    const auto &anchor = get_anchor();
+    auto since_anchor = stp - anchor.steady;
+    return anchor.wall +
+           std::chrono::duration_cast<Clock::duration>(since_anchor);
+}
+
+} // namespace tools
+} // namespace bandwit
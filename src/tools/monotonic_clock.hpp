@@ -0,0 +1,22 @@
+#ifndef MONOTONIC_CLOCK_H
+#define MONOTONIC_CLOCK_H
+
+#include "aliases.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// Produces wall clock time points that advance with the steady clock. The
+// wall clock is read only once, to anchor the steady clock to it, so the time
+// points never jump backwards or forwards when the system clock is stepped
+// (eg. by NTP) and the keys derived from them stay consistent.
+class MonotonicClock {
+  public:
+    static TimePoint now();
+    static TimePoint from_steady(SteadyTimePoint stp);
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // MONOTONIC_CLOCK_H
@@ -0,0 +1,102 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "macros.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// A bounded queue between any number of producer threads and one consumer
+// thread, without locks. Like the SpscRing the slots are filled and read in
+// place. Every slot has a sequence number that tells whose turn it is: a
+// producer claims a slot by moving the tail past it, and hands it over by
+// moving its sequence on, so a producer that is slow to fill its slot only
+// holds up the consumer, never the other producers. Capacity has to be a
+// power of two.
+template <typename T, std::size_t Capacity> class MpscRing {
+    static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0),
+                  "MpscRing capacity must be a power of two");
+
+  public:
+    MpscRing() {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    CLASS_DISABLE_COPIES(MpscRing)
+    CLASS_DISABLE_MOVES(MpscRing)
+
+    // Producer: claims a slot to fill in, or returns nullptr if the ring is
+    // full. The slot is only handed to the consumer by push() with the same
+    // ticket.
+    T *claim(std::size_t *ticket) {
+        auto pos = tail_.load(std::memory_order_relaxed);
+
+        while (true) {
+            auto &slot = slots_[pos & (Capacity - 1)];
+            auto seq = slot.seq.load(std::memory_order_acquire);
+
+            if (seq == pos) {
+                // free for this lap, unless another producer beats us to it
+                if (tail_.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+                    *ticket = pos;
+                    return &slot.value;
+                }
+            } else if (seq < pos) {
+                // the consumer has not got to it since the last lap
+                return nullptr;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Producer: publishes the slot returned by claim()
+    void push(std::size_t ticket) {
+        slots_[ticket & (Capacity - 1)].seq.store(ticket + 1,
+                                                  std::memory_order_release);
+    }
+
+    // Consumer: the oldest slot, or nullptr if the ring is empty or the
+    // oldest slot is still being filled in. The slot is only handed back to
+    // the producers by pop().
+    const T *front() const {
+        const auto &slot = slots_[head_ & (Capacity - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != head_ + 1) {
+            return nullptr;
+        }
+
+        return &slot.value;
+    }
+
+    // Consumer: releases the slot returned by front() for the next lap
+    void pop() {
+        slots_[head_ & (Capacity - 1)].seq.store(head_ + Capacity,
+                                                 std::memory_order_release);
+        ++head_;
+    }
+
+  private:
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    struct Slot {
+        std::atomic<std::size_t> seq{0};
+        T value{};
+    };
+
+    // the producers share tail_, only the consumer touches head_
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_{0};
+    alignas(CACHE_LINE_SIZE) std::size_t head_{0};
+    alignas(CACHE_LINE_SIZE) std::array<Slot, Capacity> slots_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // MPSC_RING_H
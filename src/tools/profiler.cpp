@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "macros.hpp"
+#include "profiler.hpp"
+
+namespace bandwit {
+namespace tools {
+
+constexpr std::array<const char *, NUM_STAGES> STAGE_LABELS{
+    "sample", "record", "slice", "scale", "draw", "format", "flush",
+};
+
+// Short enough for all of them to fit into one line
+constexpr std::array<const char *, NUM_STAGES> STAGE_SHORT_LABELS{
+    "smp", "rec", "slc", "scl", "drw", "fmt", "out",
+};
+
+// Values under 8 get a bucket each. Above that the bucket is the position of
+// the top bit and the two bits under it.
+static std::size_t get_bucket_idx(uint64_t value) {
+    if (value < 8) {
+        return SIZE_T(value);
+    }
+
+    auto shift = 61 - __builtin_clzll(value);
+    return SIZE_T(shift) * 4 + SIZE_T(value >> shift);
+}
+
+static uint64_t get_upper_bound(std::size_t idx) {
+    if (idx < 8) {
+        return idx;
+    }
+
+    auto shift = idx / 4 - 1;
+    auto top = uint64_t{idx - shift * 4};
+    return (top << shift) + ((uint64_t{1} << shift) - 1);
+}
+
+void Histogram::add(uint64_t value) {
+    counts_[get_bucket_idx(value)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t Histogram::get_count() const {
+    uint64_t count{0};
+    for (const auto &bucket_count : counts_) {
+        count += bucket_count.load(std::memory_order_relaxed);
+    }
+
+    return count;
+}
+
+uint64_t Histogram::get_percentile(double percentile) const {
+    auto count = get_count();
+    if (count == 0) {
+        return 0;
+    }
+
+    // the rank of the value, counting from 1
+    auto rank = std::max(
+        uint64_t{1}, static_cast<uint64_t>(std::ceil(F64(count) * percentile /
+                                                     100.0)));
+
+    uint64_t seen{0};
+    for (std::size_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+        seen += counts_[idx].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return get_upper_bound(idx);
+        }
+    }
+
+    // counts were added while we were looking
+    return get_upper_bound(NUM_BUCKETS - 1);
+}
+
+void Profiler::add(Stage stage, SteadyClock::duration elapsed) {
+    auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+    stages_[SIZE_T(stage)].add(U64(std::max(nanos.count(), int64_t{0})));
+}
+
+void Profiler::add_flushed_bytes(std::size_t num_bytes) {
+    flushed_bytes_.add(U64(num_bytes));
+}
+
+// In whole microseconds, with a decimal under one
+static void append_micros(std::string *out, uint64_t nanos) {
+    char buf[32];
+    if (nanos < 1000) {
+        snprintf(buf, sizeof(buf), "%.1f", F64(nanos) / 1000.0);
+    } else {
+        snprintf(buf, sizeof(buf), "%llu",
+                 static_cast<unsigned long long>(nanos / 1000));
+    }
+
+    *out += buf;
+}
+
+std::string Profiler::get_summary() const {
+    // eg. "us smp 12/40 rec 0.8/2 ... out 35/90 1.2kb"
+    std::string summary{"us"};
+
+    for (std::size_t i = 0; i < NUM_STAGES; ++i) {
+        summary += ' ';
+        summary += STAGE_SHORT_LABELS[i];
+        summary += ' ';
+        append_micros(&summary, stages_[i].get_percentile(50));
+        summary += '/';
+        append_micros(&summary, stages_[i].get_percentile(99));
+    }
+
+    char buf[32];
+    auto num_bytes = flushed_bytes_.get_percentile(50);
+    if (num_bytes < 1024) {
+        snprintf(buf, sizeof(buf), " %llub",
+                 static_cast<unsigned long long>(num_bytes));
+    } else {
+        snprintf(buf, sizeof(buf), " %.1fkb", F64(num_bytes) / 1024.0);
+    }
+    summary += buf;
+
+    return summary;
+}
+
+static void put_row(std::ostream &out, const char *label,
+                    const Histogram &hist, double divisor) {
+    char line[128];
+    snprintf(line, sizeof(line), "%-8s %10llu %10.1f %10.1f %10.1f %10.1f\n",
+             label, static_cast<unsigned long long>(hist.get_count()),
+             F64(hist.get_percentile(50)) / divisor,
+             F64(hist.get_percentile(90)) / divisor,
+             F64(hist.get_percentile(99)) / divisor,
+             F64(hist.get_percentile(99.9)) / divisor);
+    out << line;
+}
+
+void Profiler::dump(std::ostream &out) const {
+    out << "stage         count        p50        p90        p99      p99.9\n";
+
+    // in microseconds
+    for (std::size_t i = 0; i < NUM_STAGES; ++i) {
+        put_row(out, STAGE_LABELS[i], stages_[i], 1000.0);
+    }
+
+    // per flush
+    put_row(out, "bytes", flushed_bytes_, 1.0);
+}
+
+StageTimer::StageTimer(Profiler *profiler, Stage stage)
+    : profiler_{profiler}, stage_{stage} {
+    if (profiler_ != nullptr) {
+        start_ = SteadyClock::now();
+    }
+}
+
+StageTimer::~StageTimer() {
+    if (profiler_ != nullptr) {
+        profiler_->add(stage_, SteadyClock::now() - start_);
+    }
+}
+
+} // namespace tools
+} // namespace bandwit
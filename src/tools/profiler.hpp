@@ -0,0 +1,102 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "aliases.hpp"
+#include "macros.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// Counts values into buckets of fixed bounds, four to every power of two, so
+// a percentile comes out within 25% of the true one. Adding a value is a
+// couple of instructions and it never allocates. The counts are atomic, so
+// one thread can add while another reads.
+class Histogram {
+  public:
+    void add(uint64_t value);
+
+    uint64_t get_count() const;
+
+    // The upper bound of the bucket that has the percentile in it, 0 if
+    // nothing was added
+    uint64_t get_percentile(double percentile) const;
+
+  private:
+    // enough for every uint64_t
+    static constexpr std::size_t NUM_BUCKETS = 252;
+
+    std::array<std::atomic<uint64_t>, NUM_BUCKETS> counts_{};
+};
+
+// The stages that every sample and every frame go through
+enum class Stage {
+    // reading and parsing the counters, which the samplers do in one pass
+    SAMPLE,
+    // recording the deltas into the time series, or receiving them from a
+    // daemon
+    RECORD,
+    SLICE,
+    // working out bar heights from the slice values
+    SCALE,
+    // putting the bars into the back buffer
+    DRAW,
+    // formatting the axes, the title and the menu into the back buffer
+    FORMAT,
+    // diffing the back buffer and writing the changes to the terminal
+    FLUSH,
+};
+
+constexpr std::size_t NUM_STAGES = 7;
+
+// A latency histogram of every stage, in nanoseconds, and one of the bytes
+// written to the terminal per flush
+class Profiler {
+  public:
+    Profiler() = default;
+
+    CLASS_DISABLE_COPIES(Profiler)
+    CLASS_DISABLE_MOVES(Profiler)
+
+    void add(Stage stage, SteadyClock::duration elapsed);
+    void add_flushed_bytes(std::size_t num_bytes);
+
+    // p50/p99 of every stage and the p50 of the bytes per flush, to fit
+    // into a line of the terminal
+    std::string get_summary() const;
+
+    // the count, p50, p90, p99 and p99.9 of every stage in microseconds
+    // and of the bytes per flush, a line each
+    void dump(std::ostream &out) const;
+
+  private:
+    std::array<Histogram, NUM_STAGES> stages_{};
+    Histogram flushed_bytes_{};
+};
+
+// Adds the time from its construction to its destruction to a stage of the
+// profiler, if there is one
+class StageTimer {
+  public:
+    StageTimer(Profiler *profiler, Stage stage);
+    ~StageTimer();
+
+    CLASS_DISABLE_COPIES(StageTimer)
+    CLASS_DISABLE_MOVES(StageTimer)
+
+  private:
+    Profiler *profiler_{nullptr};
+    Stage stage_{};
+    SteadyTimePoint start_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // PROFILER_H
@@ -0,0 +1,33 @@
+#include <chrono>
+
+#include "replay_clock.hpp"
+
+namespace bandwit {
+namespace tools {
+
+ReplayClock::ReplayClock(TimePoint start, double speed,
+                         SteadyTimePoint steady_start)
+    : start_{start}, speed_{speed}, steady_start_{steady_start} {}
+
+TimePoint ReplayClock::now(SteadyTimePoint stp) const {
+    if (speed_ == 0) {
+        return TimePoint::max();
+    }
+
+    auto elapsed = std::chrono::duration<double>(stp - steady_start_);
+    return start_ + std::chrono::duration_cast<TimePoint::duration>(
+                        elapsed * speed_);
+}
+
+SteadyTimePoint ReplayClock::get_steady(TimePoint tp) const {
+    if (speed_ == 0) {
+        return steady_start_;
+    }
+
+    auto recorded = std::chrono::duration<double>(tp - start_);
+    return steady_start_ + std::chrono::duration_cast<SteadyClock::duration>(
+                               recorded / speed_);
+}
+
+} // namespace tools
+} // namespace bandwit
@@ -0,0 +1,32 @@
+#ifndef REPLAY_CLOCK_H
+#define REPLAY_CLOCK_H
+
+#include "aliases.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// The time in a recording that is being replayed, which starts at the start
+// of the recording when the replay starts and then runs speed times as fast
+// as the steady clock, whatever the wall clock says. With a speed of 0 the
+// replay runs as fast as it can, every recorded time is due straight away.
+class ReplayClock {
+  public:
+    ReplayClock(TimePoint start, double speed, SteadyTimePoint steady_start);
+
+    // the recorded time that is due at stp
+    TimePoint now(SteadyTimePoint stp) const;
+
+    // when the recorded time tp is due
+    SteadyTimePoint get_steady(TimePoint tp) const;
+
+  private:
+    TimePoint start_{};
+    double speed_{0};
+    SteadyTimePoint steady_start_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // REPLAY_CLOCK_H
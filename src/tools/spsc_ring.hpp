@@ -0,0 +1,77 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+#include "macros.hpp"
+
+namespace bandwit {
+namespace tools {
+
+// A bounded queue between exactly one producer thread and one consumer
+// thread, without locks. The slots are filled and read in place, so a T that
+// holds a buffer, eg. a vector, keeps its capacity from one lap to the next
+// and nothing is allocated once it is warmed up. Capacity has to be a power
+// of two.
+template <typename T, std::size_t Capacity> class SpscRing {
+    static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0),
+                  "SpscRing capacity must be a power of two");
+
+  public:
+    SpscRing() = default;
+
+    CLASS_DISABLE_COPIES(SpscRing)
+    CLASS_DISABLE_MOVES(SpscRing)
+
+    // Producer: the slot to fill in, or nullptr if the ring is full. The slot
+    // is only handed to the consumer by push().
+    T *get_push_slot() {
+        auto tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return nullptr;
+        }
+
+        return &slots_[tail & (Capacity - 1)];
+    }
+
+    // Producer: publishes the slot returned by get_push_slot()
+    void push() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    // Consumer: the oldest slot, or nullptr if the ring is empty. The slot is
+    // only handed back to the producer by pop().
+    const T *front() const {
+        auto head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        return &slots_[head & (Capacity - 1)];
+    }
+
+    // Consumer: releases the slot returned by front()
+    void pop() {
+        head_.store(head_.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+  private:
+    // Kept apart so that the two threads do not bounce a cache line between
+    // them with every push and pop
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    // the producer writes tail_, the consumer writes head_, both only ever
+    // grow and are wrapped into the slots on use
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> head_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> tail_{0};
+    alignas(CACHE_LINE_SIZE) std::array<T, Capacity> slots_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // SPSC_RING_H
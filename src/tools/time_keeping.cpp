@@ -1,30 +1,152 @@
+#include <cstdio>
+
 #include "time_keeping.hpp"
 
 namespace bandwit {
 namespace tools {
 
-int TimeKeeping::get_wday(TimePoint tp) {
-    std::time_t tt = Clock::to_time_t(tp);
-    tm local_tm = *localtime(&tt);
-    return local_tm.tm_wday;
-}
+constexpr std::time_t SECS_PER_HOUR = 3600;
+constexpr std::time_t SECS_PER_DAY = 24 * SECS_PER_HOUR;
+
+// 1970-01-01 was a Thursday
+constexpr std::time_t EPOCH_WDAY = 4;
 
-int TimeKeeping::get_hours(TimePoint tp) {
+LocalTime TimeKeeping::get_local_time(TimePoint tp) {
     std::time_t tt = Clock::to_time_t(tp);
-    tm local_tm = *localtime(&tt);
-    return local_tm.tm_hour;
+    std::time_t local = tt + get_utc_offset(tt);
+
+    // Floor division, so that times before the epoch work too
+    std::time_t days = local / SECS_PER_DAY;
+    if ((local % SECS_PER_DAY) < 0) {
+        --days;
+    }
+
+    auto secs_of_day = static_cast<int>(local - days * SECS_PER_DAY);
+    auto wday = static_cast<int>((days + EPOCH_WDAY) % 7);
+
+    return LocalTime{
+        wday < 0 ? wday + 7 : wday,
+        secs_of_day / 3600,
+        (secs_of_day / 60) % 60,
+        secs_of_day % 60,
+    };
 }
 
+int TimeKeeping::get_wday(TimePoint tp) { return get_local_time(tp).wday; }
+
+int TimeKeeping::get_hours(TimePoint tp) { return get_local_time(tp).hours; }
+
 int TimeKeeping::get_minutes(TimePoint tp) {
-    std::time_t tt = Clock::to_time_t(tp);
-    tm local_tm = *localtime(&tt);
-    return local_tm.tm_min;
+    return get_local_time(tp).minutes;
 }
 
 int TimeKeeping::get_seconds(TimePoint tp) {
-    std::time_t tt = Clock::to_time_t(tp);
-    tm local_tm = *localtime(&tt);
-    return local_tm.tm_sec;
+    return get_local_time(tp).seconds;
+}
+
+std::optional<TimePoint> TimeKeeping::parse_local_time(const std::string &text,
+                                                      TimePoint now) {
+    std::time_t now_tt = Clock::to_time_t(now);
+    tm local_tm{};
+    localtime_r(&now_tt, &local_tm);
+
+    int year{0};
+    int month{0};
+    int mday{0};
+    int hours{0};
+    int minutes{0};
+    int seconds{0};
+    int len{-1};
+
+    // %n is only reached if everything before it matched, and has to be at
+    // the end of the text so that nothing is left over
+    auto text_len = static_cast<int>(text.size());
+    auto matches = [&len, text_len] { return len == text_len; };
+    bool has_date = true;
+
+    sscanf(text.c_str(), "%d-%d-%d %d:%d:%d%n", &year, &month, &mday, &hours,
+           &minutes, &seconds, &len);
+    if (!matches()) {
+        seconds = 0;
+        sscanf(text.c_str(), "%d-%d-%d %d:%d%n", &year, &month, &mday, &hours,
+               &minutes, &len);
+    }
+    if (!matches()) {
+        has_date = false;
+        sscanf(text.c_str(), "%d:%d:%d%n", &hours, &minutes, &seconds, &len);
+    }
+    if (!matches()) {
+        seconds = 0;
+        sscanf(text.c_str(), "%d:%d%n", &hours, &minutes, &len);
+    }
+    if (!matches() || (hours < 0) || (hours > 23) || (minutes < 0) ||
+        (minutes > 59) || (seconds < 0) || (seconds > 59)) {
+        return std::nullopt;
+    }
+
+    if (has_date) {
+        if ((month < 1) || (month > 12) || (mday < 1) || (mday > 31)) {
+            return std::nullopt;
+        }
+
+        local_tm.tm_year = year - 1900;
+        local_tm.tm_mon = month - 1;
+        local_tm.tm_mday = mday;
+    }
+
+    local_tm.tm_hour = hours;
+    local_tm.tm_min = minutes;
+    local_tm.tm_sec = seconds;
+    // let mktime work out whether DST was in effect
+    local_tm.tm_isdst = -1;
+
+    tm parsed_tm = local_tm;
+    std::time_t tt = mktime(&parsed_tm);
+
+    // A time of day later than now is meant as yesterday's
+    if (!has_date && (tt > now_tt)) {
+        parsed_tm = local_tm;
+        --parsed_tm.tm_mday;
+        tt = mktime(&parsed_tm);
+    }
+
+    if (tt == -1) {
+        return std::nullopt;
+    }
+
+    return Clock::from_time_t(tt);
+}
+
+long TimeKeeping::lookup_utc_offset(std::time_t tt) {
+    tm local_tm{};
+    localtime_r(&tt, &local_tm);
+    return local_tm.tm_gmtoff;
+}
+
+long TimeKeeping::get_utc_offset(std::time_t tt) {
+    std::lock_guard<std::mutex> lock{mutex_};
+
+    if ((tt >= offset_from_) && (tt < offset_until_)) {
+        return utc_offset_;
+    }
+
+    std::time_t hour_from = tt - (tt % SECS_PER_HOUR);
+    if ((tt % SECS_PER_HOUR) < 0) {
+        hour_from -= SECS_PER_HOUR;
+    }
+    std::time_t hour_until = hour_from + SECS_PER_HOUR;
+
+    // The offset is the same over the whole hour if it is the same at both
+    // ends, offsets do not change twice in an hour
+    long offset = lookup_utc_offset(tt);
+    if ((lookup_utc_offset(hour_from) == offset) &&
+        (lookup_utc_offset(hour_until - 1) == offset)) {
+        offset_from_ = hour_from;
+        offset_until_ = hour_until;
+        utc_offset_ = offset;
+    }
+
+    return offset;
 }
 
 } // namespace tools
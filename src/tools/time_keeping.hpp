@@ -1,17 +1,52 @@
 #ifndef TIME_KEEPING_H
 #define TIME_KEEPING_H
 
+#include <ctime>
+#include <mutex>
+#include <optional>
+#include <string>
+
 #include "aliases.hpp"
 
 namespace bandwit {
 namespace tools {
 
+// The fields of a local time that the axes are labelled with
+struct LocalTime {
+    int wday;
+    int hours;
+    int minutes;
+    int seconds;
+};
+
+// Converts to local time by adding the UTC offset, which is only looked up
+// in the timezone database once per hour. An hour that contains a change of
+// offset, eg. a DST transition, is not cached and every second in it is
+// looked up. Safe to share between threads.
 class TimeKeeping {
   public:
+    LocalTime get_local_time(TimePoint tp);
+
     int get_wday(TimePoint tp);
     int get_hours(TimePoint tp);
     int get_minutes(TimePoint tp);
     int get_seconds(TimePoint tp);
+
+    // Parses a local time typed in as [YYYY-MM-DD ]HH:MM[:SS]. Without a date
+    // it is the latest such time that is not after now.
+    static std::optional<TimePoint> parse_local_time(const std::string &text,
+                                                     TimePoint now);
+
+  private:
+    static long lookup_utc_offset(std::time_t tt);
+    long get_utc_offset(std::time_t tt);
+
+    std::mutex mutex_{};
+
+    // the offset over [offset_from_, offset_until_)
+    std::time_t offset_from_{0};
+    std::time_t offset_until_{0};
+    long utc_offset_{0};
 };
 
 } // namespace tools
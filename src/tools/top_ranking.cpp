@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <utility>
+
+#include "top_ranking.hpp"
+
+namespace bandwit {
+namespace tools {
+
+TopRanking::TopRanking(std::size_t num_items, std::size_t max_ranked)
+    : max_ranked_{max_ranked}, values_(num_items), slots_(num_items) {
+    // Every value is 0 to begin with, which ranks the lowest items first
+    for (std::size_t item = 0; item < num_items; ++item) {
+        push(false, item);
+    }
+
+    rebalance();
+}
+
+void TopRanking::update(std::size_t item, uint64_t value) {
+    if (values_[item] == value) {
+        return;
+    }
+
+    values_[item] = value;
+
+    auto slot = slots_[item];
+    sift_up(slot.is_ranked, slot.pos);
+    sift_down(slot.is_ranked, slots_[item].pos);
+
+    rebalance();
+}
+
+uint64_t TopRanking::get_value(std::size_t item) const {
+    return values_[item];
+}
+
+std::size_t TopRanking::get_num_items() const { return values_.size(); }
+
+std::size_t TopRanking::get_max_ranked() const { return max_ranked_; }
+
+void TopRanking::set_max_ranked(std::size_t max_ranked) {
+    max_ranked_ = max_ranked;
+    rebalance();
+}
+
+void TopRanking::get_ranked(std::vector<std::size_t> *items) const {
+    items->assign(ranked_.begin(), ranked_.end());
+    std::sort(items->begin(), items->end(),
+              [this](std::size_t a, std::size_t b) { return is_higher(a, b); });
+}
+
+bool TopRanking::is_higher(std::size_t item, std::size_t other) const {
+    if (values_[item] != values_[other]) {
+        return values_[item] > values_[other];
+    }
+
+    return item < other;
+}
+
+bool TopRanking::is_above(bool is_ranked, std::size_t a, std::size_t b) const {
+    // the lowest of the ranked on top, the highest of the others
+    return is_ranked ? is_higher(b, a) : is_higher(a, b);
+}
+
+std::vector<std::size_t> &TopRanking::get_heap(bool is_ranked) {
+    return is_ranked ? ranked_ : others_;
+}
+
+void TopRanking::place(bool is_ranked, std::size_t pos, std::size_t item) {
+    get_heap(is_ranked)[pos] = item;
+    slots_[item] = Slot{is_ranked, pos};
+}
+
+void TopRanking::push(bool is_ranked, std::size_t item) {
+    auto &heap = get_heap(is_ranked);
+    heap.push_back(item);
+    slots_[item] = Slot{is_ranked, heap.size() - 1};
+    sift_up(is_ranked, heap.size() - 1);
+}
+
+std::size_t TopRanking::pop(bool is_ranked) {
+    auto &heap = get_heap(is_ranked);
+    auto top = heap.front();
+
+    place(is_ranked, 0, heap.back());
+    heap.pop_back();
+    if (!heap.empty()) {
+        sift_down(is_ranked, 0);
+    }
+
+    return top;
+}
+
+void TopRanking::sift_up(bool is_ranked, std::size_t pos) {
+    auto &heap = get_heap(is_ranked);
+    auto item = heap[pos];
+
+    while (pos > 0) {
+        auto parent = (pos - 1) / 2;
+        if (!is_above(is_ranked, item, heap[parent])) {
+            break;
+        }
+
+        place(is_ranked, pos, heap[parent]);
+        pos = parent;
+    }
+
+    place(is_ranked, pos, item);
+}
+
+void TopRanking::sift_down(bool is_ranked, std::size_t pos) {
+    auto &heap = get_heap(is_ranked);
+    auto item = heap[pos];
+
+    while (true) {
+        auto child = 2 * pos + 1;
+        if (child >= heap.size()) {
+            break;
+        }
+
+        if ((child + 1 < heap.size()) &&
+            is_above(is_ranked, heap[child + 1], heap[child])) {
+            ++child;
+        }
+
+        if (!is_above(is_ranked, heap[child], item)) {
+            break;
+        }
+
+        place(is_ranked, pos, heap[child]);
+        pos = child;
+    }
+
+    place(is_ranked, pos, item);
+}
+
+void TopRanking::rebalance() {
+    while ((ranked_.size() < max_ranked_) && !others_.empty()) {
+        push(true, pop(false));
+    }
+
+    while (ranked_.size() > max_ranked_) {
+        push(false, pop(true));
+    }
+
+    // After a single update one trade is all it takes
+    while (!ranked_.empty() && !others_.empty() &&
+           is_higher(others_.front(), ranked_.front())) {
+        auto lowest = ranked_.front();
+        auto highest = others_.front();
+
+        place(true, 0, highest);
+        place(false, 0, lowest);
+        sift_down(true, 0);
+        sift_down(false, 0);
+    }
+}
+
+} // namespace tools
+} // namespace bandwit
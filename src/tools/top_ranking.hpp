@@ -0,0 +1,66 @@
+#ifndef TOP_RANKING_H
+#define TOP_RANKING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bandwit {
+namespace tools {
+
+// The items with the highest values out of a fixed set of items whose values
+// keep changing, kept up to date one update at a time rather than by sorting
+// all of the items. The ranked items are in a min-heap, with the lowest of
+// them on top, and the others in a max-heap, with the highest of them on
+// top. An update fixes up the heap the item is in, and if the highest of the
+// others then beats the lowest ranked item the two trade places, which is
+// O(log n), and reading out the ranking only sorts the ranked items. Equal
+// values rank the lower item first.
+class TopRanking {
+  public:
+    // All the values start out as 0
+    TopRanking(std::size_t num_items, std::size_t max_ranked);
+
+    void update(std::size_t item, uint64_t value);
+    uint64_t get_value(std::size_t item) const;
+
+    std::size_t get_num_items() const;
+    std::size_t get_max_ranked() const;
+    void set_max_ranked(std::size_t max_ranked);
+
+    // The ranked items, the highest value first
+    void get_ranked(std::vector<std::size_t> *items) const;
+
+  private:
+    // where an item is in the heaps
+    struct Slot {
+        bool is_ranked{false};
+        std::size_t pos{0};
+    };
+
+    bool is_higher(std::size_t item, std::size_t other) const;
+    // whether a belongs above b in the heap
+    bool is_above(bool is_ranked, std::size_t a, std::size_t b) const;
+
+    std::vector<std::size_t> &get_heap(bool is_ranked);
+    void place(bool is_ranked, std::size_t pos, std::size_t item);
+    void push(bool is_ranked, std::size_t item);
+    std::size_t pop(bool is_ranked);
+    void sift_up(bool is_ranked, std::size_t pos);
+    void sift_down(bool is_ranked, std::size_t pos);
+
+    // Moves items across until there are max_ranked_ ranked ones, or all
+    // of them, and all of those are higher than all the others
+    void rebalance();
+
+    std::size_t max_ranked_{0};
+    std::vector<uint64_t> values_{};
+    std::vector<Slot> slots_{};
+    std::vector<std::size_t> ranked_{};
+    std::vector<std::size_t> others_{};
+};
+
+} // namespace tools
+} // namespace bandwit
+
+#endif // TOP_RANKING_H